@@ -0,0 +1,1008 @@
+/*! \file    BTree.hpp
+ *  \brief   Ordered set and map containers implemented as B+ trees.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ *
+ * BinaryTree uses one node per key, so every level of a search is a cache miss. A B+ tree
+ * keeps many keys in each node, in a contiguous array that is searched with one or two cache
+ * line loads. All items are kept in the leaves; the inner nodes only hold separator keys that
+ * guide a search. The leaves are linked in both directions so iteration never climbs the tree.
+ *
+ * The NodeBytes template parameter sets the approximate size of a node. The default of 256
+ * bytes (four cache lines) works well for small keys held in memory; larger values such as
+ * 4096 make the trees shallower at the cost of moving more data when a node is updated.
+ *
+ * Keys (and the mapped values of a BTreeMap) must be default constructible and nothrow
+ * movable, since each node holds arrays of them. Inserting or erasing an item may move other
+ * items between nodes, so it invalidates all iterators. Erased items are moved from but not
+ * destroyed until their node is reused or freed.
+ */
+
+#ifndef BTREE_HPP
+#define BTREE_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace spica {
+
+    namespace detail {
+
+        // The mapped type of a B+ tree that implements a set.
+        struct btree_no_value { };
+
+        // Lets operator-> return a pointer to a reference proxy.
+        template<typename Reference>
+        struct btree_arrow {
+            Reference reference;
+            Reference *operator->( ) { return &reference; }
+        };
+
+        //
+        // The B+ tree shared by BTreeSet and BTreeMap. V is btree_no_value for sets. Each inner
+        // node with n keys has n + 1 children. Every key in children[i] is less than keys[i],
+        // and every key in children[i + 1] is not less than keys[i].
+        //
+        template<typename K, typename V, typename Compare, std::size_t NodeBytes>
+        class btree {
+        public:
+            typedef K              key_type;
+            typedef Compare        key_compare;
+            typedef std::size_t    size_type;
+            typedef std::ptrdiff_t difference_type;
+
+            static constexpr bool is_map = !std::is_same_v<V, btree_no_value>;
+
+        protected:
+            static constexpr std::size_t value_bytes = is_map ? sizeof( V ) : 0;
+
+            // The space taken by the links in a leaf node, the largest node overhead.
+            static constexpr std::size_t header_bytes = 3 * sizeof( void * );
+
+            static_assert( NodeBytes >= header_bytes, "NodeBytes is too small for the node links" );
+
+            // The space left for the arrays. Zero for a NodeBytes that fails the assertion
+            // above, so that the capacities below don't wrap around and fail another one.
+            static constexpr std::size_t array_bytes =
+                ( NodeBytes >= header_bytes ) ? NodeBytes - header_bytes : 0;
+
+            //! Number of items in a leaf node.
+            static constexpr std::size_t leaf_capacity = std::max< std::size_t >(
+                4, array_bytes / ( sizeof( K ) + value_bytes ) );
+
+            //! Number of keys in an inner node.
+            static constexpr std::size_t inner_capacity = std::max< std::size_t >(
+                4, ( array_bytes + sizeof( void * ) ) / ( sizeof( K ) + sizeof( void * ) ) );
+
+            // Nodes other than the root are merged or refilled when they fall below these.
+            static constexpr std::size_t leaf_minimum  = leaf_capacity / 2;
+            static constexpr std::size_t inner_minimum = ( inner_capacity - 1 ) / 2;
+
+            // Enough levels for any tree that fits in memory.
+            static constexpr int maximum_depth = 64;
+
+            static_assert( leaf_capacity < 65536 && inner_capacity < 65536,
+                           "NodeBytes is too large for the key type" );
+
+            typedef std::conditional_t< is_map, std::array< V, leaf_capacity >, btree_no_value > value_array;
+
+            struct node {
+                bool          is_leaf;
+                std::uint16_t count;     // Number of keys.
+
+                explicit node( bool leaf ) : is_leaf( leaf ), count( 0 ) { }
+            };
+
+            struct leaf_node : node {
+                leaf_node *previous;
+                leaf_node *next;
+                K          keys[leaf_capacity];
+                [[no_unique_address]] value_array values;
+
+                leaf_node( ) : node( true ), previous( nullptr ), next( nullptr ) { }
+            };
+
+            struct inner_node : node {
+                K     keys[inner_capacity];
+                node *children[inner_capacity + 1];
+
+                inner_node( ) : node( false ) { }
+            };
+
+            // A step in the path from the root to a leaf.
+            struct path_entry {
+                inner_node *parent;
+                int         index;   // Which child of parent the path goes through.
+            };
+
+            node      *root;
+            leaf_node *first_leaf;
+            leaf_node *last_leaf;
+            size_type  item_count;
+            [[no_unique_address]] Compare comp;
+
+        public:
+            //! B+ tree iterators are bidirectional iterators.
+            /*!
+             * An iterator is a leaf and a position in it. Decrementing end( ) gives the last
+             * item.
+             */
+            template<bool is_const>
+            class basic_iterator {
+
+                friend class btree;
+
+            public:
+                typedef std::bidirectional_iterator_tag iterator_category;
+                typedef std::ptrdiff_t difference_type;
+                typedef std::conditional_t< is_map, std::pair< const K, V >, K > value_type;
+                typedef std::conditional_t< is_map,
+                    std::pair< const K &, std::conditional_t< is_const, const V &, V & > >,
+                    const K & > reference;
+                typedef std::conditional_t< is_map, btree_arrow< reference >, const K * > pointer;
+
+                basic_iterator( ) : tree( nullptr ), leaf( nullptr ), index( 0 ) { }
+
+                // Allows iterator to convert to const_iterator.
+                template<bool other_const>
+                    requires( is_const && !other_const )
+                basic_iterator( const basic_iterator<other_const> &other ) :
+                    tree( other.tree ), leaf( other.leaf ), index( other.index ) { }
+
+                reference operator*( ) const
+                {
+                    if constexpr( is_map ) return reference( leaf->keys[index], leaf->values[index] );
+                    else return leaf->keys[index];
+                }
+
+                pointer operator->( ) const
+                {
+                    if constexpr( is_map ) return pointer{ **this };
+                    else return &leaf->keys[index];
+                }
+
+                basic_iterator &operator++( )
+                {
+                    if( ++index == leaf->count ) {
+                        leaf  = leaf->next;
+                        index = 0;
+                    }
+                    return *this;
+                }
+
+                basic_iterator operator++( int )
+                {
+                    basic_iterator old( *this );
+                    ++*this;
+                    return old;
+                }
+
+                basic_iterator &operator--( )
+                {
+                    if( leaf == nullptr ) {
+                        leaf  = tree->last_leaf;
+                        index = leaf->count;
+                    }
+                    else if( index == 0 ) {
+                        leaf  = leaf->previous;
+                        index = leaf->count;
+                    }
+                    --index;
+                    return *this;
+                }
+
+                basic_iterator operator--( int )
+                {
+                    basic_iterator old( *this );
+                    --*this;
+                    return old;
+                }
+
+                bool operator==( const basic_iterator &other ) const
+                    { return leaf == other.leaf && index == other.index; }
+
+            private:
+                template<bool> friend class basic_iterator;
+
+                basic_iterator( const btree *t, leaf_node *l, int i ) :
+                    tree( t ), leaf( l ), index( i ) { }
+
+                const btree *tree;
+                leaf_node   *leaf;
+                int          index;
+            };
+
+            btree( const Compare &c = Compare( ) ) :
+                root( nullptr ), first_leaf( nullptr ), last_leaf( nullptr ), item_count( 0 ), comp( c )
+                { }
+
+           ~btree( ) { clear( ); }
+
+            //! Returns the number of items.
+            size_type size( ) const { return item_count; }
+
+            //! Returns true if there are no items.
+            bool empty( ) const { return item_count == 0; }
+
+            //! Returns the comparison object.
+            key_compare key_comp( ) const { return comp; }
+
+            //! Returns true if the key is present.
+            bool contains( const K &key ) const
+            {
+                leaf_node *leaf;
+                int index;
+                return locate( key, leaf, index );
+            }
+
+            //! Removes the item with the given key. Returns the number of items removed.
+            size_type erase( const K &key );
+
+            //! Removes all items.
+            void clear( );
+
+        protected:
+            typedef basic_iterator<false> mutable_iterator;
+            typedef basic_iterator<true>  constant_iterator;
+
+            // Iterators for a leaf position, moving past the end of a leaf to the next one.
+            template<bool is_const>
+            basic_iterator<is_const> make_iterator( leaf_node *leaf, int index ) const
+            {
+                if( leaf != nullptr && index == leaf->count ) {
+                    leaf  = leaf->next;
+                    index = 0;
+                }
+                return basic_iterator<is_const>( this, leaf, index );
+            }
+
+            template<bool is_const>
+            basic_iterator<is_const> first( ) const
+                { return basic_iterator<is_const>( this, first_leaf, 0 ); }
+
+            template<bool is_const>
+            basic_iterator<is_const> past_end( ) const
+                { return basic_iterator<is_const>( this, nullptr, 0 ); }
+
+            // Searches for the key. Returns true if it is found. Otherwise leaf and index give
+            // the position of the first larger key (index might equal the leaf's count).
+            bool locate( const K &key, leaf_node *&leaf, int &index ) const;
+
+            // Position of the first key that is not less than (lower) or greater than (upper)
+            // the given key.
+            template<bool is_const>
+            basic_iterator<is_const> bound( const K &key, bool upper ) const;
+
+            // Inserts the key if it is not present, with a mapped value constructed from the
+            // arguments. Returns the position of the key and whether it was inserted.
+            template<typename... Args>
+            std::pair<mutable_iterator, bool> insert_unique( const K &key, Args &&... args );
+
+            // Replaces the contents with a sorted range of keys (for sets) or pairs (for maps).
+            template<typename InputIterator>
+            void load_sorted( InputIterator first, InputIterator last );
+
+        private:
+            // Inhibit copying.
+            btree( const btree & );
+            btree &operator=( const btree & );
+
+            static std::size_t minimum( const node *n )
+                { return n->is_leaf ? leaf_minimum : inner_minimum; }
+
+            // Index of the child to search for the key.
+            int child_index( const inner_node *n, const K &key ) const
+                { return static_cast<int>( std::upper_bound( n->keys, n->keys + n->count, key, comp ) - n->keys ); }
+
+            // Index of the first key in the leaf not less than the given key.
+            int leaf_index( const leaf_node *n, const K &key ) const
+                { return static_cast<int>( std::lower_bound( n->keys, n->keys + n->count, key, comp ) - n->keys ); }
+
+            // Finds the leaf that should hold the key, recording the path. Returns the depth.
+            int descend( const K &key, path_entry *path, leaf_node *&leaf ) const;
+
+            // Moves items [first, last) of one leaf to position destination of another leaf.
+            static void move_items( leaf_node *from, int first, int last, leaf_node *to, int destination );
+
+            // Opens a gap at index in a leaf or closes the gap at index.
+            static void open_gap( leaf_node *n, int index );
+            static void close_gap( leaf_node *n, int index );
+
+            void add_to_parents( path_entry *path, int depth, K separator, node *right );
+            void rebalance( node *n, path_entry *path, int depth );
+            void borrow_from_left( inner_node *parent, int index );
+            void borrow_from_right( inner_node *parent, int index );
+            void merge_children( inner_node *parent, int index );
+
+            static void free_node( node *n );
+            static void free_subtree( node *n );
+        };
+
+
+        // =====
+        // Private Methods
+        // =====
+
+        template<typename K, typename V, typename Compare, std::size_t NodeBytes>
+        void btree<K, V, Compare, NodeBytes>::free_node( node *n )
+        {
+            if( n->is_leaf ) delete static_cast<leaf_node *>( n );
+            else delete static_cast<inner_node *>( n );
+        }
+
+
+        //
+        // free_subtree
+        //
+        // The recursion is as deep as the tree, which is never more than a few levels.
+        //
+        template<typename K, typename V, typename Compare, std::size_t NodeBytes>
+        void btree<K, V, Compare, NodeBytes>::free_subtree( node *n )
+        {
+            if( !n->is_leaf ) {
+                inner_node *inner = static_cast<inner_node *>( n );
+                for( int i = 0; i <= inner->count; ++i ) free_subtree( inner->children[i] );
+            }
+            free_node( n );
+        }
+
+
+        template<typename K, typename V, typename Compare, std::size_t NodeBytes>
+        int btree<K, V, Compare, NodeBytes>::descend(
+            const K &key, path_entry *path, leaf_node *&leaf ) const
+        {
+            int depth = 0;
+            node *n = root;
+            while( !n->is_leaf ) {
+                inner_node *inner = static_cast<inner_node *>( n );
+                int index = child_index( inner, key );
+                path[depth++] = path_entry{ inner, index };
+                n = inner->children[index];
+            }
+            leaf = static_cast<leaf_node *>( n );
+            return depth;
+        }
+
+
+        template<typename K, typename V, typename Compare, std::size_t NodeBytes>
+        bool btree<K, V, Compare, NodeBytes>::locate( const K &key, leaf_node *&leaf, int &index ) const
+        {
+            leaf  = nullptr;
+            index = 0;
+            if( root == nullptr ) return false;
+
+            node *n = root;
+            while( !n->is_leaf ) {
+                inner_node *inner = static_cast<inner_node *>( n );
+                n = inner->children[child_index( inner, key )];
+            }
+            leaf  = static_cast<leaf_node *>( n );
+            index = leaf_index( leaf, key );
+            return index < leaf->count && !comp( key, leaf->keys[index] );
+        }
+
+
+        template<typename K, typename V, typename Compare, std::size_t NodeBytes>
+        void btree<K, V, Compare, NodeBytes>::move_items(
+            leaf_node *from, int first, int last, leaf_node *to, int destination )
+        {
+            std::move( from->keys + first, from->keys + last, to->keys + destination );
+            if constexpr( is_map ) {
+                std::move( from->values.begin( ) + first,
+                           from->values.begin( ) + last,
+                           to->values.begin( ) + destination );
+            }
+        }
+
+
+        template<typename K, typename V, typename Compare, std::size_t NodeBytes>
+        void btree<K, V, Compare, NodeBytes>::open_gap( leaf_node *n, int index )
+        {
+            std::move_backward( n->keys + index, n->keys + n->count, n->keys + n->count + 1 );
+            if constexpr( is_map ) {
+                std::move_backward( n->values.begin( ) + index,
+                                    n->values.begin( ) + n->count,
+                                    n->values.begin( ) + n->count + 1 );
+            }
+        }
+
+
+        template<typename K, typename V, typename Compare, std::size_t NodeBytes>
+        void btree<K, V, Compare, NodeBytes>::close_gap( leaf_node *n, int index )
+        {
+            move_items( n, index + 1, n->count, n, index );
+        }
+
+
+        //
+        // add_to_parents
+        //
+        // A node on the path has been split and right is its new right sibling. The separator
+        // and the new node are added to the parent, which might be split in turn. If the root
+        // is split the tree gets a new root.
+        //
+        template<typename K, typename V, typename Compare, std::size_t NodeBytes>
+        void btree<K, V, Compare, NodeBytes>::add_to_parents(
+            path_entry *path, int depth, K separator, node *right )
+        {
+            for( int level = depth - 1; level >= 0; --level ) {
+                inner_node *parent = path[level].parent;
+                int index = path[level].index;
+
+                if( parent->count < inner_capacity ) {
+                    std::move_backward( parent->keys + index,
+                                        parent->keys + parent->count,
+                                        parent->keys + parent->count + 1 );
+                    std::move_backward( parent->children + index + 1,
+                                        parent->children + parent->count + 1,
+                                        parent->children + parent->count + 2 );
+                    parent->keys[index] = std::move( separator );
+                    parent->children[index + 1] = right;
+                    ++parent->count;
+                    return;
+                }
+
+                // Build the overfull node in temporary arrays and divide it in two. The middle
+                // key moves up to the next level.
+                std::array< K, inner_capacity + 1 > keys;
+                std::array< node *, inner_capacity + 2 > children;
+                std::move( parent->keys, parent->keys + index, keys.begin( ) );
+                keys[index] = std::move( separator );
+                std::move( parent->keys + index, parent->keys + inner_capacity, keys.begin( ) + index + 1 );
+                std::copy( parent->children, parent->children + index + 1, children.begin( ) );
+                children[index + 1] = right;
+                std::copy( parent->children + index + 1,
+                           parent->children + inner_capacity + 1,
+                           children.begin( ) + index + 2 );
+
+                const int middle = static_cast<int>( ( inner_capacity + 1 ) / 2 );
+                const int total  = static_cast<int>( inner_capacity + 1 );
+                inner_node *sibling = new inner_node;
+                std::move( keys.begin( ), keys.begin( ) + middle, parent->keys );
+                std::copy( children.begin( ), children.begin( ) + middle + 1, parent->children );
+                parent->count = static_cast<std::uint16_t>( middle );
+                std::move( keys.begin( ) + middle + 1, keys.end( ), sibling->keys );
+                std::copy( children.begin( ) + middle + 1, children.end( ), sibling->children );
+                sibling->count = static_cast<std::uint16_t>( total - middle - 1 );
+
+                separator = std::move( keys[middle] );
+                right = sibling;
+            }
+
+            inner_node *new_root = new inner_node;
+            new_root->keys[0] = std::move( separator );
+            new_root->children[0] = root;
+            new_root->children[1] = right;
+            new_root->count = 1;
+            root = new_root;
+        }
+
+
+        //
+        // borrow_from_left
+        //
+        // Moves one item from the left sibling of parent->children[index] into it. For inner
+        // nodes the item rotates through the parent.
+        //
+        template<typename K, typename V, typename Compare, std::size_t NodeBytes>
+        void btree<K, V, Compare, NodeBytes>::borrow_from_left( inner_node *parent, int index )
+        {
+            node *n = parent->children[index];
+            node *left = parent->children[index - 1];
+
+            if( n->is_leaf ) {
+                leaf_node *leaf = static_cast<leaf_node *>( n );
+                leaf_node *sibling = static_cast<leaf_node *>( left );
+                open_gap( leaf, 0 );
+                move_items( sibling, sibling->count - 1, sibling->count, leaf, 0 );
+                --sibling->count;
+                ++leaf->count;
+                parent->keys[index - 1] = leaf->keys[0];
+            }
+            else {
+                inner_node *inner = static_cast<inner_node *>( n );
+                inner_node *sibling = static_cast<inner_node *>( left );
+                std::move_backward( inner->keys, inner->keys + inner->count, inner->keys + inner->count + 1 );
+                std::move_backward( inner->children,
+                                    inner->children + inner->count + 1,
+                                    inner->children + inner->count + 2 );
+                inner->keys[0] = std::move( parent->keys[index - 1] );
+                inner->children[0] = sibling->children[sibling->count];
+                parent->keys[index - 1] = std::move( sibling->keys[sibling->count - 1] );
+                --sibling->count;
+                ++inner->count;
+            }
+        }
+
+
+        template<typename K, typename V, typename Compare, std::size_t NodeBytes>
+        void btree<K, V, Compare, NodeBytes>::borrow_from_right( inner_node *parent, int index )
+        {
+            node *n = parent->children[index];
+            node *right = parent->children[index + 1];
+
+            if( n->is_leaf ) {
+                leaf_node *leaf = static_cast<leaf_node *>( n );
+                leaf_node *sibling = static_cast<leaf_node *>( right );
+                move_items( sibling, 0, 1, leaf, leaf->count );
+                ++leaf->count;
+                close_gap( sibling, 0 );
+                --sibling->count;
+                parent->keys[index] = sibling->keys[0];
+            }
+            else {
+                inner_node *inner = static_cast<inner_node *>( n );
+                inner_node *sibling = static_cast<inner_node *>( right );
+                inner->keys[inner->count] = std::move( parent->keys[index] );
+                inner->children[inner->count + 1] = sibling->children[0];
+                ++inner->count;
+                parent->keys[index] = std::move( sibling->keys[0] );
+                std::move( sibling->keys + 1, sibling->keys + sibling->count, sibling->keys );
+                std::copy( sibling->children + 1, sibling->children + sibling->count + 1, sibling->children );
+                --sibling->count;
+            }
+        }
+
+
+        //
+        // merge_children
+        //
+        // Moves everything in parent->children[index + 1] into parent->children[index] and
+        // removes the right node and its separator from the parent.
+        //
+        template<typename K, typename V, typename Compare, std::size_t NodeBytes>
+        void btree<K, V, Compare, NodeBytes>::merge_children( inner_node *parent, int index )
+        {
+            node *left  = parent->children[index];
+            node *right = parent->children[index + 1];
+
+            if( left->is_leaf ) {
+                leaf_node *l = static_cast<leaf_node *>( left );
+                leaf_node *r = static_cast<leaf_node *>( right );
+                move_items( r, 0, r->count, l, l->count );
+                l->count += r->count;
+                l->next = r->next;
+                if( r->next != nullptr ) r->next->previous = l; else last_leaf = l;
+            }
+            else {
+                inner_node *l = static_cast<inner_node *>( left );
+                inner_node *r = static_cast<inner_node *>( right );
+                l->keys[l->count] = std::move( parent->keys[index] );
+                std::move( r->keys, r->keys + r->count, l->keys + l->count + 1 );
+                std::copy( r->children, r->children + r->count + 1, l->children + l->count + 1 );
+                l->count += r->count + 1;
+            }
+            free_node( right );
+
+            std::move( parent->keys + index + 1, parent->keys + parent->count, parent->keys + index );
+            std::copy( parent->children + index + 2,
+                       parent->children + parent->count + 1,
+                       parent->children + index + 1 );
+            --parent->count;
+        }
+
+
+        //
+        // rebalance
+        //
+        // Called after an item is removed from a leaf. A node that has fallen below its minimum
+        // takes an item from a sibling if one can spare it; otherwise it is merged with a
+        // sibling, which removes a key from the parent and might leave the parent too small.
+        // The tree gets shorter when the root is left with a single child.
+        //
+        template<typename K, typename V, typename Compare, std::size_t NodeBytes>
+        void btree<K, V, Compare, NodeBytes>::rebalance( node *n, path_entry *path, int depth )
+        {
+            for( int level = depth - 1; level >= 0; --level ) {
+                if( n->count >= minimum( n ) ) return;
+
+                inner_node *parent = path[level].parent;
+                int index = path[level].index;
+                node *left  = ( index > 0 ) ? parent->children[index - 1] : nullptr;
+                node *right = ( index < parent->count ) ? parent->children[index + 1] : nullptr;
+
+                if( left != nullptr && left->count > minimum( left ) ) {
+                    borrow_from_left( parent, index );
+                    return;
+                }
+                if( right != nullptr && right->count > minimum( right ) ) {
+                    borrow_from_right( parent, index );
+                    return;
+                }
+                if( left != nullptr ) merge_children( parent, index - 1 );
+                else merge_children( parent, index );
+                n = parent;
+            }
+
+            if( !root->is_leaf && root->count == 0 ) {
+                node *old_root = root;
+                root = static_cast<inner_node *>( root )->children[0];
+                free_node( old_root );
+            }
+            else if( root->is_leaf && root->count == 0 ) {
+                free_node( root );
+                root = nullptr;
+                first_leaf = nullptr;
+                last_leaf  = nullptr;
+            }
+        }
+
+
+        // =====
+        // Public and Protected Methods
+        // =====
+
+        template<typename K, typename V, typename Compare, std::size_t NodeBytes>
+        void btree<K, V, Compare, NodeBytes>::clear( )
+        {
+            if( root != nullptr ) free_subtree( root );
+            root = nullptr;
+            first_leaf = nullptr;
+            last_leaf  = nullptr;
+            item_count = 0;
+        }
+
+
+        template<typename K, typename V, typename Compare, std::size_t NodeBytes>
+        template<bool is_const>
+        typename btree<K, V, Compare, NodeBytes>::template basic_iterator<is_const>
+            btree<K, V, Compare, NodeBytes>::bound( const K &key, bool upper ) const
+        {
+            leaf_node *leaf;
+            int index;
+            bool found = locate( key, leaf, index );
+            if( found && upper ) ++index;
+            return make_iterator<is_const>( leaf, index );
+        }
+
+
+        //
+        // insert_unique
+        //
+        // A full leaf is split in half, except that when the key goes after the last item in
+        // the tree the new leaf holds only the new key. Keys that arrive in ascending order
+        // therefore leave full leaves behind them.
+        //
+        template<typename K, typename V, typename Compare, std::size_t NodeBytes>
+        template<typename... Args>
+        std::pair<typename btree<K, V, Compare, NodeBytes>::mutable_iterator, bool>
+            btree<K, V, Compare, NodeBytes>::insert_unique( const K &key, Args &&... args )
+        {
+            if( root == nullptr ) {
+                leaf_node *leaf = new leaf_node;
+                root = first_leaf = last_leaf = leaf;
+            }
+
+            path_entry path[maximum_depth];
+            leaf_node *leaf;
+            int depth = descend( key, path, leaf );
+            int index = leaf_index( leaf, key );
+            if( index < leaf->count && !comp( key, leaf->keys[index] ) ) {
+                return std::make_pair( mutable_iterator( this, leaf, index ), false );
+            }
+
+            // Construct the new item before changing anything in case construction throws.
+            K new_key( key );
+            [[maybe_unused]] std::conditional_t< is_map, V, btree_no_value > new_value{ std::forward<Args>( args )... };
+
+            leaf_node *target = leaf;
+            int target_index = index;
+            if( leaf->count == leaf_capacity ) {
+                const int capacity = static_cast<int>( leaf_capacity );
+                int split = ( index == capacity && leaf->next == nullptr ) ? capacity : ( capacity + 1 ) / 2;
+                leaf_node *right = new leaf_node;
+
+                if( index < split ) {
+                    move_items( leaf, split - 1, capacity, right, 0 );
+                    right->count = static_cast<std::uint16_t>( capacity - split + 1 );
+                    leaf->count  = static_cast<std::uint16_t>( split - 1 );
+                }
+                else {
+                    move_items( leaf, split, capacity, right, 0 );
+                    right->count = static_cast<std::uint16_t>( capacity - split );
+                    leaf->count  = static_cast<std::uint16_t>( split );
+                    target = right;
+                    target_index = index - split;
+                }
+
+                right->previous = leaf;
+                right->next = leaf->next;
+                if( leaf->next != nullptr ) leaf->next->previous = right; else last_leaf = right;
+                leaf->next = right;
+
+                // The separator is the first key in the right leaf after the insertion.
+                K separator = ( target == right && target_index == 0 ) ? new_key : right->keys[0];
+                add_to_parents( path, depth, std::move( separator ), right );
+            }
+
+            open_gap( target, target_index );
+            target->keys[target_index] = std::move( new_key );
+            if constexpr( is_map ) target->values[target_index] = std::move( new_value );
+            ++target->count;
+            ++item_count;
+            return std::make_pair( mutable_iterator( this, target, target_index ), true );
+        }
+
+
+        template<typename K, typename V, typename Compare, std::size_t NodeBytes>
+        typename btree<K, V, Compare, NodeBytes>::size_type
+            btree<K, V, Compare, NodeBytes>::erase( const K &key )
+        {
+            if( root == nullptr ) return 0;
+
+            path_entry path[maximum_depth];
+            leaf_node *leaf;
+            int depth = descend( key, path, leaf );
+            int index = leaf_index( leaf, key );
+            if( index == leaf->count || comp( key, leaf->keys[index] ) ) return 0;
+
+            close_gap( leaf, index );
+            --leaf->count;
+            --item_count;
+            rebalance( leaf, path, depth );
+            return 1;
+        }
+
+
+        //
+        // load_sorted
+        //
+        // The leaves are filled completely from left to right. The last leaf is then topped up
+        // from its neighbor if it is too small. Each level of inner nodes is built from the
+        // level below with the children divided evenly among the nodes. This takes O(n) time.
+        //
+        template<typename K, typename V, typename Compare, std::size_t NodeBytes>
+        template<typename InputIterator>
+        void btree<K, V, Compare, NodeBytes>::load_sorted( InputIterator first, InputIterator last )
+        {
+            clear( );
+
+            std::vector< std::pair< K, node * > > level;  // First key of each node and the node.
+            std::vector< inner_node * > inner_nodes;      // Only used to clean up after an error.
+            try {
+                leaf_node *leaf = nullptr;
+                for( ; first != last; ++first ) {
+                    const K *key;
+                    if constexpr( is_map ) key = &( *first ).first; else key = &*first;
+
+                    if( leaf != nullptr ) {
+                        const K &previous = leaf->keys[leaf->count - 1];
+                        if( !comp( previous, *key ) ) {
+                            if( comp( *key, previous ) )
+                                throw std::invalid_argument( "btree: bulk load range is not sorted" );
+                            continue;  // Duplicate.
+                        }
+                    }
+                    if( leaf == nullptr || leaf->count == leaf_capacity ) {
+                        leaf_node *fresh = new leaf_node;
+                        fresh->previous = leaf;
+                        if( leaf != nullptr ) leaf->next = fresh; else first_leaf = fresh;
+                        leaf = fresh;
+                        last_leaf = leaf;
+                        level.push_back( std::make_pair( *key, leaf ) );
+                    }
+                    leaf->keys[leaf->count] = *key;
+                    if constexpr( is_map ) leaf->values[leaf->count] = ( *first ).second;
+                    ++leaf->count;
+                    ++item_count;
+                }
+                if( leaf == nullptr ) return;
+
+                if( leaf->count < leaf_minimum && leaf->previous != nullptr ) {
+                    leaf_node *previous = leaf->previous;
+                    int needed = static_cast<int>( leaf_minimum - leaf->count );
+                    std::move_backward( leaf->keys, leaf->keys + leaf->count, leaf->keys + leaf->count + needed );
+                    if constexpr( is_map ) {
+                        std::move_backward( leaf->values.begin( ),
+                                            leaf->values.begin( ) + leaf->count,
+                                            leaf->values.begin( ) + leaf->count + needed );
+                    }
+                    move_items( previous, previous->count - needed, previous->count, leaf, 0 );
+                    previous->count -= needed;
+                    leaf->count += needed;
+                    level.back( ).first = leaf->keys[0];
+                }
+
+                while( level.size( ) > 1 ) {
+                    std::size_t children = level.size( );
+                    std::size_t nodes = ( children + inner_capacity ) / ( inner_capacity + 1 );
+                    std::vector< std::pair< K, node * > > next_level;
+                    next_level.reserve( nodes );
+                    std::size_t position = 0;
+                    for( std::size_t i = 0; i < nodes; ++i ) {
+                        std::size_t size = children / nodes + ( i < children % nodes ? 1 : 0 );
+                        inner_node *inner = new inner_node;
+                        inner_nodes.push_back( inner );
+                        inner->children[0] = level[position].second;
+                        for( std::size_t j = 1; j < size; ++j ) {
+                            inner->keys[j - 1] = level[position + j].first;
+                            inner->children[j] = level[position + j].second;
+                        }
+                        inner->count = static_cast<std::uint16_t>( size - 1 );
+                        next_level.push_back( std::make_pair( level[position].first, inner ) );
+                        position += size;
+                    }
+                    level.swap( next_level );
+                }
+                root = level[0].second;
+            }
+            catch( ... ) {
+                for( inner_node *inner : inner_nodes ) delete inner;
+                while( first_leaf != nullptr ) {
+                    leaf_node *next = first_leaf->next;
+                    delete first_leaf;
+                    first_leaf = next;
+                }
+                last_leaf  = nullptr;
+                item_count = 0;
+                throw;
+            }
+        }
+
+    }
+
+
+    //! Ordered set implemented as a B+ tree.
+    /*!
+     * BTreeSet provides the same operations as BinaryTree. It also provides lower_bound and
+     * upper_bound for range scans and a bulk load from a sorted range.
+     */
+    template<typename T, typename Compare = std::less<T>, std::size_t NodeBytes = 256>
+    class BTreeSet : public detail::btree< T, detail::btree_no_value, Compare, NodeBytes > {
+        typedef detail::btree< T, detail::btree_no_value, Compare, NodeBytes > base;
+
+    public:
+        typedef T                value_type;
+        typedef const T         &reference;
+        typedef const T         &const_reference;
+        typedef Compare          value_compare;
+        typedef typename base::constant_iterator iterator;
+        typedef typename base::constant_iterator const_iterator;
+
+        //! Creates an empty set.
+        BTreeSet( const Compare &c = Compare( ) ) : base( c ) { }
+
+        //! Creates a set from a sorted range in O(n) time. See bulk_load( ).
+        template<typename InputIterator>
+        BTreeSet( InputIterator first, InputIterator last, const Compare &c = Compare( ) ) : base( c )
+            { this->load_sorted( first, last ); }
+
+        //! Returns an iterator that points at the first item in the set.
+        iterator begin( ) const { return this->template first<true>( ); }
+
+        //! Returns an iterator that points just past the last item in the set.
+        iterator end( ) const { return this->template past_end<true>( ); }
+
+        //! Inserts an item. The bool is false if an equivalent item was already present.
+        std::pair<iterator, bool> insert( const T &item )
+        {
+            std::pair<typename base::mutable_iterator, bool> result = this->insert_unique( item );
+            return std::make_pair( iterator( result.first ), result.second );
+        }
+
+        //! Locates an item in the set.
+        iterator find( const T &item ) const
+        {
+            typename base::leaf_node *leaf;
+            int index;
+            if( !this->locate( item, leaf, index ) ) return end( );
+            return this->template make_iterator<true>( leaf, index );
+        }
+
+        //! Returns the first item not less than the given item.
+        iterator lower_bound( const T &item ) const { return this->template bound<true>( item, false ); }
+
+        //! Returns the first item greater than the given item.
+        iterator upper_bound( const T &item ) const { return this->template bound<true>( item, true ); }
+
+        using base::erase;
+
+        //! Erases the item at the specified location.
+        void erase( iterator it ) { base::erase( *it ); }
+
+        //! Replaces the contents with the items in a sorted range in O(n) time.
+        /*!
+         * Duplicates in the range are skipped. If the range is not sorted
+         * std::invalid_argument is thrown and the set is left empty.
+         */
+        template<typename InputIterator>
+        void bulk_load( InputIterator first, InputIterator last )
+            { this->load_sorted( first, last ); }
+    };
+
+
+    //! Ordered map implemented as a B+ tree.
+    /*!
+     * The keys and the mapped values are kept in separate arrays in each leaf so that searching
+     * a leaf only touches keys. As a result the iterators do not refer to std::pair objects.
+     * Dereferencing an iterator gives a pair of references, std::pair< const K &, V & >, that
+     * supports it->first, it->second, and structured bindings.
+     */
+    template<typename K, typename V, typename Compare = std::less<K>, std::size_t NodeBytes = 256>
+    class BTreeMap : public detail::btree< K, V, Compare, NodeBytes > {
+        typedef detail::btree< K, V, Compare, NodeBytes > base;
+
+    public:
+        typedef V                       mapped_type;
+        typedef std::pair< const K, V > value_type;
+        typedef typename base::mutable_iterator  iterator;
+        typedef typename base::constant_iterator const_iterator;
+
+        //! Creates an empty map.
+        BTreeMap( const Compare &c = Compare( ) ) : base( c ) { }
+
+        //! Creates a map from a range of pairs sorted by key in O(n) time. See bulk_load( ).
+        template<typename InputIterator>
+        BTreeMap( InputIterator first, InputIterator last, const Compare &c = Compare( ) ) : base( c )
+            { this->load_sorted( first, last ); }
+
+        iterator       begin( )        { return this->template first<false>( ); }
+        const_iterator begin( ) const  { return this->template first<true>( ); }
+        iterator       end( )          { return this->template past_end<false>( ); }
+        const_iterator end( ) const    { return this->template past_end<true>( ); }
+
+        //! Inserts a key and value. The bool is false if the key was already present.
+        std::pair<iterator, bool> insert( const value_type &item )
+            { return this->insert_unique( item.first, item.second ); }
+
+        //! Inserts a key and a value constructed from args if the key is not present.
+        template<typename... Args>
+        std::pair<iterator, bool> try_emplace( const K &key, Args &&... args )
+            { return this->insert_unique( key, std::forward<Args>( args )... ); }
+
+        //! Inserts the key and value or assigns the value if the key is present.
+        std::pair<iterator, bool> insert_or_assign( const K &key, const V &value )
+        {
+            std::pair<iterator, bool> result = this->insert_unique( key, value );
+            if( !result.second ) result.first->second = value;
+            return result;
+        }
+
+        //! Returns the value for the key, inserting a default constructed value if necessary.
+        V &operator[]( const K &key ) { return this->insert_unique( key ).first->second; }
+
+        //! Locates a key in the map.
+        iterator find( const K &key )
+        {
+            typename base::leaf_node *leaf;
+            int index;
+            if( !this->locate( key, leaf, index ) ) return end( );
+            return this->template make_iterator<false>( leaf, index );
+        }
+
+        const_iterator find( const K &key ) const
+            { return const_cast<BTreeMap *>( this )->find( key ); }
+
+        //! Returns the first item with a key not less than the given key.
+        iterator       lower_bound( const K &key )       { return this->template bound<false>( key, false ); }
+        const_iterator lower_bound( const K &key ) const { return this->template bound<true>( key, false ); }
+
+        //! Returns the first item with a key greater than the given key.
+        iterator       upper_bound( const K &key )       { return this->template bound<false>( key, true ); }
+        const_iterator upper_bound( const K &key ) const { return this->template bound<true>( key, true ); }
+
+        using base::erase;
+
+        //! Erases the item at the specified location.
+        void erase( const_iterator it ) { base::erase( it->first ); }
+
+        //! Replaces the contents with a range of pairs sorted by key in O(n) time.
+        /*!
+         * Items with duplicate keys are skipped. If the range is not sorted
+         * std::invalid_argument is thrown and the map is left empty.
+         */
+        template<typename InputIterator>
+        void bulk_load( InputIterator first, InputIterator last )
+            { this->load_sorted( first, last ); }
+    };
+
+}
+
+#endif
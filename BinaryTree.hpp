@@ -4,8 +4,6 @@
  *
  * TODO: Consider the following items...
  *
- * + Implement a test program! This is a priority, especially for a template!
- * + Implement operator--() for iterators.
  * + Implement reverse iterators.
  * + Implement the copy constructor and operator=()
  */
@@ -16,19 +14,45 @@
 #include <algorithm>
 #include <functional>
 #include <iterator>
+#include <memory>
+#include <type_traits>
 #include <utility>
 
 namespace spica {
 
+    //! How a BinaryTree keeps itself balanced.
+    enum class tree_balance {
+        none,       //!< Plain binary search tree. Sorted input makes it a linked list.
+        red_black,  //!< Red-black tree. Height at most 2 lg(n + 1).
+        avl         //!< AVL tree. Height at most 1.44 lg(n + 2); faster lookups, slower updates.
+    };
+
+    // Lets the tests check the balance of a tree. It is only defined by the tests.
+    template<typename Tree> struct tree_invariants;
+
     //! Binary tree class template.
     /*!
-     * This template provides a binary search tree with no extra code for balancing. Thus if the
-     * tree becomes unbalanced it will not perform very well. On the other hand it has lower
-     * overhead than, for example, a red-black tree.
+     * This template provides a binary search tree. By default it is a red-black tree so that
+     * insert, find, and erase take O(lg(n)) time whatever order the items arrive in. An AVL
+     * tree, which is more rigidly balanced, can be selected instead. With tree_balance::none
+     * there is no extra code for balancing. Thus if the tree becomes unbalanced it will not
+     * perform very well. On the other hand it has lower overhead.
      *
      * This template provides all the usual operations (or at least, that is the intent).
+     * Erasing an item only invalidates iterators to that item.
+     *
+     * Each node records the size of its subtree. This costs one word per node but lets nth( ),
+     * rank( ), and count_range( ) answer order statistic queries in O(lg(n)) time rather than
+     * walking the items with an iterator.
+     *
+     * Nodes are obtained from an allocator of type Allocator rebound to the node type. With a
+     * PoolAllocator the nodes are packed into large chunks and clear( ) releases the chunks
+     * without visiting the nodes (if the items have trivial destructors).
      */
-    template<typename T, typename StrictWeakOrdering = std::less<T>>
+    template<typename T,
+             typename StrictWeakOrdering = std::less<T>,
+             typename Allocator = std::allocator<T>,
+             tree_balance Balance = tree_balance::red_black>
     class BinaryTree {
 
     public:
@@ -39,34 +63,67 @@ namespace spica {
         typedef const T  &const_reference;
         typedef std::size_t    size_type;
         typedef std::ptrdiff_t difference_type;
+        typedef Allocator      allocator_type;
 
     private:
+        template<typename Tree> friend struct tree_invariants;
+
         struct TreeNode {
             T         data;
             TreeNode *parent;
             TreeNode *left;
             TreeNode *right;
+            size_type size;       // Number of nodes in the subtree rooted here.
+            signed char balance;  // Color (red-black) or height (AVL). Unused otherwise.
 
             TreeNode( const T &d, TreeNode *p, TreeNode *l, TreeNode *r ) :
-                data( d ), parent( p ), left( l ), right( r ) { }
+                data( d ), parent( p ), left( l ), right( r ), size( 1 ), balance( 0 ) { }
         }; // End of nested TreeNode structure.
 
+        typedef typename std::allocator_traits<Allocator>::template rebind_alloc<TreeNode> node_allocator;
+        typedef std::allocator_traits<node_allocator> node_traits;
+
+        // Red-black colors. Empty subtrees are black.
+        static const signed char red   = 0;
+        static const signed char black = 1;
+
         // Private members of tree.
         TreeNode  *root;   // Points at root of tree or NULL if tree empty.
         size_type  count;  // Number of nodes in the tree.
         StrictWeakOrdering comp;   // Comparison object.
+        [[no_unique_address]] node_allocator node_alloc;
 
         // Private methods.
         void       kill_subtree( TreeNode * );
+        void       free_node( TreeNode * );
         const TreeNode *minimum_node( TreeNode * ) const;  // Given node non-null.
         const TreeNode *maximum_node( TreeNode * ) const;  // Given node non-null.
 
+        // Order statistic support.
+        static size_type subtree_size( const TreeNode *n ) { return n == nullptr ? 0 : n->size; }
+        static void update_size( TreeNode *n )
+            { n->size = 1 + subtree_size( n->left ) + subtree_size( n->right ); }
+        static void adjust_sizes( TreeNode *n, int delta );
+
+        // Balancing support.
+        static bool is_red( const TreeNode *n ) { return n != nullptr && n->balance == red; }
+        static int  height( const TreeNode *n ) { return n == nullptr ? 0 : n->balance; }
+        static void update_height( TreeNode *n )
+            { n->balance = static_cast<signed char>( 1 + std::max( height( n->left ), height( n->right ) ) ); }
+
+        void replace_child( TreeNode *parent, TreeNode *old_child, TreeNode *new_child );
+        void rotate_left( TreeNode * );
+        void rotate_right( TreeNode * );
+        void red_black_insert_fixup( TreeNode * );
+        void red_black_erase_fixup( TreeNode *child, TreeNode *parent );
+        void avl_rebalance( TreeNode * );
+
     public:
 
         //! Tree iterators class.
         /*!
          * Tree iterators are bidirectional iterators and support all the usual bidirectional
-         * operations (at least that is the intent).
+         * operations (at least that is the intent). Decrementing end( ) gives the last item.
          */
         class iterator {
 
@@ -118,8 +175,9 @@ namespace spica {
         friend class iterator;
 
         //! Default constructors.
-        BinaryTree( StrictWeakOrdering c = StrictWeakOrdering( ) )
-            : root( nullptr ), count( 0 ), comp( c )
+        BinaryTree( StrictWeakOrdering c = StrictWeakOrdering( ),
+                    const Allocator &allocator = Allocator( ) )
+            : root( nullptr ), count( 0 ), comp( c ), node_alloc( allocator )
             { }
 
         // For now don't bother with copying. Save that for version 2.0!
@@ -138,12 +196,37 @@ namespace spica {
         //! Returns the number of items in the tree.
         size_type size( ) const { return count; }
 
+        //! Returns a copy of the allocator.
+        allocator_type get_allocator( ) const { return allocator_type( node_alloc ); }
+
         //! Inserts a new item in the tree.
         std::pair<iterator, bool> insert( const T & );
 
         //! Locates an item in the tree.
         iterator find( const T & ) const;
 
+        //! Returns the first item not less than the given item, or end( ) if there is none.
+        iterator lower_bound( const T & ) const;
+
+        //! Returns the first item greater than the given item, or end( ) if there is none.
+        iterator upper_bound( const T & ) const;
+
+        //! Returns the item at the given position in sorted order (starting at zero).
+        /*!
+         * Returns end( ) if the position is not less than size( ).
+         */
+        iterator nth( size_type ) const;
+
+        //! Returns the number of items less than the given item.
+        size_type rank( const T & ) const;
+
+        //! Returns the number of items in the half open range [low, high).
+        size_type count_range( const T &low, const T &high ) const
+        {
+            if( !comp( low, high ) ) return 0;
+            return rank( high ) - rank( low );
+        }
+
         //! Erases an item at the specified location.
         void erase( iterator );
 
@@ -154,12 +237,12 @@ namespace spica {
 
 
     // =====
-    // Methods of BinaryTree<T, StrictWeakOrdering>::iterator
+    // Methods of BinaryTree<T, StrictWeakOrdering, Allocator, Balance>::iterator
     // =====
 
-    template<typename T, typename StrictWeakOrdering>
-    typename BinaryTree<T, StrictWeakOrdering>::iterator &
-        BinaryTree<T, StrictWeakOrdering>::iterator::operator++( )
+    template<typename T, typename StrictWeakOrdering, typename Allocator, tree_balance Balance>
+    typename BinaryTree<T, StrictWeakOrdering, Allocator, Balance>::iterator &
+        BinaryTree<T, StrictWeakOrdering, Allocator, Balance>::iterator::operator++( )
     {
         // Is incrementing an off-the-end iterator undefined?
         if( my_node == nullptr ) return *this;
@@ -179,11 +262,27 @@ namespace spica {
     }
 
 
-    template<typename T, typename StrictWeakOrdering>
-    typename BinaryTree<T, StrictWeakOrdering>::iterator &
-        BinaryTree<T, StrictWeakOrdering>::iterator::operator--( )
+    template<typename T, typename StrictWeakOrdering, typename Allocator, tree_balance Balance>
+    typename BinaryTree<T, StrictWeakOrdering, Allocator, Balance>::iterator &
+        BinaryTree<T, StrictWeakOrdering, Allocator, Balance>::iterator::operator--( )
     {
-        // UNFINISHED!
+        // Decrementing an off-the-end iterator moves it to the last item (if there is one).
+        if( my_node == nullptr ) {
+            if( my_tree->root != nullptr ) my_node = my_tree->maximum_node( my_tree->root );
+            return *this;
+        }
+
+        if( my_node->left != nullptr ) {
+            my_node = my_tree->maximum_node( my_node->left );
+        }
+        else {
+            typename BinaryTree::TreeNode *candidate = my_node->parent;
+            while( candidate != nullptr && my_node == candidate->left ) {
+                my_node = candidate;
+                candidate = my_node->parent;
+            }
+            my_node = candidate;
+        }
         return *this;
     }
 
@@ -192,19 +291,49 @@ namespace spica {
     // Methods of BinaryTree
     // =====
 
-    template<typename T, typename StrictWeakOrdering>
-    void BinaryTree<T, StrictWeakOrdering>::kill_subtree( TreeNode *r )
+    //
+    // kill_subtree
+    //
+    // This is done without recursion so that a degenerate (unbalanced) tree can't overflow the
+    // stack. Each node is freed after both of its children, when the walk returns to its parent.
+    //
+    template<typename T, typename StrictWeakOrdering, typename Allocator, tree_balance Balance>
+    void BinaryTree<T, StrictWeakOrdering, Allocator, Balance>::kill_subtree( TreeNode *r )
     {
         if( r == nullptr ) return;
-        kill_subtree( r->left );
-        kill_subtree( r->right );
-        delete r;
+        TreeNode *stop = r->parent;
+        TreeNode *current = r;
+        while( current != stop ) {
+            if( current->left != nullptr ) {
+                current = current->left;
+            }
+            else if( current->right != nullptr ) {
+                current = current->right;
+            }
+            else {
+                TreeNode *parent = current->parent;
+                if( parent != nullptr ) {
+                    if( parent->left == current ) parent->left = nullptr;
+                    else parent->right = nullptr;
+                }
+                free_node( current );
+                current = parent;
+            }
+        }
     }
 
 
-    template<typename T, typename StrictWeakOrdering>
-    const typename BinaryTree<T, StrictWeakOrdering>::TreeNode *
-        BinaryTree<T, StrictWeakOrdering>::minimum_node( TreeNode *r ) const
+    template<typename T, typename StrictWeakOrdering, typename Allocator, tree_balance Balance>
+    void BinaryTree<T, StrictWeakOrdering, Allocator, Balance>::free_node( TreeNode *r )
+    {
+        node_traits::destroy( node_alloc, r );
+        node_traits::deallocate( node_alloc, r, 1 );
+    }
+
+
+    template<typename T, typename StrictWeakOrdering, typename Allocator, tree_balance Balance>
+    const typename BinaryTree<T, StrictWeakOrdering, Allocator, Balance>::TreeNode *
+        BinaryTree<T, StrictWeakOrdering, Allocator, Balance>::minimum_node( TreeNode *r ) const
     {
         while( r->left != nullptr ) {
             r = r->left;
@@ -213,9 +342,9 @@ namespace spica {
     }
 
 
-    template<typename T, typename StrictWeakOrdering>
-    const typename BinaryTree<T, StrictWeakOrdering>::TreeNode *
-        BinaryTree<T, StrictWeakOrdering>::maximum_node( TreeNode *r ) const
+    template<typename T, typename StrictWeakOrdering, typename Allocator, tree_balance Balance>
+    const typename BinaryTree<T, StrictWeakOrdering, Allocator, Balance>::TreeNode *
+        BinaryTree<T, StrictWeakOrdering, Allocator, Balance>::maximum_node( TreeNode *r ) const
     {
         while( r->right != nullptr ) {
             r = r->right;
@@ -224,72 +353,364 @@ namespace spica {
     }
 
 
-    template<typename T, typename StrictWeakOrdering>
-    BinaryTree<T, StrictWeakOrdering>::~BinaryTree( )
+    //
+    // adjust_sizes
+    //
+    // Adds delta to the size of n and of each of its ancestors.
+    //
+    template<typename T, typename StrictWeakOrdering, typename Allocator, tree_balance Balance>
+    void BinaryTree<T, StrictWeakOrdering, Allocator, Balance>::adjust_sizes( TreeNode *n, int delta )
+    {
+        for( ; n != nullptr; n = n->parent ) {
+            n->size += delta;
+        }
+    }
+
+
+    //
+    // rank
+    //
+    // Whenever the search moves right, the left subtree and the node itself are counted.
+    //
+    template<typename T, typename StrictWeakOrdering, typename Allocator, tree_balance Balance>
+    typename BinaryTree<T, StrictWeakOrdering, Allocator, Balance>::size_type
+        BinaryTree<T, StrictWeakOrdering, Allocator, Balance>::rank( const T &item ) const
+    {
+        size_type result = 0;
+        const TreeNode *p = root;
+        while( p != nullptr ) {
+            if( comp( p->data, item ) ) {
+                result += subtree_size( p->left ) + 1;
+                p = p->right;
+            }
+            else {
+                p = p->left;
+            }
+        }
+        return result;
+    }
+
+
+    //
+    // replace_child
+    //
+    // Makes new_child take old_child's place under parent, or at the root if parent is null.
+    // The parent pointer of new_child is not changed.
+    //
+    template<typename T, typename StrictWeakOrdering, typename Allocator, tree_balance Balance>
+    void BinaryTree<T, StrictWeakOrdering, Allocator, Balance>::replace_child(
+        TreeNode *parent, TreeNode *old_child, TreeNode *new_child )
+    {
+        if( parent == nullptr ) {
+            root = new_child;
+        }
+        else if( parent->left == old_child ) {
+            parent->left = new_child;
+        }
+        else {
+            parent->right = new_child;
+        }
+    }
+
+
+    //
+    // rotate_left
+    //
+    // The right child of x takes the place of x, and x becomes its left child. Subtree sizes
+    // are updated here; the caller updates any balance information.
+    //
+    template<typename T, typename StrictWeakOrdering, typename Allocator, tree_balance Balance>
+    void BinaryTree<T, StrictWeakOrdering, Allocator, Balance>::rotate_left( TreeNode *x )
+    {
+        TreeNode *y = x->right;
+        x->right = y->left;
+        if( y->left != nullptr ) y->left->parent = x;
+        y->parent = x->parent;
+        replace_child( x->parent, x, y );
+        y->left = x;
+        x->parent = y;
+        y->size = x->size;
+        update_size( x );
+    }
+
+
+    template<typename T, typename StrictWeakOrdering, typename Allocator, tree_balance Balance>
+    void BinaryTree<T, StrictWeakOrdering, Allocator, Balance>::rotate_right( TreeNode *x )
+    {
+        TreeNode *y = x->left;
+        x->left = y->right;
+        if( y->right != nullptr ) y->right->parent = x;
+        y->parent = x->parent;
+        replace_child( x->parent, x, y );
+        y->right = x;
+        x->parent = y;
+        y->size = x->size;
+        update_size( x );
+    }
+
+
+    //
+    // red_black_insert_fixup
+    //
+    // The new node is red. If its parent is also red the problem is either pushed up the tree
+    // by recoloring (when the uncle is red) or removed by one or two rotations. See
+    // Introduction to Algorithms by Cormen, Leiserson, Rivest, and Stein, chapter 13.
+    //
+    template<typename T, typename StrictWeakOrdering, typename Allocator, tree_balance Balance>
+    void BinaryTree<T, StrictWeakOrdering, Allocator, Balance>::red_black_insert_fixup( TreeNode *z )
     {
-        kill_subtree( root );
+        while( is_red( z->parent ) ) {
+            TreeNode *p = z->parent;
+            TreeNode *g = p->parent;  // A red node is never the root, so g exists.
+            if( p == g->left ) {
+                TreeNode *uncle = g->right;
+                if( is_red( uncle ) ) {
+                    p->balance = black;
+                    uncle->balance = black;
+                    g->balance = red;
+                    z = g;
+                }
+                else {
+                    if( z == p->right ) {
+                        z = p;
+                        rotate_left( z );
+                        p = z->parent;
+                    }
+                    p->balance = black;
+                    g->balance = red;
+                    rotate_right( g );
+                }
+            }
+            else {
+                TreeNode *uncle = g->left;
+                if( is_red( uncle ) ) {
+                    p->balance = black;
+                    uncle->balance = black;
+                    g->balance = red;
+                    z = g;
+                }
+                else {
+                    if( z == p->left ) {
+                        z = p;
+                        rotate_right( z );
+                        p = z->parent;
+                    }
+                    p->balance = black;
+                    g->balance = red;
+                    rotate_left( g );
+                }
+            }
+        }
+        root->balance = black;
     }
 
 
-    template<typename T, typename StrictWeakOrdering>
-    typename BinaryTree<T, StrictWeakOrdering>::iterator
-        BinaryTree<T, StrictWeakOrdering>::begin( ) const
+    //
+    // red_black_erase_fixup
+    //
+    // Called when a black node was removed. The child that took its place (possibly null)
+    // carries an "extra black" that is moved up the tree or absorbed by rotations. The parent
+    // is passed separately because the child might be null.
+    //
+    template<typename T, typename StrictWeakOrdering, typename Allocator, tree_balance Balance>
+    void BinaryTree<T, StrictWeakOrdering, Allocator, Balance>::red_black_erase_fixup(
+        TreeNode *x, TreeNode *parent )
+    {
+        while( x != root && !is_red( x ) ) {
+            if( x == parent->left ) {
+                TreeNode *w = parent->right;  // Not null since x's side has fewer blacks.
+                if( is_red( w ) ) {
+                    w->balance = black;
+                    parent->balance = red;
+                    rotate_left( parent );
+                    w = parent->right;
+                }
+                if( !is_red( w->left ) && !is_red( w->right ) ) {
+                    w->balance = red;
+                    x = parent;
+                    parent = x->parent;
+                }
+                else {
+                    if( !is_red( w->right ) ) {
+                        w->left->balance = black;
+                        w->balance = red;
+                        rotate_right( w );
+                        w = parent->right;
+                    }
+                    w->balance = parent->balance;
+                    parent->balance = black;
+                    w->right->balance = black;
+                    rotate_left( parent );
+                    x = root;
+                }
+            }
+            else {
+                TreeNode *w = parent->left;
+                if( is_red( w ) ) {
+                    w->balance = black;
+                    parent->balance = red;
+                    rotate_right( parent );
+                    w = parent->left;
+                }
+                if( !is_red( w->left ) && !is_red( w->right ) ) {
+                    w->balance = red;
+                    x = parent;
+                    parent = x->parent;
+                }
+                else {
+                    if( !is_red( w->left ) ) {
+                        w->right->balance = black;
+                        w->balance = red;
+                        rotate_left( w );
+                        w = parent->left;
+                    }
+                    w->balance = parent->balance;
+                    parent->balance = black;
+                    w->left->balance = black;
+                    rotate_right( parent );
+                    x = root;
+                }
+            }
+        }
+        if( x != nullptr ) x->balance = black;
+    }
+
+
+    //
+    // avl_rebalance
+    //
+    // Walks from n toward the root, restoring heights and rotating where the heights of two
+    // subtrees differ by two. The walk stops as soon as a subtree's height is unchanged since
+    // nothing above it can be affected.
+    //
+    template<typename T, typename StrictWeakOrdering, typename Allocator, tree_balance Balance>
+    void BinaryTree<T, StrictWeakOrdering, Allocator, Balance>::avl_rebalance( TreeNode *n )
+    {
+        while( n != nullptr ) {
+            int old_height   = n->balance;
+            int left_height  = height( n->left );
+            int right_height = height( n->right );
+            TreeNode *subtree = n;
+
+            if( left_height > right_height + 1 ) {
+                TreeNode *l = n->left;
+                if( height( l->left ) < height( l->right ) ) {
+                    rotate_left( l );
+                    update_height( l );
+                    update_height( l->parent );
+                }
+                rotate_right( n );
+                update_height( n );
+                subtree = n->parent;
+                update_height( subtree );
+            }
+            else if( right_height > left_height + 1 ) {
+                TreeNode *r = n->right;
+                if( height( r->right ) < height( r->left ) ) {
+                    rotate_right( r );
+                    update_height( r );
+                    update_height( r->parent );
+                }
+                rotate_left( n );
+                update_height( n );
+                subtree = n->parent;
+                update_height( subtree );
+            }
+            else {
+                update_height( n );
+            }
+
+            if( subtree->balance == old_height ) break;
+            n = subtree->parent;
+        }
+    }
+
+
+    template<typename T, typename StrictWeakOrdering, typename Allocator, tree_balance Balance>
+    BinaryTree<T, StrictWeakOrdering, Allocator, Balance>::~BinaryTree( )
+    {
+        clear( );
+    }
+
+
+    template<typename T, typename StrictWeakOrdering, typename Allocator, tree_balance Balance>
+    typename BinaryTree<T, StrictWeakOrdering, Allocator, Balance>::iterator
+        BinaryTree<T, StrictWeakOrdering, Allocator, Balance>::begin( ) const
     {
         if( root == nullptr ) return iterator( this, nullptr );
         return iterator( this, minimum_node( root ) );
     }
 
 
-    template<typename T, typename StrictWeakOrdering>
-    typename BinaryTree<T, StrictWeakOrdering>::iterator
-        BinaryTree<T, StrictWeakOrdering>::end( ) const
+    template<typename T, typename StrictWeakOrdering, typename Allocator, tree_balance Balance>
+    typename BinaryTree<T, StrictWeakOrdering, Allocator, Balance>::iterator
+        BinaryTree<T, StrictWeakOrdering, Allocator, Balance>::end( ) const
     {
         return iterator( this, nullptr );
     }
 
 
-    template<typename T, typename StrictWeakOrdering>
-    std::pair<typename BinaryTree<T, StrictWeakOrdering>::iterator, bool>
-        BinaryTree<T, StrictWeakOrdering>::insert( const T &item )
+    template<typename T, typename StrictWeakOrdering, typename Allocator, tree_balance Balance>
+    std::pair<typename BinaryTree<T, StrictWeakOrdering, Allocator, Balance>::iterator, bool>
+        BinaryTree<T, StrictWeakOrdering, Allocator, Balance>::insert( const T &item )
     {
         TreeNode *bookmark = nullptr;
         TreeNode *current  = root;
-        TreeNode *new_node = new TreeNode( item, nullptr, nullptr, nullptr );
+        bool      go_left  = false;
 
         while( current != nullptr ) {
             bookmark = current;
-            if( comp( new_node->data, current->data ) ) {
+            if( comp( item, current->data ) ) {
                 current = current->left;
+                go_left = true;
             }
-            else if( comp( current->data, new_node->data ) ) {
+            else if( comp( current->data, item ) ) {
                 current = current->right;
+                go_left = false;
             }
             else {
                 // Current is a copy of the new item.
-                delete new_node;
                 return std::pair<iterator, bool>( iterator( this, current ), false );
             }
         }
 
-        new_node->parent = bookmark;
+        TreeNode *new_node = node_traits::allocate( node_alloc, 1 );
+        try {
+            node_traits::construct( node_alloc, new_node, item, bookmark, nullptr, nullptr );
+        }
+        catch( ... ) {
+            node_traits::deallocate( node_alloc, new_node, 1 );
+            throw;
+        }
+
         if( bookmark == nullptr ) {
             root = new_node;
         }
-        else if( comp( new_node->data, bookmark->data ) ) {
+        else if( go_left ) {
             bookmark->left = new_node;
         }
         else {
             bookmark->right = new_node;
         }
+        adjust_sizes( bookmark, 1 );
+
+        if constexpr( Balance == tree_balance::red_black ) {
+            new_node->balance = red;
+            red_black_insert_fixup( new_node );
+        }
+        else if constexpr( Balance == tree_balance::avl ) {
+            new_node->balance = 1;
+            avl_rebalance( bookmark );
+        }
 
         ++count;
         return std::pair<iterator, bool>( iterator( this, new_node ), true );
     }
 
 
-    template<typename T, typename StrictWeakOrdering>
-    typename BinaryTree<T, StrictWeakOrdering>::iterator
-        BinaryTree<T, StrictWeakOrdering>::find( const T &item ) const
+    template<typename T, typename StrictWeakOrdering, typename Allocator, tree_balance Balance>
+    typename BinaryTree<T, StrictWeakOrdering, Allocator, Balance>::iterator
+        BinaryTree<T, StrictWeakOrdering, Allocator, Balance>::find( const T &item ) const
     {
         TreeNode *p = root;
         while( p != 0 && ( comp( item, p->data ) || comp( p->data, item ) ) ) {
@@ -304,55 +725,143 @@ namespace spica {
     }
 
 
-    template<typename T, typename StrictWeakOrdering>
-    void BinaryTree<T, StrictWeakOrdering>::erase( iterator it )
+    template<typename T, typename StrictWeakOrdering, typename Allocator, tree_balance Balance>
+    typename BinaryTree<T, StrictWeakOrdering, Allocator, Balance>::iterator
+        BinaryTree<T, StrictWeakOrdering, Allocator, Balance>::lower_bound( const T &item ) const
     {
-        // This version of erase assumes 'it' points at a valid node.
-        const TreeNode *splice;
-        TreeNode *rest;
-
-        if( it.my_node->left == nullptr || it.my_node->right == nullptr ) {
-            splice = it.my_node;
-        }
-        else {
-            splice = minimum_node( it.my_node->right );
+        const TreeNode *result = nullptr;
+        const TreeNode *p = root;
+        while( p != nullptr ) {
+            if( comp( p->data, item ) ) {
+                p = p->right;
+            }
+            else {
+                result = p;
+                p = p->left;
+            }
         }
+        return iterator( this, result );
+    }
 
-        if( splice->left != nullptr ) {
-            rest = splice->left;
-        }
-        else {
-            rest = splice->right;
-        }
 
-        if( rest != 0 ) {
-            rest->parent = splice->parent;
+    template<typename T, typename StrictWeakOrdering, typename Allocator, tree_balance Balance>
+    typename BinaryTree<T, StrictWeakOrdering, Allocator, Balance>::iterator
+        BinaryTree<T, StrictWeakOrdering, Allocator, Balance>::upper_bound( const T &item ) const
+    {
+        const TreeNode *result = nullptr;
+        const TreeNode *p = root;
+        while( p != nullptr ) {
+            if( comp( item, p->data ) ) {
+                result = p;
+                p = p->left;
+            }
+            else {
+                p = p->right;
+            }
         }
-        if( splice->parent == nullptr ) {
-            root = rest;
+        return iterator( this, result );
+    }
+
+
+    //
+    // nth
+    //
+    // The size of the left subtree says whether the wanted item is to the left, here, or to
+    // the right. Going right skips the left subtree and this node.
+    //
+    template<typename T, typename StrictWeakOrdering, typename Allocator, tree_balance Balance>
+    typename BinaryTree<T, StrictWeakOrdering, Allocator, Balance>::iterator
+        BinaryTree<T, StrictWeakOrdering, Allocator, Balance>::nth( size_type position ) const
+    {
+        const TreeNode *p = root;
+        while( p != nullptr ) {
+            size_type left_size = subtree_size( p->left );
+            if( position < left_size ) {
+                p = p->left;
+            }
+            else if( position == left_size ) {
+                break;
+            }
+            else {
+                position -= left_size + 1;
+                p = p->right;
+            }
         }
-        else if( splice == splice->parent->left ) {
-            splice->parent->left = rest;
+        return iterator( this, p );
+    }
+
+
+    //
+    // erase
+    //
+    // A node with two children is replaced by its successor, which is moved rather than
+    // copied so that iterators to the successor remain valid. The successor takes over the
+    // removed node's color or height; the balancing then starts where the successor was taken
+    // from.
+    //
+    template<typename T, typename StrictWeakOrdering, typename Allocator, tree_balance Balance>
+    void BinaryTree<T, StrictWeakOrdering, Allocator, Balance>::erase( iterator it )
+    {
+        // This version of erase assumes 'it' points at a valid node.
+        TreeNode *z = const_cast<TreeNode *>( it.my_node );
+        TreeNode *child;           // The node that moves into the vacated position.
+        TreeNode *child_parent;    // Its new parent (needed when the child is null).
+        [[maybe_unused]] signed char removed_balance = z->balance;
+
+        if( z->left == nullptr || z->right == nullptr ) {
+            child = ( z->left != nullptr ) ? z->left : z->right;
+            child_parent = z->parent;
+            if( child != nullptr ) child->parent = z->parent;
+            replace_child( z->parent, z, child );
         }
         else {
-            splice->parent->right = rest;
-        }
-
-        if( splice != it.my_node ) {
-            const_cast<TreeNode *>( it.my_node )->data = splice->data;
+            TreeNode *successor = const_cast<TreeNode *>( minimum_node( z->right ) );
+            removed_balance = successor->balance;
+            child = successor->right;
+            if( successor->parent == z ) {
+                child_parent = successor;
+            }
+            else {
+                child_parent = successor->parent;
+                if( child != nullptr ) child->parent = successor->parent;
+                successor->parent->left = child;
+                successor->right = z->right;
+                successor->right->parent = successor;
+            }
+            successor->parent = z->parent;
+            replace_child( z->parent, z, successor );
+            successor->left = z->left;
+            successor->left->parent = successor;
+            successor->balance = z->balance;
+            successor->size = z->size;
         }
 
-        delete splice;
+        // Every node from the removed position up to the root lost one descendant.
+        adjust_sizes( child_parent, -1 );
+        free_node( z );
         --count;
 
+        if constexpr( Balance == tree_balance::red_black ) {
+            if( removed_balance == black ) red_black_erase_fixup( child, child_parent );
+        }
+        else if constexpr( Balance == tree_balance::avl ) {
+            avl_rebalance( child_parent );
+        }
+
         // The iterator `it` is now invalid. Is that okay?
     }
 
 
-    template<typename T, typename StrictWeakOrdering>
-    void BinaryTree<T, StrictWeakOrdering>::clear( )
+    template<typename T, typename StrictWeakOrdering, typename Allocator, tree_balance Balance>
+    void BinaryTree<T, StrictWeakOrdering, Allocator, Balance>::clear( )
     {
-        kill_subtree( root );
+        // If the allocator's pools belong to this tree alone they can be released in one step.
+        bool released = false;
+        if constexpr( std::is_trivially_destructible_v<TreeNode> &&
+                      requires( node_allocator &a ) { a.release( ); } ) {
+            released = node_alloc.release( );
+        }
+        if( !released ) kill_subtree( root );
         root  = nullptr;
         count = 0;
     }
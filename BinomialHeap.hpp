@@ -1,10 +1,6 @@
 /*! \file    BinomialHeap.hpp
  *  \brief   Binomial heap container template
  *  \author  Peter Chapin <spicacality@kelseymountain.org>
- *
- * TODO: Consider the following...
- *
- * + Implement the DELETE and "DECREASE"-KEY operations.
  */
 
 #ifndef BINOMIALHEAP_H
@@ -13,7 +9,10 @@
 #include <cstddef>
 #include <functional>
 #include <iterator>
-#include <queue>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
 
 namespace spica {
 
@@ -35,8 +34,22 @@ namespace spica {
      *  reference has a very nice presentation on binomial heaps including some excellent
      *  diagrams showing how these functions work. In addition, the reference contains several
      *  suggestions for ways this simple minded implementation might be improved.
+     *
+     * The push( ) method returns a handle that can later be given to decrease_key( ) or
+     * erase( ), for example by graph algorithms such as Dijkstra's that would otherwise need to
+     * insert duplicate entries and skip the stale ones. A handle points at a small cell that
+     * records which node currently holds its item. When an item moves toward the front it
+     * trades places with its parent's item, and the cells of the two items (if any) are
+     * updated, so each step takes O(1) time. Because items move between nodes, T must be
+     * swappable.
+     *
+     * Nodes are obtained from an allocator of type Allocator rebound to the node type. With a
+     * PoolAllocator the nodes are packed into large chunks and clear( ) releases the chunks
+     * without visiting the nodes (if the items have trivial destructors).
      */
-    template<typename T, typename StrictWeakOrdering = std::less<T>>
+    template<typename T,
+             typename StrictWeakOrdering = std::less<T>,
+             typename Allocator = std::allocator<T>>
     class BinomialHeap {
     public:
 
@@ -49,22 +62,39 @@ namespace spica {
         typedef       key_type           &reference;
         typedef const key_type           &const_reference;
         typedef       std::size_t         size_type;
+        typedef       Allocator           allocator_type;
 
     private:
 
+        struct BinomialTreeNode;
+
+        // Records the node holding an item that has a handle.
+        struct HandleCell {
+            BinomialTreeNode *node;
+        };
+
         // A binomial heap is a list of binomial trees.
         struct BinomialTreeNode {
             BinomialTreeNode *parent;
             BinomialTreeNode *child;
             BinomialTreeNode *sibling;
+            HandleCell       *cell;     // The cell of the item in this node, if it has one.
             int               degree;
             key_type          data;
 
             // Initializes the members of a tree node.
             BinomialTreeNode( const key_type &new_item ) : data( new_item )
-                { parent = child = sibling = nullptr; degree = 0; }
+                { parent = child = sibling = nullptr; cell = nullptr; degree = 0; }
         };
 
+        typedef typename std::allocator_traits<Allocator>::template rebind_alloc<BinomialTreeNode> node_allocator;
+        typedef std::allocator_traits<node_allocator> node_traits;
+
+        // Cells are allocated with a copy of the node allocator made when needed. A PoolAllocator
+        // can only release its pools when it has no copies, so the copy isn't kept.
+        typedef typename std::allocator_traits<Allocator>::template rebind_alloc<HandleCell> cell_allocator;
+        typedef std::allocator_traits<cell_allocator> cell_traits;
+
         // The head of the root list.
         BinomialTreeNode *roots;
 
@@ -76,20 +106,41 @@ namespace spica {
         //
         StrictWeakOrdering comp;
 
+        // Allocator used for the nodes.
+        [[no_unique_address]] node_allocator node_alloc;
+
         // This recursive function destroys the heap below and to the right of the given node.
         // It also destroys the given node.
         //
-        static void destroy_heap( BinomialTreeNode * );
+        void destroy_heap( BinomialTreeNode * );
 
         // This function handles the linking of two binomial trees.
         static void binomial_link( BinomialTreeNode *left, BinomialTreeNode *right );
 
-        // This function merges two root lists into a single root list. The root list in the
-        // given heap is removed (the heap is made empty) and the root list in 'this' heap is
-        // expanded. This function sorts the binomial trees in the root list in order of
-        // ascending degree.
+        // This function merges two root lists into a single root list. The given root list is
+        // combined with the root list in 'this' heap. This function sorts the binomial trees in
+        // the root list in order of ascending degree.
         //
-        void binomial_merge( BinomialHeap &other );
+        void binomial_merge( BinomialTreeNode *other_roots );
+
+        // This function merges the given root list into 'this' heap and then links trees of
+        // equal degree so that the heap is again a proper binomial heap.
+        //
+        void merge_roots( BinomialTreeNode *other_roots );
+
+        // This function adds a new node holding a copy of the given item to the heap.
+        BinomialTreeNode *insert_node( const T &new_item );
+
+        // This function destroys a node that is no longer in the heap, along with its cell.
+        void destroy_node( BinomialTreeNode *node );
+
+        // This function exchanges the items of a node and its parent, along with their cells.
+        static void swap_with_parent( BinomialTreeNode *node );
+
+        // This function unlinks the given root (preceded by previous in the root list), merges
+        // its children back into the heap, and destroys it.
+        //
+        void remove_root( BinomialTreeNode *root, BinomialTreeNode *previous );
 
         // Make copy operations illegal on binomial heaps (for now).
         BinomialHeap( const BinomialHeap & ) = delete;
@@ -99,17 +150,10 @@ namespace spica {
 
         //! Binomial heap iterator class.
         /*!
-         * Binomial heap iterators are forward iterators. They provide O(1) increment and O(n)
-         * sweeps through the entire heap. However, because of the structure of a binomial heap,
-         * these iterators are relatively "heavy weight." As a consequence they might throw an
-         * exception (std::bad_alloc) when they are copied or when they are incremented. In
-         * practice I do not expect that this would be a major problem. They might also consume
-         * a considerable amount of memory if they are iterating over a large heap.
-         *
-         * Specifically a binomial heap iterator maintains a queue of node pointers that it uses
-         * to keep track of portions of the heap it needs to "go back" and explore further. For
-         * a large heap this queue can contain a sizable number of pointers [TODO: Figure out
-         * some specifics about how large the queue might get].
+         * Binomial heap iterators are forward iterators that visit the items in an unspecified
+         * order. An iterator is just a node pointer; it walks the trees in preorder using the
+         * links in the nodes, so it never allocates memory and is cheap to copy. An increment
+         * takes O(1) amortized time.
          */
         class iterator {
 
@@ -124,60 +168,72 @@ namespace spica {
 
         private:
             const BinomialTreeNode *current;
-            std::queue<const BinomialTreeNode *> *pQ;
 
-            iterator( const BinomialTreeNode *c, std::queue<const BinomialTreeNode *> *q )
-                : current( c ), pQ( q ) { }
+            explicit iterator( const BinomialTreeNode *c ) : current( c ) { }
 
         public:
             //! Default constructor.
-            iterator( ) : current( nullptr ), pQ( nullptr ) { }
-
-            //! Copy constructor.
-            iterator( const iterator &other )
-            {
-                current = other.current;
-                pQ      = new std::queue<const BinomialTreeNode *>( *other.pQ );
-            }
-
-            //! Assignment operator.
-            iterator &operator=( const iterator &other )
-            {
-                delete pQ;
-                current = other.current;
-                pQ      = new std::queue<const BinomialTreeNode *>( *other.pQ );
-                return *this;
-            }
-
-            //! Destructor.
-           ~iterator( ) { delete pQ; }
+            iterator( ) : current( nullptr ) { }
 
             //! Returns true if two iterators point at the same object or both end( ).
-            bool operator==( const iterator other )
+            bool operator==( const iterator &other ) const
                 { return current == other.current; }
 
             //! Returns a reference to the current object.
             /*! Applying this operation to an end() iterator is undefined. */
-            const T &operator*( )
+            const T &operator*( ) const
                 { return current->data; }
 
             //! Returns a pointer to the current object.
             /*! Applying this operation to an end( ) iterator is undefined. */
-            const T *operator->( )
+            const T *operator->( ) const
                 { return &current->data; }
 
             //! Prefix increment.
-            /*!
-             * Postfix is inefficient because copying an iterator is non-trivial. Therefor
-             * postfix increment has not been implemented.
-             */
             iterator &operator++( );
 
+            //! Postfix increment.
+            iterator operator++( int )
+            {
+                iterator old( *this );
+                ++*this;
+                return old;
+            }
+
         };  // End of BinomialHeap::iterator.
 
+        //! Refers to an item in the heap.
+        /*!
+         * A handle stays valid until its item is removed from the heap by pop( ), erase( ), or
+         * clear( ), even if the heap is merged into another heap.
+         */
+        class handle {
+
+            friend class BinomialHeap;
+
+        public:
+            //! Default constructor. The handle does not refer to any item.
+            handle( ) : cell( nullptr ) { }
+
+            //! Returns a reference to the item.
+            const T &operator*( ) const { return cell->node->data; }
+
+            //! Returns a pointer to the item.
+            const T *operator->( ) const { return &cell->node->data; }
+
+            //! Returns true if the handles refer to the same item.
+            bool operator==( const handle &other ) const { return cell == other.cell; }
+
+        private:
+            explicit handle( HandleCell *c ) : cell( c ) { }
+
+            HandleCell *cell;
+        };
+
         //! Create an empty heap.
-        BinomialHeap( const StrictWeakOrdering &C = StrictWeakOrdering( ) )
-            : roots( nullptr ), count( 0 ), comp( C )
+        BinomialHeap( const StrictWeakOrdering &C = StrictWeakOrdering( ),
+                      const Allocator &A = Allocator( ) )
+            : roots( nullptr ), count( 0 ), comp( C ), node_alloc( A )
             { }
 
         //! Create a heap from the given sequence.
@@ -185,7 +241,8 @@ namespace spica {
         BinomialHeap(
             InputIterator first,
             InputIterator last,
-            const StrictWeakOrdering &C = StrictWeakOrdering( )
+            const StrictWeakOrdering &C = StrictWeakOrdering( ),
+            const Allocator &A = Allocator( )
         );
 
         //! Destroy the heap and all contained nodes.
@@ -206,6 +263,9 @@ namespace spica {
         value_compare value_comp( ) const
             { return comp; }
 
+        allocator_type get_allocator( ) const
+            { return allocator_type( node_alloc ); }
+
         //! Return an iterator to the first item in the heap.
         iterator begin( ) const;
 
@@ -215,20 +275,18 @@ namespace spica {
         //! Insert a copy of the given object into 'this' heap.
         /*!
          * This method returns a pointer to the new copy of the object for future reference.
-         * This pointer will be valid until the heap holding the object is destroyed or until
-         * the data object is popped from the heap. If 'this' heap is merged into another heap,
-         * this pointer will continue to correctly point at the appropriate data object.
-         *
-         * Note that this method returns a pointer rather than the more usual iterator because
-         * binomial heap iterators contain quite a bit of state information about the iteration
-         * in progress. Building this state information for a newly inserted item would be
-         * expensive.
+         * The pointer remains valid, also if 'this' heap is merged into another heap, until the
+         * object is popped from the heap or the heap is destroyed. However, decrease_key( ) and
+         * erase( ) move items between nodes, so once they are used the pointer may refer to a
+         * different item. Use push( ) to keep track of an item in that case.
          */
         const T *insert( const T &new_item );
 
-        //! Wrapper around insert for consistency with pop.
-        void push( const T &new_item )
-            { insert( new_item ); }
+        //! Inserts a copy of the given object and returns a handle to it.
+        /*!
+         * Unlike insert( ), this allocates a cell for the handle in addition to the node.
+         */
+        handle push( const T &new_item );
 
         //! Inserts each item in the range [first, last) into the heap.
         template<typename InputIterator>
@@ -248,10 +306,26 @@ namespace spica {
          */
         void pop( );
 
+        //! Replaces an item with one that is not after it in the heap ordering.
+        /*!
+         * The item moves toward the front of the heap. This takes O(lg(n)) time.
+         *
+         * \exception std::invalid_argument if the new value comes after the old one.
+         */
+        void decrease_key( handle item, const T &new_value );
+
+        //! Removes the item referred to by the handle. O(lg(n))
+        void erase( handle item );
+
+        //! Remove every item from the heap.
+        void clear( );
+
         //! Merge the other binomial heap into 'this' heap.
         /*!
          * The other heap is emptied by this operation but not destroyed; it remains in a usable
-         * state.
+         * state. The nodes of the other heap are taken over without copying, so the allocators
+         * of the two heaps must compare equal (for PoolAllocator, the heaps must be given copies
+         * of the same allocator).
          */
         BinomialHeap &merge( BinomialHeap &other );
     };
@@ -264,8 +338,8 @@ namespace spica {
     //
     // binomial_link
     //
-    template<typename T, typename StrictWeakOrdering>
-    void BinomialHeap<T, StrictWeakOrdering>::
+    template<typename T, typename StrictWeakOrdering, typename Allocator>
+    void BinomialHeap<T, StrictWeakOrdering, Allocator>::
         binomial_link( BinomialTreeNode *left, BinomialTreeNode *right )
     {
         left->parent  = right;
@@ -278,8 +352,8 @@ namespace spica {
     //
     // destroy_heap
     //
-    template<typename T, typename StrictWeakOrdering>
-    void BinomialHeap<T, StrictWeakOrdering>::destroy_heap( BinomialTreeNode *p )
+    template<typename T, typename StrictWeakOrdering, typename Allocator>
+    void BinomialHeap<T, StrictWeakOrdering, Allocator>::destroy_heap( BinomialTreeNode *p )
     {
         if( p == 0 ) return;
         destroy_heap( p->child );
@@ -288,8 +362,22 @@ namespace spica {
         // heaps. (How true is this?)
         //
         destroy_heap( p->sibling );
+        destroy_node( p );
+    }
 
-        delete p;
+
+    //
+    // destroy_node
+    //
+    template<typename T, typename StrictWeakOrdering, typename Allocator>
+    void BinomialHeap<T, StrictWeakOrdering, Allocator>::destroy_node( BinomialTreeNode *p )
+    {
+        if( p->cell != nullptr ) {
+            cell_allocator cell_alloc( node_alloc );
+            cell_traits::deallocate( cell_alloc, p->cell, 1 );
+        }
+        node_traits::destroy( node_alloc, p );
+        node_traits::deallocate( node_alloc, p, 1 );
     }
 
 
@@ -300,31 +388,21 @@ namespace spica {
     //
     // binomial_merge
     //
-    template<typename T, typename StrictWeakOrdering>
-    void BinomialHeap<T, StrictWeakOrdering>::binomial_merge( BinomialHeap &other )
+    template<typename T, typename StrictWeakOrdering, typename Allocator>
+    void BinomialHeap<T, StrictWeakOrdering, Allocator>::binomial_merge( BinomialTreeNode *other_roots )
     {
-        // Update the item count information.
-        count += other.count;
-        other.count = 0;
-
-        // If the other heap is empty, we are done already.
-        if( other.roots == nullptr ) return;
+        // If the other root list is empty, we are done already.
+        if( other_roots == nullptr ) return;
 
         // If this heap is empty, it is easy.
         if( roots == nullptr ) {
-            roots            = other.roots;
-            other.roots      = nullptr;
+            roots = other_roots;
             return;
         }
 
         // Now we have to think.
         BinomialTreeNode *this_walker  = roots;
-        BinomialTreeNode *other_walker = other.roots;
-
-        // We no longer need other.roots. Let's set it to 0. At this point the other heap is
-        // emptied and ready to be reused.
-        //
-        other.roots = nullptr;
+        BinomialTreeNode *other_walker = other_roots;
 
         // First, let's set an initial value to roots.
         if( this_walker->degree < other_walker->degree ) {
@@ -378,24 +456,22 @@ namespace spica {
     //
     // operator++
     //
-    template<typename T, typename StrictWeakOrdering>
-    typename BinomialHeap<T, StrictWeakOrdering>::iterator &
-        BinomialHeap<T, StrictWeakOrdering>::iterator::operator++( )
+    // Preorder: go down to the first child if there is one, otherwise to the next sibling of
+    // the nearest node (starting with this one) that has a sibling. The roots are siblings of
+    // each other, so this carries on into the next tree.
+    //
+    template<typename T, typename StrictWeakOrdering, typename Allocator>
+    typename BinomialHeap<T, StrictWeakOrdering, Allocator>::iterator &
+        BinomialHeap<T, StrictWeakOrdering, Allocator>::iterator::operator++( )
     {
-        if( current->sibling != nullptr ) {
-            current = current->sibling;
-            if( current->child != nullptr ) pQ->push( current->child );
+        if( current->child != nullptr ) {
+            current = current->child;
+            return *this;
         }
-        else if( !pQ->empty( ) ) {
-            current = pQ->front( );
-            pQ->pop( );
-            if( current->child != nullptr ) pQ->push( current->child );
-        }
-        else { // We are done. Make *this into a valid end iterator.
-            current = nullptr;
-            delete pQ;
-            pQ = nullptr;
+        while( current != nullptr && current->sibling == nullptr ) {
+            current = current->parent;
         }
+        if( current != nullptr ) current = current->sibling;
         return *this;
     }
 
@@ -407,11 +483,11 @@ namespace spica {
     //
     // Template constructor
     //
-    template<typename T, typename StrictWeakOrdering>
+    template<typename T, typename StrictWeakOrdering, typename Allocator>
     template<typename InputIterator>
-        BinomialHeap<T, StrictWeakOrdering>::BinomialHeap(
-            InputIterator first, InputIterator last, const StrictWeakOrdering &C)
-                : roots( nullptr ), count( 0 ), comp( C )
+        BinomialHeap<T, StrictWeakOrdering, Allocator>::BinomialHeap(
+            InputIterator first, InputIterator last, const StrictWeakOrdering &C, const Allocator &A )
+                : roots( nullptr ), count( 0 ), comp( C ), node_alloc( A )
     {
         insert( first, last );
     }
@@ -420,52 +496,85 @@ namespace spica {
     //
     // Destructor
     //
-    template<typename T, typename StrictWeakOrdering>
-    BinomialHeap<T, StrictWeakOrdering>::~BinomialHeap( )
+    template<typename T, typename StrictWeakOrdering, typename Allocator>
+    BinomialHeap<T, StrictWeakOrdering, Allocator>::~BinomialHeap( )
     {
-        // Destroying a NULL pointer is safe.
-        destroy_heap( roots );
+        clear( );
     }
 
 
     //
     // begin
     //
-    template<typename T, typename StrictWeakOrdering>
-    typename BinomialHeap<T, StrictWeakOrdering>::iterator
-        BinomialHeap<T, StrictWeakOrdering>::begin( ) const
+    template<typename T, typename StrictWeakOrdering, typename Allocator>
+    typename BinomialHeap<T, StrictWeakOrdering, Allocator>::iterator
+        BinomialHeap<T, StrictWeakOrdering, Allocator>::begin( ) const
     {
-        if( roots == nullptr ) return iterator( );
-        std::queue<const BinomialTreeNode *> *q = new std::queue<const BinomialTreeNode *>;
-        if( roots->child != nullptr ) q->push( roots->child );
-        return iterator( roots, q );
+        return iterator( roots );
     }
 
 
     //
     // insert
     //
-    template<typename T, typename StrictWeakOrdering>
-    const T *BinomialHeap<T, StrictWeakOrdering>::insert( const T &new_item )
+    template<typename T, typename StrictWeakOrdering, typename Allocator>
+    const T *BinomialHeap<T, StrictWeakOrdering, Allocator>::insert( const T &new_item )
     {
-        BinomialHeap<key_type, StrictWeakOrdering> temp_heap( comp );
+        return &insert_node( new_item )->data;
+    }
 
-        BinomialTreeNode *new_node = new BinomialTreeNode( new_item );
 
-        temp_heap.roots = new_node;
-        temp_heap.count = 1;
-        merge( temp_heap );
+    //
+    // insert_node
+    //
+    template<typename T, typename StrictWeakOrdering, typename Allocator>
+    typename BinomialHeap<T, StrictWeakOrdering, Allocator>::BinomialTreeNode *
+        BinomialHeap<T, StrictWeakOrdering, Allocator>::insert_node( const T &new_item )
+    {
+        BinomialTreeNode *new_node = node_traits::allocate( node_alloc, 1 );
+        try {
+            node_traits::construct( node_alloc, new_node, new_item );
+        }
+        catch( ... ) {
+            node_traits::deallocate( node_alloc, new_node, 1 );
+            throw;
+        }
+
+        // The new node is a root list of one tree.
+        merge_roots( new_node );
+        ++count;
 
-        return &new_node->data;
+        return new_node;
+    }
+
+
+    //
+    // push
+    //
+    template<typename T, typename StrictWeakOrdering, typename Allocator>
+    typename BinomialHeap<T, StrictWeakOrdering, Allocator>::handle
+        BinomialHeap<T, StrictWeakOrdering, Allocator>::push( const T &new_item )
+    {
+        cell_allocator cell_alloc( node_alloc );
+        HandleCell *cell = cell_traits::allocate( cell_alloc, 1 );
+        try {
+            cell_traits::construct( cell_alloc, cell, HandleCell{ insert_node( new_item ) } );
+        }
+        catch( ... ) {
+            cell_traits::deallocate( cell_alloc, cell, 1 );
+            throw;
+        }
+        cell->node->cell = cell;
+        return handle( cell );
     }
 
 
     //
     // Template insert
     //
-    template<typename T, typename StrictWeakOrdering>
+    template<typename T, typename StrictWeakOrdering, typename Allocator>
     template<typename InputIterator>
-        void BinomialHeap<T, StrictWeakOrdering>::
+        void BinomialHeap<T, StrictWeakOrdering, Allocator>::
             insert( InputIterator first, InputIterator last )
     {
         while( first != last ) {
@@ -478,8 +587,8 @@ namespace spica {
     //
     // front
     //
-    template<typename T, typename StrictWeakOrdering>
-    const T &BinomialHeap<T, StrictWeakOrdering>::front( ) const
+    template<typename T, typename StrictWeakOrdering, typename Allocator>
+    const T &BinomialHeap<T, StrictWeakOrdering, Allocator>::front( ) const
     {
         // Add error handling?
         // if( roots == 0 ) ...
@@ -509,8 +618,8 @@ namespace spica {
     //
     // pop
     //
-    template<typename T, typename StrictWeakOrdering>
-    void BinomialHeap<T, StrictWeakOrdering>::pop( )
+    template<typename T, typename StrictWeakOrdering, typename Allocator>
+    void BinomialHeap<T, StrictWeakOrdering, Allocator>::pop( )
     {
         // Add error handling?
         // if( roots == nullptr ) ...
@@ -541,7 +650,18 @@ namespace spica {
             consider = consider->sibling;
         }
 
-        // Now unlink the minimum root node from the root list.
+        remove_root( front_node, min_previous );
+    }
+
+
+    //
+    // remove_root
+    //
+    template<typename T, typename StrictWeakOrdering, typename Allocator>
+    void BinomialHeap<T, StrictWeakOrdering, Allocator>::remove_root(
+        BinomialTreeNode *front_node, BinomialTreeNode *min_previous )
+    {
+        // Unlink the root node from the root list.
         if( min_previous == nullptr ) roots = front_node->sibling;
             else min_previous->sibling = front_node->sibling;
         front_node->sibling = nullptr;
@@ -552,44 +672,139 @@ namespace spica {
         BinomialTreeNode *leftovers = front_node->child;
         front_node->child = nullptr;
 
-        // Create a temporary heap.
-        BinomialHeap<key_type> temp_heap( comp );
-
-        // Walk down the sibling list of the leftovers and prepend the nodes to the temp heap's
-        // root list. Note that this works fine if the minimum node has no children.
+        // Walk down the sibling list of the leftovers and prepend the nodes to a new root list
+        // (the children are in order of decreasing degree). Note that this works fine if the
+        // minimum node has no children.
         //
+        BinomialTreeNode *leftover_roots = nullptr;
         while( leftovers != nullptr ) {
             BinomialTreeNode *temp = leftovers->sibling;
-            leftovers->sibling = temp_heap.roots;
-            temp_heap.roots = leftovers;
+            leftovers->parent  = nullptr;
+            leftovers->sibling = leftover_roots;
+            leftover_roots = leftovers;
             leftovers = temp;
         }
 
         // Combine the leftovers back into 'this' heap.
-        merge( temp_heap );
+        merge_roots( leftover_roots );
 
         // Blow away the front node.
-        delete front_node;
+        destroy_node( front_node );
 
         // Update our records on how many things are in this heap.
         count--;
     }
 
 
+    //
+    // swap_with_parent
+    //
+    // The tree is not changed. The items trade nodes, and so do their cells, which are then
+    // pointed at their new nodes.
+    //
+    template<typename T, typename StrictWeakOrdering, typename Allocator>
+    void BinomialHeap<T, StrictWeakOrdering, Allocator>::swap_with_parent( BinomialTreeNode *node )
+    {
+        BinomialTreeNode *parent = node->parent;
+
+        using std::swap;
+        swap( node->data, parent->data );
+        swap( node->cell, parent->cell );
+        if( node->cell != nullptr ) node->cell->node = node;
+        if( parent->cell != nullptr ) parent->cell->node = parent;
+    }
+
+
+    //
+    // decrease_key
+    //
+    template<typename T, typename StrictWeakOrdering, typename Allocator>
+    void BinomialHeap<T, StrictWeakOrdering, Allocator>::decrease_key( handle item, const T &new_value )
+    {
+        BinomialTreeNode *node = item.cell->node;
+        if( comp( node->data, new_value ) )
+            throw std::invalid_argument( "BinomialHeap::decrease_key: new value comes after the old value" );
+
+        node->data = new_value;
+        while( node->parent != nullptr && comp( node->data, node->parent->data ) ) {
+            swap_with_parent( node );
+            node = node->parent;
+        }
+    }
+
+
+    //
+    // erase
+    //
+    // The item is moved to the root of its tree, as if its key were smaller than every other
+    // key, and then removed the same way pop removes the front item.
+    //
+    template<typename T, typename StrictWeakOrdering, typename Allocator>
+    void BinomialHeap<T, StrictWeakOrdering, Allocator>::erase( handle item )
+    {
+        BinomialTreeNode *node = item.cell->node;
+        while( node->parent != nullptr ) {
+            swap_with_parent( node );
+            node = node->parent;
+        }
+
+        BinomialTreeNode *previous = nullptr;
+        for( BinomialTreeNode *p = roots; p != node; p = p->sibling ) previous = p;
+        remove_root( node, previous );
+    }
+
+
+    //
+    // clear
+    //
+    template<typename T, typename StrictWeakOrdering, typename Allocator>
+    void BinomialHeap<T, StrictWeakOrdering, Allocator>::clear( )
+    {
+        // If the allocator's pools belong to this heap alone they can be released in one step.
+        bool released = false;
+        if constexpr( std::is_trivially_destructible_v<BinomialTreeNode> &&
+                      requires( node_allocator &a ) { a.release( ); } ) {
+            released = node_alloc.release( );
+        }
+
+        // Destroying a NULL pointer is safe.
+        if( !released ) destroy_heap( roots );
+        roots = nullptr;
+        count = 0;
+    }
+
+
     //
     // merge
     //
-    template<typename T, typename StrictWeakOrdering>
-    BinomialHeap<T, StrictWeakOrdering> &
-        BinomialHeap<T, StrictWeakOrdering>::merge( BinomialHeap &other )
+    template<typename T, typename StrictWeakOrdering, typename Allocator>
+    BinomialHeap<T, StrictWeakOrdering, Allocator> &
+        BinomialHeap<T, StrictWeakOrdering, Allocator>::merge( BinomialHeap &other )
     {
-        // Combine the root lists in sorted order and empty the 'other' heap. This operation
-        // takes O(Lg(n)) time.
+        // Take the other heap's trees. At this point the other heap is emptied and ready to be
+        // reused.
         //
-        binomial_merge( other );
+        BinomialTreeNode *other_roots = other.roots;
+        count += other.count;
+        other.roots = nullptr;
+        other.count = 0;
+
+        merge_roots( other_roots );
+        return *this;
+    }
+
+
+    //
+    // merge_roots
+    //
+    template<typename T, typename StrictWeakOrdering, typename Allocator>
+    void BinomialHeap<T, StrictWeakOrdering, Allocator>::merge_roots( BinomialTreeNode *other_roots )
+    {
+        // Combine the root lists in sorted order. This operation takes O(Lg(n)) time.
+        binomial_merge( other_roots );
 
         // If there is nothing in the combined heaps we are done.
-        if( roots == nullptr ) return *this;
+        if( roots == nullptr ) return;
 
         // Set up three pointers into the merged root list.
         BinomialTreeNode *previous = nullptr;
@@ -632,7 +847,6 @@ namespace spica {
             // Figure out a new next.
             next = current->sibling;
         }
-        return *this;
     }
 
 }
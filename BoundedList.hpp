@@ -11,14 +11,25 @@
 #ifndef BOUNDEDLIST_HPP
 #define BOUNDEDLIST_HPP
 
+#include <algorithm>
+#include <cstddef>
 #include <initializer_list>
 #include <iterator>
+#include <limits>
 #include <memory>
 #include <new>
 #include <stdexcept>
+#include <type_traits>
+#include <utility>
 
 namespace spica {
 
+    //! What a BoundedList does when it is full and another item is added.
+    enum class list_growth {
+        fixed,     //!< Throw std::length_error (the default). The list never allocates again.
+        doubling   //!< Reallocate the arrays with twice the capacity.
+    };
+
     //! Linked list with preallocated memory and upper bound on size.
     /*!
      * Bounded lists store elements in an array that is allocated at the time of construction.
@@ -30,10 +41,26 @@ namespace spica {
      * Internally, bounded lists reserve the first location of the storage array (index 0) to
      * hold a sentinel node. This node is never initialized but its pointers to the next and
      * previous node are used.
+     *
+     * The items, the "next" links, and the "previous" links are kept in three parallel arrays.
+     * The links are indices of type Index. Using a narrower type, such as std::uint32_t, halves
+     * the memory used by the links (or better) but limits the capacity of the list to the
+     * largest value of that type.
+     *
+     * A list created with list_growth::doubling reallocates its arrays when it becomes full,
+     * and reserve( ) can enlarge any list. Each item stays at the same index in the new arrays,
+     * so iterators remain valid, but pointers and references to the items do not.
+     *
+     * After many insertions and erasures the order of the list has little to do with the
+     * order of the items in memory, and iteration jumps around the arrays. Calling compact( )
+     * moves the items so that the list order is the array order, making iteration sequential.
      */
-    template<typename T>
+    template<typename T, typename Index = std::size_t>
     class BoundedList {
 
+        static_assert( std::is_integral_v<Index> && std::is_unsigned_v<Index>,
+                       "BoundedList indices must be of an unsigned integral type" );
+
         BoundedList( const BoundedList & ) = delete;
         BoundedList &operator=( const BoundedList & ) = delete;
 
@@ -47,17 +74,28 @@ namespace spica {
         typedef const T  &const_reference;
         typedef std::size_t    size_type;
         typedef std::ptrdiff_t difference_type;
+        typedef Index          index_type;
 
     private:
-        T         *raw;       // Preallocated block of raw memory.
-        size_type *next;      // Array of "next" indices.
-        size_type *previous;  // Array of "previous" indices.
-        size_type  count;     // Number of items in list.
-        size_type  capacity;  // Size of preallocated block.
-        size_type  free;      // Front of the free list.
+        T          *raw;       // Preallocated block of raw memory.
+        Index      *next;      // Array of "next" indices.
+        Index      *previous;  // Array of "previous" indices.
+        size_type   count;     // Number of items in list.
+        size_type   capacity;  // Size of preallocated block.
+        size_type   free;      // Front of the free list.
+        list_growth growth;    // What to do when the list is full.
 
         void do_initialize(size_type max_size);
 
+        // Makes room for one more item or throws std::length_error.
+        void make_room( );
+
+        // Reallocates the arrays with the given capacity, keeping each item at its index.
+        void reallocate( size_type new_capacity );
+
+        // Links the first count slots in order, followed by the remaining slots as free slots.
+        void link_in_order( ) noexcept;
+
     public:
 
         //! Bounded list iterators.
@@ -135,16 +173,16 @@ namespace spica {
             iterator( ) noexcept : my_list( 0 ), my_node( 0 )
                 { }
 
-        }; // End of BoundedList<T>::iterator
+        }; // End of BoundedList<T, Index>::iterator
 
         //friend class BoundedList::iterator;
 
-        BoundedList( size_type max_count );
+        BoundedList( size_type max_count, list_growth policy = list_growth::fixed );
         BoundedList(const std::initializer_list<T> &initializer);
        ~BoundedList( ) noexcept;
 
         BoundedList( BoundedList &&other ) noexcept;
-        BoundedList<T> &operator=(BoundedList &&other) noexcept;
+        BoundedList &operator=(BoundedList &&other) noexcept;
 
         //! Return the number of elements currently on the list. O(1)
         size_type size( ) const noexcept
@@ -158,6 +196,33 @@ namespace spica {
         size_type max_size( ) const noexcept
             { return( capacity ); }
 
+        //! Returns the growth policy given to the constructor.
+        list_growth growth_policy( ) const noexcept
+            { return( growth ); }
+
+        //! Enlarges the list so that it can hold at least new_capacity items.
+        /*!
+         * This works whatever the growth policy. Iterators remain valid but pointers and
+         * references to the items do not.
+         *
+         * \exception std::length_error if new_capacity can't be represented by Index.
+         */
+        void reserve( size_type new_capacity )
+            { if( new_capacity > capacity ) reallocate( new_capacity ); }
+
+        //! Moves the items so that the list order matches their order in memory. O(max_size( ))
+        /*!
+         * Afterwards the i-th item of the list is at index i and the free slots follow the
+         * items in order, so iterating over the list (and appending to it) accesses the arrays
+         * sequentially. No memory is allocated; the items are moved in place. All iterators,
+         * pointers, and references to the items are invalidated.
+         *
+         * \exception Any exception thrown by T's move constructor or by swapping two items. In
+         * this case all the items are destroyed and the list is left empty before the
+         * exception is rethrown.
+         */
+        void compact( );
+
         iterator begin( ) noexcept
             { return( iterator( this, next[0] ) ); }
 
@@ -174,8 +239,8 @@ namespace spica {
         //! Appends item to the end of the list. O(1)
         /*!
          * \param item Reference to the new item. The type T must be copyable.
-         * \exception std::length_error if the list is full. In this case, the new item is not
-         * copied. Bounded lists never increase in capacity once they are created.
+         * \exception std::length_error if the list is full and its growth policy is
+         * list_growth::fixed. In this case, the new item is not copied.
          */
         void push_back( const T &item );
 
@@ -201,8 +266,8 @@ namespace spica {
          * \param item The new item to be inserted. The type T must be copyable.
          * \return An iterator that points at the new item as it exists on the list.
          * \exception std::length_error if there is insufficient space in the list for the new
-         * item. In this case, the new item is not copied. Bounded lists never increase in
-         * capacity once they are created.
+         * item and its growth policy is list_growth::fixed. In this case, the new item is not
+         * copied.
          */
         iterator insert( iterator pos, const T &item );
 
@@ -222,12 +287,15 @@ namespace spica {
     // IMPLEMENTATION BEGINS HERE!
     // ===========================
 
-    template<typename T>
-    void BoundedList<T>::do_initialize( size_type max_count )
+    template<typename T, typename Index>
+    void BoundedList<T, Index>::do_initialize( size_type max_count )
     {
+        if( max_count > std::numeric_limits<Index>::max( ) )
+            throw std::length_error( "BoundedList: capacity too large for the index type" );
+
         std::unique_ptr<char[]> temp_raw( new char[( max_count + 1 ) * sizeof(T)] );
-        std::unique_ptr<size_type[]> temp_next( new size_type[max_count + 1] );
-        std::unique_ptr<size_type[]> temp_previous( new size_type[max_count + 1] );
+        std::unique_ptr<Index[]> temp_next( new Index[max_count + 1] );
+        std::unique_ptr<Index[]> temp_previous( new Index[max_count + 1] );
 
         raw      = reinterpret_cast<T*>( temp_raw.release( ) );
         next     = temp_next.release( );
@@ -251,15 +319,76 @@ namespace spica {
     }
 
 
-    template<typename T>
-    BoundedList<T>::BoundedList( size_type max_count )
+    template<typename T, typename Index>
+    void BoundedList<T, Index>::make_room( )
+    {
+        const size_type limit = std::numeric_limits<Index>::max( );
+        if( growth == list_growth::fixed || capacity == limit )
+            throw std::length_error( "BoundedList: full; can't increase capacity" );
+
+        reallocate( ( capacity < 4 ) ? 8 : ( capacity > limit / 2 ) ? limit : 2 * capacity );
+    }
+
+
+    //
+    // reallocate
+    //
+    // The items are moved (or copied, if their move constructor might throw) into the same
+    // slots of the new block, so the links can be copied unchanged and iterators, which hold
+    // indices, stay valid. The new slots are put on the front of the free list.
+    //
+    template<typename T, typename Index>
+    void BoundedList<T, Index>::reallocate( size_type new_capacity )
+    {
+        if( new_capacity > std::numeric_limits<Index>::max( ) )
+            throw std::length_error( "BoundedList: capacity too large for the index type" );
+
+        std::unique_ptr<char[]> temp_raw( new char[( new_capacity + 1 ) * sizeof(T)] );
+        std::unique_ptr<Index[]> temp_next( new Index[new_capacity + 1] );
+        std::unique_ptr<Index[]> temp_previous( new Index[new_capacity + 1] );
+        T *new_raw = reinterpret_cast<T *>( temp_raw.get( ) );
+
+        size_type current = next[0];
+        try {
+            while( current != 0 ) {
+                new ( &new_raw[current] ) T( std::move_if_noexcept( raw[current] ) );
+                current = next[current];
+            }
+        }
+        catch( ... ) {
+            for( size_type p = next[0]; p != current; p = next[p] ) new_raw[p].~T( );
+            throw;
+        }
+        for( current = next[0]; current != 0; current = next[current] ) raw[current].~T( );
+
+        std::copy( next, next + capacity + 1, temp_next.get( ) );
+        std::copy( previous, previous + capacity + 1, temp_previous.get( ) );
+        for( size_type i = capacity + 1; i < new_capacity; ++i ) {
+            temp_next[i] = static_cast<Index>( i + 1 );
+        }
+        temp_next[new_capacity] = static_cast<Index>( free );
+        free = capacity + 1;
+
+        delete [] previous;
+        delete [] next;
+        delete [] reinterpret_cast<char *>( raw );
+        raw      = reinterpret_cast<T *>( temp_raw.release( ) );
+        next     = temp_next.release( );
+        previous = temp_previous.release( );
+        capacity = new_capacity;
+    }
+
+
+    template<typename T, typename Index>
+    BoundedList<T, Index>::BoundedList( size_type max_count, list_growth policy ) : growth( policy )
     {
         do_initialize( max_count );
     }
 
 
-    template<typename T>
-    BoundedList<T>::BoundedList( const std::initializer_list<T> &initializer )
+    template<typename T, typename Index>
+    BoundedList<T, Index>::BoundedList( const std::initializer_list<T> &initializer ) :
+        growth( list_growth::fixed )
     {
         // Default construct *this so the list is fully functional.
         do_initialize( initializer.size( ) );
@@ -272,8 +401,8 @@ namespace spica {
     }
 
 
-    template<typename T>
-    BoundedList<T>::~BoundedList( ) noexcept
+    template<typename T, typename Index>
+    BoundedList<T, Index>::~BoundedList( ) noexcept
     {
         if( raw == nullptr ) return;
 
@@ -291,8 +420,8 @@ namespace spica {
     }
 
 
-    template<typename T>
-    BoundedList<T>::BoundedList( BoundedList&& other ) noexcept
+    template<typename T, typename Index>
+    BoundedList<T, Index>::BoundedList( BoundedList&& other ) noexcept
     {
         raw      = other.raw;
         next     = other.next;
@@ -300,6 +429,7 @@ namespace spica {
         count    = other.count;
         capacity = other.capacity;
         free     = other.free;
+        growth   = other.growth;
 
         other.raw      = nullptr;
         other.next     = nullptr;
@@ -307,8 +437,8 @@ namespace spica {
     }
 
 
-    template<typename T>
-    BoundedList<T> &BoundedList<T>::operator=( BoundedList&& other ) noexcept
+    template<typename T, typename Index>
+    BoundedList<T, Index> &BoundedList<T, Index>::operator=( BoundedList&& other ) noexcept
     {
         if( this != &other ) {
             this->~BoundedList( );
@@ -319,6 +449,7 @@ namespace spica {
             count    = other.count;
             capacity = other.capacity;
             free     = other.free;
+            growth   = other.growth;
 
             other.raw      = nullptr;
             other.next     = nullptr;
@@ -328,11 +459,19 @@ namespace spica {
     }
 
 
-    template<typename T>
-    void BoundedList<T>::push_back( const T &item )
+    template<typename T, typename Index>
+    void BoundedList<T, Index>::push_back( const T &item )
     {
-        if( free == 0 )
-            throw std::length_error( "BoundedList: full; can't increase capacity" );
+        if( free == 0 ) {
+            // Growing frees the old block, which might hold item, so copy it first.
+            if( growth == list_growth::doubling ) {
+                T copy( item );
+                make_room( );
+                push_back( copy );
+                return;
+            }
+            make_room( );
+        }
 
         // Pull a slot off the free list.
         size_type new_item = free;
@@ -350,9 +489,9 @@ namespace spica {
     }
 
 
-    template<typename T>
+    template<typename T, typename Index>
     template<typename ForwardIterator>
-    void BoundedList<T>::push_back( ForwardIterator first, ForwardIterator last )
+    void BoundedList<T, Index>::push_back( ForwardIterator first, ForwardIterator last )
     {
         while( first != last ) {
             push_back( *first );
@@ -361,8 +500,8 @@ namespace spica {
     }
 
 
-    template<typename T>
-    void BoundedList<T>::pop_back( ) noexcept
+    template<typename T, typename Index>
+    void BoundedList<T, Index>::pop_back( ) noexcept
     {
         // Remove the last item (I assume one is present).
         size_type p = previous[previous[0]];
@@ -376,15 +515,22 @@ namespace spica {
     }
 
 
-    template<typename T>
-    typename BoundedList<T>::iterator
-        BoundedList<T>::insert( iterator pos, const T &item )
+    template<typename T, typename Index>
+    typename BoundedList<T, Index>::iterator
+        BoundedList<T, Index>::insert( iterator pos, const T &item )
     {
         size_type p;
 
-        // If there is no space for the new item, just throw and die.
-        if( count == capacity )
-            throw std::length_error( "BoundedList: full; can't increase capacity" );
+        // If there is no space for the new item, grow or throw. Growing frees the old block,
+        // which might hold item, so copy it first.
+        if( count == capacity ) {
+            if( growth == list_growth::doubling ) {
+                T copy( item );
+                make_room( );
+                return insert( pos, copy );
+            }
+            make_room( );
+        }
 
         // Locate a free slot and construct the incoming item into it.
         p = free;
@@ -401,9 +547,9 @@ namespace spica {
     }
 
 
-    template<typename T>
-    typename BoundedList<T>::iterator
-        BoundedList<T>::erase( iterator pos ) noexcept
+    template<typename T, typename Index>
+    typename BoundedList<T, Index>::iterator
+        BoundedList<T, Index>::erase( iterator pos ) noexcept
     {
         size_type p = pos.my_node;
         size_type temp = next[p];
@@ -416,6 +562,77 @@ namespace spica {
         count--;
         return( iterator(this, temp) );
     }
+
+
+    //
+    // compact
+    //
+    // The previous array is used to record where the contents of each slot belong: the i-th
+    // item of the list belongs at index i and the free slots (which hold no objects) take the
+    // remaining indices. Each swap puts the contents of one slot in its final place, so there
+    // are at most max_size( ) swaps. A slot holds an item exactly when its destination is at
+    // most count. Finally the links are rewritten to describe the new order.
+    //
+    template<typename T, typename Index>
+    void BoundedList<T, Index>::compact( )
+    {
+        Index *destination = previous;
+        size_type rank = 0;
+        for( size_type p = next[0]; p != 0; p = next[p] ) destination[p] = static_cast<Index>( ++rank );
+        for( size_type p = free; p != 0; p = next[p] ) destination[p] = static_cast<Index>( ++rank );
+
+        try {
+            for( size_type i = 1; i <= capacity; ++i ) {
+                while( destination[i] != i ) {
+                    size_type j = destination[i];
+                    bool i_live = destination[i] <= count;
+                    bool j_live = destination[j] <= count;
+                    if( i_live && j_live ) {
+                        using std::swap;
+                        swap( raw[i], raw[j] );
+                    }
+                    else if( i_live ) {
+                        new ( &raw[j] ) T( std::move( raw[i] ) );
+                        raw[i].~T( );
+                    }
+                    else if( j_live ) {
+                        new ( &raw[i] ) T( std::move( raw[j] ) );
+                        raw[j].~T( );
+                    }
+                    std::swap( destination[i], destination[j] );
+                }
+            }
+        }
+        catch( ... ) {
+            for( size_type i = 1; i <= capacity; ++i ) {
+                if( destination[i] <= count ) raw[i].~T( );
+            }
+            count = 0;
+            link_in_order( );
+            throw;
+        }
+        link_in_order( );
+    }
+
+
+    template<typename T, typename Index>
+    void BoundedList<T, Index>::link_in_order( ) noexcept
+    {
+        for( size_type i = 1; i <= capacity; ++i ) {
+            next[i] = static_cast<Index>( i + 1 );
+            previous[i] = static_cast<Index>( i - 1 );
+        }
+        next[0] = ( count > 0 ) ? 1 : 0;
+        previous[0] = static_cast<Index>( count );
+        if( count > 0 ) next[count] = 0;
+        if( count < capacity ) {
+            next[capacity] = 0;
+            free = count + 1;
+        }
+        else {
+            free = 0;
+        }
+    }
 }
 
 #endif
@@ -0,0 +1,320 @@
+/*! \file    ConcurrentBoundedList.hpp
+ *  \brief   Fixed capacity object pool that can be used by many threads at once.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ *
+ * ConcurrentBoundedList is the BoundedList storage scheme without the list: a block of slots
+ * allocated when the object is constructed, and a free list threaded through an array of
+ * indices. It serves programs that use a BoundedList as an object pool, allocating with insert
+ * and releasing with erase, from several threads. Such programs don't need the order of the
+ * list, and keeping a shared doubly linked list consistent would serialize every operation, so
+ * the items are not linked together. Instead insert returns a pointer to the new item and
+ * erase takes that pointer back.
+ *
+ * The free list is a lock-free stack. Its top is a single atomic word holding the index of the
+ * top slot and a generation count. Every change to the stack increments the generation, so a
+ * thread that read the top, was delayed, and then tries to replace it fails even if the same
+ * slot has returned to the top in the meantime (the ABA problem). The generation is 32 bits
+ * so a stale top would have to survive four billion operations to be mistaken for a new one.
+ *
+ * Even a lock-free stack has one word that every thread writes. A local_cache holds a few free
+ * slots for one thread and trades with the shared stack in batches, each batch costing a
+ * single compare and swap.
+ */
+
+#ifndef CONCURRENTBOUNDEDLIST_HPP
+#define CONCURRENTBOUNDEDLIST_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace spica {
+
+    //! Fixed capacity object pool with a lock-free free list.
+    /*!
+     * Slots are numbered from 1 to max_size( ) with indices of type Index, which can be at most
+     * 32 bits wide. Slot 0 is not used so that 0 can mark the end of the free list.
+     *
+     * The pool itself (construction, destruction) must not be used concurrently. The
+     * destructor destroys the items that are still present, which requires that every
+     * local_cache of the pool has been destroyed first.
+     */
+    template<typename T, typename Index = std::uint32_t>
+    class ConcurrentBoundedList {
+
+        static_assert( std::is_integral_v<Index> && std::is_unsigned_v<Index> && sizeof( Index ) <= 4,
+                       "ConcurrentBoundedList indices must be of an unsigned type of at most 32 bits" );
+
+        ConcurrentBoundedList( const ConcurrentBoundedList & ) = delete;
+        ConcurrentBoundedList &operator=( const ConcurrentBoundedList & ) = delete;
+
+    public:
+
+        // The usual typedef names.
+        typedef       T  value_type;
+        typedef       T *pointer;
+        typedef const T *const_pointer;
+        typedef       T  &reference;
+        typedef const T  &const_reference;
+        typedef std::size_t    size_type;
+        typedef Index          index_type;
+
+    private:
+        T                   *raw;       // Preallocated block of raw memory.
+        std::atomic<Index>  *next;      // Array of "next" indices for the free list.
+        size_type            capacity;  // Size of preallocated block.
+
+        // Top of the free list: the generation in the high 32 bits, the index in the low 32.
+        alignas( 64 ) std::atomic<std::uint64_t> top;
+
+        static Index index_of( std::uint64_t word )
+            { return static_cast<Index>( word & 0xFFFFFFFFU ); }
+
+        static std::uint64_t make_top( std::uint64_t old_word, size_type index )
+            { return ( ( old_word >> 32 ) + 1 ) << 32 | index; }
+
+        // Removes up to limit slots from the free list and stores them in result. Returns the
+        // number of slots removed; zero if the free list is empty.
+        size_type pop_slots( Index *result, size_type limit ) noexcept;
+
+        // Returns the given slots to the free list. The slots must not be on the free list.
+        void push_slots( const Index *slots, size_type n ) noexcept;
+
+        // Constructs a copy of item in the given slot. Returns the slot to the free list if
+        // the copy constructor throws.
+        T *construct( Index slot, const T &item );
+
+    public:
+
+        //! Holds free slots for the use of one thread.
+        /*!
+         * A local_cache must only be used by one thread at a time. Items inserted through one
+         * cache can be erased through another cache or through the pool itself. When a cache
+         * is destroyed it returns its free slots to the pool.
+         */
+        class local_cache {
+
+            local_cache( const local_cache & ) = delete;
+            local_cache &operator=( const local_cache & ) = delete;
+
+        public:
+            //! Number of free slots a cache can hold.
+            static const size_type cache_size = 64;
+
+            //! Creates an empty cache for the given pool.
+            explicit local_cache( ConcurrentBoundedList &pool ) noexcept :
+                my_pool( pool ), count( 0 )
+                { }
+
+            //! Returns the cached slots to the pool.
+           ~local_cache( )
+                { my_pool.push_slots( slots, count ); }
+
+            //! Like ConcurrentBoundedList::insert but takes slots from the cache when possible.
+            T *insert( const T &item );
+
+            //! Like ConcurrentBoundedList::erase but keeps the slot in the cache when possible.
+            void erase( T *item ) noexcept;
+
+        private:
+            ConcurrentBoundedList &my_pool;
+            size_type              count;               // Number of slots in the cache.
+            Index                  slots[cache_size];
+        };
+
+        //! Creates a pool with room for max_count items.
+        /*!
+         * \exception std::length_error if max_count can't be represented by Index.
+         */
+        explicit ConcurrentBoundedList( size_type max_count );
+
+        //! Destroys the items that are still present. See the class description.
+       ~ConcurrentBoundedList( ) noexcept;
+
+        //! Returns the number of items the pool can hold.
+        size_type max_size( ) const noexcept
+            { return( capacity ); }
+
+        //! Copies an item into a free slot and returns a pointer to the copy. Thread safe.
+        /*!
+         * \exception std::length_error if there are no free slots. In this case, the new item
+         * is not copied. Some slots may be held in local caches.
+         */
+        T *insert( const T &item );
+
+        //! Destroys an item and returns its slot to the pool. Thread safe.
+        /*!
+         * \param item A pointer returned by insert (of the pool or one of its caches). The
+         * item must not have been erased already.
+         */
+        void erase( T *item ) noexcept;
+
+    };  // End of ConcurrentBoundedList<T, Index>
+
+    // ===========================
+    // IMPLEMENTATION BEGINS HERE!
+    // ===========================
+
+    //
+    // pop_slots
+    //
+    // The chain of slots below the top is read before the compare and swap. If the swap
+    // succeeds the generation has not changed, so no slot was pushed or popped in between and
+    // the chain that was read is still the top of the stack. Reads of a chain that changes
+    // under us return stale indices, which is harmless since the swap then fails.
+    //
+    template<typename T, typename Index>
+    typename ConcurrentBoundedList<T, Index>::size_type
+        ConcurrentBoundedList<T, Index>::pop_slots( Index *result, size_type limit ) noexcept
+    {
+        std::uint64_t old_top = top.load( std::memory_order_acquire );
+        while( true ) {
+            size_type n = 0;
+            Index current = index_of( old_top );
+            while( current != 0 && n < limit ) {
+                result[n++] = current;
+                current = next[current].load( std::memory_order_relaxed );
+            }
+            if( n == 0 ) return 0;
+            if( top.compare_exchange_weak( old_top, make_top( old_top, current ),
+                                           std::memory_order_acq_rel, std::memory_order_acquire ) )
+                return n;
+        }
+    }
+
+
+    template<typename T, typename Index>
+    void ConcurrentBoundedList<T, Index>::push_slots( const Index *slots, size_type n ) noexcept
+    {
+        if( n == 0 ) return;
+
+        // Chain the slots together. No other thread can reach them yet.
+        for( size_type i = 0; i + 1 < n; ++i ) {
+            next[slots[i]].store( slots[i + 1], std::memory_order_relaxed );
+        }
+
+        std::uint64_t old_top = top.load( std::memory_order_relaxed );
+        do {
+            next[slots[n - 1]].store( index_of( old_top ), std::memory_order_relaxed );
+        } while( !top.compare_exchange_weak( old_top, make_top( old_top, slots[0] ),
+                                             std::memory_order_acq_rel, std::memory_order_relaxed ) );
+    }
+
+
+    template<typename T, typename Index>
+    T *ConcurrentBoundedList<T, Index>::construct( Index slot, const T &item )
+    {
+        try {
+            return new ( &raw[slot] ) T( item );
+        }
+        catch( ... ) {
+            push_slots( &slot, 1 );
+            throw;
+        }
+    }
+
+
+    template<typename T, typename Index>
+    ConcurrentBoundedList<T, Index>::ConcurrentBoundedList( size_type max_count ) :
+        raw( nullptr ), next( nullptr ), capacity( max_count ), top( 0 )
+    {
+        if( max_count > std::numeric_limits<Index>::max( ) )
+            throw std::length_error( "ConcurrentBoundedList: capacity too large for the index type" );
+
+        std::unique_ptr<char[]> temp_raw( new char[( max_count + 1 ) * sizeof(T)] );
+        next = new std::atomic<Index>[max_count + 1];
+        raw  = reinterpret_cast<T *>( temp_raw.release( ) );
+
+        // Prepare the free list.
+        for( size_type i = 0; i <= capacity; ++i ) {
+            next[i].store( static_cast<Index>( ( i == 0 || i == capacity ) ? 0 : i + 1 ),
+                           std::memory_order_relaxed );
+        }
+        if( capacity > 0 ) top.store( 1, std::memory_order_relaxed );
+    }
+
+
+    template<typename T, typename Index>
+    ConcurrentBoundedList<T, Index>::~ConcurrentBoundedList( ) noexcept
+    {
+        // Destroy the items in the slots that are not on the free list. The free slots are
+        // marked by linking each one to itself, which a slot never is on the free list, so the
+        // stale links of the occupied slots can't be mistaken for the mark.
+        if constexpr( !std::is_trivially_destructible_v<T> ) {
+            Index p = index_of( top.load( ) );
+            while( p != 0 ) {
+                Index following = next[p].load( );
+                next[p].store( p );
+                p = following;
+            }
+            for( size_type i = 1; i <= capacity; ++i ) {
+                if( next[i].load( ) != i ) raw[i].~T( );
+            }
+        }
+
+        delete [] next;
+        delete [] reinterpret_cast<char *>( raw );
+    }
+
+
+    template<typename T, typename Index>
+    T *ConcurrentBoundedList<T, Index>::insert( const T &item )
+    {
+        Index slot;
+        if( pop_slots( &slot, 1 ) == 0 )
+            throw std::length_error( "ConcurrentBoundedList: full; can't increase capacity" );
+        return construct( slot, item );
+    }
+
+
+    template<typename T, typename Index>
+    void ConcurrentBoundedList<T, Index>::erase( T *item ) noexcept
+    {
+        Index slot = static_cast<Index>( item - raw );
+        item->~T( );
+        push_slots( &slot, 1 );
+    }
+
+
+    // ------------------------------
+    // Methods of local_cache
+    // ------------------------------
+
+    //
+    // local_cache::insert
+    //
+    // An empty cache is refilled with half its capacity. This leaves room for erasures so a
+    // thread that alternates between insert and erase near the boundary doesn't go to the
+    // shared stack on every call.
+    //
+    template<typename T, typename Index>
+    T *ConcurrentBoundedList<T, Index>::local_cache::insert( const T &item )
+    {
+        if( count == 0 ) {
+            count = my_pool.pop_slots( slots, cache_size / 2 );
+            if( count == 0 )
+                throw std::length_error( "ConcurrentBoundedList: full; can't increase capacity" );
+        }
+        return my_pool.construct( slots[--count], item );
+    }
+
+
+    template<typename T, typename Index>
+    void ConcurrentBoundedList<T, Index>::local_cache::erase( T *item ) noexcept
+    {
+        item->~T( );
+        if( count == cache_size ) {
+            my_pool.push_slots( slots + cache_size / 2, cache_size / 2 );
+            count = cache_size / 2;
+        }
+        slots[count++] = static_cast<Index>( item - my_pool.raw );
+    }
+}
+
+#endif
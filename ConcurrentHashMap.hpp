@@ -0,0 +1,649 @@
+/*! \file    ConcurrentHashMap.hpp
+    \brief   Hash map and set that can be used by many threads at once.
+    \author  Peter Chapin <spicacality@kelseymountain.org>
+
+    ConcurrentHashMap is a chained hash table designed for lookup tables that are shared by
+    many threads and read much more often than they are written. Lookups take no locks. They
+    follow the chains using atomic loads inside an epoch_guard (see epoch.hpp) so they never
+    wait for writers and never write to shared memory other than the thread's own epoch
+    record. Writers lock one of a fixed number of stripes selected by the low bits of the key's
+    hash. Writers to different stripes proceed in parallel.
+
+    Nodes are never modified after they are published. Assigning a new value to a key replaces
+    its node, and removed nodes are retired rather than deleted, so a reader always sees a
+    consistent key/value pair. Because of this the map can't hand out references to its
+    values; lookups copy the value out. Values that are expensive to copy can be stored through
+    a std::shared_ptr.
+
+    When some stripe holds more elements than its share of the buckets, a table with twice as
+    many buckets is allocated. The elements are moved to it a few buckets at a time by the
+    threads that write to the map. A migrated bucket in the old table is replaced by a marker
+    that sends readers and writers to the new table, so readers are never stopped by a resize.
+    The old table is retired once all of its buckets are migrated. The number of buckets is a
+    power of two, at least stripe_count. Since the stripe is chosen by the low bits of the
+    hash, one stripe lock covers a key's bucket in both tables.
+
+    Iteration with for_each is weakly consistent: it sees every element that was present for
+    the whole iteration and might or might not see elements inserted or removed during it.
+
+    Keys and values must be copy constructible; elements are copied when they move to a new
+    table. If such a copy throws, the exception propagates out of the write that was helping
+    with the resize. The map stays correct, but it won't grow any further.
+*/
+
+#ifndef CONCURRENTHASHMAP_HPP
+#define CONCURRENTHASHMAP_HPP
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <optional>
+#include <utility>
+#include "epoch.hpp"
+#include "synchronize.hpp"
+
+namespace spica {
+
+    namespace detail {
+
+        // Scrambles a hash value so that its low bits depend on all of its bits.
+        inline std::uint64_t spread_hash( std::uint64_t hash )
+        {
+            hash ^= hash >> 33;
+            hash *= 0xC4CEB9FE1A85EC53ULL;
+            hash ^= hash >> 33;
+            return hash;
+        }
+
+        template< typename K, typename V >
+        struct concurrent_node {
+            concurrent_node( const K &k, const V &v, std::uint64_t h, concurrent_node *n )
+                : key( k ), value( v ), hash( h ), next( n ) { }
+
+            const K                          key;
+            [[no_unique_address]] const V    value;
+            const std::uint64_t              hash;
+            std::atomic< concurrent_node * > next;
+        };
+
+        template< typename K, typename V >
+        struct concurrent_table {
+            typedef concurrent_node< K, V > node;
+
+            explicit concurrent_table( std::size_t bucket_count )
+                : size( bucket_count ), buckets( new std::atomic< node * >[bucket_count] )
+            {
+                for( std::size_t i = 0; i < size; ++i )
+                    buckets[i].store( nullptr, std::memory_order_relaxed );
+            }
+
+            // Deletes the chains that are still in this table (not those already migrated).
+           ~concurrent_table( )
+            {
+                for( std::size_t i = 0; i < size; ++i ) {
+                    node *p = buckets[i].load( std::memory_order_relaxed );
+                    if( p == moved( ) ) continue;
+                    while( p != nullptr ) {
+                        node *next = p->next.load( std::memory_order_relaxed );
+                        delete p;
+                        p = next;
+                    }
+                }
+            }
+
+            // Marker stored in a bucket whose chain has been copied to the next table.
+            static node *moved( )
+            {
+                alignas( node ) static char marker;
+                return reinterpret_cast< node * >( &marker );
+            }
+
+            const std::size_t                          size;     // A power of two.
+            std::unique_ptr< std::atomic< node * >[] > buckets;
+            std::atomic< concurrent_table * >          next{ nullptr };   // Resize target.
+            std::atomic< std::size_t >                 claimed{ 0 };      // Buckets handed out.
+            std::atomic< std::size_t >                 migrated{ 0 };     // Buckets finished.
+        };
+
+        // Mapped type of ConcurrentHashSet. Takes no space in the nodes.
+        struct concurrent_unit { };
+
+    }
+
+
+    //! Hash map with lock-free lookups and striped locking for updates.
+    template< typename K,
+              typename V,
+              typename Hash = std::hash< K >,
+              typename Eq   = std::equal_to< K > >
+    class ConcurrentHashMap {
+    public:
+        typedef K           key_type;
+        typedef V           mapped_type;
+        typedef std::size_t size_type;
+        typedef Hash        hasher;
+        typedef Eq          key_equal;
+
+        //! Number of write locks. Also the smallest number of buckets.
+        static const size_type stripe_count = 64;
+
+        //! Creates an empty map.
+        /*!
+         * \param bucket_count The initial number of buckets, rounded up to a power of two.
+         * \param spin_limit Given to the stripe locks. See mutex_sem.
+         */
+        explicit ConcurrentHashMap( size_type bucket_count = 0, int spin_limit = 0 );
+
+        //! The map must not be in use by other threads when it is destroyed.
+       ~ConcurrentHashMap( );
+
+        //! Returns the number of elements. Approximate if other threads are writing.
+        size_type size( )  const;
+        bool      empty( ) const { return size( ) == 0; }
+
+        //! Returns the number of buckets in the newest table.
+        size_type bucket_count( ) const;
+
+        //! Returns true if elements are being moved to a larger table.
+        bool resizing( ) const
+        {
+            epoch_guard guard;
+            return current.load( std::memory_order_acquire )->next.load( ) != nullptr;
+        }
+
+        //! Copies the value with the given key into result. Returns false if there is none.
+        bool find( const K &key, V &result ) const;
+
+        //! Returns a copy of the value with the given key, if there is one.
+        std::optional< V > get( const K &key ) const;
+
+        bool contains( const K &key ) const;
+
+        //! Inserts the key and value if the key is not present. Returns true if inserted.
+        bool insert( const K &key, const V &value );
+
+        //! Replaces the key's value or inserts the pair. Returns true if the key was inserted.
+        bool insert_or_assign( const K &key, const V &value );
+
+        //! Replaces the key's value with f( old_value ). Returns false if the key is absent.
+        /*!
+         * The function is called with the key's stripe locked, so updates made this way are
+         * atomic with respect to other writers. It should be short and must not use the map.
+         */
+        template< typename F >
+        bool update( const K &key, F f );
+
+        //! Removes the element with the given key. Returns true if it was present.
+        bool erase( const K &key );
+
+        //! Removes all elements and returns to the initial number of buckets.
+        void clear( );
+
+        //! Calls f( key, value ) for each element. See the file comment about consistency.
+        template< typename F >
+        void for_each( F f ) const;
+
+    private:
+        typedef detail::concurrent_node< K, V >  node;
+        typedef detail::concurrent_table< K, V > table;
+        typedef std::atomic< node * >            link;
+
+        // Number of buckets a writer migrates after each update while a resize is underway.
+        static const size_type migration_batch = 16;
+
+        struct alignas( 64 ) stripe {
+            mutex_sem                lock;
+            std::atomic< size_type > count{ 0 };   // Elements in this stripe's buckets.
+        };
+
+        std::atomic< table * > current;      // The table given to new operations.
+        size_type              minimum_size;
+        mutable stripe         stripes[stripe_count];
+
+        [[no_unique_address]] Hash hash_function;
+        [[no_unique_address]] Eq   equal_function;
+
+        std::uint64_t hash_of( const K &key ) const
+            { return detail::spread_hash( static_cast< std::uint64_t >( hash_function( key ) ) ); }
+
+        stripe &stripe_of( std::uint64_t hash ) const
+            { return stripes[hash & ( stripe_count - 1 )]; }
+
+        static void add_count( stripe &s, size_type delta )
+            { s.count.store( s.count.load( std::memory_order_relaxed ) + delta,
+                             std::memory_order_relaxed ); }
+
+        // Returns the bucket holding the hash's chain, following migrated buckets to the newer
+        // tables. The chain's first node is returned in head.
+        static link *locate_bucket( table *t, std::uint64_t hash, node *&head );
+
+        // Returns the link that points at the node with the key, or nullptr if there is none.
+        // The caller must hold the stripe lock.
+        link *find_link( link *bucket, node *head, std::uint64_t hash, const K &key ) const;
+
+        // Starts a resize if the stripe is too full. The caller must hold the stripe lock.
+        void check_growth( table *t, const stripe &s );
+
+        // Migrates some buckets if a resize is underway.
+        void help_migrate( );
+
+        // Copies one bucket's chain to the next table and marks the bucket as moved.
+        void migrate_bucket( table *t, table *fresh, size_type index );
+
+        // Visits the chain of one bucket, following it into newer tables if it was migrated.
+        template< typename F >
+        static void visit_bucket( table *t, size_type index, F &f );
+
+        // Inhibit copying.
+        ConcurrentHashMap( const ConcurrentHashMap & );
+        ConcurrentHashMap &operator=( const ConcurrentHashMap & );
+    };
+
+
+    //! Hash set with lock-free lookups. A thin wrapper around ConcurrentHashMap.
+    template< typename K,
+              typename Hash = std::hash< K >,
+              typename Eq   = std::equal_to< K > >
+    class ConcurrentHashSet {
+    public:
+        typedef K           key_type;
+        typedef K           value_type;
+        typedef std::size_t size_type;
+
+        explicit ConcurrentHashSet( size_type bucket_count = 0, int spin_limit = 0 )
+            : map( bucket_count, spin_limit ) { }
+
+        size_type size( )         const { return map.size( ); }
+        bool      empty( )        const { return map.empty( ); }
+        size_type bucket_count( ) const { return map.bucket_count( ); }
+
+        bool contains( const K &key ) const { return map.contains( key ); }
+        bool insert( const K &key ) { return map.insert( key, detail::concurrent_unit( ) ); }
+        bool erase( const K &key )  { return map.erase( key ); }
+        void clear( )               { map.clear( ); }
+
+        //! Calls f( key ) for each element.
+        template< typename F >
+        void for_each( F f ) const
+            { map.for_each( [&f]( const K &key, const detail::concurrent_unit & ) { f( key ); } ); }
+
+    private:
+        ConcurrentHashMap< K, detail::concurrent_unit, Hash, Eq > map;
+    };
+
+
+    //
+    // Constructor and destructor
+    //
+    template< typename K, typename V, typename Hash, typename Eq >
+    ConcurrentHashMap< K, V, Hash, Eq >::ConcurrentHashMap( size_type bucket_count, int spin_limit )
+        : minimum_size( std::bit_ceil( bucket_count < stripe_count ? stripe_count : bucket_count ) )
+    {
+        current.store( new table( minimum_size ) );
+        for( stripe &s : stripes ) s.lock.set_spin_limit( spin_limit );
+    }
+
+
+    //
+    // A resize might be underway, in which case the current table's successor holds elements
+    // too. Tables that were already retired are deleted by the reclamation system.
+    //
+    template< typename K, typename V, typename Hash, typename Eq >
+    ConcurrentHashMap< K, V, Hash, Eq >::~ConcurrentHashMap( )
+    {
+        table *t = current.load( );
+        while( t != nullptr ) {
+            table *next = t->next.load( );
+            delete t;
+            t = next;
+        }
+    }
+
+
+    template< typename K, typename V, typename Hash, typename Eq >
+    typename ConcurrentHashMap< K, V, Hash, Eq >::size_type
+        ConcurrentHashMap< K, V, Hash, Eq >::size( ) const
+    {
+        size_type total = 0;
+        for( const stripe &s : stripes ) total += s.count.load( std::memory_order_relaxed );
+        return total;
+    }
+
+
+    template< typename K, typename V, typename Hash, typename Eq >
+    typename ConcurrentHashMap< K, V, Hash, Eq >::size_type
+        ConcurrentHashMap< K, V, Hash, Eq >::bucket_count( ) const
+    {
+        epoch_guard guard;
+        table *t = current.load( std::memory_order_acquire );
+        table *next = t->next.load( std::memory_order_acquire );
+        return ( next != nullptr ) ? next->size : t->size;
+    }
+
+
+    //
+    // Lookups
+    //
+    template< typename K, typename V, typename Hash, typename Eq >
+    typename ConcurrentHashMap< K, V, Hash, Eq >::link *
+        ConcurrentHashMap< K, V, Hash, Eq >::locate_bucket(
+            table *t, std::uint64_t hash, node *&head )
+    {
+        for( ;; ) {
+            link *bucket = &t->buckets[hash & ( t->size - 1 )];
+            head = bucket->load( std::memory_order_acquire );
+            if( head != table::moved( ) ) return bucket;
+            t = t->next.load( std::memory_order_acquire );
+        }
+    }
+
+
+    template< typename K, typename V, typename Hash, typename Eq >
+    bool ConcurrentHashMap< K, V, Hash, Eq >::find( const K &key, V &result ) const
+    {
+        std::uint64_t hash = hash_of( key );
+        epoch_guard guard;
+        node *p;
+        locate_bucket( current.load( std::memory_order_acquire ), hash, p );
+        for( ; p != nullptr; p = p->next.load( std::memory_order_acquire ) ) {
+            if( p->hash == hash && equal_function( p->key, key ) ) {
+                result = p->value;
+                return true;
+            }
+        }
+        return false;
+    }
+
+
+    template< typename K, typename V, typename Hash, typename Eq >
+    std::optional< V > ConcurrentHashMap< K, V, Hash, Eq >::get( const K &key ) const
+    {
+        std::uint64_t hash = hash_of( key );
+        epoch_guard guard;
+        node *p;
+        locate_bucket( current.load( std::memory_order_acquire ), hash, p );
+        for( ; p != nullptr; p = p->next.load( std::memory_order_acquire ) ) {
+            if( p->hash == hash && equal_function( p->key, key ) ) return p->value;
+        }
+        return std::nullopt;
+    }
+
+
+    template< typename K, typename V, typename Hash, typename Eq >
+    bool ConcurrentHashMap< K, V, Hash, Eq >::contains( const K &key ) const
+    {
+        std::uint64_t hash = hash_of( key );
+        epoch_guard guard;
+        node *p;
+        locate_bucket( current.load( std::memory_order_acquire ), hash, p );
+        for( ; p != nullptr; p = p->next.load( std::memory_order_acquire ) ) {
+            if( p->hash == hash && equal_function( p->key, key ) ) return true;
+        }
+        return false;
+    }
+
+
+    template< typename K, typename V, typename Hash, typename Eq >
+    typename ConcurrentHashMap< K, V, Hash, Eq >::link *
+        ConcurrentHashMap< K, V, Hash, Eq >::find_link(
+            link *bucket, node *head, std::uint64_t hash, const K &key ) const
+    {
+        link *previous = bucket;
+        for( node *p = head; p != nullptr; p = p->next.load( std::memory_order_relaxed ) ) {
+            if( p->hash == hash && equal_function( p->key, key ) ) return previous;
+            previous = &p->next;
+        }
+        return nullptr;
+    }
+
+
+    //
+    // Updates
+    //
+    // Each update locks the key's stripe and loads the current table while holding it. Nodes
+    // are published with release stores so a reader that finds a node also sees its contents.
+    // Replaced and removed nodes are retired because readers might still be looking at them.
+    //
+    template< typename K, typename V, typename Hash, typename Eq >
+    bool ConcurrentHashMap< K, V, Hash, Eq >::insert( const K &key, const V &value )
+    {
+        std::uint64_t hash = hash_of( key );
+        epoch_guard guard;
+        {
+            stripe &s = stripe_of( hash );
+            mutex_sem::grabber lock( s.lock );
+            table *t = current.load( std::memory_order_acquire );
+            node *head;
+            link *bucket = locate_bucket( t, hash, head );
+            if( find_link( bucket, head, hash, key ) != nullptr ) return false;
+            bucket->store( new node( key, value, hash, head ), std::memory_order_release );
+            add_count( s, 1 );
+            check_growth( t, s );
+        }
+        help_migrate( );
+        return true;
+    }
+
+
+    template< typename K, typename V, typename Hash, typename Eq >
+    bool ConcurrentHashMap< K, V, Hash, Eq >::insert_or_assign( const K &key, const V &value )
+    {
+        std::uint64_t hash = hash_of( key );
+        epoch_guard guard;
+        bool inserted = false;
+        {
+            stripe &s = stripe_of( hash );
+            mutex_sem::grabber lock( s.lock );
+            table *t = current.load( std::memory_order_acquire );
+            node *head;
+            link *bucket = locate_bucket( t, hash, head );
+            link *position = find_link( bucket, head, hash, key );
+            if( position != nullptr ) {
+                node *old = position->load( std::memory_order_relaxed );
+                position->store( new node( key, value, hash, old->next.load( ) ),
+                                 std::memory_order_release );
+                epoch_retire( old );
+            }
+            else {
+                bucket->store( new node( key, value, hash, head ), std::memory_order_release );
+                add_count( s, 1 );
+                check_growth( t, s );
+                inserted = true;
+            }
+        }
+        help_migrate( );
+        return inserted;
+    }
+
+
+    template< typename K, typename V, typename Hash, typename Eq >
+    template< typename F >
+    bool ConcurrentHashMap< K, V, Hash, Eq >::update( const K &key, F f )
+    {
+        std::uint64_t hash = hash_of( key );
+        epoch_guard guard;
+        {
+            stripe &s = stripe_of( hash );
+            mutex_sem::grabber lock( s.lock );
+            node *head;
+            link *bucket = locate_bucket( current.load( std::memory_order_acquire ), hash, head );
+            link *position = find_link( bucket, head, hash, key );
+            if( position == nullptr ) return false;
+            node *old = position->load( std::memory_order_relaxed );
+            position->store( new node( old->key, f( old->value ), hash, old->next.load( ) ),
+                             std::memory_order_release );
+            epoch_retire( old );
+        }
+        help_migrate( );
+        return true;
+    }
+
+
+    template< typename K, typename V, typename Hash, typename Eq >
+    bool ConcurrentHashMap< K, V, Hash, Eq >::erase( const K &key )
+    {
+        std::uint64_t hash = hash_of( key );
+        epoch_guard guard;
+        {
+            stripe &s = stripe_of( hash );
+            mutex_sem::grabber lock( s.lock );
+            node *head;
+            link *bucket = locate_bucket( current.load( std::memory_order_acquire ), hash, head );
+            link *position = find_link( bucket, head, hash, key );
+            if( position == nullptr ) return false;
+            node *old = position->load( std::memory_order_relaxed );
+            position->store( old->next.load( ), std::memory_order_release );
+            add_count( s, static_cast< size_type >( -1 ) );
+            epoch_retire( old );
+        }
+        help_migrate( );
+        return true;
+    }
+
+
+    //
+    // Holding every stripe lock keeps writers out. Readers might still be using the old
+    // tables so they are retired. A thread might be migrating buckets of the old table when
+    // it is replaced. That is harmless: the copies go to a retired table and the thread's
+    // attempt to make that table current fails.
+    //
+    template< typename K, typename V, typename Hash, typename Eq >
+    void ConcurrentHashMap< K, V, Hash, Eq >::clear( )
+    {
+        table *fresh = new table( minimum_size );
+        for( stripe &s : stripes ) s.lock.lock( );
+        table *old  = current.exchange( fresh );
+        table *next = old->next.load( );
+        for( stripe &s : stripes ) s.count.store( 0, std::memory_order_relaxed );
+        for( stripe &s : stripes ) s.lock.unlock( );
+
+        epoch_retire( old );
+        if( next != nullptr ) epoch_retire( next );
+    }
+
+
+    //
+    // Resizing
+    //
+    // A table is too full when any stripe holds more elements than it has buckets. With a
+    // reasonable hash function the stripes fill evenly so this is close to a load factor of
+    // one. Only the current table can start a resize and only if it isn't already resizing.
+    //
+    template< typename K, typename V, typename Hash, typename Eq >
+    void ConcurrentHashMap< K, V, Hash, Eq >::check_growth( table *t, const stripe &s )
+    {
+        if( s.count.load( std::memory_order_relaxed ) <= t->size / stripe_count ) return;
+        if( t->next.load( std::memory_order_acquire ) != nullptr ) return;
+
+        table *fresh = new table( 2 * t->size );
+        table *expected = nullptr;
+        if( !t->next.compare_exchange_strong( expected, fresh ) ) delete fresh;
+    }
+
+
+    //
+    // Buckets are claimed with an atomic counter so several threads can migrate at once. The
+    // thread that finishes the last bucket makes the new table current and retires the old
+    // one. Readers that still hold the old table follow its moved markers.
+    //
+    template< typename K, typename V, typename Hash, typename Eq >
+    void ConcurrentHashMap< K, V, Hash, Eq >::help_migrate( )
+    {
+        table *t = current.load( std::memory_order_acquire );
+        table *fresh = t->next.load( std::memory_order_acquire );
+        if( fresh == nullptr ) return;
+
+        for( size_type i = 0; i < migration_batch; ++i ) {
+            size_type index = t->claimed.fetch_add( 1 );
+            if( index >= t->size ) return;
+            migrate_bucket( t, fresh, index );
+            if( t->migrated.fetch_add( 1 ) + 1 == t->size ) {
+                table *expected = t;
+                if( current.compare_exchange_strong( expected, fresh ) ) epoch_retire( t );
+                return;
+            }
+        }
+    }
+
+
+    //
+    // Bucket i of the old table splits into buckets i and i + size of the new table. Nothing
+    // else can reach those buckets until the moved marker is stored, so they are filled with
+    // relaxed stores and published by the marker's release store. The old nodes are copied,
+    // not relinked, because readers might be traversing them.
+    //
+    template< typename K, typename V, typename Hash, typename Eq >
+    void ConcurrentHashMap< K, V, Hash, Eq >::migrate_bucket(
+        table *t, table *fresh, size_type index )
+    {
+        mutex_sem::grabber lock( stripes[index & ( stripe_count - 1 )].lock );
+        link &source = t->buckets[index];
+        link &low    = fresh->buckets[index];
+        link &high   = fresh->buckets[index + t->size];
+        node *chain  = source.load( std::memory_order_relaxed );
+
+        try {
+            for( node *p = chain; p != nullptr; p = p->next.load( std::memory_order_relaxed ) ) {
+                link &target = ( p->hash & t->size ) ? high : low;
+                target.store( new node( p->key, p->value, p->hash,
+                                        target.load( std::memory_order_relaxed ) ),
+                              std::memory_order_relaxed );
+            }
+        }
+        catch( ... ) {
+            for( link *target : { &low, &high } ) {
+                node *p = target->exchange( nullptr, std::memory_order_relaxed );
+                while( p != nullptr ) {
+                    node *next = p->next.load( std::memory_order_relaxed );
+                    delete p;
+                    p = next;
+                }
+            }
+            throw;
+        }
+
+        source.store( table::moved( ), std::memory_order_release );
+        while( chain != nullptr ) {
+            node *next = chain->next.load( std::memory_order_relaxed );
+            epoch_retire( chain );
+            chain = next;
+        }
+    }
+
+
+    //
+    // Iteration
+    //
+    template< typename K, typename V, typename Hash, typename Eq >
+    template< typename F >
+    void ConcurrentHashMap< K, V, Hash, Eq >::visit_bucket( table *t, size_type index, F &f )
+    {
+        node *p = t->buckets[index].load( std::memory_order_acquire );
+        if( p == table::moved( ) ) {
+            table *fresh = t->next.load( std::memory_order_acquire );
+            visit_bucket( fresh, index, f );
+            visit_bucket( fresh, index + t->size, f );
+            return;
+        }
+        for( ; p != nullptr; p = p->next.load( std::memory_order_acquire ) ) {
+            f( p->key, p->value );
+        }
+    }
+
+
+    template< typename K, typename V, typename Hash, typename Eq >
+    template< typename F >
+    void ConcurrentHashMap< K, V, Hash, Eq >::for_each( F f ) const
+    {
+        epoch_guard guard;
+        table *t = current.load( std::memory_order_acquire );
+        for( size_type i = 0; i < t->size; ++i ) visit_bucket( t, i, f );
+    }
+
+}
+
+#endif
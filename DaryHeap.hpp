@@ -0,0 +1,274 @@
+/*! \file    DaryHeap.hpp
+ *  \brief   Implicit d-ary heap container template
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef DARYHEAP_HPP
+#define DARYHEAP_HPP
+
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace spica {
+
+    //! Implicit d-ary heap container template.
+    /*!
+     * The items are kept in a single array in which the children of the item at index i are at
+     * indices Arity*i + 1 through Arity*i + Arity. There are no nodes and no pointers, so the
+     * heap uses no memory beyond the items themselves and a push or pop only touches a few
+     * cache lines. A larger arity makes the heap shallower, so push is faster, while pop must
+     * examine more children at each level. The default arity of four usually works best for
+     * small items; an arity of two gives the classic binary heap.
+     *
+     * DaryHeap provides the same interface as BinomialHeap except for handles: the items move
+     * around in the array as the heap changes, so push( ) does not return a handle and there are
+     * no decrease_key( ) or erase( ) operations. Use PairingHeap or FibonacciHeap when those
+     * are needed. Merging two heaps takes O(n) time rather than O(lg(n)).
+     */
+    template<typename T,
+             typename StrictWeakOrdering = std::less<T>,
+             typename Allocator = std::allocator<T>,
+             std::size_t Arity = 4>
+    class DaryHeap {
+
+        static_assert( Arity >= 2, "A d-ary heap must have an arity of at least two" );
+
+    public:
+        typedef       T                   key_type;
+        typedef       key_type            value_type;
+        typedef       StrictWeakOrdering  key_compare;
+        typedef       StrictWeakOrdering  value_compare;
+        typedef       key_type           *pointer;
+        typedef const key_type           *const_pointer;
+        typedef       key_type           &reference;
+        typedef const key_type           &const_reference;
+        typedef       std::size_t         size_type;
+        typedef       Allocator           allocator_type;
+
+        //! Iterators visit the items in an unspecified order (the order of the array).
+        typedef typename std::vector<T, Allocator>::const_iterator iterator;
+
+    private:
+        std::vector<T, Allocator> items;
+        StrictWeakOrdering comp;
+
+        // Moves the item at the given index toward the front until its parent does not come
+        // after it. The item is held aside while the parents move down into the hole.
+        void sift_up( size_type index );
+
+        // Moves the item at the given index away from the front until none of its children
+        // come before it.
+        void sift_down( size_type index );
+
+        // Establishes the heap order over the whole array in O(n) time.
+        void heapify( );
+
+    public:
+        //! Create an empty heap.
+        DaryHeap( const StrictWeakOrdering &C = StrictWeakOrdering( ),
+                  const Allocator &A = Allocator( ) )
+            : items( A ), comp( C )
+            { }
+
+        //! Create a heap from the given sequence in O(n) time.
+        template<typename InputIterator>
+        DaryHeap(
+            InputIterator first,
+            InputIterator last,
+            const StrictWeakOrdering &C = StrictWeakOrdering( ),
+            const Allocator &A = Allocator( )
+        ) : items( first, last, A ), comp( C )
+            { heapify( ); }
+
+        //! Return the number of data items in the heap. O(1)
+        size_type size( ) const
+            { return items.size( ); }
+
+        //! Returns true if the heap contains no items. O(1)
+        bool empty( ) const
+            { return items.empty( ); }
+
+        // These members are provided by other, similar container types.
+        key_compare key_comp( ) const
+            { return comp; }
+
+        value_compare value_comp( ) const
+            { return comp; }
+
+        allocator_type get_allocator( ) const
+            { return items.get_allocator( ); }
+
+        //! Reserves space for the given number of items.
+        void reserve( size_type n )
+            { items.reserve( n ); }
+
+        //! Return an iterator to the first item in the heap.
+        iterator begin( ) const { return items.begin( ); }
+
+        //! Return an iterator just past the last item in the heap.
+        iterator end( ) const { return items.end( ); }
+
+        //! Insert a copy of the given object into 'this' heap. O(lg(n))
+        void insert( const T &new_item )
+        {
+            items.push_back( new_item );
+            sift_up( items.size( ) - 1 );
+        }
+
+        //! Wrapper around insert for consistency with pop.
+        void push( const T &new_item )
+            { insert( new_item ); }
+
+        //! Inserts each item in the range [first, last) into the heap.
+        template<typename InputIterator>
+        void insert( InputIterator first, InputIterator last );
+
+        //! Return a reference to the object at the front of the heap. O(1)
+        /*!
+         * If the heap is empty when this method is called the effect is undefined.
+         */
+        const T &front( ) const
+            { return items.front( ); }
+
+        //! Extract the object at the front of the heap and throw away its value. O(lg(n))
+        /*!
+         * If the heap is empty when this method is called the effect is undefined.
+         */
+        void pop( );
+
+        //! Remove every item from the heap.
+        void clear( )
+            { items.clear( ); }
+
+        //! Merge the other heap into 'this' heap.
+        /*!
+         * The other heap is emptied by this operation but not destroyed; it remains in a usable
+         * state. The items of the other heap are moved into this heap's array.
+         */
+        DaryHeap &merge( DaryHeap &other );
+    };
+
+
+    // ---------------
+    // Private Methods
+    // ---------------
+
+    template<typename T, typename StrictWeakOrdering, typename Allocator, std::size_t Arity>
+    void DaryHeap<T, StrictWeakOrdering, Allocator, Arity>::sift_up( size_type index )
+    {
+        T item( std::move( items[index] ) );
+        while( index > 0 ) {
+            size_type parent = ( index - 1 ) / Arity;
+            if( !comp( item, items[parent] ) ) break;
+            items[index] = std::move( items[parent] );
+            index = parent;
+        }
+        items[index] = std::move( item );
+    }
+
+
+    template<typename T, typename StrictWeakOrdering, typename Allocator, std::size_t Arity>
+    void DaryHeap<T, StrictWeakOrdering, Allocator, Arity>::sift_down( size_type index )
+    {
+        const size_type count = items.size( );
+        T item( std::move( items[index] ) );
+        while( true ) {
+            size_type first = Arity * index + 1;
+            if( first >= count ) break;
+            size_type last = ( count - first < Arity ) ? count : first + Arity;
+
+            // Find the child that comes first.
+            size_type best = first;
+            for( size_type child = first + 1; child < last; ++child ) {
+                if( comp( items[child], items[best] ) ) best = child;
+            }
+            if( !comp( items[best], item ) ) break;
+            items[index] = std::move( items[best] );
+            index = best;
+        }
+        items[index] = std::move( item );
+    }
+
+
+    //
+    // heapify
+    //
+    // Sift down every item that has children, starting with the last one. Most items are near
+    // the bottom and move only a short distance, so this takes O(n) time.
+    //
+    template<typename T, typename StrictWeakOrdering, typename Allocator, std::size_t Arity>
+    void DaryHeap<T, StrictWeakOrdering, Allocator, Arity>::heapify( )
+    {
+        if( items.size( ) < 2 ) return;
+        for( size_type index = ( items.size( ) - 2 ) / Arity + 1; index > 0; --index ) {
+            sift_down( index - 1 );
+        }
+    }
+
+
+    // --------------
+    // Public Methods
+    // --------------
+
+    //
+    // Template insert
+    //
+    // When many items are added at once it is cheaper to rebuild the heap than to sift each
+    // new item up. Rebuilding touches every item once while sifting up costs up to lg(n) steps
+    // per new item.
+    //
+    template<typename T, typename StrictWeakOrdering, typename Allocator, std::size_t Arity>
+    template<typename InputIterator>
+        void DaryHeap<T, StrictWeakOrdering, Allocator, Arity>::insert( InputIterator first, InputIterator last )
+    {
+        size_type old_size = items.size( );
+        items.insert( items.end( ), first, last );
+        size_type added = items.size( ) - old_size;
+
+        size_type depth = 1;
+        for( size_type n = items.size( ); n >= Arity; n /= Arity ) ++depth;
+        if( added * depth > items.size( ) ) {
+            heapify( );
+        }
+        else {
+            for( size_type index = old_size; index < items.size( ); ++index ) sift_up( index );
+        }
+    }
+
+
+    template<typename T, typename StrictWeakOrdering, typename Allocator, std::size_t Arity>
+    void DaryHeap<T, StrictWeakOrdering, Allocator, Arity>::pop( )
+    {
+        if( items.size( ) > 1 ) {
+            items.front( ) = std::move( items.back( ) );
+            items.pop_back( );
+            sift_down( 0 );
+        }
+        else {
+            items.pop_back( );
+        }
+    }
+
+
+    template<typename T, typename StrictWeakOrdering, typename Allocator, std::size_t Arity>
+    DaryHeap<T, StrictWeakOrdering, Allocator, Arity> &
+        DaryHeap<T, StrictWeakOrdering, Allocator, Arity>::merge( DaryHeap &other )
+    {
+        if( &other == this ) return *this;
+        if( items.empty( ) ) {
+            items.swap( other.items );
+        }
+        else {
+            insert( std::make_move_iterator( other.items.begin( ) ), std::make_move_iterator( other.items.end( ) ) );
+            other.items.clear( );
+        }
+        return *this;
+    }
+
+}
+
+#endif
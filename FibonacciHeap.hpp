@@ -0,0 +1,579 @@
+/*! \file    FibonacciHeap.hpp
+ *  \brief   Fibonacci heap container template
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef FIBONACCIHEAP_HPP
+#define FIBONACCIHEAP_HPP
+
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace spica {
+
+    //! Fibonacci heap container template.
+    /*!
+     * A Fibonacci heap is a list of trees whose roots and sibling lists are circular, doubly
+     * linked lists. Insertion and merging only splice lists together, and the trees are not
+     * consolidated until the front item is removed. Insert, merge, and decrease_key take O(1)
+     * amortized time; pop and erase take O(lg(n)) amortized time. These are the best bounds of
+     * any of the heaps in this library, but the constant factors are large. Prefer PairingHeap
+     * unless the number of decrease_key operations greatly exceeds the number of pops.
+     *
+     * FibonacciHeap provides the same interface as BinomialHeap, including handles for
+     * decrease_key( ) and erase( ). See Introduction to Algorithms by Cormen, Leiserson,
+     * Rivest, and Stein, chapter 19 (third edition).
+     *
+     * Nodes are obtained from an allocator of type Allocator rebound to the node type. With a
+     * PoolAllocator the nodes are packed into large chunks and clear( ) releases the chunks
+     * without visiting the nodes (if the items have trivial destructors).
+     */
+    template<typename T,
+             typename StrictWeakOrdering = std::less<T>,
+             typename Allocator = std::allocator<T>>
+    class FibonacciHeap {
+    public:
+
+        typedef       T                   key_type;
+        typedef       key_type            value_type;
+        typedef       StrictWeakOrdering  key_compare;
+        typedef       StrictWeakOrdering  value_compare;
+        typedef       key_type           *pointer;
+        typedef const key_type           *const_pointer;
+        typedef       key_type           &reference;
+        typedef const key_type           &const_reference;
+        typedef       std::size_t         size_type;
+        typedef       Allocator           allocator_type;
+
+    private:
+
+        struct FibonacciNode {
+            FibonacciNode *parent;
+            FibonacciNode *child;   // Any one of the children.
+            FibonacciNode *left;
+            FibonacciNode *right;
+            int            degree;
+            bool           marked;  // Lost a child since it became a child itself.
+            key_type       data;
+
+            FibonacciNode( const key_type &new_item ) :
+                parent( nullptr ), child( nullptr ), left( this ), right( this ),
+                degree( 0 ), marked( false ), data( new_item ) { }
+        };
+
+        typedef typename std::allocator_traits<Allocator>::template rebind_alloc<FibonacciNode> node_allocator;
+        typedef std::allocator_traits<node_allocator> node_traits;
+
+        // A tree of degree k has at least F(k + 2) nodes, where F is the Fibonacci sequence, so
+        // no degree can reach this value with a 64 bit size_type.
+        static const int maximum_degree = 96;
+
+        // The root with the front item. The root list is reached through it.
+        FibonacciNode *minimum;
+        size_type      count;
+        StrictWeakOrdering comp;
+        [[no_unique_address]] node_allocator node_alloc;
+
+        // Joins two circular lists into one.
+        static void splice( FibonacciNode *a, FibonacciNode *b );
+
+        // Links trees of equal degree until no two roots have the same degree.
+        void consolidate( );
+
+        // Moves a node from its parent's child list to the root list.
+        void cut( FibonacciNode *node, FibonacciNode *parent );
+
+        // Cuts marked ancestors, starting with the given node, and marks the first unmarked one.
+        void cascading_cut( FibonacciNode *node );
+
+        // Moves the children of a root to the root list and destroys the root.
+        void remove_root( FibonacciNode *node );
+
+        void destroy_node( FibonacciNode *node );
+
+        // Make copy operations illegal on Fibonacci heaps (for now).
+        FibonacciHeap( const FibonacciHeap & ) = delete;
+        FibonacciHeap &operator=( const FibonacciHeap & ) = delete;
+
+    public:
+
+        //! Fibonacci heap iterator class.
+        /*!
+         * Fibonacci heap iterators are forward iterators that visit the items in an unspecified
+         * order. They walk the trees in preorder using the links in the nodes, so they never
+         * allocate memory. A sweep through the entire heap takes O(n) time.
+         */
+        class iterator {
+
+            friend class FibonacciHeap;
+
+        public:
+            typedef std::forward_iterator_tag iterator_category;
+            typedef const T                   value_type;
+            typedef const T                  *pointer;
+            typedef const T                  &reference;
+            typedef std::ptrdiff_t           difference_type;
+
+        private:
+            const FibonacciHeap *heap;
+            const FibonacciNode *current;
+
+            iterator( const FibonacciHeap *h, const FibonacciNode *c ) : heap( h ), current( c ) { }
+
+        public:
+            //! Default constructor.
+            iterator( ) : heap( nullptr ), current( nullptr ) { }
+
+            //! Returns true if two iterators point at the same object or both end( ).
+            bool operator==( const iterator &other ) const
+                { return current == other.current; }
+
+            //! Returns a reference to the current object.
+            const T &operator*( ) const
+                { return current->data; }
+
+            //! Returns a pointer to the current object.
+            const T *operator->( ) const
+                { return &current->data; }
+
+            //! Prefix increment.
+            iterator &operator++( );
+
+            //! Postfix increment.
+            iterator operator++( int )
+            {
+                iterator old( *this );
+                ++*this;
+                return old;
+            }
+        };
+
+        //! Refers to an item in the heap.
+        /*!
+         * A handle stays valid until its item is removed from the heap by pop( ), erase( ), or
+         * clear( ), even if the heap is merged into another heap.
+         */
+        class handle {
+
+            friend class FibonacciHeap;
+
+        public:
+            //! Default constructor. The handle does not refer to any item.
+            handle( ) : node( nullptr ) { }
+
+            //! Returns a reference to the item.
+            const T &operator*( ) const { return node->data; }
+
+            //! Returns a pointer to the item.
+            const T *operator->( ) const { return &node->data; }
+
+            //! Returns true if the handles refer to the same item.
+            bool operator==( const handle &other ) const { return node == other.node; }
+
+        private:
+            explicit handle( FibonacciNode *n ) : node( n ) { }
+
+            FibonacciNode *node;
+        };
+
+        //! Create an empty heap.
+        FibonacciHeap( const StrictWeakOrdering &C = StrictWeakOrdering( ),
+                       const Allocator &A = Allocator( ) )
+            : minimum( nullptr ), count( 0 ), comp( C ), node_alloc( A )
+            { }
+
+        //! Create a heap from the given sequence.
+        template<typename InputIterator>
+        FibonacciHeap(
+            InputIterator first,
+            InputIterator last,
+            const StrictWeakOrdering &C = StrictWeakOrdering( ),
+            const Allocator &A = Allocator( )
+        ) : minimum( nullptr ), count( 0 ), comp( C ), node_alloc( A )
+            { insert( first, last ); }
+
+        //! Destroy the heap and all contained nodes.
+       ~FibonacciHeap( )
+            { clear( ); }
+
+        //! Return the number of data items in the heap. O(1)
+        size_type size( ) const
+            { return count; }
+
+        //! Returns true if the heap contains no items. O(1)
+        bool empty( ) const
+            { return count == 0; }
+
+        // These members are provided by other, similar container types.
+        key_compare key_comp( ) const
+            { return comp; }
+
+        value_compare value_comp( ) const
+            { return comp; }
+
+        allocator_type get_allocator( ) const
+            { return allocator_type( node_alloc ); }
+
+        //! Return an iterator to the first item in the heap.
+        iterator begin( ) const { return iterator( this, minimum ); }
+
+        //! Return an iterator just past the last item in the heap.
+        iterator end( ) const { return iterator( this, nullptr ); }
+
+        //! Insert a copy of the given object into 'this' heap. O(1)
+        /*!
+         * This method returns a pointer to the new copy of the object. The pointer is valid
+         * until the object is removed from the heap.
+         */
+        const T *insert( const T &new_item )
+            { return &*push( new_item ); }
+
+        //! Inserts a copy of the given object and returns a handle to it. O(1)
+        handle push( const T &new_item );
+
+        //! Inserts each item in the range [first, last) into the heap.
+        template<typename InputIterator>
+        void insert( InputIterator first, InputIterator last )
+        {
+            for( ; first != last; ++first ) push( *first );
+        }
+
+        //! Return a reference to the object at the front of the heap. O(1)
+        /*!
+         * If the heap is empty when this method is called the effect is undefined.
+         */
+        const T &front( ) const
+            { return minimum->data; }
+
+        //! Extract the object at the front of the heap and throw away its value.
+        /*!
+         * If the heap is empty when this method is called the effect is undefined.
+         */
+        void pop( )
+            { remove_root( minimum ); }
+
+        //! Replaces an item with one that is not after it in the heap ordering.
+        /*!
+         * \exception std::invalid_argument if the new value comes after the old one.
+         */
+        void decrease_key( handle item, const T &new_value );
+
+        //! Removes the item referred to by the handle.
+        void erase( handle item );
+
+        //! Remove every item from the heap.
+        void clear( );
+
+        //! Merge the other Fibonacci heap into 'this' heap. O(1)
+        /*!
+         * The other heap is emptied by this operation but not destroyed; it remains in a usable
+         * state. The nodes of the other heap are taken over without copying, so the allocators
+         * of the two heaps must compare equal.
+         */
+        FibonacciHeap &merge( FibonacciHeap &other );
+    };
+
+
+    // ---------------
+    // Private Methods
+    // ---------------
+
+    template<typename T, typename StrictWeakOrdering, typename Allocator>
+    void FibonacciHeap<T, StrictWeakOrdering, Allocator>::splice( FibonacciNode *a, FibonacciNode *b )
+    {
+        FibonacciNode *a_right = a->right;
+        FibonacciNode *b_left  = b->left;
+        a->right = b;
+        b->left  = a;
+        b_left->right = a_right;
+        a_right->left = b_left;
+    }
+
+
+    //
+    // consolidate
+    //
+    // The root list is opened into a linear list and each root is linked with any earlier root
+    // of the same degree. The table holds the root of each degree seen so far. Afterward the
+    // root list is rebuilt from the table and the new minimum is found.
+    //
+    template<typename T, typename StrictWeakOrdering, typename Allocator>
+    void FibonacciHeap<T, StrictWeakOrdering, Allocator>::consolidate( )
+    {
+        FibonacciNode *by_degree[maximum_degree] = { };
+
+        minimum->left->right = nullptr;
+        FibonacciNode *walker = minimum;
+        while( walker != nullptr ) {
+            FibonacciNode *next = walker->right;
+            FibonacciNode *x = walker;
+            int degree = x->degree;
+            while( by_degree[degree] != nullptr ) {
+                FibonacciNode *y = by_degree[degree];
+                if( comp( y->data, x->data ) ) std::swap( x, y );
+
+                // Make y a child of x.
+                y->left = y->right = y;
+                y->parent = x;
+                y->marked = false;
+                if( x->child == nullptr ) x->child = y; else splice( x->child, y );
+                ++x->degree;
+
+                by_degree[degree] = nullptr;
+                ++degree;
+            }
+            by_degree[degree] = x;
+            walker = next;
+        }
+
+        minimum = nullptr;
+        for( FibonacciNode *root : by_degree ) {
+            if( root == nullptr ) continue;
+            root->left = root->right = root;
+            if( minimum == nullptr ) {
+                minimum = root;
+            }
+            else {
+                splice( minimum, root );
+                if( comp( root->data, minimum->data ) ) minimum = root;
+            }
+        }
+    }
+
+
+    template<typename T, typename StrictWeakOrdering, typename Allocator>
+    void FibonacciHeap<T, StrictWeakOrdering, Allocator>::cut( FibonacciNode *node, FibonacciNode *parent )
+    {
+        if( node->right == node ) {
+            parent->child = nullptr;
+        }
+        else {
+            node->left->right = node->right;
+            node->right->left = node->left;
+            if( parent->child == node ) parent->child = node->right;
+        }
+        --parent->degree;
+
+        node->left = node->right = node;
+        node->parent = nullptr;
+        node->marked = false;
+        splice( minimum, node );
+    }
+
+
+    template<typename T, typename StrictWeakOrdering, typename Allocator>
+    void FibonacciHeap<T, StrictWeakOrdering, Allocator>::cascading_cut( FibonacciNode *node )
+    {
+        while( node->parent != nullptr ) {
+            if( !node->marked ) {
+                node->marked = true;
+                return;
+            }
+            FibonacciNode *parent = node->parent;
+            cut( node, parent );
+            node = parent;
+        }
+    }
+
+
+    //
+    // remove_root
+    //
+    // The trees only need to be consolidated if the minimum was removed, since that is when a
+    // new minimum must be found.
+    //
+    template<typename T, typename StrictWeakOrdering, typename Allocator>
+    void FibonacciHeap<T, StrictWeakOrdering, Allocator>::remove_root( FibonacciNode *node )
+    {
+        if( node->child != nullptr ) {
+            FibonacciNode *child = node->child;
+            do {
+                child->parent = nullptr;
+                child->marked = false;
+                child = child->right;
+            } while( child != node->child );
+            splice( node, node->child );
+            node->child = nullptr;
+        }
+
+        if( node->right == node ) {
+            minimum = nullptr;
+        }
+        else {
+            node->left->right = node->right;
+            node->right->left = node->left;
+            if( node == minimum ) {
+                minimum = node->right;
+                consolidate( );
+            }
+        }
+        destroy_node( node );
+        --count;
+    }
+
+
+    template<typename T, typename StrictWeakOrdering, typename Allocator>
+    void FibonacciHeap<T, StrictWeakOrdering, Allocator>::destroy_node( FibonacciNode *node )
+    {
+        node_traits::destroy( node_alloc, node );
+        node_traits::deallocate( node_alloc, node, 1 );
+    }
+
+
+    // ----------------
+    // Iterator Methods
+    // ----------------
+
+    //
+    // operator++
+    //
+    // Preorder: go down to a child if there is one, otherwise move right in the nearest list
+    // (starting with this node's list) that has not been finished. A list is finished when
+    // moving right would return to the node where the list was entered: the parent's child
+    // pointer, or the minimum for the root list.
+    //
+    template<typename T, typename StrictWeakOrdering, typename Allocator>
+    typename FibonacciHeap<T, StrictWeakOrdering, Allocator>::iterator &
+        FibonacciHeap<T, StrictWeakOrdering, Allocator>::iterator::operator++( )
+    {
+        if( current->child != nullptr ) {
+            current = current->child;
+            return *this;
+        }
+        while( current != nullptr ) {
+            const FibonacciNode *first = ( current->parent != nullptr ) ? current->parent->child : heap->minimum;
+            if( current->right != first ) {
+                current = current->right;
+                break;
+            }
+            current = current->parent;
+        }
+        return *this;
+    }
+
+
+    // --------------
+    // Public Methods
+    // --------------
+
+    template<typename T, typename StrictWeakOrdering, typename Allocator>
+    typename FibonacciHeap<T, StrictWeakOrdering, Allocator>::handle
+        FibonacciHeap<T, StrictWeakOrdering, Allocator>::push( const T &new_item )
+    {
+        FibonacciNode *new_node = node_traits::allocate( node_alloc, 1 );
+        try {
+            node_traits::construct( node_alloc, new_node, new_item );
+        }
+        catch( ... ) {
+            node_traits::deallocate( node_alloc, new_node, 1 );
+            throw;
+        }
+
+        if( minimum == nullptr ) {
+            minimum = new_node;
+        }
+        else {
+            splice( minimum, new_node );
+            if( comp( new_node->data, minimum->data ) ) minimum = new_node;
+        }
+        ++count;
+        return handle( new_node );
+    }
+
+
+    template<typename T, typename StrictWeakOrdering, typename Allocator>
+    void FibonacciHeap<T, StrictWeakOrdering, Allocator>::decrease_key( handle item, const T &new_value )
+    {
+        FibonacciNode *node = item.node;
+        if( comp( node->data, new_value ) )
+            throw std::invalid_argument( "FibonacciHeap::decrease_key: new value comes after the old value" );
+
+        node->data = new_value;
+        FibonacciNode *parent = node->parent;
+        if( parent != nullptr && comp( node->data, parent->data ) ) {
+            cut( node, parent );
+            cascading_cut( parent );
+        }
+        if( comp( node->data, minimum->data ) ) minimum = node;
+    }
+
+
+    //
+    // erase
+    //
+    // The node is cut to the root list, as if its key had been decreased below every other
+    // key, and then removed. The minimum is left alone unless it is the node being erased.
+    //
+    template<typename T, typename StrictWeakOrdering, typename Allocator>
+    void FibonacciHeap<T, StrictWeakOrdering, Allocator>::erase( handle item )
+    {
+        FibonacciNode *node = item.node;
+        FibonacciNode *parent = node->parent;
+        if( parent != nullptr ) {
+            cut( node, parent );
+            cascading_cut( parent );
+        }
+        remove_root( node );
+    }
+
+
+    //
+    // clear
+    //
+    // Each circular list is opened and joined to the front of a linear list of nodes waiting
+    // to be destroyed. This avoids recursion.
+    //
+    template<typename T, typename StrictWeakOrdering, typename Allocator>
+    void FibonacciHeap<T, StrictWeakOrdering, Allocator>::clear( )
+    {
+        // If the allocator's pools belong to this heap alone they can be released in one step.
+        bool released = false;
+        if constexpr( std::is_trivially_destructible_v<FibonacciNode> &&
+                      requires( node_allocator &a ) { a.release( ); } ) {
+            released = node_alloc.release( );
+        }
+
+        if( !released && minimum != nullptr ) {
+            minimum->left->right = nullptr;
+            FibonacciNode *waiting = minimum;
+            while( waiting != nullptr ) {
+                FibonacciNode *node = waiting;
+                waiting = node->right;
+                if( node->child != nullptr ) {
+                    node->child->left->right = waiting;
+                    waiting = node->child;
+                }
+                destroy_node( node );
+            }
+        }
+        minimum = nullptr;
+        count   = 0;
+    }
+
+
+    template<typename T, typename StrictWeakOrdering, typename Allocator>
+    FibonacciHeap<T, StrictWeakOrdering, Allocator> &
+        FibonacciHeap<T, StrictWeakOrdering, Allocator>::merge( FibonacciHeap &other )
+    {
+        if( &other == this || other.minimum == nullptr ) return *this;
+        if( minimum == nullptr ) {
+            minimum = other.minimum;
+        }
+        else {
+            splice( minimum, other.minimum );
+            if( comp( other.minimum->data, minimum->data ) ) minimum = other.minimum;
+        }
+        count += other.count;
+        other.minimum = nullptr;
+        other.count   = 0;
+        return *this;
+    }
+
+}
+
+#endif
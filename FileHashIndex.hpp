@@ -0,0 +1,528 @@
+/*! \file    FileHashIndex.hpp
+    \brief   An open addressing hash index stored in a file.
+    \author  Peter Chapin <spicacality@kelseymountain.org>
+
+    FileHashIndex maps keys to values like a hash map, but its slots live in a FileVector so
+    the index survives when the program exits. Opening an existing index only maps the file;
+    nothing is rebuilt and pages are read from the disk as lookups touch them. Keys and values
+    must be POD types (see FileVector.hpp) and the file is only meaningful to programs that
+    use the same key, value, and hash types on a machine with the same byte order.
+
+    The index uses linear probing. Each slot holds the key's 64 bit hash (with the top bit set
+    so that it is never zero), the key, and the value. Erasing shifts later members of the
+    probe sequence back so the table never contains deleted markers. The number of slots is a
+    power of two and the table is kept at most 3/4 full.
+
+    A header in the FileVector's user area records the layout: the hash seed, the capacity and
+    position of the table, and the state of any resize that is underway. The seed is chosen at
+    random when the index is created. The default hash function, pod_hash, hashes the bytes of
+    the key with the seed, so the key type must not contain padding.
+
+    Growing a large index all at once would stop the program for a long time. Instead the new
+    table is placed after the old one in the file and the old slots are migrated lazily. Each
+    update moves a few old slots, and an update to a key that is still in the old table moves
+    that key. Lookups check the new table and then the old one. When the last old slot has
+    been moved, the old table's part of the file is discarded; on Linux the file becomes
+    sparse so the space is returned to the file system. Because tables are only ever added at
+    the end, the file's apparent size is about twice the size of the current table.
+
+    The header records whether the index was closed cleanly. Opening an index that was left in
+    the middle of an update by a program crash throws std::runtime_error; such an index has to
+    be rebuilt from the original data. Calling sync( ) makes the current state durable, even
+    against a crash of the operating system, and marks the index clean until the next update.
+
+    Pointers returned by find( ) are invalidated by any update of the index.
+*/
+
+#ifndef FILEHASHINDEX_HPP
+#define FILEHASHINDEX_HPP
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <type_traits>
+#include "FileVector.hpp"
+
+namespace spica {
+
+    //! Seeded hash of the bytes of a POD object.
+    template<POD K>
+    struct pod_hash {
+        static_assert( std::has_unique_object_representations_v<K>,
+                       "pod_hash can't be used with keys that contain padding" );
+
+        std::uint64_t operator()( const K &key, std::uint64_t seed ) const noexcept
+        {
+            const unsigned char *bytes = reinterpret_cast<const unsigned char *>( &key );
+            std::uint64_t hash = seed ^ ( sizeof( K ) * 0x9E3779B97F4A7C15ULL );
+            std::size_t i = 0;
+            for( ; i + 8 <= sizeof( K ); i += 8 ) {
+                std::uint64_t word;
+                std::memcpy( &word, bytes + i, 8 );
+                hash = ( hash ^ word ) * 0xFF51AFD7ED558CCDULL;
+                hash ^= hash >> 32;
+            }
+            if( i < sizeof( K ) ) {
+                std::uint64_t word = 0;
+                std::memcpy( &word, bytes + i, sizeof( K ) - i );
+                hash = ( hash ^ word ) * 0xFF51AFD7ED558CCDULL;
+                hash ^= hash >> 32;
+            }
+            hash ^= hash >> 33;
+            hash *= 0xC4CEB9FE1A85EC53ULL;
+            hash ^= hash >> 33;
+            return hash;
+        }
+    };
+
+    //! Compares the bytes of two POD objects.
+    template<POD K>
+    struct pod_equal {
+        bool operator()( const K &left, const K &right ) const noexcept
+            { return std::memcmp( &left, &right, sizeof( K ) ) == 0; }
+    };
+
+    namespace detail {
+
+        template<POD K, POD V>
+        struct hash_index_slot {
+            std::uint64_t tag;    // Zero if empty, one if moved to the new table, else hash.
+            K             key;
+            V             value;
+        };
+
+        const std::uint64_t slot_empty = 0;
+        const std::uint64_t slot_moved = 1;        // Only appears in a table being migrated.
+        const std::uint64_t slot_full  = 1ULL << 63;
+
+        // Stored in the user header of the FileVector. Positions are slot indexes.
+        struct hash_index_header {
+            char          magic[8];
+            std::uint32_t version;
+            std::uint32_t slot_size;
+            std::uint64_t seed;
+            std::uint64_t count;          // Elements in both tables.
+            std::uint64_t table_offset;   // The current table.
+            std::uint64_t capacity;
+            std::uint64_t old_offset;     // The table being migrated.
+            std::uint64_t old_capacity;   // Zero if no resize is underway.
+            std::uint64_t migrated;       // Old slots [0, migrated) have been moved.
+            std::uint64_t dirty;          // Nonzero while updates are unsynchronized.
+        };
+
+        const char          hash_index_magic[8] = { 'S', 'p', 'i', 'c', 'a', 'H', 'I', 0 };
+        const std::uint32_t hash_index_version  = 1;
+
+    }
+
+
+    //! Persistent hash index with lazy incremental resizing.
+    template<POD K, POD V, typename Hash = pod_hash<K>, typename Eq = pod_equal<K>>
+    class FileHashIndex {
+    public:
+        typedef K           key_type;
+        typedef V           mapped_type;
+        typedef std::size_t size_type;
+
+        //! Opens the index in the file, or creates an empty index if the file doesn't exist.
+        /*!
+         * The expected size is only used when creating an index; the table is made large
+         * enough to hold that many elements without growing. Files that don't hold an index
+         * of this type, or that were not closed cleanly, cause std::runtime_error.
+         */
+        explicit FileHashIndex( const char *file_name, size_type expected_size = 0 );
+
+        //! Marks the index clean and closes the file (without waiting for the disk).
+       ~FileHashIndex( );
+
+        size_type size( )  const { return static_cast<size_type>( header( ).count ); }
+        bool      empty( ) const { return size( ) == 0; }
+
+        //! Returns the number of slots in the current table.
+        size_type capacity( ) const { return static_cast<size_type>( header( ).capacity ); }
+
+        //! Returns true if slots are still being migrated from the previous table.
+        bool resizing( ) const { return header( ).old_capacity != 0; }
+
+        //! Returns the hash seed recorded in the file.
+        std::uint64_t seed( ) const { return header( ).seed; }
+
+        //! Returns a pointer to the value with the given key, or nullptr if there is none.
+        V *find( const K &key )
+        {
+            slot *item = const_cast<slot *>( locate( tag_of( key ), key ) );
+            return item ? &item->value : nullptr;
+        }
+
+        const V *find( const K &key ) const
+        {
+            const slot *item = locate( tag_of( key ), key );
+            return item ? &item->value : nullptr;
+        }
+
+        bool contains( const K &key ) const { return locate( tag_of( key ), key ) != nullptr; }
+
+        //! Inserts the key and value if the key isn't present. Returns true if inserted.
+        bool insert( const K &key, const V &value );
+
+        //! Replaces the key's value or inserts the pair. Returns true if the key was inserted.
+        bool insert_or_assign( const K &key, const V &value );
+
+        //! Removes the element with the given key. Returns true if it was present.
+        bool erase( const K &key );
+
+        //! Makes room for the given number of elements. Finishes any resize that is underway.
+        void reserve( size_type count );
+
+        //! Migrates all the remaining slots of the previous table.
+        void finish_resize( );
+
+        //! Writes everything to the disk and marks the index clean.
+        void sync( );
+
+    private:
+        typedef detail::hash_index_slot<K, V> slot;
+
+        // Number of old slots migrated by each update while a resize is underway. Must be at
+        // least two so migration ends before the new table (twice as big) needs to grow.
+        static const size_type migration_batch = 16;
+
+        FileVector<slot> slots;
+
+        [[no_unique_address]] Hash hash_function;
+        [[no_unique_address]] Eq   equal_function;
+
+        // The header moves when the FileVector grows, so it is looked up each time.
+        detail::hash_index_header &header( )
+            { return *static_cast<detail::hash_index_header *>( slots.user_header( ) ); }
+
+        const detail::hash_index_header &header( ) const
+            { return *static_cast<const detail::hash_index_header *>( slots.user_header( ) ); }
+
+        std::uint64_t tag_of( const K &key ) const
+            { return hash_function( key, header( ).seed ) | detail::slot_full; }
+
+        // Largest number of elements for a table with the given number of slots.
+        static size_type max_load( size_type capacity )
+            { return capacity - capacity / 4; }
+
+        // Smallest table that holds count elements (at least 16 slots).
+        static size_type capacity_for( size_type count )
+            { return std::bit_ceil( count < 12 ? size_type( 16 ) : count + count / 3 + 1 ); }
+
+        // Returns the slot holding the key in either table, or nullptr.
+        const slot *locate( std::uint64_t tag, const K &key ) const;
+
+        // Returns the index of the key in the table, or capacity if it isn't there.
+        size_type probe( const slot *table, size_type capacity, std::uint64_t tag, const K &key ) const;
+
+        // Puts an item into the first free slot of its probe sequence.
+        static void place( slot *table, size_type capacity, const slot &item );
+
+        // Empties a slot, shifting later members of its probe sequence back.
+        static void remove_at( slot *table, size_type capacity, size_type index );
+
+        // Records that the file is being changed.
+        void mark_dirty( )
+            { if( header( ).dirty == 0 ) header( ).dirty = 1; }
+
+        // Does a share of the migration and grows the table if another element wouldn't fit.
+        void prepare_update( size_type new_count );
+
+        // Adds a table with the given capacity after the current one and starts migrating.
+        void start_resize( size_type new_capacity );
+
+        // Migrates up to the given number of old slots.
+        void migrate( size_type slot_count );
+
+        // Inhibit copying.
+        FileHashIndex( const FileHashIndex & );
+        FileHashIndex &operator=( const FileHashIndex & );
+    };
+
+
+    //
+    // Constructor and destructor
+    //
+    // A new FileVector is empty and its user header is zero. Existing files are checked for a
+    // consistent layout before they are used.
+    //
+    template<POD K, POD V, typename Hash, typename Eq>
+    FileHashIndex<K, V, Hash, Eq>::FileHashIndex( const char *file_name, size_type expected_size )
+        : slots( file_name )
+    {
+        static_assert( sizeof( detail::hash_index_header ) <= FileVector<slot>::user_header_bytes );
+
+        detail::hash_index_header &h = header( );
+        bool is_index =
+            std::memcmp( h.magic, detail::hash_index_magic, sizeof( h.magic ) ) == 0;
+
+        if( !is_index && slots.empty( ) ) {
+            size_type initial = capacity_for( expected_size );
+            std::random_device source;
+            std::uint64_t seed = ( static_cast<std::uint64_t>( source( ) ) << 32 ) ^ source( );
+
+            slots.resize_for_overwrite( initial );
+            detail::hash_index_header &fresh = header( );
+            std::memset( &fresh, 0, sizeof( fresh ) );
+            std::memcpy( fresh.magic, detail::hash_index_magic, sizeof( fresh.magic ) );
+            fresh.version   = detail::hash_index_version;
+            fresh.slot_size = sizeof( slot );
+            fresh.seed      = seed;
+            fresh.capacity  = initial;
+            return;
+        }
+
+        if( !is_index || h.version != detail::hash_index_version || h.slot_size != sizeof( slot ) )
+            throw std::runtime_error( "The file is not a FileHashIndex of this type" );
+        if( h.dirty != 0 )
+            throw std::runtime_error( "The FileHashIndex was not closed cleanly" );
+        if( !std::has_single_bit( h.capacity ) || h.table_offset + h.capacity != slots.size( ) ||
+            ( h.old_capacity != 0 && ( !std::has_single_bit( h.old_capacity ) ||
+                                       h.old_offset + h.old_capacity > h.table_offset ||
+                                       h.migrated > h.old_capacity ) ) )
+            throw std::runtime_error( "The FileHashIndex has an inconsistent header" );
+    }
+
+
+    template<POD K, POD V, typename Hash, typename Eq>
+    FileHashIndex<K, V, Hash, Eq>::~FileHashIndex( )
+    {
+        header( ).dirty = 0;
+    }
+
+
+    //
+    // Lookups
+    //
+    // Keys still in the old table can be found from their home slot as usual. Migrated slots
+    // are marked as moved rather than emptied so they don't cut other probe sequences short.
+    //
+    template<POD K, POD V, typename Hash, typename Eq>
+    const typename FileHashIndex<K, V, Hash, Eq>::slot *
+        FileHashIndex<K, V, Hash, Eq>::locate( std::uint64_t tag, const K &key ) const
+    {
+        const detail::hash_index_header &h = header( );
+        const slot *table = slots.begin( ) + h.table_offset;
+        size_type index = probe( table, h.capacity, tag, key );
+        if( index != h.capacity ) return table + index;
+
+        if( h.old_capacity != 0 ) {
+            table = slots.begin( ) + h.old_offset;
+            index = probe( table, h.old_capacity, tag, key );
+            if( index != h.old_capacity ) return table + index;
+        }
+        return nullptr;
+    }
+
+
+    template<POD K, POD V, typename Hash, typename Eq>
+    typename FileHashIndex<K, V, Hash, Eq>::size_type
+        FileHashIndex<K, V, Hash, Eq>::probe(
+            const slot *table, size_type capacity, std::uint64_t tag, const K &key ) const
+    {
+        size_type mask  = capacity - 1;
+        size_type index = tag & mask;
+        for( ;; ) {
+            std::uint64_t current = table[index].tag;
+            if( current == detail::slot_empty ) return capacity;
+            if( current == tag && equal_function( table[index].key, key ) ) return index;
+            index = ( index + 1 ) & mask;
+        }
+    }
+
+
+    template<POD K, POD V, typename Hash, typename Eq>
+    void FileHashIndex<K, V, Hash, Eq>::place( slot *table, size_type capacity, const slot &item )
+    {
+        size_type mask  = capacity - 1;
+        size_type index = item.tag & mask;
+        while( table[index].tag != detail::slot_empty ) index = ( index + 1 ) & mask;
+        table[index] = item;
+    }
+
+
+    //
+    // An item can move back into the emptied slot if its home isn't cyclically between the
+    // emptied slot and its current position.
+    //
+    template<POD K, POD V, typename Hash, typename Eq>
+    void FileHashIndex<K, V, Hash, Eq>::remove_at( slot *table, size_type capacity, size_type index )
+    {
+        size_type mask = capacity - 1;
+        size_type next = index;
+        for( ;; ) {
+            next = ( next + 1 ) & mask;
+            std::uint64_t tag = table[next].tag;
+            if( tag == detail::slot_empty ) break;
+            size_type home = tag & mask;
+            if( ( ( next - home ) & mask ) >= ( ( next - index ) & mask ) ) {
+                table[index] = table[next];
+                index = next;
+            }
+        }
+        table[index].tag = detail::slot_empty;
+    }
+
+
+    //
+    // Updates
+    //
+    template<POD K, POD V, typename Hash, typename Eq>
+    bool FileHashIndex<K, V, Hash, Eq>::insert( const K &key, const V &value )
+    {
+        std::uint64_t tag = tag_of( key );
+        if( locate( tag, key ) != nullptr ) return false;
+
+        prepare_update( size( ) + 1 );
+        detail::hash_index_header &h = header( );
+        place( slots.begin( ) + h.table_offset, h.capacity, slot{ tag, key, value } );
+        ++h.count;
+        return true;
+    }
+
+
+    //
+    // A key found in the old table is moved to the new one with its new value.
+    //
+    template<POD K, POD V, typename Hash, typename Eq>
+    bool FileHashIndex<K, V, Hash, Eq>::insert_or_assign( const K &key, const V &value )
+    {
+        std::uint64_t tag = tag_of( key );
+        slot *item = const_cast<slot *>( locate( tag, key ) );
+        if( item == nullptr ) {
+            prepare_update( size( ) + 1 );
+            detail::hash_index_header &h = header( );
+            place( slots.begin( ) + h.table_offset, h.capacity, slot{ tag, key, value } );
+            ++h.count;
+            return true;
+        }
+
+        mark_dirty( );
+        detail::hash_index_header &h = header( );
+        slot *table = slots.begin( ) + h.table_offset;
+        if( item >= table ) {
+            item->value = value;
+        }
+        else {
+            item->tag = detail::slot_moved;
+            place( table, h.capacity, slot{ tag, key, value } );
+            migrate( migration_batch );
+        }
+        return false;
+    }
+
+
+    template<POD K, POD V, typename Hash, typename Eq>
+    bool FileHashIndex<K, V, Hash, Eq>::erase( const K &key )
+    {
+        slot *item = const_cast<slot *>( locate( tag_of( key ), key ) );
+        if( item == nullptr ) return false;
+
+        mark_dirty( );
+        detail::hash_index_header &h = header( );
+        slot *table = slots.begin( ) + h.table_offset;
+        if( item >= table )
+            remove_at( table, h.capacity, item - table );
+        else
+            item->tag = detail::slot_moved;
+        --h.count;
+        if( h.old_capacity != 0 ) migrate( migration_batch );
+        return true;
+    }
+
+
+    template<POD K, POD V, typename Hash, typename Eq>
+    void FileHashIndex<K, V, Hash, Eq>::prepare_update( size_type new_count )
+    {
+        mark_dirty( );
+        if( header( ).old_capacity != 0 ) migrate( migration_batch );
+        if( new_count > max_load( header( ).capacity ) ) {
+            finish_resize( );
+            start_resize( 2 * header( ).capacity );
+        }
+    }
+
+
+    template<POD K, POD V, typename Hash, typename Eq>
+    void FileHashIndex<K, V, Hash, Eq>::reserve( size_type count )
+    {
+        finish_resize( );
+        if( count > max_load( header( ).capacity ) ) {
+            mark_dirty( );
+            start_resize( capacity_for( count ) );
+            finish_resize( );
+        }
+    }
+
+
+    template<POD K, POD V, typename Hash, typename Eq>
+    void FileHashIndex<K, V, Hash, Eq>::finish_resize( )
+    {
+        if( header( ).old_capacity == 0 ) return;
+        mark_dirty( );
+        migrate( header( ).old_capacity );
+    }
+
+
+    template<POD K, POD V, typename Hash, typename Eq>
+    void FileHashIndex<K, V, Hash, Eq>::sync( )
+    {
+        header( ).dirty = 0;
+        slots.sync( );
+    }
+
+
+    //
+    // Resizing
+    //
+    // The new table goes after the current table at the end of the file. The file is grown
+    // without writing to it, so the new slots are zero (empty) and no pages are touched until
+    // elements are placed in them.
+    //
+    template<POD K, POD V, typename Hash, typename Eq>
+    void FileHashIndex<K, V, Hash, Eq>::start_resize( size_type new_capacity )
+    {
+        size_type new_offset = header( ).table_offset + header( ).capacity;
+        slots.resize_for_overwrite( new_offset + new_capacity );
+
+        detail::hash_index_header &h = header( );
+        h.old_offset   = h.table_offset;
+        h.old_capacity = h.capacity;
+        h.migrated     = 0;
+        h.table_offset = new_offset;
+        h.capacity     = new_capacity;
+    }
+
+
+    template<POD K, POD V, typename Hash, typename Eq>
+    void FileHashIndex<K, V, Hash, Eq>::migrate( size_type slot_count )
+    {
+        detail::hash_index_header &h = header( );
+        slot *old_table = slots.begin( ) + h.old_offset;
+        slot *table     = slots.begin( ) + h.table_offset;
+        size_type end   = ( slot_count < h.old_capacity - h.migrated ) ?
+                              h.migrated + slot_count : h.old_capacity;
+
+        for( size_type i = h.migrated; i < end; ++i ) {
+            if( old_table[i].tag > detail::slot_moved ) {
+                place( table, h.capacity, old_table[i] );
+                old_table[i].tag = detail::slot_moved;
+            }
+        }
+        h.migrated = end;
+
+        if( end == h.old_capacity ) {
+            slots.discard( h.old_offset, h.old_capacity );
+            h.old_offset   = 0;
+            h.old_capacity = 0;
+            h.migrated     = 0;
+        }
+    }
+
+}
+
+#endif
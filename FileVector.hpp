@@ -10,10 +10,28 @@
  * However, there are restrictions on what types of elements can be used. See the documentation
  * for more details.
  *
- * TODO:
+ * File vectors are supported on Windows (using CreateFileMapping/MapViewOfFile) and on POSIX
+ * systems (using open/ftruncate/mmap). On Linux the mapping is grown with mremap so that the
+ * kernel can often extend it in place. Even so, growth might move the mapping, which invalidates
+ * all pointers and iterators into the vector. On POSIX systems reserve_address_space can be
+ * used to set aside a large range of virtual addresses up front; afterward the file is grown
+ * in place and the elements never move. Errors on Windows are reported by throwing
+ * Windows::APIError. Errors on POSIX systems are reported by throwing std::system_error.
+ *
+ * The file starts with a header of header_bytes bytes that records the element size, a format
+ * version, and two commit records. The last user_header_bytes of the header are never touched
+ * by FileVector; programs can keep their own data about the vector there. Each commit record holds a size, a sequence number, and a
+ * checksum. A commit writes the current size into the older of the two records so a crash
+ * while committing leaves the other record intact. When a file is opened its size is taken from
+ * the valid record with the higher sequence number; the length of the file is irrelevant. Data
+ * written after the last commit might or might not be in the file after a crash. The
+ * destructor commits but it does not wait for the data to reach the disk. Use sync( ) for that.
  *
- * + This version only supports Windows. It could be generalized to any system that supports
- *   memory mapped files.
+ * A FileVectorReader maps a FileVector's file read-only. Any number of readers, in any number of
+ * processes, can share the file with one FileVector that appends to it. Readers see the
+ * elements that the writer has committed.
+ *
+ * TODO:
  *
  * + The current implementation limits the size of the file being memory mapped to 4 GB so that
  *   32-bit Windows is supported. However, that restriction is being applied (unnecessarily) to
@@ -22,18 +40,6 @@
  *
  * + Reverse iterators are not implemented.
  *
- * + Under some circumstances there is a conflict between some of the methods. For example,
- *   `insert` that takes a size and a value will take two integers for the case of
- *   FileVector<int>. Yet such a call also looks like an instantiation of the template `insert`
- *   using "int" for "InputIterator". This general problem is well known and the solution, which
- *   is ugly, is described in "Generic Programming and the STL" by Matthew Austern.
- *
- * + The template `insert` method isn't currently implemented at all. The simple way of doing it
- *   will cause it to have O(n*m) performance---a violation of the standard for vectors. The
- *   correct solution is to detect the different iterator categories at compile time and use an
- *   appropriate version of the function depending on the category. This is also described in
- *   Austern's book.
- *
  * + This implementation never reduces the capacity of a FileVector except for when the
  *   FileVector is destroyed. It probably should reduce capacity under certain circumstances in
  *   order to reclaim disk space.
@@ -54,19 +60,36 @@
 
 #include "environ.hpp"
 
-#if eOPSYS != eWINDOWS
-#error File vectors currently only support Windows.
+#if eOPSYS != eWINDOWS && eOPSYS != ePOSIX
+#error File vectors currently only support Windows and POSIX systems.
 #endif
 
 #include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <iterator>
+#include <limits>
+#include <new>
+#include <stdexcept>
 #include <type_traits>
 
+#if eOPSYS == eWINDOWS
 #define NOMINMAX
 #include <windows.h>
 
 #include "winexcept.hpp"
+#endif
+
+#if eOPSYS == ePOSIX
+#include <cerrno>
+#include <system_error>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 
 namespace spica {
@@ -79,6 +102,111 @@ namespace spica {
     template<typename T>
     concept POD = std::is_trivial_v<T> && std::is_standard_layout_v<T>;
 
+    //! Hints about how a FileVector's elements will be accessed.
+    /*!
+     * These are passed to madvise on POSIX systems. They have no effect on Windows.
+     */
+    enum class access_pattern {
+        normal,      //!< No particular pattern (the default).
+        sequential,  //!< Elements will be accessed in order. Aggressive read ahead is useful.
+        random,      //!< Elements will be accessed in random order. Read ahead is wasteful.
+        will_need,   //!< Elements will be needed soon. Start reading them now.
+        dont_need    //!< Elements won't be needed soon. Their pages can be reclaimed.
+    };
+
+    //! How FileVector::flush waits for data to be written.
+    enum class flush_mode {
+        async,       //!< Start writing the data and return at once.
+        sync         //!< Return after the data has been written to the disk.
+    };
+
+    namespace detail {
+
+        // A record of the vector's size at some moment. The fields are accessed atomically so
+        // that other processes mapping the file can read them while the file is being changed.
+        struct file_vector_commit {
+            std::uint64_t sequence;  // Zero if this record has never been written.
+            std::uint64_t count;
+            std::uint64_t checksum;  // Of sequence and count. Detects torn or damaged records.
+        };
+
+        // The start of a FileVector's file. The rest of the header is reserved.
+        struct file_vector_header {
+            char               magic[8];
+            std::uint32_t      version;
+            std::uint32_t      element_size;
+            file_vector_commit commits[2];
+        };
+
+        const char          file_vector_magic[8] = { 'S', 'p', 'i', 'c', 'a', 'F', 'V', 0 };
+        const std::uint32_t file_vector_version  = 1;
+        const std::size_t   file_vector_header_bytes = 4096;
+        const std::size_t   file_vector_user_header_bytes = 2048;   // At the end of the header.
+
+        // A 64 bit FNV-1a hash of the sequence number and count.
+        inline std::uint64_t commit_checksum( std::uint64_t sequence, std::uint64_t count )
+        {
+            std::uint64_t hash = 14695981039346656037ULL;
+            for( int i = 0; i < 8; ++i ) {
+                hash = ( hash ^ ( ( sequence >> ( 8 * i ) ) & 0xFF ) ) * 1099511628211ULL;
+            }
+            for( int i = 0; i < 8; ++i ) {
+                hash = ( hash ^ ( ( count >> ( 8 * i ) ) & 0xFF ) ) * 1099511628211ULL;
+            }
+            return hash;
+        }
+
+        // Returns true if the header has the right format for elements of the given size.
+        inline bool check_header( const file_vector_header *header, std::uint32_t element_size )
+        {
+            return std::memcmp( header->magic, file_vector_magic, sizeof( file_vector_magic ) ) == 0 &&
+                   header->version == file_vector_version &&
+                   header->element_size == element_size;
+        }
+
+        // Reads a commit record. Returns false if it has never been written or is damaged.
+        inline bool read_commit(
+            file_vector_commit &record, std::uint64_t &sequence, std::uint64_t &count )
+        {
+            sequence = std::atomic_ref< std::uint64_t >( record.sequence ).load( std::memory_order_acquire );
+            count    = std::atomic_ref< std::uint64_t >( record.count ).load( std::memory_order_relaxed );
+            std::uint64_t checksum =
+                std::atomic_ref< std::uint64_t >( record.checksum ).load( std::memory_order_relaxed );
+            return sequence != 0 && checksum == commit_checksum( sequence, count );
+        }
+
+        // Returns the index of the newest valid commit record, or -1 if there is none.
+        inline int latest_commit( file_vector_header *header, std::uint64_t &sequence, std::uint64_t &count )
+        {
+            std::uint64_t sequence_0, count_0, sequence_1, count_1;
+            bool valid_0 = read_commit( header->commits[0], sequence_0, count_0 );
+            bool valid_1 = read_commit( header->commits[1], sequence_1, count_1 );
+            if( valid_1 && ( !valid_0 || sequence_1 > sequence_0 ) ) {
+                sequence = sequence_1;
+                count    = count_1;
+                return 1;
+            }
+            if( valid_0 ) {
+                sequence = sequence_0;
+                count    = count_0;
+                return 0;
+            }
+            return -1;
+        }
+
+        // Writes a commit record. The sequence number is written last.
+        inline void write_commit( file_vector_commit &record, std::uint64_t sequence, std::uint64_t count )
+        {
+            std::atomic_ref< std::uint64_t >( record.sequence ).store( 0, std::memory_order_relaxed );
+            std::atomic_thread_fence( std::memory_order_release );
+            std::atomic_ref< std::uint64_t >( record.count ).store( count, std::memory_order_relaxed );
+            std::atomic_ref< std::uint64_t >( record.checksum )
+                .store( commit_checksum( sequence, count ), std::memory_order_relaxed );
+            std::atomic_ref< std::uint64_t >( record.sequence ).store( sequence, std::memory_order_release );
+        }
+
+    }
+
     template<POD T>
     class FileVector {
     public:
@@ -109,7 +237,8 @@ namespace spica {
         size_type size( ) const
             { return item_count; }
 
-        size_type max_size( ) const;
+        size_type max_size( ) const
+            { return std::numeric_limits<size_type>::max( ) / sizeof( T ); }
 
         size_type capacity( ) const
             { return item_capacity; }
@@ -137,6 +266,9 @@ namespace spica {
 
         void push_back( const T &new_item );
 
+        //! Appends n elements copied from data with a single reallocation and copy.
+        void append( const T *data, size_type n );
+
         void pop_back( )
             { if( item_count ) item_count--; }
 
@@ -144,19 +276,103 @@ namespace spica {
 
         void insert( iterator Position, size_type n, const T &fill );
 
-        template<class InputIterator>
+        // The range members are constrained so that, for example, insert( p, 10, 1 ) on a
+        // FileVector<int> calls the fill version.
+        template<std::input_iterator InputIterator>
         void insert( iterator Position, InputIterator first, InputIterator last );
 
         void erase( iterator Position );
         void erase( iterator first, iterator last );
         void clear( )
-            { item_count = 0 };
+            { item_count = 0; }
         void resize( size_type n, const T &fill = T( ) );
         void assign( size_type n, const T &new_item );
 
-        template<class InputIterator>
+        //! Changes the size without initializing any new elements.
+        /*!
+         * The new elements hold whatever is in the file at their position. Parts of the file
+         * that have never been written, or that were discarded, hold zero bytes. This lets a
+         * program that wants zeroed elements grow a large vector without touching its pages.
+         */
+        void resize_for_overwrite( size_type n );
+
+        //! Sets the elements [first, first + count) to zero bytes and releases their disk space.
+        /*!
+         * Whole pages in the range are removed from the file where the system supports it (on
+         * Linux the file becomes sparse). The rest of the range is simply cleared. The size of
+         * the vector is unchanged. The range is clipped to the capacity.
+         */
+        void discard( size_type first, size_type count );
+
+        template<std::input_iterator InputIterator>
         void assign( InputIterator first, InputIterator last );
 
+        //! Reserves address space so that the vector's elements never move.
+        /*!
+         * Sets aside a range of virtual addresses large enough to hold the given number of
+         * bytes and moves the vector there. Afterward the file and its mapping are grown in
+         * place so pointers and iterators remain valid as long as the elements they refer to
+         * exist. Only address space is reserved; no memory or disk space is used until the
+         * vector actually grows. Growing beyond the reservation throws std::bad_alloc.
+         *
+         * \return true if the reservation was made. Reservations are only supported on POSIX
+         * systems; on other systems this function returns false and does nothing.
+         */
+        bool reserve_address_space( size_type bytes = default_address_reserve );
+
+        //! Returns true if the elements will never move (see reserve_address_space).
+        bool stable_addresses( ) const;
+
+        //! The default size of an address space reservation (1 TB on 64-bit systems).
+        static const size_type default_address_reserve =
+            ( sizeof( size_type ) >= 8 ) ? static_cast<size_type>( 1 ) << 40 :
+                                           static_cast<size_type>( 1 ) << 30;
+
+        //! Tells the operating system how the whole vector will be accessed.
+        void advise( access_pattern pattern );
+
+        //! The number of bytes in the file before the first element.
+        static const size_type header_bytes = detail::file_vector_header_bytes;
+
+        //! The size of the part of the header reserved for the program (see user_header).
+        static const size_type user_header_bytes = detail::file_vector_user_header_bytes;
+
+        //! Returns the part of the header reserved for the program.
+        /*!
+         * The area is initially zero. It is stored in the file like the elements and written
+         * by flush( ) and sync( ). Its address changes when the vector's elements move.
+         */
+        void *user_header( )
+            { return reinterpret_cast<char *>( header ) + header_bytes - user_header_bytes; }
+
+        const void *user_header( ) const
+            { return reinterpret_cast<const char *>( header ) + header_bytes - user_header_bytes; }
+
+        //! Records the current size of the vector in the file.
+        /*!
+         * After a commit, reopening the file (even after the program crashes) produces a vector
+         * of this size. The commit record is in memory shared with the file so it survives a
+         * crash of the program but not necessarily a crash of the operating system. Use sync( )
+         * to be sure the commit reaches the disk.
+         */
+        void commit( );
+
+        //! Writes the header and all elements to the disk.
+        void flush( flush_mode mode = flush_mode::sync );
+
+        //! Writes the elements [first, first + count) to the disk.
+        void flush( size_type first, size_type count, flush_mode mode = flush_mode::sync );
+
+        //! Writes the elements to the disk, commits, and then writes the commit to the disk.
+        /*!
+         * The elements are written before the commit so that a file reopened after a crash of
+         * the operating system never contains a size larger than the data that was written.
+         */
+        void sync( );
+
+        //! Tells the operating system how the elements [first, first + count) will be accessed.
+        void advise( size_type first, size_type count, access_pattern pattern );
+
         /*!
          * Creates an empty vector if the file does not exist, otherwise creates a vector
          * containing the contents of the file.
@@ -176,7 +392,7 @@ namespace spica {
          * If the file exists it is overwritten. If it does not exist, it is created. The vector
          * contains a copy of the range [first, last).
          */
-        template<class InputIterator>
+        template<std::input_iterator InputIterator>
         FileVector( const char *file_name, InputIterator first, InputIterator last );
 
         // Cleans up.
@@ -197,8 +413,22 @@ namespace spica {
         FileVector( const FileVector<T> & ) = delete;
 
         // The internal representation.
+        #if eOPSYS == eWINDOWS
         HANDLE    file_handle;     // Handle from CreateFile( ).
         HANDLE    mapping_handle;  // The result of the file mapping operation.
+        #endif
+
+        #if eOPSYS == ePOSIX
+        int       file_descriptor; // Descriptor from open( ).
+        size_type mapped_bytes;    // Size of the file mapping that starts at header.
+        size_type reserved_bytes;  // Size of the reserved address range (zero if none).
+
+        // Returns the size of a virtual memory page.
+        static size_type page_size( )
+            { return static_cast<size_type>( sysconf( _SC_PAGESIZE ) ); }
+        #endif
+
+        detail::file_vector_header *header;  // The start of the mapping (null if unmapped).
         T        *raw;             // Points at the first element of the mapped file.
 
         size_type item_count;      // The number of elements in the vector.
@@ -211,6 +441,27 @@ namespace spica {
          * sufficient.
          */
         void reallocate( size_type more );
+
+        // The following functions hide the differences between the platforms.
+
+        // Fills in the header of a new file and commits the current size.
+        void initialize_header( );
+
+        // Opens (and optionally truncates) the file. Returns the size of the file in bytes.
+        size_type open_backing( const char *file_name, bool truncate );
+
+        // Maps the header and item_capacity elements of the open file, enlarging the file if
+        // necessary.
+        void map_backing( );
+
+        // Enlarges the file and its mapping to hold new_capacity elements. Might move raw.
+        void remap_backing( size_type new_capacity );
+
+        // Writes length bytes of the mapping, starting at offset, to the disk.
+        void flush_bytes( size_type offset, size_type length, flush_mode mode );
+
+        // Unmaps the file (if mapped), optionally trims it to item_count elements, and closes it.
+        void close_backing( bool trim );
     };
 
 
@@ -221,6 +472,114 @@ namespace spica {
     template<typename T>
     bool operator<( const FileVector<T> &, const FileVector<T> & );
 
+
+    //! Read-only view of a FileVector's file.
+    /*!
+     * A reader maps the file read-only and shared so many processes can read the elements
+     * without copying them while one FileVector appends to the file. The reader's size is a
+     * snapshot of one of the writer's commits. It only changes when refresh( ) is called so the
+     * elements [0, size( )) can be used consistently in the meantime.
+     *
+     * While readers are active the writer should only append elements and commit. Elements that
+     * are changed after they are committed might be seen in either state by a reader. Shrinking
+     * the vector below a reader's size makes the reader's behavior undefined.
+     */
+    template<POD T>
+    class FileVectorReader {
+    public:
+
+        typedef              T  value_type;
+        typedef        const T *pointer;
+        typedef        const T *const_pointer;
+        typedef        const T &reference;
+        typedef        const T &const_reference;
+        typedef    std::size_t  size_type;
+        typedef std::ptrdiff_t  difference_type;
+        typedef        const T *iterator;
+        typedef        const T *const_iterator;
+
+        //! Opens and maps the file. Throws std::runtime_error if it isn't a suitable FileVector.
+        explicit FileVectorReader( const char *file_name );
+
+        // Cleans up.
+        ~FileVectorReader( );
+
+        const_iterator begin( ) const
+            { return raw; }
+
+        const_iterator end( ) const
+            { return raw + item_count; }
+
+        //! Returns the size of the snapshot.
+        size_type size( ) const
+            { return item_count; }
+
+        bool empty( ) const
+            { return item_count == 0; }
+
+        const_reference operator[]( size_type offset ) const
+            { return raw[offset]; }
+
+        const_reference front( ) const
+            { return raw[0]; }
+
+        const_reference back( ) const
+            { return raw[item_count - 1]; }
+
+        //! The number of bytes in the file before the first element.
+        static const size_type header_bytes = detail::file_vector_header_bytes;
+
+        //! The part of the header reserved for the program. See FileVector::user_header.
+        static const size_type user_header_bytes = detail::file_vector_user_header_bytes;
+
+        const void *user_header( ) const
+            { return reinterpret_cast<const char *>( header ) + header_bytes - user_header_bytes; }
+
+        //! Returns the size of the writer's latest commit without changing the snapshot.
+        size_type committed_size( ) const;
+
+        //! Moves the snapshot to the writer's latest commit.
+        /*!
+         * If the file has grown it is remapped, which invalidates pointers and iterators into
+         * the reader.
+         *
+         * 
+eturn true if the size of the snapshot changed.
+         */
+        bool refresh( );
+
+    private:
+        FileVectorReader( const FileVectorReader & ) = delete;
+        FileVectorReader &operator=( const FileVectorReader & ) = delete;
+
+        #if eOPSYS == eWINDOWS
+        HANDLE    file_handle;     // Handle from CreateFile( ).
+        HANDLE    mapping_handle;  // The result of the file mapping operation.
+        #endif
+
+        #if eOPSYS == ePOSIX
+        int       file_descriptor; // Descriptor from open( ).
+        size_type mapped_bytes;    // Size of the file mapping that starts at header.
+        #endif
+
+        detail::file_vector_header *header;  // The start of the mapping (null if unmapped).
+        const T  *raw;             // Points at the first element of the mapped file.
+
+        size_type item_count;      // The size of the snapshot.
+        size_type item_capacity;   // The number of elements covered by the mapping.
+
+        // The following functions hide the differences between the platforms.
+
+        // Opens the file read-only.
+        void open_file( const char *file_name );
+
+        // Maps the entire file, replacing any existing mapping, and sets item_capacity.
+        void map_file( );
+
+        // Unmaps (if mapped) and closes the file.
+        void close_file( );
+    };
+
 } // End of namespace scope.
 
 
@@ -239,10 +598,9 @@ namespace spica {
     template<POD T>
     void FileVector<T>::reserve( size_type new_capacity )
     {
-        if( new_capacity < item_capacity ) return;
+        if( new_capacity <= item_capacity ) return;
 
-        size_type extra = new_capacity - item_capacity;
-        reallocate( extra );
+        reallocate( new_capacity - item_count );
     }
 
 
@@ -254,7 +612,7 @@ namespace spica {
     template<POD T>
     void FileVector<T>::push_back( const T &new_item )
     {
-        reallocate( 1 );
+        if( item_count == item_capacity ) reallocate( 1 );
 
         // Install the item.
         raw[item_count] = new_item;
@@ -262,16 +620,33 @@ namespace spica {
     }
 
 
+    //
+    // FileVector<T>::append( const T *data, size_type n )
+    //
+    // The data must not be in the vector itself because the reallocation might move it.
+    //
+    template<POD T>
+    void FileVector<T>::append( const T *data, size_type n )
+    {
+        reallocate( n );
+        std::memcpy( raw + item_count, data, sizeof( T )*n );
+        item_count += n;
+    }
+
+
     //
     // FileVector<T>::insert( iterator position, const T &new_item )
     //
-    // Inserts the new item before position.
+    // Inserts the new item before position. The reallocation might move the mapping so the
+    // position is converted to an offset first.
     //
     template<POD T>
     typename FileVector<T>::iterator
         FileVector<T>::insert( iterator position, const T &new_item )
     {
+        size_type offset = position - raw;
         reallocate( 1 );
+        position = raw + offset;
 
         std::memmove( position + 1, position, sizeof( T )*( ( raw + item_count ) - position ) );
         *position = new_item;
@@ -288,13 +663,13 @@ namespace spica {
     template<POD T>
     void FileVector<T>::insert( iterator position, size_type n, const T &fill )
     {
+        size_type offset = position - raw;
         reallocate( n );
+        position = raw + offset;
 
         std::memmove( position + n, position, sizeof( T )*( ( raw + item_count ) - position ) );
-        for( size_type counter = 0; counter < n; ++counter ) {
-            *position = fill;
-            position++;
-        }
+        std::fill_n( position, n, fill );
+        item_count += n;
     }
 
 
@@ -302,21 +677,83 @@ namespace spica {
     // template< typename InputIterator >
     // FileVector<T>::insert( iterator position, InputIterator first, InputIterator last )
     //
-    // Inserts the given sequence before position. The annoying thing about this is that I can't
-    // compute ahead of time the distance between `first` and `last`. Thus I pretty much have to
-    // insert one item at a time.
+    // Inserts the given sequence before position. With forward iterators the length of the
+    // sequence is computed first so the vector is reallocated once and the tail is moved once.
+    // With input iterators the length can't be known ahead of time. In that case the items are
+    // appended (with amortized reallocation) and then rotated into place, which is still linear.
+    // The sequence must not come from the vector itself.
+    //
+    template<POD T>
+    template<std::input_iterator InputIterator>
+    void FileVector<T>::insert( iterator position, InputIterator first, InputIterator last )
+    {
+        size_type offset = position - raw;
+
+        if constexpr( std::forward_iterator<InputIterator> ) {
+            size_type n = static_cast<size_type>( std::distance( first, last ) );
+            reallocate( n );
+            position = raw + offset;
+
+            std::memmove( position + n, position, sizeof( T )*( ( raw + item_count ) - position ) );
+            std::copy( first, last, position );
+            item_count += n;
+        }
+        else {
+            size_type old_count = item_count;
+            for( ; first != last; ++first ) push_back( *first );
+            std::rotate( raw + offset, raw + old_count, raw + item_count );
+        }
+    }
+
+
+    //
+    // template< typename InputIterator >
+    // FileVector<T>::assign( InputIterator first, InputIterator last )
+    //
+    template<POD T>
+    template<std::input_iterator InputIterator>
+    void FileVector<T>::assign( InputIterator first, InputIterator last )
+    {
+        item_count = 0;
+        insert( raw, first, last );
+    }
+
+
+    //
+    // FileVector<T>::assign( size_type n, const T &new_item )
+    //
+    template<POD T>
+    void FileVector<T>::assign( size_type n, const T &new_item )
+    {
+        item_count = 0;
+        insert( raw, n, new_item );
+    }
+
+
+    //
+    // FileVector<T>::resize( size_type n, const T &fill )
+    //
+    template<POD T>
+    void FileVector<T>::resize( size_type n, const T &fill )
+    {
+        if( n <= item_count ) {
+            item_count = n;
+        }
+        else {
+            insert( raw + item_count, n - item_count, fill );
+        }
+    }
+
+
     //
-    // Note that this will cause the run-time performance of this function to be O(n*m) where n
-    // is related to the item_count of the FileVector and m is the number of elements in the
-    // input range. This is a violation of the standard when the iterator type parameter is
-    // something more powerful than merely InputIterator. Eventually I should fix this by
-    // detecting and handling the different iterator types.
+    // FileVector<T>::resize_for_overwrite( size_type n )
     //
-    // template<POD T>
-    // template<typename InputIterator>
-    // void FileVector<T>::insert( iterator position, InputIterator first, InputIterator last )
-    // {
-    // }
+    template<POD T>
+    void FileVector<T>::resize_for_overwrite( size_type n )
+    {
+        if( n > item_count ) reallocate( n - item_count );
+        item_count = n;
+    }
 
 
     //
@@ -347,159 +784,187 @@ namespace spica {
 
 
     //
-    // FileVector<T>::FileVector( const char *file_name );
+    // FileVector<T>::advise( access_pattern )
     //
-    // The constructor opens and maps the file.
+    // Gives the operating system a hint about the entire mapping, including any reserved
+    // capacity.
     //
     template<POD T>
-    FileVector<T>::FileVector( const char *file_name )
+    void FileVector<T>::advise( access_pattern pattern )
     {
-        // Open the file.
-        file_handle = CreateFile(
-            file_name,                   // The name (of course).
-            GENERIC_READ|GENERIC_WRITE,  // I want to read and write the file.
-            0,                           // Share mode =>  exclusive access.
-            0,                           // Default security attributes.
-            OPEN_ALWAYS,                 // If it does not exist, create it.
-            FILE_FLAG_RANDOM_ACCESS,     // Let Windows optimize access.
-            0                            // No template file.
-        );
-        if( file_handle == INVALID_HANDLE_VALUE )
-            throw Windows::APIError( "Can't open the backing file for a FileVector" );
+        advise( 0, item_capacity, pattern );
+    }
 
-        // Learn the file's size. I check to make sure the file is not too large so that I can
-        // represent its byte count in size_type. This is mostly only relevant for 32-bit
-        // Windows where size_type is limited to 4 GB and yet files might be larger than that.
-        // The current implementation works by limiting the file size to 4 GB, which is
-        // unnecessarily restrictive on 64-bit Windows.
-        //
-        // In addition, I will start off with the vector's item_capacity equal to its item_count
-        // (unless its item_count is zero -- it's important that item_capacity never be zero).
-        //
-        DWORD high_word;
-        DWORD low_word;
-        low_word = GetFileSize( file_handle, &high_word );
-        if( high_word != 0 ) {
-            CloseHandle( file_handle );
-            throw std::bad_alloc( );   // Is this the best choice to throw here?
-        }
-        item_count     = low_word;
-        item_count    /= sizeof( T );
-        item_capacity = item_count;
-        if( item_capacity == 0 ) item_capacity = 1;
-        
-        // Map it.
-        mapping_handle = CreateFileMapping(
-            file_handle,          // The file we are trying to map.
-            0,                    // Default security attributes.
-            PAGE_READWRITE,       // I want to read and write this file.
-            0,                    // Map a size equal to the current capacity.
-            sizeof( T ) * item_capacity, //  ...
-            0                     // I am not interested in using a name.
-        );
-        if( mapping_handle == 0 ) {
-            CloseHandle( file_handle );
-            throw Windows::APIError( "Can't map the backing file for an FileVector" );
-        }
 
-        // Create a view into the mapped file.
-        raw = static_cast<T *>( MapViewOfFile(
-            mapping_handle,       // The mapped file from which we create the view.
-            FILE_MAP_ALL_ACCESS,  // Read/Write through this view.
-            0,                    // Offset into file where view starts.
-            0,                    //   ...
-            0                     // Map entire file.
-        ) );
-        if( raw == 0 ) {
-            CloseHandle( mapping_handle );
-            CloseHandle( file_handle );
-            throw Windows::APIError(
-                "Can't create a file view of the backing file for an FileVector" );
-        }
+    //
+    // FileVector<T>::commit( )
+    //
+    // The record that isn't the latest is overwritten. If there is no valid record the first one
+    // is used.
+    //
+    template<POD T>
+    void FileVector<T>::commit( )
+    {
+        std::uint64_t sequence = 0;
+        std::uint64_t count;
+        int latest = detail::latest_commit( header, sequence, count );
+        detail::write_commit( header->commits[( latest == 0 ) ? 1 : 0], sequence + 1, item_count );
     }
 
 
     //
-    // FileVector<T>::FileVector( const char *file_name, size_type n, const T &initial );
+    // FileVector<T>::flush( flush_mode )
     //
-    // The constructor opens and maps the file.
+    template<POD T>
+    void FileVector<T>::flush( flush_mode mode )
+    {
+        flush_bytes( 0, header_bytes + sizeof( T )*item_count, mode );
+    }
+
+
+    //
+    // FileVector<T>::flush( size_type first, size_type count, flush_mode )
+    //
+    // The range is clipped to the mapping.
     //
     template<POD T>
-    FileVector< T >::FileVector( const char *file_name, size_type n, const T &initial )
+    void FileVector<T>::flush( size_type first, size_type count, flush_mode mode )
     {
-        // Open the file.
-        file_handle = CreateFile(
-            file_name,                   // The name (of course).
-            GENERIC_READ|GENERIC_WRITE,  // I want to read and write the file.
-            0,                           // Share mode =>  exclusive access.
-            0,                           // Default security attributes.
-            CREATE_ALWAYS,               // If it exists, overwrite it.
-            FILE_FLAG_RANDOM_ACCESS,     // Let Windows optimize access.
-            0                            // No template file.
-        );
-        if( file_handle == INVALID_HANDLE_VALUE )
-            throw Windows::APIError( "Can't open the backing file for a FileVector" );
+        if( first >= item_capacity || count == 0 ) return;
+        if( count > item_capacity - first ) count = item_capacity - first;
+        flush_bytes( header_bytes + sizeof( T )*first, sizeof( T )*count, mode );
+    }
 
-        // The item_count is a parameter.
-        item_count    = n;
-        item_capacity = item_count;
-        if( item_capacity == 0 ) item_capacity = 1;
 
-        // Map it.
-        mapping_handle = CreateFileMapping(
-            file_handle,          // The file we are trying to map.
-            0,                    // Default security attributes.
-            PAGE_READWRITE,       // I want to read and write this file.
-            0,                    // Map a size equal to the current capacity.
-            sizeof(T) * item_capacity, //  ...
-            0                     // I am not interested in using a name.
-        );
-        if( mapping_handle == 0 ) {
-            CloseHandle( file_handle );
-            throw Windows::APIError( "Can't map the backing file for an FileVector" );
+    //
+    // FileVector<T>::sync( )
+    //
+    template<POD T>
+    void FileVector<T>::sync( )
+    {
+        flush( flush_mode::sync );
+        commit( );
+        flush_bytes( 0, sizeof( detail::file_vector_header ), flush_mode::sync );
+    }
+
+
+    //
+    // FileVector<T>::initialize_header( )
+    //
+    template<POD T>
+    void FileVector<T>::initialize_header( )
+    {
+        std::memset( header, 0, sizeof( detail::file_vector_header ) );
+        std::memcpy( header->magic, detail::file_vector_magic, sizeof( header->magic ) );
+        header->version      = detail::file_vector_version;
+        header->element_size = sizeof( T );
+        commit( );
+    }
+
+
+    //
+    // FileVector<T>::FileVector( const char *file_name );
+    //
+    // The constructor opens and maps the file. The size comes from the file's latest commit
+    // record and the capacity from the length of the file (it's important that item_capacity
+    // never be zero). A file that is too short to have a header or that has an unsuitable header
+    // is left unchanged and std::runtime_error is thrown.
+    //
+    template<POD T>
+    FileVector<T>::FileVector( const char *file_name )
+    {
+        size_type file_bytes = open_backing( file_name, false );
+        header = 0;
+
+        if( file_bytes == 0 ) {
+            item_count    = 0;
+            item_capacity = 1;
+            map_backing( );
+            initialize_header( );
+            return;
         }
 
-        // Create a view into the mapped file.
-        raw = static_cast<T *>( MapViewOfFile(
-            mapping_handle,       // The mapped file from which we create the view.
-            FILE_MAP_ALL_ACCESS,  // Read/Write through this view.
-            0,                    // Offset into file where view starts.
-            0,                    //   ...
-            0                     // Map entire file.
-        ) );
-        if( raw == 0 ) {
-            CloseHandle( mapping_handle );
-            CloseHandle( file_handle );
-            throw Windows::APIError(
-                "Can't create a file view of the backing file for an FileVector" );
+        if( file_bytes < header_bytes ) {
+            close_backing( false );
+            throw std::runtime_error( "The file is not a FileVector" );
+        }
+        item_capacity = ( file_bytes - header_bytes ) / sizeof( T );
+        if( item_capacity == 0 ) item_capacity = 1;
+        map_backing( );
+
+        std::uint64_t sequence;
+        std::uint64_t count;
+        if( !detail::check_header( header, sizeof( T ) ) ) {
+            close_backing( false );
+            throw std::runtime_error( "The file is not a FileVector of this type" );
         }
+        if( detail::latest_commit( header, sequence, count ) == -1 || count > item_capacity ) {
+            close_backing( false );
+            throw std::runtime_error( "The FileVector has no valid commit record" );
+        }
+        item_count = static_cast<size_type>( count );
+    }
+
+
+    //
+    // FileVector<T>::FileVector( const char *file_name, size_type n, const T &initial );
+    //
+    // The constructor opens and maps the file.
+    //
+    template<POD T>
+    FileVector< T >::FileVector( const char *file_name, size_type n, const T &initial )
+    {
+        open_backing( file_name, true );
+        header = 0;
+
+        // The item_count is a parameter.
+        item_count    = n;
+        item_capacity = item_count;
+        if( item_capacity == 0 ) item_capacity = 1;
+        map_backing( );
 
         // Initialize the vector with initial.
         for( size_type i = 0; i < item_count; ++i ) {
             raw[i] = initial;
         }
+        initialize_header( );
     }
 
 
     //
-    // FileVector<T>::~FileVector( )
+    // template< typename InputIterator >
+    // FileVector<T>::FileVector( const char *file_name, InputIterator first, InputIterator last )
     //
-    // The destructor closes things down in an orderly manner.
+    // The vector starts empty and the range is then assigned to it. The result is committed.
     //
     template<POD T>
-    FileVector<T>::~FileVector( )
+    template<std::input_iterator InputIterator>
+    FileVector<T>::FileVector( const char *file_name, InputIterator first, InputIterator last )
     {
-        UnmapViewOfFile( raw );
-        CloseHandle( mapping_handle );
+        open_backing( file_name, true );
+        header = 0;
 
-        // Now truncate the file if necessary.
-        if( item_count < item_capacity ) {
-            SetFilePointer( file_handle, sizeof( T )*item_count, 0, FILE_BEGIN );
-            SetEndOfFile( file_handle );
-        }
+        item_count    = 0;
+        item_capacity = 1;
+        map_backing( );
+        initialize_header( );
 
-        // Close the file.
-        CloseHandle( file_handle );
+        assign( first, last );
+        commit( );
+    }
+
+
+    //
+    // FileVector<T>::~FileVector( )
+    //
+    // The destructor closes things down in an orderly manner. The final size is committed but
+    // the destructor doesn't wait for the data to reach the disk.
+    //
+    template<POD T>
+    FileVector<T>::~FileVector( )
+    {
+        commit( );
+        close_backing( true );
     }
 
 
@@ -513,11 +978,21 @@ namespace spica {
     {
         using std::swap;
 
-        swap( file_handle,    other.file_handle    );
-        swap( mapping_handle, other.mapping_handle );
-        swap( raw,            other.raw            );
-        swap( item_count,     other.item_count     );
-        swap( item_capacity,  other.item_capacity  );
+        #if eOPSYS == eWINDOWS
+        swap( file_handle,     other.file_handle     );
+        swap( mapping_handle,  other.mapping_handle  );
+        #endif
+
+        #if eOPSYS == ePOSIX
+        swap( file_descriptor, other.file_descriptor );
+        swap( mapped_bytes,    other.mapped_bytes    );
+        swap( reserved_bytes,  other.reserved_bytes  );
+        #endif
+
+        swap( header,          other.header          );
+        swap( raw,             other.raw             );
+        swap( item_count,      other.item_count      );
+        swap( item_capacity,   other.item_capacity   );
     }
 
 
@@ -554,43 +1029,636 @@ namespace spica {
             }
         }
 
-        // Remap the file with the new item_capacity. If an exception occurs during the
-        // remapping operation, the FileVector will be unusuable.
+        remap_backing( new_capacity );
+        item_capacity = new_capacity;
+    }
+
+
+    //
+    // FileVectorReader<T>::FileVectorReader( const char *file_name )
+    //
+    template<POD T>
+    FileVectorReader<T>::FileVectorReader( const char *file_name )
+    {
+        open_file( file_name );
+        header     = 0;
+        item_count = 0;
+        try {
+            map_file( );
+        }
+        catch( ... ) {
+            close_file( );
+            throw;
+        }
+
+        std::uint64_t sequence;
+        std::uint64_t count;
+        if( !detail::check_header( header, sizeof( T ) ) ) {
+            close_file( );
+            throw std::runtime_error( "The file is not a FileVector of this type" );
+        }
+        if( detail::latest_commit( header, sequence, count ) == -1 ) {
+            close_file( );
+            throw std::runtime_error( "The FileVector has no valid commit record" );
+        }
+        refresh( );
+    }
+
+
+    //
+    // FileVectorReader<T>::~FileVectorReader( )
+    //
+    template<POD T>
+    FileVectorReader<T>::~FileVectorReader( )
+    {
+        close_file( );
+    }
+
+
+    //
+    // FileVectorReader<T>::committed_size( )
+    //
+    // If no record can be read at the moment (which happens only if the header is damaged) the
+    // size of the snapshot is returned.
+    //
+    template<POD T>
+    typename FileVectorReader<T>::size_type FileVectorReader<T>::committed_size( ) const
+    {
+        std::uint64_t sequence;
+        std::uint64_t count;
+        if( detail::latest_commit( header, sequence, count ) == -1 ) return item_count;
+        return static_cast<size_type>( count );
+    }
+
+
+    //
+    // FileVectorReader<T>::refresh( )
+    //
+    // The writer extends the file before it commits a size that needs the extra space, so a
+    // committed size beyond the current mapping means the file has grown.
+    //
+    template<POD T>
+    bool FileVectorReader<T>::refresh( )
+    {
+        size_type count = committed_size( );
+        if( count > item_capacity ) {
+            map_file( );
+            if( count > item_capacity ) return false;
+        }
+        if( count == item_count ) return false;
+        item_count = count;
+        return true;
+    }
+
+
+    #if eOPSYS == eWINDOWS
+
+    //==============================================
+    //           Windows Specific Functions
+    //==============================================
+
+    template<POD T>
+    typename FileVector<T>::size_type
+        FileVector<T>::open_backing( const char *file_name, bool truncate )
+    {
+        // Open the file.
+        file_handle = CreateFile(
+            file_name,                   // The name (of course).
+            GENERIC_READ|GENERIC_WRITE,  // I want to read and write the file.
+            FILE_SHARE_READ,             // Share mode =>  FileVectorReaders are allowed.
+            0,                           // Default security attributes.
+            truncate ? CREATE_ALWAYS : OPEN_ALWAYS,  // Overwrite or open, creating if needed.
+            FILE_FLAG_RANDOM_ACCESS,     // Let Windows optimize access.
+            0                            // No template file.
+        );
+        if( file_handle == INVALID_HANDLE_VALUE )
+            throw Windows::APIError( "Can't open the backing file for a FileVector" );
+
+        // Learn the file's size. I check to make sure the file is not too large so that I can
+        // represent its byte count in size_type. This is mostly only relevant for 32-bit
+        // Windows where size_type is limited to 4 GB and yet files might be larger than that.
+        // The current implementation works by limiting the file size to 4 GB, which is
+        // unnecessarily restrictive on 64-bit Windows.
         //
-        UnmapViewOfFile( raw );
-        CloseHandle( mapping_handle );
+        DWORD high_word;
+        DWORD low_word;
+        low_word = GetFileSize( file_handle, &high_word );
+        if( high_word != 0 ) {
+            CloseHandle( file_handle );
+            throw std::bad_alloc( );   // Is this the best choice to throw here?
+        }
+        return low_word;
+    }
 
+
+    template<POD T>
+    void FileVector<T>::map_backing( )
+    {
         // Map it.
         mapping_handle = CreateFileMapping(
             file_handle,          // The file we are trying to map.
             0,                    // Default security attributes.
             PAGE_READWRITE,       // I want to read and write this file.
-            0,                    // Map a size equal to the current capacity.
-            sizeof( T ) * new_capacity, //  ...
+            0,                    // Map the header and the current capacity.
+            header_bytes + sizeof( T ) * item_capacity, //  ...
             0                     // I am not interested in using a name.
         );
         if( mapping_handle == 0 ) {
             CloseHandle( file_handle );
-            throw Windows::APIError( "Can't remap the backing file for an FileVector" );
+            throw Windows::APIError( "Can't map the backing file for an FileVector" );
         }
 
         // Create a view into the mapped file.
-        raw = static_cast<T *>( MapViewOfFile(
+        header = static_cast<detail::file_vector_header *>( MapViewOfFile(
             mapping_handle,       // The mapped file from which we create the view.
             FILE_MAP_ALL_ACCESS,  // Read/Write through this view.
             0,                    // Offset into file where view starts.
             0,                    //   ...
             0                     // Map entire file.
         ) );
-        if( raw == 0 ) {
+        if( header == 0 ) {
             CloseHandle( mapping_handle );
             CloseHandle( file_handle );
             throw Windows::APIError(
-                "Can't recreate a file view of the backing file for an FileVector" );
+                "Can't create a file view of the backing file for an FileVector" );
         }
+        raw = reinterpret_cast<T *>( reinterpret_cast<char *>( header ) + header_bytes );
+    }
+
+
+    //
+    // Remap the file with the new item_capacity. If an exception occurs during the remapping
+    // operation, the FileVector will be unusuable.
+    //
+    template<POD T>
+    void FileVector<T>::remap_backing( size_type new_capacity )
+    {
+        UnmapViewOfFile( header );
+        CloseHandle( mapping_handle );
+
+        size_type old_capacity = item_capacity;
         item_capacity = new_capacity;
+        try {
+            map_backing( );
+        }
+        catch( ... ) {
+            item_capacity = old_capacity;
+            throw;
+        }
     }
 
+
+    template<POD T>
+    void FileVector<T>::flush_bytes( size_type offset, size_type length, flush_mode mode )
+    {
+        // FlushViewOfFile treats a length of zero as the rest of the view.
+        if( length == 0 ) return;
+        if( !FlushViewOfFile( reinterpret_cast<char *>( header ) + offset, length ) )
+            throw Windows::APIError( "Can't flush the view of a FileVector's file" );
+        if( mode == flush_mode::sync && !FlushFileBuffers( file_handle ) )
+            throw Windows::APIError( "Can't flush a FileVector's file to the disk" );
+    }
+
+
+    template<POD T>
+    void FileVector<T>::close_backing( bool trim )
+    {
+        if( header != 0 ) {
+            UnmapViewOfFile( header );
+            CloseHandle( mapping_handle );
+        }
+
+        // Now truncate the file if necessary.
+        if( trim && item_count < item_capacity ) {
+            SetFilePointer( file_handle, header_bytes + sizeof( T )*item_count, 0, FILE_BEGIN );
+            SetEndOfFile( file_handle );
+        }
+
+        // Close the file.
+        CloseHandle( file_handle );
+    }
+
+
+    // Windows needs placeholder mappings to grow a view in place. That isn't supported yet.
+    template<POD T>
+    bool FileVector<T>::reserve_address_space( size_type )
+    {
+        return false;
+    }
+
+
+    template<POD T>
+    bool FileVector<T>::stable_addresses( ) const
+    {
+        return false;
+    }
+
+
+    // Windows has no direct equivalent to madvise. The hints are ignored.
+    template<POD T>
+    void FileVector<T>::advise( size_type, size_type, access_pattern )
+    { }
+
+
+    // The file isn't sparse so the disk space can't be released. The elements are cleared.
+    template<POD T>
+    void FileVector<T>::discard( size_type first, size_type count )
+    {
+        if( first >= item_capacity || count == 0 ) return;
+        if( count > item_capacity - first ) count = item_capacity - first;
+        std::memset( raw + first, 0, sizeof( T ) * count );
+    }
+
+
+    template<POD T>
+    void FileVectorReader<T>::open_file( const char *file_name )
+    {
+        // The writer has the file open for writing so write sharing must be allowed.
+        file_handle = CreateFile(
+            file_name,
+            GENERIC_READ,
+            FILE_SHARE_READ|FILE_SHARE_WRITE,
+            0,
+            OPEN_EXISTING,
+            FILE_FLAG_RANDOM_ACCESS,
+            0
+        );
+        if( file_handle == INVALID_HANDLE_VALUE )
+            throw Windows::APIError( "Can't open the file for a FileVectorReader" );
+    }
+
+
+    //
+    // The new view is created before the old one is released so that the reader is unchanged if
+    // there is an error.
+    //
+    template<POD T>
+    void FileVectorReader<T>::map_file( )
+    {
+        DWORD high_word;
+        DWORD low_word = GetFileSize( file_handle, &high_word );
+        if( high_word != 0 ) throw std::bad_alloc( );
+        if( low_word < header_bytes ) throw std::runtime_error( "The file is not a FileVector" );
+
+        HANDLE new_mapping = CreateFileMapping( file_handle, 0, PAGE_READONLY, 0, 0, 0 );
+        if( new_mapping == 0 )
+            throw Windows::APIError( "Can't map the file for a FileVectorReader" );
+
+        void *view = MapViewOfFile( new_mapping, FILE_MAP_READ, 0, 0, 0 );
+        if( view == 0 ) {
+            CloseHandle( new_mapping );
+            throw Windows::APIError( "Can't create a file view for a FileVectorReader" );
+        }
+
+        if( header != 0 ) {
+            UnmapViewOfFile( header );
+            CloseHandle( mapping_handle );
+        }
+        mapping_handle = new_mapping;
+        header         = static_cast<detail::file_vector_header *>( view );
+        raw            = reinterpret_cast<const T *>( static_cast<char *>( view ) + header_bytes );
+        item_capacity  = ( low_word - header_bytes ) / sizeof( T );
+    }
+
+
+    template<POD T>
+    void FileVectorReader<T>::close_file( )
+    {
+        if( header != 0 ) {
+            UnmapViewOfFile( header );
+            CloseHandle( mapping_handle );
+            header = 0;
+        }
+        CloseHandle( file_handle );
+    }
+
+    #endif
+
+
+    #if eOPSYS == ePOSIX
+
+    //============================================
+    //           POSIX Specific Functions
+    //============================================
+
+    template<POD T>
+    typename FileVector<T>::size_type
+        FileVector<T>::open_backing( const char *file_name, bool truncate )
+    {
+        int flags = O_RDWR | O_CREAT;
+        if( truncate ) flags |= O_TRUNC;
+
+        file_descriptor = ::open( file_name, flags, 0666 );
+        if( file_descriptor == -1 )
+            throw std::system_error(
+                errno, std::generic_category( ), "Can't open the backing file for a FileVector" );
+
+        struct stat file_information;
+        if( fstat( file_descriptor, &file_information ) == -1 ) {
+            int error = errno;
+            ::close( file_descriptor );
+            throw std::system_error(
+                error, std::generic_category( ), "Can't get the size of a FileVector's file" );
+        }
+        return static_cast<size_type>( file_information.st_size );
+    }
+
+
+    template<POD T>
+    void FileVector<T>::map_backing( )
+    {
+        size_type bytes = header_bytes + sizeof( T ) * item_capacity;
+        if( item_capacity > ( std::numeric_limits<size_type>::max( ) - header_bytes ) / sizeof( T ) ||
+            bytes > static_cast<size_type>( std::numeric_limits<off_t>::max( ) ) ) {
+            ::close( file_descriptor );
+            throw std::bad_alloc( );
+        }
+
+        // The file might be shorter than the mapping (when it is new, for example).
+        struct stat file_information;
+        if( fstat( file_descriptor, &file_information ) == -1 ||
+            ( static_cast<size_type>( file_information.st_size ) < bytes &&
+              ftruncate( file_descriptor, static_cast<off_t>( bytes ) ) == -1 ) ) {
+            int error = errno;
+            ::close( file_descriptor );
+            throw std::system_error(
+                error, std::generic_category( ), "Can't size the backing file for a FileVector" );
+        }
+
+        void *mapping =
+            mmap( 0, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, file_descriptor, 0 );
+        if( mapping == MAP_FAILED ) {
+            int error = errno;
+            ::close( file_descriptor );
+            throw std::system_error(
+                error, std::generic_category( ), "Can't map the backing file for a FileVector" );
+        }
+        header = static_cast<detail::file_vector_header *>( mapping );
+        raw    = reinterpret_cast<T *>( static_cast<char *>( mapping ) + header_bytes );
+        mapped_bytes   = bytes;
+        reserved_bytes = 0;
+    }
+
+
+    //
+    // The reserved range is created with PROT_NONE so it uses no memory. The file is mapped
+    // over the start of it with MAP_FIXED. To make it possible to extend the file mapping
+    // later, the mapping (and the file) is rounded up to a whole number of pages.
+    //
+    template<POD T>
+    bool FileVector<T>::reserve_address_space( size_type bytes )
+    {
+        size_type page = page_size( );
+        if( reserved_bytes != 0 ) return true;
+        if( bytes > std::numeric_limits<size_type>::max( ) - page ) throw std::bad_alloc( );
+        bytes = ( bytes + page - 1 ) / page * page;
+
+        size_type committed = ( mapped_bytes + page - 1 ) / page * page;
+        if( bytes < committed ) bytes = committed;
+
+        void *region = mmap( 0, bytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0 );
+        if( region == MAP_FAILED )
+            throw std::system_error(
+                errno, std::generic_category( ), "Can't reserve address space for a FileVector" );
+
+        if( ftruncate( file_descriptor, static_cast<off_t>( committed ) ) == -1 ) {
+            int error = errno;
+            munmap( region, bytes );
+            throw std::system_error(
+                error, std::generic_category( ), "Can't enlarge the backing file for a FileVector" );
+        }
+
+        void *mapping = mmap(
+            region, committed, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, file_descriptor, 0 );
+        if( mapping == MAP_FAILED ) {
+            int error = errno;
+            munmap( region, bytes );
+            throw std::system_error(
+                error, std::generic_category( ), "Can't map the backing file for a FileVector" );
+        }
+
+        munmap( header, mapped_bytes );
+        header         = static_cast<detail::file_vector_header *>( mapping );
+        raw            = reinterpret_cast<T *>( static_cast<char *>( mapping ) + header_bytes );
+        mapped_bytes   = committed;
+        reserved_bytes = bytes;
+        item_capacity  = ( committed - header_bytes ) / sizeof( T );
+        return true;
+    }
+
+
+    template<POD T>
+    bool FileVector<T>::stable_addresses( ) const
+    {
+        return reserved_bytes != 0;
+    }
+
+
+    //
+    // The file is enlarged first and then the mapping. With an address space reservation the
+    // new part of the file is mapped just after the existing mapping, replacing part of the
+    // reserved range. Otherwise, where mremap is available (Linux) the kernel can often extend
+    // the mapping without moving it. If something goes wrong the old mapping remains valid and
+    // the vector is unchanged (although the file might be longer).
+    //
+    template<POD T>
+    void FileVector<T>::remap_backing( size_type new_capacity )
+    {
+        size_type new_bytes = header_bytes + sizeof( T ) * new_capacity;
+        if( new_capacity > ( std::numeric_limits<size_type>::max( ) - header_bytes ) / sizeof( T ) ||
+            new_bytes > static_cast<size_type>( std::numeric_limits<off_t>::max( ) ) )
+            throw std::bad_alloc( );
+
+        if( reserved_bytes != 0 ) {
+            size_type page = page_size( );
+            new_bytes = ( new_bytes + page - 1 ) / page * page;
+            if( new_bytes > reserved_bytes ) throw std::bad_alloc( );
+
+            if( ftruncate( file_descriptor, static_cast<off_t>( new_bytes ) ) == -1 )
+                throw std::system_error(
+                    errno, std::generic_category( ), "Can't enlarge the backing file for a FileVector" );
+
+            char *end_of_mapping = reinterpret_cast<char *>( header ) + mapped_bytes;
+            void *mapping = mmap( end_of_mapping, new_bytes - mapped_bytes,
+                PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, file_descriptor,
+                static_cast<off_t>( mapped_bytes ) );
+            if( mapping == MAP_FAILED )
+                throw std::system_error(
+                    errno, std::generic_category( ), "Can't extend the mapping of a FileVector" );
+
+            mapped_bytes = new_bytes;
+            return;
+        }
+
+        if( ftruncate( file_descriptor, static_cast<off_t>( new_bytes ) ) == -1 )
+            throw std::system_error(
+                errno, std::generic_category( ), "Can't enlarge the backing file for a FileVector" );
+
+        #if defined(MREMAP_MAYMOVE)
+        void *mapping = mremap( header, mapped_bytes, new_bytes, MREMAP_MAYMOVE );
+        if( mapping == MAP_FAILED )
+            throw std::system_error(
+                errno, std::generic_category( ), "Can't remap the backing file for a FileVector" );
+        #else
+        void *mapping =
+            mmap( 0, new_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, file_descriptor, 0 );
+        if( mapping == MAP_FAILED )
+            throw std::system_error(
+                errno, std::generic_category( ), "Can't remap the backing file for a FileVector" );
+        munmap( header, mapped_bytes );
+        #endif
+
+        header = static_cast<detail::file_vector_header *>( mapping );
+        raw    = reinterpret_cast<T *>( static_cast<char *>( mapping ) + header_bytes );
+        mapped_bytes = new_bytes;
+    }
+
+
+    //
+    // msync requires a page aligned address so the start of the range is rounded down to a page
+    // boundary.
+    //
+    template<POD T>
+    void FileVector<T>::flush_bytes( size_type offset, size_type length, flush_mode mode )
+    {
+        if( length == 0 ) return;
+        size_type aligned_offset = offset - offset % page_size( );
+        char *base = reinterpret_cast<char *>( header );
+        int flags = ( mode == flush_mode::sync ) ? MS_SYNC : MS_ASYNC;
+        if( msync( base + aligned_offset, offset + length - aligned_offset, flags ) == -1 )
+            throw std::system_error(
+                errno, std::generic_category( ), "Can't flush a FileVector to the disk" );
+    }
+
+
+    template<POD T>
+    void FileVector<T>::close_backing( bool trim )
+    {
+        // Unmapping the reservation also unmaps the file mapping at its start.
+        if( header != 0 )
+            munmap( header, ( reserved_bytes != 0 ) ? reserved_bytes : mapped_bytes );
+
+        // Now truncate the file if necessary. There is nothing useful to do if this fails.
+        if( trim && item_count < item_capacity ) {
+            int result = ftruncate(
+                file_descriptor, static_cast<off_t>( header_bytes + sizeof( T )*item_count ) );
+            (void)result;
+        }
+
+        ::close( file_descriptor );
+    }
+
+
+    //
+    // madvise requires a page aligned address so the start of the range is rounded down to a
+    // page boundary. The range is clipped to the mapping.
+    //
+    template<POD T>
+    void FileVector<T>::advise( size_type first, size_type count, access_pattern pattern )
+    {
+        int advice = MADV_NORMAL;
+        switch( pattern ) {
+        case access_pattern::normal:     advice = MADV_NORMAL;     break;
+        case access_pattern::sequential: advice = MADV_SEQUENTIAL; break;
+        case access_pattern::random:     advice = MADV_RANDOM;     break;
+        case access_pattern::will_need:  advice = MADV_WILLNEED;   break;
+        case access_pattern::dont_need:  advice = MADV_DONTNEED;   break;
+        }
+
+        if( first >= item_capacity || count == 0 ) return;
+        size_type last = ( count > item_capacity - first ) ? item_capacity : first + count;
+        size_type start_byte = header_bytes + sizeof( T ) * first;
+        size_type end_byte   = header_bytes + sizeof( T ) * last;
+
+        size_type aligned_start = start_byte - start_byte % page_size( );
+        char *base = reinterpret_cast<char *>( header );
+        if( madvise( base + aligned_start, end_byte - aligned_start, advice ) == -1 )
+            throw std::system_error(
+                errno, std::generic_category( ), "Can't advise the kernel about a FileVector" );
+    }
+
+
+    //
+    // Punching a hole in the file removes the pages from the mapping too; they read as zero
+    // afterward. Only whole pages can be removed so the partial pages at the ends of the range
+    // are cleared instead. So is everything if the file system can't punch holes.
+    //
+    template<POD T>
+    void FileVector<T>::discard( size_type first, size_type count )
+    {
+        if( first >= item_capacity || count == 0 ) return;
+        if( count > item_capacity - first ) count = item_capacity - first;
+        size_type start_byte = header_bytes + sizeof( T ) * first;
+        size_type end_byte   = header_bytes + sizeof( T ) * ( first + count );
+        char *base = reinterpret_cast<char *>( header );
+
+        #if defined(FALLOC_FL_PUNCH_HOLE)
+        size_type page = page_size( );
+        size_type hole_start = ( start_byte + page - 1 ) / page * page;
+        size_type hole_end   = end_byte / page * page;
+        if( hole_start < hole_end &&
+            fallocate( file_descriptor, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                       static_cast<off_t>( hole_start ),
+                       static_cast<off_t>( hole_end - hole_start ) ) == 0 ) {
+            std::memset( base + start_byte, 0, hole_start - start_byte );
+            std::memset( base + hole_end,   0, end_byte - hole_end );
+            return;
+        }
+        #endif
+        std::memset( base + start_byte, 0, end_byte - start_byte );
+    }
+
+
+    template<POD T>
+    void FileVectorReader<T>::open_file( const char *file_name )
+    {
+        file_descriptor = ::open( file_name, O_RDONLY );
+        if( file_descriptor == -1 )
+            throw std::system_error(
+                errno, std::generic_category( ), "Can't open the file for a FileVectorReader" );
+    }
+
+
+    //
+    // The new mapping is made before the old one is released so that the reader is unchanged if
+    // there is an error.
+    //
+    template<POD T>
+    void FileVectorReader<T>::map_file( )
+    {
+        struct stat file_information;
+        if( fstat( file_descriptor, &file_information ) == -1 )
+            throw std::system_error(
+                errno, std::generic_category( ), "Can't get the size of a FileVector's file" );
+
+        size_type bytes = static_cast<size_type>( file_information.st_size );
+        if( bytes < header_bytes ) throw std::runtime_error( "The file is not a FileVector" );
+
+        void *mapping = mmap( 0, bytes, PROT_READ, MAP_SHARED, file_descriptor, 0 );
+        if( mapping == MAP_FAILED )
+            throw std::system_error(
+                errno, std::generic_category( ), "Can't map the file for a FileVectorReader" );
+
+        if( header != 0 ) munmap( header, mapped_bytes );
+        header        = static_cast<detail::file_vector_header *>( mapping );
+        raw           = reinterpret_cast<const T *>( static_cast<char *>( mapping ) + header_bytes );
+        mapped_bytes  = bytes;
+        item_capacity = ( bytes - header_bytes ) / sizeof( T );
+    }
+
+
+    template<POD T>
+    void FileVectorReader<T>::close_file( )
+    {
+        if( header != 0 ) {
+            munmap( header, mapped_bytes );
+            header = 0;
+        }
+        ::close( file_descriptor );
+    }
+
+    #endif
+
 }
 
 #endif
@@ -7,10 +7,20 @@
 #define GRAPH_HPP
 
 #include <iterator>
+#include <stdexcept>
 #include <vector>
 
 namespace spica {
 
+    //! How a CSRGraph stores the weights of its edges.
+    enum class csr_layout {
+        interleaved,  //!< Each edge's weight is stored next to its destination vertex.
+        separate,     //!< Weights are in their own array, so traversals don't load them.
+        unweighted    //!< Weights are not stored at all.
+    };
+
+    template<typename Weight, csr_layout Layout> class CSRGraph;
+
     //! Weighted, directed graphs.
     /*!
      * This template contains an adjacency list representation of a weighted, directed graph.
@@ -23,9 +33,16 @@ namespace spica {
      * assumed to correspond to actual vertices in the graph; the vertex numbering can't have
      * any "holes." Both vertices and edges are counted with an unsigned integral type named
      * 'count_t.'
+     *
+     * Each vertex's edges are kept in a separate vector, which makes the graph easy to build
+     * but scatters it around memory. When the graph is complete, freeze( ) produces a CSRGraph
+     * that packs all the edges into a few flat arrays for fast traversal.
      */
     template<typename Weight>
     class Graph {
+
+        template<typename W, csr_layout L> friend class CSRGraph;
+
     public:
         typedef unsigned int count_t;
         static const count_t nil = static_cast< count_t >( -1 );
@@ -43,6 +60,7 @@ namespace spica {
 
     private:
         std::vector<std::vector<EdgeInfo>> adjacency;
+        count_t edge_count = 0;
 
     public:
 
@@ -84,8 +102,9 @@ namespace spica {
         //! Return the number of vertices in the graph.
         count_t num_vertices( ) const;
 
-        //! Return the number of directed edges in the graph.
-        count_t num_edges( ) const;
+        //! Return the number of directed edges in the graph. O(1)
+        count_t num_edges( ) const
+            { return edge_count; }
 
         //! Creates a new vertex.
         /*!
@@ -105,6 +124,8 @@ namespace spica {
          * \param v2 The destination vertex for the edge.
          * \param w  The weight on the edge.
          *
+         * \exception std::length_error if the graph already has as many edges as count_t can
+         * count. The graph is not changed.
          * \exception std::bad_alloc if memory exhausted.
          */
         void create_edge( count_t v1, count_t v2, Weight w );
@@ -130,6 +151,17 @@ namespace spica {
          * \return An edge_iterator that points just past the last edge leaving vertex v_number.
          */
         edge_iterator eend( count_t v_number );
+
+        //! Returns a compressed sparse row copy of the graph. O(V + E)
+        /*!
+         * The copy is independent of this graph; later changes to this graph don't affect it.
+         * Each vertex's edges appear in the copy in the order they are visited by ebegin( ).
+         *
+         * \exception std::bad_alloc if memory exhausted.
+         */
+        template<csr_layout Layout = csr_layout::separate>
+        CSRGraph<Weight, Layout> freeze( ) const
+            { return CSRGraph<Weight, Layout>( *this ); }
     };
 
 
@@ -141,17 +173,6 @@ namespace spica {
     }
 
 
-    template<typename Weight>
-    typename Graph<Weight>::count_t Graph<Weight>::num_edges( ) const
-    {
-        count_t total = 0;
-        for( count_t i = 0; i < adjacency.size( ); ++i ) {
-            total += adjacency[i].size( );
-        }
-        return( total );
-    }
-
-
     template<typename Weight>
     void Graph<Weight>::create_vertex( count_t v_number )
     {
@@ -163,10 +184,13 @@ namespace spica {
     template<typename Weight>
     void Graph<Weight>::create_edge( count_t v1, count_t v2, Weight w )
     {
+        if( edge_count == nil )
+            throw std::length_error( "Graph: too many edges" );
         create_vertex( v1 );
         create_vertex( v2 );
         EdgeInfo new_edge = { v2, w };
         adjacency[v1].push_back( new_edge );
+        ++edge_count;
     }
 
 
@@ -184,6 +208,111 @@ namespace spica {
     {
         return( edge_iterator( adjacency[v_number].end( ) ) );
     }
+
+
+    //! Immutable graph in compressed sparse row form.
+    /*!
+     * A CSRGraph is made from a Graph with Graph::freeze( ). The destination vertices of all
+     * the edges are stored in one array, ordered by source vertex, and a second array holds
+     * the index of each vertex's first edge. A traversal reads both arrays almost
+     * sequentially instead of following a pointer to a separate block for every vertex.
+     *
+     * The Layout parameter controls where the weights go. With csr_layout::separate (the
+     * default) they are in a third array that is only read when weight( ) is called, so
+     * traversals that ignore weights, such as a breadth first search, load half as much
+     * memory (or less). With csr_layout::interleaved each weight is next to its destination,
+     * which suits algorithms that use every weight they see. With csr_layout::unweighted there
+     * are no weights.
+     *
+     * Edges are numbered from 0 to num_edges( ) - 1. The edges leaving vertex v are those
+     * numbered from edge_begin( v ) up to, but not including, edge_end( v ).
+     */
+    template<typename Weight, csr_layout Layout = csr_layout::separate>
+    class CSRGraph {
+    public:
+        typedef typename Graph<Weight>::count_t  count_t;
+        typedef typename Graph<Weight>::EdgeInfo EdgeInfo;
+
+        //! Copies the given graph.
+        /*!
+         * \exception std::length_error if the graph has too many vertices to number with count_t.
+         * \exception std::bad_alloc if memory exhausted.
+         */
+        explicit CSRGraph( const Graph<Weight> &graph );
+
+        //! Return the number of vertices in the graph.
+        count_t num_vertices( ) const
+            { return static_cast<count_t>( offsets.size( ) - 1 ); }
+
+        //! Return the number of directed edges in the graph.
+        count_t num_edges( ) const
+            { return offsets.back( ); }
+
+        //! Return the number of edges leaving vertex v.
+        count_t degree( count_t v ) const
+            { return offsets[v + 1] - offsets[v]; }
+
+        //! Return the number of the first edge leaving vertex v.
+        count_t edge_begin( count_t v ) const
+            { return offsets[v]; }
+
+        //! Return one more than the number of the last edge leaving vertex v.
+        count_t edge_end( count_t v ) const
+            { return offsets[v + 1]; }
+
+        //! Return the destination vertex of edge e.
+        count_t target( count_t e ) const
+        {
+            if constexpr( Layout == csr_layout::interleaved ) return edges[e].remote_vertex;
+            else return targets[e];
+        }
+
+        //! Return the weight of edge e.
+        const Weight &weight( count_t e ) const requires( Layout != csr_layout::unweighted )
+        {
+            if constexpr( Layout == csr_layout::interleaved ) return edges[e].edge_weight;
+            else return weights[e];
+        }
+
+    private:
+        std::vector<count_t>  offsets;  // Index of each vertex's first edge, then num_edges( ).
+        std::vector<count_t>  targets;  // Destination of each edge (separate and unweighted).
+        std::vector<Weight>   weights;  // Weight of each edge (separate).
+        std::vector<EdgeInfo> edges;    // Destination and weight of each edge (interleaved).
+    };
+
+
+    template<typename Weight, csr_layout Layout>
+    CSRGraph<Weight, Layout>::CSRGraph( const Graph<Weight> &graph )
+    {
+        // Graph::create_edge keeps the edge count representable. The number of vertices plus
+        // one must also fit in a count_t.
+        if( graph.adjacency.size( ) > Graph<Weight>::nil - 1 )
+            throw std::length_error( "CSRGraph: too many vertices" );
+
+        offsets.reserve( graph.adjacency.size( ) + 1 );
+        if constexpr( Layout == csr_layout::interleaved ) {
+            edges.reserve( graph.edge_count );
+        }
+        else {
+            targets.reserve( graph.edge_count );
+            if constexpr( Layout == csr_layout::separate ) weights.reserve( graph.edge_count );
+        }
+
+        for( const std::vector<EdgeInfo> &vertex_edges : graph.adjacency ) {
+            offsets.push_back( static_cast<count_t>( Layout == csr_layout::interleaved ? edges.size( ) : targets.size( ) ) );
+            for( const EdgeInfo &edge : vertex_edges ) {
+                if constexpr( Layout == csr_layout::interleaved ) {
+                    edges.push_back( edge );
+                }
+                else {
+                    targets.push_back( edge.remote_vertex );
+                    if constexpr( Layout == csr_layout::separate ) weights.push_back( edge.edge_weight );
+                }
+            }
+        }
+        offsets.push_back( graph.edge_count );
+    }
 }
 
 #endif
@@ -0,0 +1,830 @@
+/*! \file    HashMapFlat.hpp
+    \brief   A flat (open addressing) hash map that probes groups of control bytes.
+    \author  Peter Chapin <spicacality@kelseymountain.org>
+
+    HashMapFlat stores its key/value pairs directly in an array of slots. A parallel array of
+    control bytes records the state of each slot: empty, deleted, or full. A full slot's control
+    byte holds seven bits of the key's hash. A lookup loads sixteen control bytes at once,
+    compares all of them against the hash fragment with a few SSE2 instructions, and only
+    compares keys in the slots that match. Because each group of sixteen bytes that contains an
+    empty slot ends a probe sequence, most unsuccessful lookups examine only one group.
+
+    The number of slots is a power of two and the table grows when it would become more than
+    7/8 full. Erased slots are marked deleted (unless nothing could have probed past them, in
+    which case they are simply emptied). Deleted slots are reused by later insertions and are
+    removed when the table is rehashed.
+
+    The hash and equality function objects should be stateless so that they inline; they are
+    not stored when they are empty classes. If both of them declare a member type
+    is_transparent, lookups can use any type the functions accept (for example a
+    std::string_view for a map with std::string keys) without constructing a key. The functor
+    string_hash defined below is such a hash function for strings; use it with std::equal_to<>.
+
+    Inserting may rehash, which invalidates all iterators and references. Erasing never moves
+    other elements.
+*/
+
+#ifndef HASHMAPFLAT_HPP
+#define HASHMAPFLAT_HPP
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 2 )
+#define pHASHMAPFLAT_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace spica {
+
+    //! Transparent hash function for strings.
+    /*!
+     * Accepts std::string, std::string_view, and C strings so a HashMapFlat with std::string
+     * keys can be searched without constructing a std::string.
+     */
+    struct string_hash {
+        typedef void is_transparent;
+
+        std::size_t operator()( std::string_view text ) const noexcept
+            { return std::hash< std::string_view >( )( text ); }
+    };
+
+    namespace detail {
+
+        // Control byte values. Full slots hold a value from 0 to 127.
+        const signed char ctrl_empty   = -128;  // 0x80
+        const signed char ctrl_deleted = -2;    // 0xFE
+
+        const std::size_t group_width = 16;
+
+        // A set of positions within a group, one bit per position.
+        typedef std::uint32_t group_mask;
+
+        // Sixteen control bytes loaded from an arbitrary position.
+        class control_group {
+        public:
+            explicit control_group( const signed char *position )
+            {
+                #if defined(pHASHMAPFLAT_SSE2)
+                bytes = _mm_loadu_si128( reinterpret_cast< const __m128i * >( position ) );
+                #else
+                std::memcpy( bytes, position, group_width );
+                #endif
+            }
+
+            // Positions holding the given hash fragment.
+            group_mask match( signed char fragment ) const
+            {
+                #if defined(pHASHMAPFLAT_SSE2)
+                return static_cast< group_mask >(
+                    _mm_movemask_epi8( _mm_cmpeq_epi8( _mm_set1_epi8( fragment ), bytes ) ) );
+                #else
+                group_mask result = 0;
+                for( std::size_t i = 0; i < group_width; ++i )
+                    if( bytes[i] == fragment ) result |= 1U << i;
+                return result;
+                #endif
+            }
+
+            // Positions that are empty.
+            group_mask match_empty( ) const
+            {
+                return match( ctrl_empty );
+            }
+
+            // Positions that are empty or deleted (that is, the control byte is negative).
+            group_mask match_available( ) const
+            {
+                #if defined(pHASHMAPFLAT_SSE2)
+                return static_cast< group_mask >( _mm_movemask_epi8( bytes ) );
+                #else
+                group_mask result = 0;
+                for( std::size_t i = 0; i < group_width; ++i )
+                    if( bytes[i] < 0 ) result |= 1U << i;
+                return result;
+                #endif
+            }
+
+        private:
+            #if defined(pHASHMAPFLAT_SSE2)
+            __m128i bytes;
+            #else
+            signed char bytes[group_width];
+            #endif
+        };
+
+        // Scrambles a hash value so that its low and high bits both depend on all of its bits.
+        // Hash functions such as std::hash< int > are often the identity.
+        inline std::uint64_t mix_hash( std::uint64_t hash )
+        {
+            hash ^= hash >> 33;
+            hash *= 0xFF51AFD7ED558CCDULL;
+            hash ^= hash >> 33;
+            return hash;
+        }
+
+        template< typename Hash, typename Eq >
+        concept transparent_functions = requires {
+            typename Hash::is_transparent;
+            typename Eq::is_transparent;
+        };
+
+    }
+
+
+    //! Open addressing hash map.
+    template< typename K,
+              typename V,
+              typename Hash = std::hash< K >,
+              typename Eq   = std::equal_to< K > >
+    class HashMapFlat {
+    public:
+        typedef K                          key_type;
+        typedef V                          mapped_type;
+        typedef std::pair< const K, V >    value_type;
+        typedef std::size_t                size_type;
+        typedef std::ptrdiff_t             difference_type;
+        typedef Hash                       hasher;
+        typedef Eq                         key_equal;
+        typedef value_type                &reference;
+        typedef const value_type          &const_reference;
+
+        template< bool is_const >
+        class basic_iterator {
+            friend class HashMapFlat;
+        public:
+            typedef std::forward_iterator_tag iterator_category;
+            typedef HashMapFlat::value_type   value_type;
+            typedef std::ptrdiff_t            difference_type;
+            typedef std::conditional_t< is_const, const value_type *, value_type * > pointer;
+            typedef std::conditional_t< is_const, const value_type &, value_type & > reference;
+
+            basic_iterator( ) : ctrl( nullptr ), slot( nullptr ), end_ctrl( nullptr ) { }
+
+            // Allows iterator to convert to const_iterator.
+            template< bool other_const >
+                requires( is_const && !other_const )
+            basic_iterator( const basic_iterator< other_const > &other )
+                : ctrl( other.ctrl ), slot( other.slot ), end_ctrl( other.end_ctrl ) { }
+
+            reference operator*( )  const { return *slot; }
+            pointer   operator->( ) const { return slot; }
+
+            basic_iterator &operator++( )
+            {
+                ++ctrl;
+                ++slot;
+                skip_available( );
+                return *this;
+            }
+
+            basic_iterator operator++( int )
+            {
+                basic_iterator old( *this );
+                ++*this;
+                return old;
+            }
+
+            bool operator==( const basic_iterator &other ) const { return ctrl == other.ctrl; }
+            bool operator!=( const basic_iterator &other ) const { return ctrl != other.ctrl; }
+
+        private:
+            template< bool > friend class basic_iterator;
+
+            const signed char *ctrl;      // The control byte of the current slot.
+            value_type        *slot;      // The current slot.
+            const signed char *end_ctrl;  // The control byte just past the last slot.
+
+            basic_iterator( const signed char *c, value_type *s, const signed char *e )
+                : ctrl( c ), slot( s ), end_ctrl( e ) { }
+
+            void skip_available( )
+            {
+                while( ctrl != end_ctrl && *ctrl < 0 ) {
+                    ++ctrl;
+                    ++slot;
+                }
+            }
+        };
+
+        typedef basic_iterator< false > iterator;
+        typedef basic_iterator< true  > const_iterator;
+
+        //! Creates an empty map. No memory is allocated until the first insertion.
+        HashMapFlat( );
+
+        //! Creates an empty map with room for the given number of elements.
+        explicit HashMapFlat( size_type expected_size );
+
+        HashMapFlat( const HashMapFlat &other );
+        HashMapFlat( HashMapFlat &&other ) noexcept;
+       ~HashMapFlat( );
+
+        //! Copy and move assignment (the argument is copied or moved as appropriate).
+        HashMapFlat &operator=( HashMapFlat other ) noexcept;
+
+        void swap( HashMapFlat &other ) noexcept;
+
+        size_type size( )         const { return item_count; }
+        bool      empty( )        const { return item_count == 0; }
+        size_type bucket_count( ) const { return capacity; }
+        float     load_factor( )  const
+            { return capacity ? static_cast< float >( item_count ) / capacity : 0.0f; }
+
+        iterator       begin( );
+        const_iterator begin( ) const;
+        iterator       end( );
+        const_iterator end( ) const;
+
+        //! Finds the element with the given key. Returns end( ) if there is none.
+        iterator       find( const K &key )       { return make_iterator( locate( key ) ); }
+        const_iterator find( const K &key ) const { return make_iterator( locate( key ) ); }
+
+        //! Finds an element using any key type accepted by transparent Hash and Eq functions.
+        template< typename Q >
+            requires detail::transparent_functions< Hash, Eq >
+        iterator find( const Q &key ) { return make_iterator( locate( key ) ); }
+
+        template< typename Q >
+            requires detail::transparent_functions< Hash, Eq >
+        const_iterator find( const Q &key ) const { return make_iterator( locate( key ) ); }
+
+        bool contains( const K &key ) const { return locate( key ) != capacity; }
+
+        template< typename Q >
+            requires detail::transparent_functions< Hash, Eq >
+        bool contains( const Q &key ) const { return locate( key ) != capacity; }
+
+        size_type count( const K &key ) const { return contains( key ) ? 1 : 0; }
+
+        //! Returns the value with the given key. Throws std::out_of_range if there is none.
+        V       &at( const K &key );
+        const V &at( const K &key ) const;
+
+        //! Returns the value with the given key, inserting a default value if necessary.
+        V &operator[]( const K &key ) { return try_emplace( key ).first->second; }
+        V &operator[]( K &&key )      { return try_emplace( std::move( key ) ).first->second; }
+
+        //! Inserts a copy of the pair if its key is not already present.
+        std::pair< iterator, bool > insert( const value_type &item )
+            { return try_emplace( item.first, item.second ); }
+
+        std::pair< iterator, bool > insert( value_type &&item )
+            { return try_emplace( item.first, std::move( item.second ) ); }
+
+        //! Constructs the value from args in place if the key is not already present.
+        /*!
+         * If the key is present, nothing is constructed and the arguments are not used. The
+         * key is copied (or moved) into the table only if it is inserted.
+         */
+        template< typename... Args >
+        std::pair< iterator, bool > try_emplace( const K &key, Args &&... args );
+
+        template< typename... Args >
+        std::pair< iterator, bool > try_emplace( K &&key, Args &&... args );
+
+        //! Constructs a value_type from the arguments and inserts it if its key is not present.
+        /*!
+         * When given exactly a key and a value, this behaves like try_emplace. Otherwise the
+         * pair is constructed first in order to find its key.
+         */
+        template< typename... Args >
+        std::pair< iterator, bool > emplace( Args &&... args );
+
+        //! Assigns to the value if the key is present, otherwise inserts it.
+        template< typename M >
+        std::pair< iterator, bool > insert_or_assign( const K &key, M &&value );
+
+        //! Removes the element with the given key. Returns the number of elements removed.
+        size_type erase( const K &key );
+
+        template< typename Q >
+            requires detail::transparent_functions< Hash, Eq >
+        size_type erase( const Q &key );
+
+        //! Removes the element at the given position. Returns an iterator to the next element.
+        iterator erase( const_iterator position );
+
+        //! Removes all elements. The capacity is unchanged.
+        void clear( );
+
+        //! Makes room for the given number of elements without rehashing.
+        void reserve( size_type count );
+
+        //! Changes the number of slots to at least count (rounded up to a power of two).
+        void rehash( size_type count );
+
+    private:
+        signed char *ctrl;          // capacity + group_width control bytes (see below).
+        value_type  *slots;         // capacity slots.
+        size_type    capacity;      // A power of two, at least group_width, or zero.
+        size_type    item_count;    // Number of full slots.
+        size_type    growth_left;   // Number of empty slots that can be filled before growing.
+
+        [[no_unique_address]] Hash hash_function;
+        [[no_unique_address]] Eq   equal_function;
+
+        // The last group_width control bytes repeat the first group_width so a group can be
+        // loaded starting at any slot without wrapping around.
+
+        // Maximum number of full plus deleted slots for a given capacity (7/8 of it).
+        static size_type max_load( size_type slot_count )
+            { return slot_count - slot_count / 8; }
+
+        template< typename Q >
+        std::uint64_t hash_of( const Q &key ) const
+            { return detail::mix_hash( static_cast< std::uint64_t >( hash_function( key ) ) ); }
+
+        static signed char fragment( std::uint64_t hash )
+            { return static_cast< signed char >( hash & 0x7F ); }
+
+        void set_ctrl( size_type index, signed char value )
+        {
+            ctrl[index] = value;
+            if( index < detail::group_width ) ctrl[capacity + index] = value;
+        }
+
+        iterator make_iterator( size_type index )
+            { return iterator( ctrl + index, slots + index, ctrl + capacity ); }
+
+        const_iterator make_iterator( size_type index ) const
+            { return const_iterator( ctrl + index, slots + index, ctrl + capacity ); }
+
+        // Returns the index of the slot with the key, or capacity if it isn't present.
+        template< typename Q >
+        size_type locate( const Q &key ) const;
+
+        // Returns the index of the first empty or deleted slot in the probe sequence for hash.
+        size_type find_available( std::uint64_t hash ) const;
+
+        // Returns the slot to use for a new element with this hash, growing if necessary.
+        size_type prepare_insert( std::uint64_t hash );
+
+        // Finds the key or inserts a value constructed from args.
+        template< typename KeyArg, typename... Args >
+        std::pair< iterator, bool > find_or_emplace( KeyArg &&key, Args &&... args );
+
+        // Marks a slot as no longer used and destroys its element.
+        void erase_slot( size_type index );
+
+        // Allocates new arrays with the given capacity and moves the elements into them.
+        void resize( size_type new_capacity );
+
+        // Destroys the elements and releases the arrays.
+        void release( );
+    };
+
+
+    //
+    // Constructors and the destructor.
+    //
+    template< typename K, typename V, typename Hash, typename Eq >
+    HashMapFlat< K, V, Hash, Eq >::HashMapFlat( )
+        : ctrl( nullptr ), slots( nullptr ), capacity( 0 ), item_count( 0 ), growth_left( 0 )
+    { }
+
+
+    template< typename K, typename V, typename Hash, typename Eq >
+    HashMapFlat< K, V, Hash, Eq >::HashMapFlat( size_type expected_size )
+        : HashMapFlat( )
+    {
+        reserve( expected_size );
+    }
+
+
+    template< typename K, typename V, typename Hash, typename Eq >
+    HashMapFlat< K, V, Hash, Eq >::HashMapFlat( const HashMapFlat &other )
+        : HashMapFlat( other.item_count )
+    {
+        for( const value_type &item : other ) {
+            find_or_emplace( item.first, item.second );
+        }
+    }
+
+
+    template< typename K, typename V, typename Hash, typename Eq >
+    HashMapFlat< K, V, Hash, Eq >::HashMapFlat( HashMapFlat &&other ) noexcept
+        : HashMapFlat( )
+    {
+        swap( other );
+    }
+
+
+    template< typename K, typename V, typename Hash, typename Eq >
+    HashMapFlat< K, V, Hash, Eq >::~HashMapFlat( )
+    {
+        release( );
+    }
+
+
+    template< typename K, typename V, typename Hash, typename Eq >
+    HashMapFlat< K, V, Hash, Eq > &
+        HashMapFlat< K, V, Hash, Eq >::operator=( HashMapFlat other ) noexcept
+    {
+        swap( other );
+        return *this;
+    }
+
+
+    template< typename K, typename V, typename Hash, typename Eq >
+    void HashMapFlat< K, V, Hash, Eq >::swap( HashMapFlat &other ) noexcept
+    {
+        using std::swap;
+        swap( ctrl,        other.ctrl        );
+        swap( slots,       other.slots       );
+        swap( capacity,    other.capacity    );
+        swap( item_count,  other.item_count  );
+        swap( growth_left, other.growth_left );
+    }
+
+
+    //
+    // Iteration.
+    //
+    template< typename K, typename V, typename Hash, typename Eq >
+    typename HashMapFlat< K, V, Hash, Eq >::iterator HashMapFlat< K, V, Hash, Eq >::begin( )
+    {
+        iterator result = make_iterator( 0 );
+        result.skip_available( );
+        return result;
+    }
+
+
+    template< typename K, typename V, typename Hash, typename Eq >
+    typename HashMapFlat< K, V, Hash, Eq >::const_iterator
+        HashMapFlat< K, V, Hash, Eq >::begin( ) const
+    {
+        const_iterator result = make_iterator( 0 );
+        result.skip_available( );
+        return result;
+    }
+
+
+    template< typename K, typename V, typename Hash, typename Eq >
+    typename HashMapFlat< K, V, Hash, Eq >::iterator HashMapFlat< K, V, Hash, Eq >::end( )
+    {
+        return make_iterator( capacity );
+    }
+
+
+    template< typename K, typename V, typename Hash, typename Eq >
+    typename HashMapFlat< K, V, Hash, Eq >::const_iterator
+        HashMapFlat< K, V, Hash, Eq >::end( ) const
+    {
+        return make_iterator( capacity );
+    }
+
+
+    //
+    // HashMapFlat<K, V, Hash, Eq>::locate
+    //
+    // Groups are probed with triangular steps (group_width, 2*group_width, ...), which visits
+    // every group when the capacity is a power of two. A group with an empty slot ends the
+    // search since an insertion would have used that slot.
+    //
+    template< typename K, typename V, typename Hash, typename Eq >
+    template< typename Q >
+    typename HashMapFlat< K, V, Hash, Eq >::size_type
+        HashMapFlat< K, V, Hash, Eq >::locate( const Q &key ) const
+    {
+        if( capacity == 0 ) return 0;
+
+        std::uint64_t hash      = hash_of( key );
+        signed char   h2        = fragment( hash );
+        size_type     mask      = capacity - 1;
+        size_type     position  = static_cast< size_type >( hash >> 7 ) & mask;
+        size_type     step      = 0;
+
+        for( ;; ) {
+            detail::control_group group( ctrl + position );
+            for( detail::group_mask matches = group.match( h2 ); matches != 0; matches &= matches - 1 ) {
+                size_type index = ( position + std::countr_zero( matches ) ) & mask;
+                if( equal_function( slots[index].first, key ) ) return index;
+            }
+            if( group.match_empty( ) != 0 ) return capacity;
+            step    += detail::group_width;
+            position = ( position + step ) & mask;
+        }
+    }
+
+
+    //
+    // HashMapFlat<K, V, Hash, Eq>::find_available
+    //
+    template< typename K, typename V, typename Hash, typename Eq >
+    typename HashMapFlat< K, V, Hash, Eq >::size_type
+        HashMapFlat< K, V, Hash, Eq >::find_available( std::uint64_t hash ) const
+    {
+        size_type mask     = capacity - 1;
+        size_type position = static_cast< size_type >( hash >> 7 ) & mask;
+        size_type step     = 0;
+
+        for( ;; ) {
+            detail::control_group group( ctrl + position );
+            detail::group_mask available = group.match_available( );
+            if( available != 0 ) return ( position + std::countr_zero( available ) ) & mask;
+            step    += detail::group_width;
+            position = ( position + step ) & mask;
+        }
+    }
+
+
+    //
+    // HashMapFlat<K, V, Hash, Eq>::prepare_insert
+    //
+    // Reusing a deleted slot doesn't reduce growth_left. When growth_left runs out the table is
+    // rehashed. If many of the used slots are deleted, rehashing at the same size is enough.
+    //
+    template< typename K, typename V, typename Hash, typename Eq >
+    typename HashMapFlat< K, V, Hash, Eq >::size_type
+        HashMapFlat< K, V, Hash, Eq >::prepare_insert( std::uint64_t hash )
+    {
+        size_type index = ( capacity == 0 ) ? 0 : find_available( hash );
+        if( capacity == 0 || ( growth_left == 0 && ctrl[index] == detail::ctrl_empty ) ) {
+            if( capacity != 0 && item_count < max_load( capacity ) / 2 ) {
+                resize( capacity );
+            }
+            else {
+                resize( capacity == 0 ? detail::group_width : capacity * 2 );
+            }
+            index = find_available( hash );
+        }
+        if( ctrl[index] == detail::ctrl_empty ) --growth_left;
+        set_ctrl( index, fragment( hash ) );
+        ++item_count;
+        return index;
+    }
+
+
+    //
+    // HashMapFlat<K, V, Hash, Eq>::find_or_emplace
+    //
+    // The element is constructed in its slot. If construction throws the slot is released.
+    //
+    template< typename K, typename V, typename Hash, typename Eq >
+    template< typename KeyArg, typename... Args >
+    std::pair< typename HashMapFlat< K, V, Hash, Eq >::iterator, bool >
+        HashMapFlat< K, V, Hash, Eq >::find_or_emplace( KeyArg &&key, Args &&... args )
+    {
+        size_type index = locate( key );
+        if( index != capacity ) return std::make_pair( make_iterator( index ), false );
+
+        index = prepare_insert( hash_of( key ) );
+        try {
+            new ( slots + index ) value_type(
+                std::piecewise_construct,
+                std::forward_as_tuple( std::forward< KeyArg >( key ) ),
+                std::forward_as_tuple( std::forward< Args >( args )... ) );
+        }
+        catch( ... ) {
+            set_ctrl( index, detail::ctrl_deleted );
+            --item_count;
+            throw;
+        }
+        return std::make_pair( make_iterator( index ), true );
+    }
+
+
+    template< typename K, typename V, typename Hash, typename Eq >
+    template< typename... Args >
+    std::pair< typename HashMapFlat< K, V, Hash, Eq >::iterator, bool >
+        HashMapFlat< K, V, Hash, Eq >::try_emplace( const K &key, Args &&... args )
+    {
+        return find_or_emplace( key, std::forward< Args >( args )... );
+    }
+
+
+    template< typename K, typename V, typename Hash, typename Eq >
+    template< typename... Args >
+    std::pair< typename HashMapFlat< K, V, Hash, Eq >::iterator, bool >
+        HashMapFlat< K, V, Hash, Eq >::try_emplace( K &&key, Args &&... args )
+    {
+        return find_or_emplace( std::move( key ), std::forward< Args >( args )... );
+    }
+
+
+    template< typename K, typename V, typename Hash, typename Eq >
+    template< typename... Args >
+    std::pair< typename HashMapFlat< K, V, Hash, Eq >::iterator, bool >
+        HashMapFlat< K, V, Hash, Eq >::emplace( Args &&... args )
+    {
+        if constexpr( sizeof...( Args ) == 2 ) {
+            return find_or_emplace( std::forward< Args >( args )... );
+        }
+        else {
+            value_type item( std::forward< Args >( args )... );
+            return find_or_emplace( item.first, std::move( item.second ) );
+        }
+    }
+
+
+    template< typename K, typename V, typename Hash, typename Eq >
+    template< typename M >
+    std::pair< typename HashMapFlat< K, V, Hash, Eq >::iterator, bool >
+        HashMapFlat< K, V, Hash, Eq >::insert_or_assign( const K &key, M &&value )
+    {
+        std::pair< iterator, bool > result = find_or_emplace( key, std::forward< M >( value ) );
+        if( !result.second ) result.first->second = std::forward< M >( value );
+        return result;
+    }
+
+
+    template< typename K, typename V, typename Hash, typename Eq >
+    V &HashMapFlat< K, V, Hash, Eq >::at( const K &key )
+    {
+        size_type index = locate( key );
+        if( index == capacity ) throw std::out_of_range( "HashMapFlat: key not found" );
+        return slots[index].second;
+    }
+
+
+    template< typename K, typename V, typename Hash, typename Eq >
+    const V &HashMapFlat< K, V, Hash, Eq >::at( const K &key ) const
+    {
+        size_type index = locate( key );
+        if( index == capacity ) throw std::out_of_range( "HashMapFlat: key not found" );
+        return slots[index].second;
+    }
+
+
+    //
+    // HashMapFlat<K, V, Hash, Eq>::erase_slot
+    //
+    // The slot can be made empty (instead of deleted) if no probe sequence could have passed
+    // over it. That is the case when there is no run of group_width full or deleted slots
+    // containing it, because a probe sequence only moves to another group when the one it is
+    // looking at has no empty slots.
+    //
+    template< typename K, typename V, typename Hash, typename Eq >
+    void HashMapFlat< K, V, Hash, Eq >::erase_slot( size_type index )
+    {
+        slots[index].~value_type( );
+        --item_count;
+
+        size_type mask = capacity - 1;
+        size_type before_index = ( index - detail::group_width ) & mask;
+        detail::group_mask empty_after  = detail::control_group( ctrl + index ).match_empty( );
+        detail::group_mask empty_before = detail::control_group( ctrl + before_index ).match_empty( );
+
+        bool never_full = empty_before != 0 && empty_after != 0 &&
+            static_cast< size_type >(
+                std::countr_zero( empty_after ) +
+                std::countl_zero( static_cast< std::uint16_t >( empty_before ) ) ) < detail::group_width;
+
+        if( never_full ) {
+            set_ctrl( index, detail::ctrl_empty );
+            ++growth_left;
+        }
+        else {
+            set_ctrl( index, detail::ctrl_deleted );
+        }
+    }
+
+
+    template< typename K, typename V, typename Hash, typename Eq >
+    typename HashMapFlat< K, V, Hash, Eq >::size_type
+        HashMapFlat< K, V, Hash, Eq >::erase( const K &key )
+    {
+        size_type index = locate( key );
+        if( index == capacity ) return 0;
+        erase_slot( index );
+        return 1;
+    }
+
+
+    template< typename K, typename V, typename Hash, typename Eq >
+    template< typename Q >
+        requires detail::transparent_functions< Hash, Eq >
+    typename HashMapFlat< K, V, Hash, Eq >::size_type
+        HashMapFlat< K, V, Hash, Eq >::erase( const Q &key )
+    {
+        size_type index = locate( key );
+        if( index == capacity ) return 0;
+        erase_slot( index );
+        return 1;
+    }
+
+
+    template< typename K, typename V, typename Hash, typename Eq >
+    typename HashMapFlat< K, V, Hash, Eq >::iterator
+        HashMapFlat< K, V, Hash, Eq >::erase( const_iterator position )
+    {
+        size_type index = static_cast< size_type >( position.ctrl - ctrl );
+        erase_slot( index );
+        iterator result = make_iterator( index );
+        ++result;
+        return result;
+    }
+
+
+    template< typename K, typename V, typename Hash, typename Eq >
+    void HashMapFlat< K, V, Hash, Eq >::clear( )
+    {
+        for( size_type i = 0; i < capacity; ++i ) {
+            if( ctrl[i] >= 0 ) slots[i].~value_type( );
+        }
+        if( capacity != 0 ) std::memset( ctrl, detail::ctrl_empty, capacity + detail::group_width );
+        item_count  = 0;
+        growth_left = max_load( capacity );
+    }
+
+
+    template< typename K, typename V, typename Hash, typename Eq >
+    void HashMapFlat< K, V, Hash, Eq >::reserve( size_type count )
+    {
+        if( count <= item_count + growth_left ) return;
+        rehash( count + count / 7 + 1 );
+    }
+
+
+    template< typename K, typename V, typename Hash, typename Eq >
+    void HashMapFlat< K, V, Hash, Eq >::rehash( size_type count )
+    {
+        size_type new_capacity = detail::group_width;
+        while( new_capacity < count || max_load( new_capacity ) < item_count ) {
+            new_capacity *= 2;
+            if( new_capacity == 0 ) throw std::length_error( "HashMapFlat: too many slots requested" );
+        }
+        resize( new_capacity );
+    }
+
+
+    //
+    // HashMapFlat<K, V, Hash, Eq>::resize
+    //
+    // The elements are moved (their keys are copied since they are const). The new arrays are
+    // complete before the old ones are released.
+    //
+    template< typename K, typename V, typename Hash, typename Eq >
+    void HashMapFlat< K, V, Hash, Eq >::resize( size_type new_capacity )
+    {
+        std::allocator< value_type > allocator;
+
+        signed char *new_ctrl  = new signed char[new_capacity + detail::group_width];
+        value_type  *new_slots;
+        try {
+            new_slots = allocator.allocate( new_capacity );
+        }
+        catch( ... ) {
+            delete [] new_ctrl;
+            throw;
+        }
+        std::memset( new_ctrl, detail::ctrl_empty, new_capacity + detail::group_width );
+
+        signed char *old_ctrl     = ctrl;
+        value_type  *old_slots    = slots;
+        size_type    old_capacity = capacity;
+
+        ctrl        = new_ctrl;
+        slots       = new_slots;
+        capacity    = new_capacity;
+        growth_left = max_load( new_capacity ) - item_count;
+
+        for( size_type i = 0; i < old_capacity; ++i ) {
+            if( old_ctrl[i] >= 0 ) {
+                std::uint64_t hash = hash_of( old_slots[i].first );
+                size_type index = find_available( hash );
+                set_ctrl( index, fragment( hash ) );
+                new ( slots + index ) value_type( std::move( old_slots[i] ) );
+                old_slots[i].~value_type( );
+            }
+        }
+
+        if( old_capacity != 0 ) {
+            delete [] old_ctrl;
+            allocator.deallocate( old_slots, old_capacity );
+        }
+    }
+
+
+    template< typename K, typename V, typename Hash, typename Eq >
+    void HashMapFlat< K, V, Hash, Eq >::release( )
+    {
+        if( capacity == 0 ) return;
+        for( size_type i = 0; i < capacity; ++i ) {
+            if( ctrl[i] >= 0 ) slots[i].~value_type( );
+        }
+        delete [] ctrl;
+        std::allocator< value_type >( ).deallocate( slots, capacity );
+        ctrl        = nullptr;
+        slots       = nullptr;
+        capacity    = 0;
+        item_count  = 0;
+        growth_left = 0;
+    }
+
+}
+
+#endif
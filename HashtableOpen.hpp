@@ -1,13 +1,30 @@
 /*! \file    HashtableOpen.hpp
-    \brief   An open addressing (with linear probing) style hash table.
+    \brief   An open addressing (with Robin Hood linear probing) style hash table.
     \author  Peter Chapin <spicacality@kelseymountain.org>
+
+    The table keeps its items in an array of slots whose size is a power of two so a hash value
+    is reduced to a slot index with a mask. Beside the slots is a byte array of metadata. Each
+    byte is zero if its slot is empty and otherwise records how far the item in the slot is from
+    its home slot (its "probe distance"). Insertion uses Robin Hood hashing: an item being
+    inserted takes the slot of any item it meets that is closer to home than it is, and that
+    item continues the search instead. This keeps probe sequences short and lets a search stop
+    as soon as it meets an item closer to home than the key it is looking for. Erasure shifts
+    the following items of a probe sequence back one slot so no tombstones are needed.
+
+    The table grows (doubling the number of slots) when an insertion would raise the load
+    factor above max_load_factor( ). Growing invalidates all iterators. Erasing also moves items
+    so it invalidates all iterators.
 */
 
 #ifndef HASHTABLEOPEN_HPP
 #define HASHTABLEOPEN_HPP
 
 #include <cstddef>
+#include <cstdint>
 #include <iterator>
+#include <new>
+#include <stdexcept>
+#include <utility>
 
 namespace spica {
 
@@ -27,12 +44,17 @@ namespace spica {
         // necessary because I can not allow the user to modify items while they are in the
         // table.
         //
-        class iterator :
-            public std::iterator< std::bidirectional_iterator_tag, const T > {
+        class iterator {
 
             friend class HashtableOpen;
 
         public:
+            typedef std::bidirectional_iterator_tag iterator_category;
+            typedef const T                         value_type;
+            typedef std::ptrdiff_t                  difference_type;
+            typedef const T                        *pointer;
+            typedef const T                        &reference;
+
             typename HashtableOpen< T, Hasher >::value_type &operator*( ) const;
             // Overloaded indirection.
 
@@ -56,9 +78,10 @@ namespace spica {
 
         friend class HashtableOpen::iterator;
 
-        HashtableOpen( size_type size, Hasher function );
-        // Initializes the hash table by creating 'size' buckets and remembering the hash
-        // function.
+        HashtableOpen( size_type size, Hasher function, float load_limit = 0.8f );
+        // Initializes the hash table by creating at least 'size' buckets (rounded up to a power
+        // of two) and remembering the hash function. The table grows when its load factor
+        // would exceed load_limit.
 
        ~HashtableOpen( );
         // Destroys objects in the table.
@@ -72,13 +95,38 @@ namespace spica {
         bool empty( ) const;
         // Returns true if the size() is zero and false otherwise.
 
-      std::pair< iterator, bool > insert( const key_type & );
+        float load_factor( ) const;
+        // Returns size( ) / bucket_count( ).
+
+        float max_load_factor( ) const;
+        void  max_load_factor( float );
+        // Returns or changes the load factor at which the table grows. The value is clamped to
+        // the range [0.1, 0.95]. Lowering it might cause the table to grow at once.
+
+        void rehash( size_type );
+        // Changes the number of buckets to at least the given value (rounded up to a power of
+        // two). The number of buckets is never made too small for the current items.
+
+        void reserve( size_type );
+        // Makes room for the given number of items without exceeding the maximum load factor.
+
+        std::pair< iterator, bool > insert( const key_type & );
         // Copies the argument into the table. If it is already in the table (according to
         // operator==() for type T), there is no effect on the table. It returns an iterator to
         // the object as it exists in the table. The second member of the pair is a flag. It has
         // the value true if the new item was inserted and false if the item was already in the
         // table.
-        
+
+        size_type erase( const key_type & );
+        // Removes the object that matches the argument, if there is one. Returns the number of
+        // objects removed (zero or one).
+
+        void erase( iterator );
+        // Removes the object the iterator points at.
+
+        void clear( );
+        // Removes all objects. The number of buckets is unchanged.
+
         iterator find( const key_type & ) const;
         // Finds an object in the table that "matches" the argument according to operator==()
         // for type T. It returns an iterator to the object if it exists in the table. Otherwise
@@ -89,11 +137,41 @@ namespace spica {
         // Functions for producing scanning over the table items.
 
     private:
-        T        *table;         // Points at the table itself.
-        size_type nbuckets;      // Number of buckets in the table.
-        size_type item_count;    // Number of items in the table.
-        bool     *freemap;       // Entries are marked trued if they are free.
-        Hasher    hash_function; // The hash function.
+        // Metadata values. Other values are one more than the probe distance. Distances that
+        // don't fit in a byte are recomputed from the item's hash.
+        static constexpr unsigned char empty_slot = 0;
+        static constexpr unsigned char far_slot   = 255;
+
+        T             *table;          // Points at the table itself.
+        unsigned char *metadata;       // Probe distance of each slot (see above).
+        size_type      nbuckets;       // Number of buckets in the table (a power of two).
+        size_type      mask;           // nbuckets - 1.
+        size_type      item_count;     // Number of items in the table.
+        size_type      grow_limit;     // Grow before item_count exceeds this.
+        float          max_load;       // The maximum load factor.
+        Hasher         hash_function;  // The hash function.
+
+        size_type home( const T & ) const;
+        // Returns the slot where an item would be if there were no collisions.
+
+        size_type distance( size_type index ) const;
+        // Returns the probe distance of the item in an occupied slot.
+
+        void set_distance( size_type index, size_type probe_distance );
+        // Records the probe distance of the item in a slot.
+
+        size_type locate( const key_type & ) const;
+        // Returns the slot holding a matching item or nbuckets if there is none.
+
+        size_type place( T &&item );
+        // Installs an item known not to be in the table. Returns the slot where it was put.
+
+        void allocate( size_type count );
+        // Allocates empty arrays for count buckets (a power of two) and sets the related members.
+
+        // Inhibit copying.
+        HashtableOpen( const HashtableOpen & );
+        HashtableOpen &operator=( const HashtableOpen & );
     };
 
 
@@ -103,20 +181,22 @@ namespace spica {
     // The constructor initializes the members of the hash table.
     //
     template< typename T, typename Hasher >
-    HashtableOpen< T, Hasher >::HashtableOpen( size_type size, Hasher function )
+    HashtableOpen< T, Hasher >::HashtableOpen( size_type size, Hasher function, float load_limit )
+        : hash_function( function )
     {
-        table         = reinterpret_cast< T * >( new char[size * sizeof( T )] );
-        freemap       = new bool[size];
-        nbuckets      = size;
-        item_count    = 0;
-        hash_function = function;
-
-        // Initialize the free map.
-        for( size_type i = 0; i < nbuckets; ++i ) {
-            freemap[i] = true;
+        item_count = 0;
+        max_load   = load_limit;
+        if( max_load < 0.1f  ) max_load = 0.1f;
+        if( max_load > 0.95f ) max_load = 0.95f;
+
+        size_type count = 8;
+        while( count < size ) {
+            count *= 2;
+            if( count == 0 ) throw std::length_error( "hash table: too many buckets requested" );
         }
+        allocate( count );
     }
-    
+
 
     //
     // HashtableOpen<T, Hasher>::~HashtableOpen
@@ -126,17 +206,42 @@ namespace spica {
     template< typename T, typename Hasher >
     HashtableOpen< T, Hasher >::~HashtableOpen( )
     {
-        // Explicitly destroy existing table items.
-        for( size_type i = 0; i < nbuckets; ++i ) {
-            if( !freemap[i] ) table[i].~T( );
-        }
+        clear( );
 
         // Don't forget to release the memory allocated earlier.
-        delete [] freemap;
+        delete [] metadata;
         delete [] reinterpret_cast< char * >( table );
     }
 
 
+    //
+    // HashtableOpen<T, Hasher>::allocate
+    //
+    // The old arrays (if any) are not released. The caller is responsible for them.
+    //
+    template< typename T, typename Hasher >
+    void HashtableOpen< T, Hasher >::allocate( size_type count )
+    {
+        if( count > static_cast< size_type >( -1 ) / sizeof( T ) ) throw std::bad_alloc( );
+
+        unsigned char *new_metadata = new unsigned char[count]( );
+        try {
+            table = reinterpret_cast< T * >( new char[count * sizeof( T )] );
+        }
+        catch( ... ) {
+            delete [] new_metadata;
+            throw;
+        }
+        metadata = new_metadata;
+        nbuckets = count;
+        mask     = count - 1;
+
+        // At least one bucket must always be empty so that searches terminate.
+        grow_limit = static_cast< size_type >( max_load * count );
+        if( grow_limit >= count ) grow_limit = count - 1;
+    }
+
+
     //
     // HashtableOpen<T, Hasher>::size
     //
@@ -178,57 +283,271 @@ namespace spica {
     }
 
 
+    //
+    // HashtableOpen<T, Hasher>::load_factor
+    //
+    template< typename T, typename Hasher >
+    inline
+    float HashtableOpen< T, Hasher >::load_factor( ) const
+    {
+        return static_cast< float >( item_count ) / static_cast< float >( nbuckets );
+    }
+
+
+    //
+    // HashtableOpen<T, Hasher>::max_load_factor
+    //
+    template< typename T, typename Hasher >
+    inline
+    float HashtableOpen< T, Hasher >::max_load_factor( ) const
+    {
+        return max_load;
+    }
+
+
+    //
+    // HashtableOpen<T, Hasher>::max_load_factor( float )
+    //
+    // Rehashing to the current number of buckets recomputes grow_limit and grows the table if
+    // it is now too full.
+    //
+    template< typename T, typename Hasher >
+    void HashtableOpen< T, Hasher >::max_load_factor( float new_max_load )
+    {
+        max_load = new_max_load;
+        if( max_load < 0.1f  ) max_load = 0.1f;
+        if( max_load > 0.95f ) max_load = 0.95f;
+        rehash( nbuckets );
+    }
+
+
+    //
+    // HashtableOpen<T, Hasher>::home
+    //
+    // The hash value is mixed before it is masked so that hash functions with poor low order
+    // bits (such as the identity function on integers that are multiples of a power of two) are
+    // still spread across the table.
+    //
+    template< typename T, typename Hasher >
+    inline
+    typename HashtableOpen< T, Hasher >::size_type
+        HashtableOpen< T, Hasher >::home( const T &item ) const
+    {
+        std::uint64_t hash = static_cast< std::uint64_t >( hash_function( item ) );
+        hash *= 0x9E3779B97F4A7C15ULL;
+        return static_cast< size_type >( hash ^ ( hash >> 32 ) ) & mask;
+    }
+
+
+    //
+    // HashtableOpen<T, Hasher>::distance
+    //
+    template< typename T, typename Hasher >
+    inline
+    typename HashtableOpen< T, Hasher >::size_type
+        HashtableOpen< T, Hasher >::distance( size_type index ) const
+    {
+        if( metadata[index] != far_slot ) return metadata[index] - 1;
+        return ( index - home( table[index] ) ) & mask;
+    }
+
+
+    //
+    // HashtableOpen<T, Hasher>::set_distance
+    //
+    template< typename T, typename Hasher >
+    inline
+    void HashtableOpen< T, Hasher >::set_distance( size_type index, size_type probe_distance )
+    {
+        metadata[index] = ( probe_distance < far_slot - 1 ) ?
+            static_cast< unsigned char >( probe_distance + 1 ) : far_slot;
+    }
+
+
+    //
+    // HashtableOpen<T, Hasher>::locate
+    //
+    // The search stops at an empty bucket or at an item that is closer to its home than the key
+    // would be. In either case, Robin Hood insertion would have put the key in that bucket.
+    //
+    template< typename T, typename Hasher >
+    typename HashtableOpen< T, Hasher >::size_type
+        HashtableOpen< T, Hasher >::locate( const key_type &key ) const
+    {
+        size_type index = home( key );
+        for( size_type probe_distance = 0; metadata[index] != empty_slot; ++probe_distance ) {
+            if( distance( index ) < probe_distance ) break;
+            if( table[index] == key ) return index;
+            index = ( index + 1 ) & mask;
+        }
+        return nbuckets;
+    }
+
+
+    //
+    // HashtableOpen<T, Hasher>::place
+    //
+    // The item being placed takes the bucket of any item that is closer to its home. The
+    // displaced item is then placed further along in the same way.
+    //
+    template< typename T, typename Hasher >
+    typename HashtableOpen< T, Hasher >::size_type
+        HashtableOpen< T, Hasher >::place( T &&item )
+    {
+        using std::swap;
+
+        size_type index          = home( item );
+        size_type probe_distance = 0;
+        size_type result         = nbuckets;
+
+        while( metadata[index] != empty_slot ) {
+            size_type existing_distance = distance( index );
+            if( existing_distance < probe_distance ) {
+                swap( item, table[index] );
+                set_distance( index, probe_distance );
+                if( result == nbuckets ) result = index;
+                probe_distance = existing_distance;
+            }
+            ++probe_distance;
+            index = ( index + 1 ) & mask;
+        }
+
+        new ( &table[index] ) T( std::move( item ) );
+        set_distance( index, probe_distance );
+        return ( result == nbuckets ) ? index : result;
+    }
+
+
+    //
+    // HashtableOpen<T, Hasher>::rehash
+    //
+    // The items are moved into new arrays. The order in which they are placed doesn't matter.
+    //
+    template< typename T, typename Hasher >
+    void HashtableOpen< T, Hasher >::rehash( size_type count )
+    {
+        size_type new_count = 8;
+        while( new_count < count || static_cast< size_type >( max_load * new_count ) < item_count ||
+               new_count <= item_count ) {
+            new_count *= 2;
+            if( new_count == 0 ) throw std::length_error( "hash table: too many buckets requested" );
+        }
+
+        T             *old_table    = table;
+        unsigned char *old_metadata = metadata;
+        size_type      old_count    = nbuckets;
+
+        allocate( new_count );
+        for( size_type i = 0; i < old_count; ++i ) {
+            if( old_metadata[i] != empty_slot ) {
+                place( std::move( old_table[i] ) );
+                old_table[i].~T( );
+            }
+        }
+
+        delete [] old_metadata;
+        delete [] reinterpret_cast< char * >( old_table );
+    }
+
+
+    //
+    // HashtableOpen<T, Hasher>::reserve
+    //
+    template< typename T, typename Hasher >
+    void HashtableOpen< T, Hasher >::reserve( size_type count )
+    {
+        if( count <= grow_limit ) return;
+        rehash( static_cast< size_type >( count / max_load ) + 1 );
+    }
+
+
     //
     // HashtableOpen<T, Hasher>::insert
     //
-    // This function inserts a new key value into the table.
+    // This function inserts a new key value into the table. The table is grown first if adding
+    // the key would make it too full.
     //
     template< typename T, typename Hasher >
     std::pair< typename HashtableOpen< T, Hasher >::iterator, bool >
         HashtableOpen< T, Hasher >::insert( const key_type &key )
     {
-        size_type index;
-        iterator  result;
-
-        // Is there space?
-        if( item_count == nbuckets )
-            throw std::length_error( "hash table: full; can't increase capacity" );
-
-        // Compute the table index where this object might be.
-        index  = hash_function( key );
-        index %= nbuckets;
-
-        // Search for a free bucket using linear probing. Since there is at least one free slot,
-        // this loop will terminate eventually. In the normal case, this loop should be skipped
-        // immediately (that is, the desired bucket should be available most of the time).
-        // 
-        while( !freemap[index] ) {
-
-            // If the items is already in the table, indicate as much to the caller.
-            if( table[index] == key ) {
-                result.table = this;
-                result.current = index;
-                return std::pair< iterator, bool >( result, false );
-            }
+        iterator result;
+        result.table = this;
 
-            // Try the next bucket.
-            ++index;
-            if( index > nbuckets ) index = 0;
+        // If the item is already in the table, indicate as much to the caller.
+        size_type index = locate( key );
+        if( index != nbuckets ) {
+            result.current = index;
+            return std::pair< iterator, bool >( result, false );
         }
 
+        if( item_count + 1 > grow_limit ) rehash( nbuckets * 2 );
+
         // Install new item.
-        new ( &table[index] ) T( key );
-        freemap[index] = false;
+        result.current = place( T( key ) );
         ++item_count;
 
-        // Set up iterator for return.
-        result.table = this;
-        result.current = index;
-
         return std::pair< iterator, bool >( result, true );
     }
 
 
+    //
+    // HashtableOpen<T, Hasher>::erase( iterator )
+    //
+    // The items after the erased one are shifted back until an empty bucket or an item in its
+    // home bucket is found. Each shifted item is one bucket closer to its home.
+    //
+    template< typename T, typename Hasher >
+    void HashtableOpen< T, Hasher >::erase( iterator position )
+    {
+        size_type index = position.current;
+        table[index].~T( );
+        --item_count;
+
+        size_type next = ( index + 1 ) & mask;
+        while( metadata[next] != empty_slot && distance( next ) != 0 ) {
+            size_type next_distance = distance( next );
+            new ( &table[index] ) T( std::move( table[next] ) );
+            table[next].~T( );
+            set_distance( index, next_distance - 1 );
+            index = next;
+            next  = ( next + 1 ) & mask;
+        }
+        metadata[index] = empty_slot;
+    }
+
+
+    //
+    // HashtableOpen<T, Hasher>::erase( const key_type & )
+    //
+    template< typename T, typename Hasher >
+    typename HashtableOpen< T, Hasher >::size_type
+        HashtableOpen< T, Hasher >::erase( const key_type &key )
+    {
+        iterator position = find( key );
+        if( position == end( ) ) return 0;
+        erase( position );
+        return 1;
+    }
+
+
+    //
+    // HashtableOpen<T, Hasher>::clear
+    //
+    template< typename T, typename Hasher >
+    void HashtableOpen< T, Hasher >::clear( )
+    {
+        // Explicitly destroy existing table items.
+        for( size_type i = 0; i < nbuckets; ++i ) {
+            if( metadata[i] != empty_slot ) {
+                table[i].~T( );
+                metadata[i] = empty_slot;
+            }
+        }
+        item_count = 0;
+    }
+
+
     //
     // HashtableOpen<T, Hasher>::find
     //
@@ -240,29 +559,10 @@ namespace spica {
     typename HashtableOpen< T, Hasher >::iterator
         HashtableOpen< T, Hasher >::find( const key_type &key ) const
     {
-        size_type index;
-        size_type original_index;
-        iterator  result;
+        iterator result;
 
-        // Initialize result to be the same as the end() iterator.
         result.table = this;
-        result.current = nbuckets;
-
-        // Compute the table index where this object might be.
-        index  = hash_function( key );
-        index %= nbuckets;
-        original_index = index;
-
-        while( freemap[index] == false ) {
-            if( table[index] == key ) {
-                result.current = index;
-                break;
-            }
-            ++index;
-            if( index == nbuckets ) index = 0;
-            if( index == original_index ) break;
-        }
-
+        result.current = locate( key );
         return result;
     }
 
@@ -282,7 +582,7 @@ namespace spica {
         // Start at the top of the table and look for the first filled bucket.
         size_type i;
         for( i = 0; i < nbuckets; ++i ) {
-            if( !freemap[i] ) break;
+            if( metadata[i] != empty_slot ) break;
         }
 
         // Prepare iterator. Notice that if the table is empty, i will be nbuckets as desired.
@@ -309,7 +609,7 @@ namespace spica {
 
         // The "just off the end" iterator will use a just off the end bucket index. Other
         // representations are probably possible, but this one certainly seems natural.
-        // 
+        //
         result.table = this;
         result.current = nbuckets;
 
@@ -346,7 +646,7 @@ namespace spica {
 
         // Now look for a new filled bucket.
         while( current < table->nbuckets ) {
-            if( !table->freemap[current] ) break;
+            if( table->metadata[current] != empty_slot ) break;
             ++current;
         }
         return *this;
@@ -368,8 +668,8 @@ namespace spica {
         // such an operation is undefined anyway. It is necessary to support incrementing just
         // past the end, but it is not necessary to support decrementing just before the
         // beginning.
-        // 
-        while( table->freemap[--current] ) ;
+        //
+        while( table->metadata[--current] == empty_slot ) ;
         return *this;
     }
 
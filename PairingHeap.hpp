@@ -0,0 +1,511 @@
+/*! \file    PairingHeap.hpp
+ *  \brief   Pairing heap container template
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef PAIRINGHEAP_HPP
+#define PAIRINGHEAP_HPP
+
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace spica {
+
+    //! Pairing heap container template.
+    /*!
+     * A pairing heap is a single tree in which each node has a list of children. Insertion and
+     * merging just make one root a child of the other, so they take O(1) time. Removing the
+     * front item pairs up its children from left to right and then combines the pairs from
+     * right to left, which takes O(lg(n)) amortized time. Decreasing a key cuts the item's
+     * subtree out and makes it a child of the root; its amortized cost is o(lg(n)) and in
+     * practice it is nearly constant. Pairing heaps are usually faster than binomial and
+     * Fibonacci heaps even though their worst case bounds are weaker.
+     *
+     * PairingHeap provides the same interface as BinomialHeap, including handles for
+     * decrease_key( ) and erase( ). See Fredman, Sedgewick, Sleator, and Tarjan, "The Pairing
+     * Heap: A New Form of Self-Adjusting Heap," Algorithmica 1, 1986.
+     *
+     * Nodes are obtained from an allocator of type Allocator rebound to the node type. With a
+     * PoolAllocator the nodes are packed into large chunks and clear( ) releases the chunks
+     * without visiting the nodes (if the items have trivial destructors).
+     */
+    template<typename T,
+             typename StrictWeakOrdering = std::less<T>,
+             typename Allocator = std::allocator<T>>
+    class PairingHeap {
+    public:
+
+        typedef       T                   key_type;
+        typedef       key_type            value_type;
+        typedef       StrictWeakOrdering  key_compare;
+        typedef       StrictWeakOrdering  value_compare;
+        typedef       key_type           *pointer;
+        typedef const key_type           *const_pointer;
+        typedef       key_type           &reference;
+        typedef const key_type           &const_reference;
+        typedef       std::size_t         size_type;
+        typedef       Allocator           allocator_type;
+
+    private:
+
+        // The children of a node form a list linked by the next pointers. The previous pointer
+        // refers to the previous sibling, or to the parent for the first child. It is null for
+        // the root.
+        //
+        struct PairingNode {
+            PairingNode *child;
+            PairingNode *next;
+            PairingNode *previous;
+            key_type     data;
+
+            PairingNode( const key_type &new_item ) :
+                child( nullptr ), next( nullptr ), previous( nullptr ), data( new_item ) { }
+        };
+
+        typedef typename std::allocator_traits<Allocator>::template rebind_alloc<PairingNode> node_allocator;
+        typedef std::allocator_traits<node_allocator> node_traits;
+
+        PairingNode *root;
+        size_type    count;
+        StrictWeakOrdering comp;
+        [[no_unique_address]] node_allocator node_alloc;
+
+        // Makes the root that comes later a child of the other and returns the new root.
+        PairingNode *meld( PairingNode *left, PairingNode *right );
+
+        // Combines a list of siblings into one tree using the two pass method.
+        PairingNode *combine_siblings( PairingNode *first );
+
+        // Removes a (non-root) node and its subtree from its parent.
+        static void cut( PairingNode *node );
+
+        // Returns the parent of a node, or null for the root.
+        static PairingNode *parent_of( const PairingNode *node );
+
+        void destroy_node( PairingNode *node );
+
+        // Make copy operations illegal on pairing heaps (for now).
+        PairingHeap( const PairingHeap & ) = delete;
+        PairingHeap &operator=( const PairingHeap & ) = delete;
+
+    public:
+
+        //! Pairing heap iterator class.
+        /*!
+         * Pairing heap iterators are forward iterators that visit the items in an unspecified
+         * order. They walk the tree in preorder using the links in the nodes, so they never
+         * allocate memory. A sweep through the entire heap takes O(n) time.
+         */
+        class iterator {
+
+            friend class PairingHeap;
+
+        public:
+            typedef std::forward_iterator_tag iterator_category;
+            typedef const T                   value_type;
+            typedef const T                  *pointer;
+            typedef const T                  &reference;
+            typedef std::ptrdiff_t           difference_type;
+
+        private:
+            const PairingNode *current;
+
+            explicit iterator( const PairingNode *c ) : current( c ) { }
+
+        public:
+            //! Default constructor.
+            iterator( ) : current( nullptr ) { }
+
+            //! Returns true if two iterators point at the same object or both end( ).
+            bool operator==( const iterator &other ) const
+                { return current == other.current; }
+
+            //! Returns a reference to the current object.
+            const T &operator*( ) const
+                { return current->data; }
+
+            //! Returns a pointer to the current object.
+            const T *operator->( ) const
+                { return &current->data; }
+
+            //! Prefix increment.
+            iterator &operator++( );
+
+            //! Postfix increment.
+            iterator operator++( int )
+            {
+                iterator old( *this );
+                ++*this;
+                return old;
+            }
+        };
+
+        //! Refers to an item in the heap.
+        /*!
+         * A handle stays valid until its item is removed from the heap by pop( ), erase( ), or
+         * clear( ), even if the heap is merged into another heap.
+         */
+        class handle {
+
+            friend class PairingHeap;
+
+        public:
+            //! Default constructor. The handle does not refer to any item.
+            handle( ) : node( nullptr ) { }
+
+            //! Returns a reference to the item.
+            const T &operator*( ) const { return node->data; }
+
+            //! Returns a pointer to the item.
+            const T *operator->( ) const { return &node->data; }
+
+            //! Returns true if the handles refer to the same item.
+            bool operator==( const handle &other ) const { return node == other.node; }
+
+        private:
+            explicit handle( PairingNode *n ) : node( n ) { }
+
+            PairingNode *node;
+        };
+
+        //! Create an empty heap.
+        PairingHeap( const StrictWeakOrdering &C = StrictWeakOrdering( ),
+                     const Allocator &A = Allocator( ) )
+            : root( nullptr ), count( 0 ), comp( C ), node_alloc( A )
+            { }
+
+        //! Create a heap from the given sequence.
+        template<typename InputIterator>
+        PairingHeap(
+            InputIterator first,
+            InputIterator last,
+            const StrictWeakOrdering &C = StrictWeakOrdering( ),
+            const Allocator &A = Allocator( )
+        ) : root( nullptr ), count( 0 ), comp( C ), node_alloc( A )
+            { insert( first, last ); }
+
+        //! Destroy the heap and all contained nodes.
+       ~PairingHeap( )
+            { clear( ); }
+
+        //! Return the number of data items in the heap. O(1)
+        size_type size( ) const
+            { return count; }
+
+        //! Returns true if the heap contains no items. O(1)
+        bool empty( ) const
+            { return count == 0; }
+
+        // These members are provided by other, similar container types.
+        key_compare key_comp( ) const
+            { return comp; }
+
+        value_compare value_comp( ) const
+            { return comp; }
+
+        allocator_type get_allocator( ) const
+            { return allocator_type( node_alloc ); }
+
+        //! Return an iterator to the first item in the heap.
+        iterator begin( ) const { return iterator( root ); }
+
+        //! Return an iterator just past the last item in the heap.
+        iterator end( ) const { return iterator( ); }
+
+        //! Insert a copy of the given object into 'this' heap. O(1)
+        /*!
+         * This method returns a pointer to the new copy of the object. The pointer is valid
+         * until the object is removed from the heap.
+         */
+        const T *insert( const T &new_item )
+            { return &*push( new_item ); }
+
+        //! Inserts a copy of the given object and returns a handle to it. O(1)
+        handle push( const T &new_item );
+
+        //! Inserts each item in the range [first, last) into the heap.
+        template<typename InputIterator>
+        void insert( InputIterator first, InputIterator last )
+        {
+            for( ; first != last; ++first ) push( *first );
+        }
+
+        //! Return a reference to the object at the front of the heap. O(1)
+        /*!
+         * If the heap is empty when this method is called the effect is undefined.
+         */
+        const T &front( ) const
+            { return root->data; }
+
+        //! Extract the object at the front of the heap and throw away its value.
+        /*!
+         * If the heap is empty when this method is called the effect is undefined.
+         */
+        void pop( );
+
+        //! Replaces an item with one that is not after it in the heap ordering.
+        /*!
+         * \exception std::invalid_argument if the new value comes after the old one.
+         */
+        void decrease_key( handle item, const T &new_value );
+
+        //! Removes the item referred to by the handle.
+        void erase( handle item );
+
+        //! Remove every item from the heap.
+        void clear( );
+
+        //! Merge the other pairing heap into 'this' heap. O(1)
+        /*!
+         * The other heap is emptied by this operation but not destroyed; it remains in a usable
+         * state. The nodes of the other heap are taken over without copying, so the allocators
+         * of the two heaps must compare equal.
+         */
+        PairingHeap &merge( PairingHeap &other );
+    };
+
+
+    // ---------------
+    // Private Methods
+    // ---------------
+
+    template<typename T, typename StrictWeakOrdering, typename Allocator>
+    typename PairingHeap<T, StrictWeakOrdering, Allocator>::PairingNode *
+        PairingHeap<T, StrictWeakOrdering, Allocator>::meld( PairingNode *left, PairingNode *right )
+    {
+        if( left  == nullptr ) return right;
+        if( right == nullptr ) return left;
+        if( comp( right->data, left->data ) ) std::swap( left, right );
+
+        // The right tree becomes the first child of the left tree.
+        right->previous = left;
+        right->next = left->child;
+        if( left->child != nullptr ) left->child->previous = right;
+        left->child = right;
+        left->next = nullptr;
+        left->previous = nullptr;
+        return left;
+    }
+
+
+    //
+    // combine_siblings
+    //
+    // The first pass melds the siblings in pairs from left to right, pushing each result onto
+    // a list (linked by next) so that the list ends up in reverse order. The second pass melds
+    // the list from right to left into a single tree.
+    //
+    template<typename T, typename StrictWeakOrdering, typename Allocator>
+    typename PairingHeap<T, StrictWeakOrdering, Allocator>::PairingNode *
+        PairingHeap<T, StrictWeakOrdering, Allocator>::combine_siblings( PairingNode *first )
+    {
+        PairingNode *pairs = nullptr;
+        while( first != nullptr ) {
+            PairingNode *a = first;
+            PairingNode *b = a->next;
+            first = ( b != nullptr ) ? b->next : nullptr;
+            a->next = a->previous = nullptr;
+            if( b != nullptr ) b->next = b->previous = nullptr;
+
+            PairingNode *melded = meld( a, b );
+            melded->next = pairs;
+            pairs = melded;
+        }
+
+        PairingNode *result = nullptr;
+        while( pairs != nullptr ) {
+            PairingNode *next = pairs->next;
+            pairs->next = nullptr;
+            result = meld( pairs, result );
+            pairs = next;
+        }
+        return result;
+    }
+
+
+    template<typename T, typename StrictWeakOrdering, typename Allocator>
+    void PairingHeap<T, StrictWeakOrdering, Allocator>::cut( PairingNode *node )
+    {
+        if( node->previous->child == node ) node->previous->child = node->next;
+        else node->previous->next = node->next;
+        if( node->next != nullptr ) node->next->previous = node->previous;
+        node->next = nullptr;
+        node->previous = nullptr;
+    }
+
+
+    //
+    // parent_of
+    //
+    // Walks back along the sibling list to the first child, whose previous pointer is the
+    // parent.
+    //
+    template<typename T, typename StrictWeakOrdering, typename Allocator>
+    typename PairingHeap<T, StrictWeakOrdering, Allocator>::PairingNode *
+        PairingHeap<T, StrictWeakOrdering, Allocator>::parent_of( const PairingNode *node )
+    {
+        while( node->previous != nullptr && node->previous->child != node ) {
+            node = node->previous;
+        }
+        return node->previous;
+    }
+
+
+    template<typename T, typename StrictWeakOrdering, typename Allocator>
+    void PairingHeap<T, StrictWeakOrdering, Allocator>::destroy_node( PairingNode *node )
+    {
+        node_traits::destroy( node_alloc, node );
+        node_traits::deallocate( node_alloc, node, 1 );
+    }
+
+
+    // ----------------
+    // Iterator Methods
+    // ----------------
+
+    //
+    // operator++
+    //
+    // Preorder: go down to the first child if there is one, otherwise to the next sibling of
+    // the nearest node (starting with this one) that has a sibling. Each sibling list is walked
+    // back once while climbing, so a full sweep takes O(n) time.
+    //
+    template<typename T, typename StrictWeakOrdering, typename Allocator>
+    typename PairingHeap<T, StrictWeakOrdering, Allocator>::iterator &
+        PairingHeap<T, StrictWeakOrdering, Allocator>::iterator::operator++( )
+    {
+        if( current->child != nullptr ) {
+            current = current->child;
+            return *this;
+        }
+        while( current != nullptr && current->next == nullptr ) {
+            current = parent_of( current );
+        }
+        if( current != nullptr ) current = current->next;
+        return *this;
+    }
+
+
+    // --------------
+    // Public Methods
+    // --------------
+
+    template<typename T, typename StrictWeakOrdering, typename Allocator>
+    typename PairingHeap<T, StrictWeakOrdering, Allocator>::handle
+        PairingHeap<T, StrictWeakOrdering, Allocator>::push( const T &new_item )
+    {
+        PairingNode *new_node = node_traits::allocate( node_alloc, 1 );
+        try {
+            node_traits::construct( node_alloc, new_node, new_item );
+        }
+        catch( ... ) {
+            node_traits::deallocate( node_alloc, new_node, 1 );
+            throw;
+        }
+
+        root = meld( root, new_node );
+        ++count;
+        return handle( new_node );
+    }
+
+
+    template<typename T, typename StrictWeakOrdering, typename Allocator>
+    void PairingHeap<T, StrictWeakOrdering, Allocator>::pop( )
+    {
+        PairingNode *old_root = root;
+        root = combine_siblings( old_root->child );
+        destroy_node( old_root );
+        --count;
+    }
+
+
+    template<typename T, typename StrictWeakOrdering, typename Allocator>
+    void PairingHeap<T, StrictWeakOrdering, Allocator>::decrease_key( handle item, const T &new_value )
+    {
+        PairingNode *node = item.node;
+        if( comp( node->data, new_value ) )
+            throw std::invalid_argument( "PairingHeap::decrease_key: new value comes after the old value" );
+
+        node->data = new_value;
+        if( node != root ) {
+            cut( node );
+            root = meld( root, node );
+        }
+    }
+
+
+    //
+    // erase
+    //
+    // The node's subtree is cut out and the node's children are combined into a tree that
+    // replaces it.
+    //
+    template<typename T, typename StrictWeakOrdering, typename Allocator>
+    void PairingHeap<T, StrictWeakOrdering, Allocator>::erase( handle item )
+    {
+        PairingNode *node = item.node;
+        if( node == root ) {
+            pop( );
+            return;
+        }
+        cut( node );
+        root = meld( root, combine_siblings( node->child ) );
+        destroy_node( node );
+        --count;
+    }
+
+
+    //
+    // clear
+    //
+    // The nodes waiting to be destroyed are kept in a list linked by next. When a node with
+    // children is destroyed its list of children is put at the front of the waiting list. This
+    // avoids recursion, which could be deep since a pairing heap can have any shape.
+    //
+    template<typename T, typename StrictWeakOrdering, typename Allocator>
+    void PairingHeap<T, StrictWeakOrdering, Allocator>::clear( )
+    {
+        // If the allocator's pools belong to this heap alone they can be released in one step.
+        bool released = false;
+        if constexpr( std::is_trivially_destructible_v<PairingNode> &&
+                      requires( node_allocator &a ) { a.release( ); } ) {
+            released = node_alloc.release( );
+        }
+
+        PairingNode *waiting = released ? nullptr : root;
+        while( waiting != nullptr ) {
+            PairingNode *node = waiting;
+            waiting = node->next;
+            if( node->child != nullptr ) {
+                PairingNode *last_child = node->child;
+                while( last_child->next != nullptr ) last_child = last_child->next;
+                last_child->next = waiting;
+                waiting = node->child;
+            }
+            destroy_node( node );
+        }
+        root  = nullptr;
+        count = 0;
+    }
+
+
+    template<typename T, typename StrictWeakOrdering, typename Allocator>
+    PairingHeap<T, StrictWeakOrdering, Allocator> &
+        PairingHeap<T, StrictWeakOrdering, Allocator>::merge( PairingHeap &other )
+    {
+        if( &other == this ) return *this;
+        root = meld( root, other.root );
+        count += other.count;
+        other.root  = nullptr;
+        other.count = 0;
+        return *this;
+    }
+
+}
+
+#endif
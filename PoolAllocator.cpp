@@ -0,0 +1,106 @@
+/*! \file    PoolAllocator.cpp
+ *  \brief   Implementation of the fixed-size memory pool.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <algorithm>
+#include "PoolAllocator.hpp"
+
+namespace spica {
+
+    namespace {
+
+        // The first chunk of a pool holds this many blocks. Later chunks double in size.
+        const std::size_t initial_chunk_blocks = 32;
+
+        // Chunks stop growing when they reach this many bytes.
+        const std::size_t maximum_chunk_bytes = 1024 * 1024;
+
+        // Blocks are placed after the link at the start of each chunk at this alignment.
+        const std::size_t block_alignment = alignof( std::max_align_t );
+
+        // Blocks must be able to hold the free list link when they are free, and sizes are
+        // rounded so that every block in a chunk is aligned.
+        std::size_t rounded_size( std::size_t size )
+        {
+            size = std::max( size, sizeof( void * ) );
+            return ( size + block_alignment - 1 ) & ~( block_alignment - 1 );
+        }
+
+    }
+
+
+    MemoryPool::MemoryPool( size_type block_size ) :
+        block_bytes( rounded_size( block_size ) ),
+        next_chunk_blocks( initial_chunk_blocks ),
+        live( 0 ),
+        reserved( 0 ),
+        free_list( nullptr ),
+        next_block( nullptr ),
+        chunk_end( nullptr ),
+        chunks( nullptr )
+    { }
+
+
+    MemoryPool::~MemoryPool( )
+    {
+        release( );
+    }
+
+
+    //
+    // release
+    //
+    void MemoryPool::release( ) noexcept
+    {
+        while( chunks != nullptr ) {
+            void *next = *static_cast<void **>( chunks );
+            ::operator delete( chunks );
+            chunks = next;
+        }
+        next_chunk_blocks = initial_chunk_blocks;
+        live       = 0;
+        reserved   = 0;
+        free_list  = nullptr;
+        next_block = nullptr;
+        chunk_end  = nullptr;
+    }
+
+
+    //
+    // new_chunk
+    //
+    void MemoryPool::new_chunk( )
+    {
+        size_type bytes = block_alignment + next_chunk_blocks * block_bytes;
+        void *chunk = ::operator new( bytes );
+        *static_cast<void **>( chunk ) = chunks;
+        chunks = chunk;
+        reserved  += bytes;
+        next_block = static_cast<char *>( chunk ) + block_alignment;
+        chunk_end  = next_block + next_chunk_blocks * block_bytes;
+        if( 2 * next_chunk_blocks * block_bytes <= maximum_chunk_bytes ) next_chunk_blocks *= 2;
+    }
+
+
+    namespace detail {
+
+        MemoryPool *pool_set::find( std::size_t block_size )
+        {
+            std::size_t rounded = rounded_size( block_size );
+            for( std::unique_ptr< MemoryPool > &pool : pools ) {
+                if( pool->block_size( ) == rounded ) return pool.get( );
+            }
+            pools.push_back( std::make_unique< MemoryPool >( block_size ) );
+            return pools.back( ).get( );
+        }
+
+
+        void pool_set::release( ) noexcept
+        {
+            for( std::unique_ptr< MemoryPool > &pool : pools ) pool->release( );
+        }
+
+    }
+
+}
@@ -0,0 +1,222 @@
+/*! \file    PoolAllocator.hpp
+ *  \brief   Fixed-size memory pool and an allocator that uses it.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ *
+ * Node based containers such as BinaryTree, SingleList, and BinomialHeap allocate one node for
+ * each item. With the global allocator those nodes are scattered across the heap, each carries
+ * the allocator's bookkeeping overhead, and destroying the container means one call to the
+ * allocator per node. A MemoryPool hands out blocks of a single size from large contiguous
+ * chunks instead. Freed blocks go on a free list and are reused before new space is taken from
+ * a chunk. All the chunks can be returned at once, without visiting the blocks.
+ *
+ * PoolAllocator is a standard allocator that draws single objects from a MemoryPool. Copies of
+ * a PoolAllocator, including copies rebound to other types, share a set of pools (one for each
+ * block size). The containers in this library check for the release( ) member of their
+ * allocator. When a container holds the only reference to its pools and its items have trivial
+ * destructors, clear( ) and the destructor release the pools instead of freeing each node.
+ *
+ * Neither class is thread safe. A PoolAllocator should be used by one container, or by several
+ * containers that are used by the same thread.
+ */
+
+#ifndef POOLALLOCATOR_HPP
+#define POOLALLOCATOR_HPP
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace spica {
+
+    //! Allocates blocks of one size from contiguous chunks.
+    /*!
+     * The first chunk holds a few blocks. Each new chunk is twice the size of the previous one
+     * up to a limit, so small pools stay small and large pools make few calls to the global
+     * allocator. Blocks are aligned for any type with fundamental alignment.
+     */
+    class MemoryPool {
+    public:
+        typedef std::size_t size_type;
+
+        //! Creates an empty pool of blocks with the given size. No memory is allocated yet.
+        explicit MemoryPool( size_type block_size );
+
+        //! Returns all chunks to the global allocator.
+       ~MemoryPool( );
+
+        //! Returns an uninitialized block. Throws std::bad_alloc if memory is exhausted.
+        void *allocate( )
+        {
+            if( free_list != nullptr ) {
+                free_block *block = free_list;
+                free_list = block->next;
+                ++live;
+                return block;
+            }
+            if( next_block == chunk_end ) new_chunk( );
+            void *block = next_block;
+            next_block += block_bytes;
+            ++live;
+            return block;
+        }
+
+        //! Puts a block obtained from allocate( ) on the free list.
+        void deallocate( void *block ) noexcept
+        {
+            free_block *freed = static_cast<free_block *>( block );
+            freed->next = free_list;
+            free_list = freed;
+            --live;
+        }
+
+        //! Returns every chunk to the global allocator. All blocks become invalid.
+        void release( ) noexcept;
+
+        //! Returns the size of the blocks handed out (the requested size after rounding).
+        size_type block_size( ) const noexcept { return block_bytes; }
+
+        //! Returns the number of blocks currently allocated.
+        size_type in_use( ) const noexcept { return live; }
+
+        //! Returns the number of bytes obtained from the global allocator.
+        size_type capacity( ) const noexcept { return reserved; }
+
+    private:
+        struct free_block {
+            free_block *next;
+        };
+
+        size_type   block_bytes;
+        size_type   next_chunk_blocks;  // Number of blocks in the next chunk.
+        size_type   live;               // Number of blocks handed out and not freed.
+        size_type   reserved;           // Total bytes in all chunks.
+        free_block *free_list;
+        char       *next_block;         // Next never used block in the newest chunk.
+        char       *chunk_end;
+        void       *chunks;             // Newest chunk. Each chunk starts with a link to the next.
+
+        void new_chunk( );
+
+        // Inhibit copying.
+        MemoryPool( const MemoryPool & );
+        MemoryPool &operator=( const MemoryPool & );
+    };
+
+    namespace detail {
+
+        //
+        // The pools shared by a PoolAllocator and its copies, one for each block size. The
+        // containers in this library use only one or two sizes so a short list is enough.
+        //
+        class pool_set {
+        public:
+            MemoryPool *find( std::size_t block_size );
+            void release( ) noexcept;
+
+        private:
+            std::vector< std::unique_ptr< MemoryPool > > pools;
+        };
+
+    }
+
+    //! Standard allocator that takes single objects from a MemoryPool.
+    /*!
+     * Requests for more than one object are passed to the global operator new. A copy of an
+     * allocator shares its pools and compares equal to it. The allocator given to a copy of a
+     * container has new pools, so that the copy can release its pools independently. Objects
+     * with extended alignment are not supported.
+     */
+    template<typename T>
+    class PoolAllocator {
+
+        template<typename U> friend class PoolAllocator;
+
+    public:
+        typedef T value_type;
+        typedef std::true_type  propagate_on_container_move_assignment;
+        typedef std::true_type  propagate_on_container_swap;
+        typedef std::false_type is_always_equal;
+
+        PoolAllocator( ) : pools( std::make_shared< detail::pool_set >( ) ), pool( nullptr ) { }
+
+        PoolAllocator( const PoolAllocator &other ) noexcept :
+            pools( other.pools ), pool( other.pool ) { }
+
+        PoolAllocator( PoolAllocator &&other ) noexcept :
+            pools( std::move( other.pools ) ), pool( other.pool )
+            { other.pool = nullptr; }
+
+        template<typename U>
+        PoolAllocator( const PoolAllocator<U> &other ) noexcept :
+            pools( other.pools ), pool( nullptr ) { }
+
+        PoolAllocator &operator=( const PoolAllocator &other ) noexcept
+        {
+            pools = other.pools;
+            pool  = other.pool;
+            return *this;
+        }
+
+        PoolAllocator &operator=( PoolAllocator &&other ) noexcept
+        {
+            pools = std::move( other.pools );
+            pool  = other.pool;
+            other.pool = nullptr;
+            return *this;
+        }
+
+        T *allocate( std::size_t n )
+        {
+            static_assert( alignof( T ) <= alignof( std::max_align_t ),
+                           "PoolAllocator does not support over-aligned types" );
+            if( n != 1 ) return static_cast<T *>( ::operator new( n * sizeof( T ) ) );
+            if( pool == nullptr ) {
+                // A moved-from allocator starts over with new pools.
+                if( pools == nullptr ) pools = std::make_shared< detail::pool_set >( );
+                pool = pools->find( sizeof( T ) );
+            }
+            return static_cast<T *>( pool->allocate( ) );
+        }
+
+        void deallocate( T *p, std::size_t n ) noexcept
+        {
+            if( n != 1 ) {
+                ::operator delete( p );
+                return;
+            }
+            // The pool exists because some copy of this allocator allocated the object.
+            if( pool == nullptr ) pool = pools->find( sizeof( T ) );
+            pool->deallocate( p );
+        }
+
+        //! Frees every object allocated from the pools if no other allocator shares them.
+        /*!
+         * Returns false, and does nothing, if the pools are shared. Objects in the pools are
+         * not destroyed.
+         */
+        bool release( ) noexcept
+        {
+            if( pools == nullptr ) return true;
+            if( pools.use_count( ) != 1 ) return false;
+            pools->release( );
+            return true;
+        }
+
+        //! A copied container gets its own pools.
+        PoolAllocator select_on_container_copy_construction( ) const
+            { return PoolAllocator( ); }
+
+        template<typename U>
+        bool operator==( const PoolAllocator<U> &other ) const noexcept
+            { return pools == other.pools; }
+
+    private:
+        std::shared_ptr< detail::pool_set > pools;
+        MemoryPool *pool;   // The pool for sizeof( T ) once it has been looked up.
+    };
+
+}
+
+#endif
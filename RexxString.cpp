@@ -89,7 +89,7 @@ namespace spica {
 
         #if defined(pMULTITHREADED)
         // This is the "BRSL" (Big RexxString Lock).
-        mutex_sem string_lock;
+        mutex_sem string_lock( "RexxString" );
         #endif
 
         //-------------------------------------------------
@@ -14,22 +14,73 @@ namespace spica {
     }
 
 
+    // If a coroutine is waiting, the increment is passed directly to it and the count is not
+    // changed.
     void Semaphore::up( )
     {
+        std::function< void( ) > resume;
+
         lock.lock( );
-        raw_count++;
+        if( async_waiters.empty( ) ) {
+            raw_count++;
+        }
+        else {
+            resume = std::move( async_waiters.front( ) );
+            async_waiters.pop_front( );
+        }
         lock.unlock( );
-        non_zero.notify_one( );
+
+        if( resume ) resume( );
+        else non_zero.notify_one( );
     }
 
 
     void Semaphore::down( )
     {
+        #if defined(pLOCK_PROFILE)
+        unsigned long long start = ( profile != 0 ) ? profile_clock( ) : 0;
+        #endif
+
         boost::unique_lock< boost::mutex > guard( lock );
         while( raw_count == 0 )
             non_zero.wait( guard );
 
         raw_count--;
+
+        #if defined(pLOCK_PROFILE)
+        if( profile != 0 ) profile->wait_times( ).record( profile_clock( ) - start );
+        #endif
+    }
+
+
+    bool Semaphore::try_down( )
+    {
+        boost::lock_guard< boost::mutex > guard( lock );
+        if( raw_count == 0 ) return false;
+        raw_count--;
+        return true;
+    }
+
+
+    bool Semaphore::wait_async( std::function< void( ) > resume )
+    {
+        boost::lock_guard< boost::mutex > guard( lock );
+        if( raw_count > 0 ) {
+            raw_count--;
+            return false;
+        }
+        async_waiters.push_back( std::move( resume ) );
+        return true;
+    }
+
+
+    void Semaphore::set_profile_name( const char *name )
+    {
+        #if defined(pLOCK_PROFILE)
+        profile = lock_profile::find( name );
+        #else
+        (void)name;
+        #endif
     }
 
 }
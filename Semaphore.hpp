@@ -2,14 +2,23 @@
  *  \brief   Interface to a semaphore class.
  *  \author  Peter Chapin <spicacality@kelseymountain.org>
  *
- * The semaphores defined here are implemented in terms of boost::thread facilities.
+ * The semaphores defined here are implemented in terms of boost::thread facilities. Coroutines
+ * can decrement a semaphore without blocking their thread with co_await sem.down_async( executor ).
+ * See task.hpp.
  */
 
 #ifndef SEMAPHORE_HPP
 #define SEMAPHORE_HPP
 
+#include <coroutine>
+#include <deque>
+#include <functional>
 #include <boost/thread.hpp>
 
+#if defined(pLOCK_PROFILE)
+#include "lock_profile.hpp"
+#endif
+
 namespace spica {
 
     class Semaphore {
@@ -40,10 +49,62 @@ namespace spica {
          */
         void down( );
 
+        //! Decrements the semaphore if it is not zero.
+        /*!
+         * \return true if the semaphore was decremented; false if it was zero.
+         */
+        bool try_down( );
+
+        //! Awaitable returned by down_async.
+        template< typename Executor > class down_awaiter {
+        public:
+            down_awaiter( Semaphore &s, Executor &e ) : sem( s ), executor( e ) { }
+
+            bool await_ready( ) { return sem.try_down( ); }
+            bool await_suspend( std::coroutine_handle< > waiting )
+            {
+                Executor *target = &executor;
+                return sem.wait_async(
+                    [target, waiting]( ) { target->post( [waiting]( ) { waiting.resume( ); } ); } );
+            }
+            void await_resume( ) { }
+
+        private:
+            Semaphore &sem;
+            Executor  &executor;
+        };
+
+        //! Decrements the semaphore from a coroutine.
+        /*!
+         * If the semaphore is zero the awaiting coroutine is suspended, without blocking its
+         * thread, until another thread increments the semaphore. The coroutine is then resumed
+         * on the executor. Suspended coroutines are served before threads blocked in down().
+         */
+        template< typename Executor >
+        down_awaiter< Executor > down_async( Executor &executor )
+            { return down_awaiter< Executor >( *this, executor ); }
+
+        //! Names the lock profile used by this semaphore. Does nothing unless pLOCK_PROFILE.
+        /*!
+         * Only wait times are recorded. See lock_profile.hpp.
+         */
+        void set_profile_name( const char *name );
+
     private:
         boost::mutex lock;
         boost::condition_variable non_zero;
         int raw_count;
+
+        // Functions that resume coroutines waiting in down_async( ).
+        std::deque< std::function< void( ) > > async_waiters;
+
+        // Decrements the semaphore if possible and returns false. Otherwise records the
+        // waiter, to be called by up( ), and returns true.
+        bool wait_async( std::function< void( ) > resume );
+
+        #if defined(pLOCK_PROFILE)
+        lock_profile *profile = 0;
+        #endif
     };
 
 }
@@ -7,13 +7,26 @@
 #define SINGLELIST_HPP
 
 #include <cstddef>
+#include <functional>
 #include <initializer_list>
 #include <iterator>
+#include <memory>
+#include <type_traits>
 #include <utility>
 
 namespace spica {
 
-    template<typename T>
+    //! Singly linked list class template.
+    /*!
+     * Nodes are obtained from an allocator of type Allocator rebound to the node type. With a
+     * PoolAllocator the nodes are packed into large chunks and clear( ) releases the chunks
+     * without visiting the nodes (if the items have trivial destructors).
+     *
+     * The list keeps a pointer to its last node so push_back( ) takes constant time. Splicing,
+     * merging, and sorting relink the existing nodes; they never copy items or allocate memory.
+     * Nodes can only move between lists whose allocators compare equal.
+     */
+    template<typename T, typename Allocator = std::allocator<T>>
     class SingleList {
     public:
         // The usual typedef names.
@@ -24,6 +37,7 @@ namespace spica {
         typedef const T  &const_reference;
         typedef std::size_t    size_type;
         typedef std::ptrdiff_t difference_type;
+        typedef Allocator      allocator_type;
 
     private:
         // Each node in the list is an instance of structure Node.
@@ -31,21 +45,39 @@ namespace spica {
             T     data;  // The data item in this node.
             Node *next;  // Pointer to the next node in the list or nullptr if there are no others.
 
-            // Convenience constructor. Initializes the fields of Node by copy construction.
-            Node( const T &item, Node *p ) : data(item), next(p) { }
+            // Convenience constructor. Constructs the data item from the given arguments.
+            template<typename... Args>
+            Node( Node *p, Args &&...args ) : data( std::forward<Args>( args )... ), next(p) { }
         };
 
+        typedef typename std::allocator_traits<Allocator>::template rebind_alloc<Node> node_allocator;
+        typedef std::allocator_traits<node_allocator> node_traits;
+
         Node *head_node;  // Points at first element in list (or nullptr if list is empty).
         Node *last_node;  // Points at the last element in the list (or nullptr if list is empty).
         size_type count;  // The number of items in the list.
+        [[no_unique_address]] node_allocator node_alloc;
+
+        // Allocates and constructs a node, or deallocates it if the construction throws.
+        template<typename... Args>
+        Node *create_node( Node *next, Args &&...args );
+
+        // Destroys and deallocates every node.
+        void destroy_nodes( ) noexcept;
+
+        // Merges two sorted, null terminated chains of nodes. On ties the nodes of the first
+        // chain come first. Returns the head of the result and stores its last node in tail.
+        template<typename StrictWeakOrdering>
+        static Node *merge_nodes( Node *first, Node *second, StrictWeakOrdering &comp, Node *&tail );
 
     public:
         // Default constructor and destructor.
-        SingleList( );
+        explicit SingleList( const Allocator &allocator = Allocator( ) );
        ~SingleList( ) noexcept;
 
         // Initializer list constructor.
-        SingleList( const std::initializer_list<T> &initializers );
+        SingleList(
+            const std::initializer_list<T> &initializers, const Allocator &allocator = Allocator( ) );
 
         // Copy operations.
         SingleList( const SingleList &other );
@@ -99,11 +131,34 @@ namespace spica {
         //! Returns the number of items in the list.
         size_type size( ) const noexcept;
 
+        //! Returns a copy of the allocator.
+        allocator_type get_allocator( ) const
+            { return allocator_type( node_alloc ); }
+
+        //! Removes every item from the list.
+        void clear( ) noexcept;
+
         //! Adds item to the front of the list.
-        void push_front( const T &item );
+        void push_front( const T &item )
+            { emplace_front( item ); }
+
+        void push_front( T &&item )
+            { emplace_front( std::move( item ) ); }
 
         //! Adds item to the end of the list.
-        void push_back( const T &item );
+        void push_back( const T &item )
+            { emplace_back( item ); }
+
+        void push_back( T &&item )
+            { emplace_back( std::move( item ) ); }
+
+        //! Constructs an item from the given arguments at the front of the list. O(1)
+        template<typename... Args>
+        reference emplace_front( Args &&...args );
+
+        //! Constructs an item from the given arguments at the end of the list. O(1)
+        template<typename... Args>
+        reference emplace_back( Args &&...args );
 
         //! Inserts item before the iterator p. Returns iterator to the inserted item.
         // Note that insert requires a reference to an iterator (why?). Is that a problem?
@@ -114,6 +169,45 @@ namespace spica {
         template<typename InputIterator>
         iterator insert( iterator &p, InputIterator first, InputIterator last );
 
+        //! Moves all the items of other into this list before the iterator p. O(1)
+        /*!
+         * The other list is left empty and iterators into it are invalidated. Like insert,
+         * this updates p so that it remains valid; it still points at the same item (or just
+         * past the end). If the allocators of the two lists don't compare equal the effect is
+         * undefined.
+         */
+        void splice( iterator &p, SingleList &other ) noexcept;
+
+        //! Moves all the items of other into this list after the item at p. O(1)
+        /*!
+         * The iterator p must point at an item (it must not be end( )). Iterators to the item
+         * after p are invalidated. Otherwise this is the same as splice.
+         */
+        void splice_after( iterator p, SingleList &other ) noexcept;
+
+        //! Moves the items of the sorted list other into this sorted list. O(n + m)
+        /*!
+         * The result is sorted and other is left empty. The merge is stable: items of this list
+         * come before equal items of other. No items are copied. If the allocators of the two
+         * lists don't compare equal the effect is undefined.
+         */
+        void merge( SingleList &other )
+            { merge( other, std::less<T>( ) ); }
+
+        template<typename StrictWeakOrdering>
+        void merge( SingleList &other, StrictWeakOrdering comp );
+
+        //! Sorts the list. O(n lg(n))
+        /*!
+         * This is a stable bottom up merge sort. It relinks the nodes, so no items are copied
+         * or moved and no memory is allocated. Iterators into the list are invalidated.
+         */
+        void sort( )
+            { sort( std::less<T>( ) ); }
+
+        template<typename StrictWeakOrdering>
+        void sort( StrictWeakOrdering comp );
+
         //! Returns an iterator to the first item in the list.
         iterator begin( ) noexcept;
 
@@ -125,34 +219,92 @@ namespace spica {
     // IMPLEMENTATION BEGINS HERE!
     // ===========================
 
-    template<typename T>
-    SingleList<T>::SingleList( )
+    template<typename T, typename Allocator>
+    template<typename... Args>
+    typename SingleList<T, Allocator>::Node *
+        SingleList<T, Allocator>::create_node( Node *next, Args &&...args )
     {
-        head_node = nullptr;
-        last_node = nullptr;
-        count = 0;
+        Node *new_node = node_traits::allocate( node_alloc, 1 );
+        try {
+            node_traits::construct( node_alloc, new_node, next, std::forward<Args>( args )... );
+        }
+        catch( ... ) {
+            node_traits::deallocate( node_alloc, new_node, 1 );
+            throw;
+        }
+        return new_node;
     }
 
 
-    template<typename T>
-    SingleList<T>::~SingleList( ) noexcept
+    template<typename T, typename Allocator>
+    void SingleList<T, Allocator>::destroy_nodes( ) noexcept
     {
+        // If the allocator's pools belong to this list alone they can be released in one step.
+        if constexpr( std::is_trivially_destructible_v<Node> &&
+                      requires( node_allocator &a ) { a.release( ); } ) {
+            if( node_alloc.release( ) ) return;
+        }
+
         Node *current = head_node;
         while( current != nullptr ) {
             Node *temp = current->next;
-            delete current;
+            node_traits::destroy( node_alloc, current );
+            node_traits::deallocate( node_alloc, current, 1 );
             current = temp;
         }
     }
 
 
-    template<typename T>
-    SingleList<T>::SingleList( const std::initializer_list<T> &initializers )
+    template<typename T, typename Allocator>
+    template<typename StrictWeakOrdering>
+    typename SingleList<T, Allocator>::Node *SingleList<T, Allocator>::merge_nodes(
+        Node *first, Node *second, StrictWeakOrdering &comp, Node *&tail )
+    {
+        Node  *head = nullptr;
+        Node **link = &head;
+        Node  *last = nullptr;
+        while( first != nullptr && second != nullptr ) {
+            if( comp( second->data, first->data ) ) {
+                last = second;
+                second = second->next;
+            }
+            else {
+                last = first;
+                first = first->next;
+            }
+            *link = last;
+            link = &last->next;
+        }
+
+        // Attach what remains and find the end of it.
+        *link = ( first != nullptr ) ? first : second;
+        while( *link != nullptr ) {
+            last = *link;
+            link = &last->next;
+        }
+        tail = last;
+        return head;
+    }
+
+
+    template<typename T, typename Allocator>
+    SingleList<T, Allocator>::SingleList( const Allocator &allocator ) :
+        head_node( nullptr ), last_node( nullptr ), count( 0 ), node_alloc( allocator )
+    { }
+
+
+    template<typename T, typename Allocator>
+    SingleList<T, Allocator>::~SingleList( ) noexcept
+    {
+        destroy_nodes( );
+    }
+
+
+    template<typename T, typename Allocator>
+    SingleList<T, Allocator>::SingleList(
+        const std::initializer_list<T> &initializers, const Allocator &allocator ) :
+        head_node( nullptr ), last_node( nullptr ), count( 0 ), node_alloc( allocator )
     {
-        // Default construct the object.
-        head_node = nullptr;
-        last_node = nullptr;
-        count = 0;
 
         // Insert the individual items.
         iterator it = end( );
@@ -162,15 +314,14 @@ namespace spica {
     }
 
 
-    template<typename T>
-    SingleList<T>::SingleList( const SingleList &other )
+    template<typename T, typename Allocator>
+    SingleList<T, Allocator>::SingleList( const SingleList &other ) :
+        head_node( nullptr ),
+        last_node( nullptr ),
+        count( 0 ),
+        node_alloc( node_traits::select_on_container_copy_construction( other.node_alloc ) )
     {
-        // First, default construct myself.
-        head_node = nullptr;
-        last_node = nullptr;
-        count = 0;
-
-        // Next, loop over the other list and push_back its items onto myself.
+        // Loop over the other list and push_back its items onto myself.
         Node *current = other.head_node;
         while( current != nullptr ) {
             push_back( current->data );
@@ -179,12 +330,12 @@ namespace spica {
     }
 
 
-    template<typename T>
-    SingleList<T> &SingleList<T>::operator=( const SingleList &other )
+    template<typename T, typename Allocator>
+    SingleList<T, Allocator> &SingleList<T, Allocator>::operator=( const SingleList &other )
     {
         if( this != &other ) {
             // Copy the other value into a temporary list (for exception safety).
-            SingleList<T> temp_list( other );
+            SingleList temp_list( other );
 
             // It worked! Move the value from the temporary list into myself.
             *this = std::move( temp_list );
@@ -193,11 +344,12 @@ namespace spica {
     }
 
 
-    template<typename T>
-    SingleList<T>::SingleList( SingleList &&other ) noexcept :
+    template<typename T, typename Allocator>
+    SingleList<T, Allocator>::SingleList( SingleList &&other ) noexcept :
         head_node( other.head_node ),
         last_node( other.last_node ),
-        count( other.count )
+        count( other.count ),
+        node_alloc( std::move( other.node_alloc ) )
     {
         // Leave the other object destructable.
         other.head_node = nullptr;
@@ -206,16 +358,17 @@ namespace spica {
     }
 
 
-    template<typename T>
-    SingleList<T> &SingleList<T>::operator=( SingleList &&other ) noexcept
+    template<typename T, typename Allocator>
+    SingleList<T, Allocator> &SingleList<T, Allocator>::operator=( SingleList &&other ) noexcept
     {
         if( this != &other ) {
-            // Remove the value of the target object.
-            Node *current = head_node;
-            while( current != nullptr ) {
-                Node *temp = current->next;
-                delete current;
-                current = temp;
+            // Remove the value of the target object. The nodes of the other list must be
+            // freed by the other list's allocator, so the allocator is transferred as well.
+            // Allocators that don't propagate on move assignment are assumed to be equal.
+            //
+            destroy_nodes( );
+            if constexpr( node_traits::propagate_on_container_move_assignment::value ) {
+                node_alloc = std::move( other.node_alloc );
             }
 
             // Transfer the other value.
@@ -232,8 +385,8 @@ namespace spica {
     }
 
 
-    template<typename T>
-    typename SingleList<T>::iterator &SingleList<T>::iterator::operator++( ) noexcept
+    template<typename T, typename Allocator>
+    typename SingleList<T, Allocator>::iterator &SingleList<T, Allocator>::iterator::operator++( ) noexcept
     {
         previous = current;
         current = current->next;
@@ -241,8 +394,8 @@ namespace spica {
     }
 
 
-    template<typename T>
-    typename SingleList<T>::iterator SingleList<T>::iterator::operator++( int ) noexcept
+    template<typename T, typename Allocator>
+    typename SingleList<T, Allocator>::iterator SingleList<T, Allocator>::iterator::operator++( int ) noexcept
     {
         iterator copy = { object, previous, current };
         previous = current;
@@ -251,38 +404,49 @@ namespace spica {
     }
 
 
-    template<typename T>
-    inline bool SingleList<T>::iterator::operator==( const iterator &other ) const noexcept
+    template<typename T, typename Allocator>
+    inline bool SingleList<T, Allocator>::iterator::operator==( const iterator &other ) const noexcept
     {
         return (object == other.object && previous == other.previous && current == other.current);
     }
 
 
-    template<typename T>
-    inline typename SingleList<T>::reference SingleList<T>::iterator::operator*( ) const noexcept
+    template<typename T, typename Allocator>
+    inline typename SingleList<T, Allocator>::reference SingleList<T, Allocator>::iterator::operator*( ) const noexcept
     {
         return current->data;
     }
 
 
-    template<typename T>
-    inline typename SingleList<T>::pointer SingleList<T>::iterator::operator->( ) const noexcept
+    template<typename T, typename Allocator>
+    inline typename SingleList<T, Allocator>::pointer SingleList<T, Allocator>::iterator::operator->( ) const noexcept
     {
         return &current->data;
     }
 
 
-    template<typename T>
-    inline typename SingleList<T>::size_type SingleList<T>::size( ) const noexcept
+    template<typename T, typename Allocator>
+    inline typename SingleList<T, Allocator>::size_type SingleList<T, Allocator>::size( ) const noexcept
     {
         return count;
     }
 
 
-    template<typename T>
-    void SingleList<T>::push_front( const T &item )
+    template<typename T, typename Allocator>
+    void SingleList<T, Allocator>::clear( ) noexcept
     {
-        Node *new_node = new Node( item, head_node );
+        destroy_nodes( );
+        head_node = nullptr;
+        last_node = nullptr;
+        count = 0;
+    }
+
+
+    template<typename T, typename Allocator>
+    template<typename... Args>
+    typename SingleList<T, Allocator>::reference SingleList<T, Allocator>::emplace_front( Args &&...args )
+    {
+        Node *new_node = create_node( head_node, std::forward<Args>( args )... );
         if( head_node == nullptr ) {
             head_node = new_node;
             last_node = new_node;
@@ -292,13 +456,15 @@ namespace spica {
             head_node = new_node;
             count++;
         }
+        return new_node->data;
     }
 
 
-    template<typename T>
-    void SingleList<T>::push_back( const T &item )
+    template<typename T, typename Allocator>
+    template<typename... Args>
+    typename SingleList<T, Allocator>::reference SingleList<T, Allocator>::emplace_back( Args &&...args )
     {
-        Node *new_node = new Node( item, nullptr );
+        Node *new_node = create_node( nullptr, std::forward<Args>( args )... );
         if( last_node == nullptr ) {
             head_node = new_node;
             last_node = new_node;
@@ -309,13 +475,14 @@ namespace spica {
             last_node = new_node;
             count++;
         }
+        return new_node->data;
     }
 
 
-    template<typename T>
-    typename SingleList<T>::iterator SingleList<T>::insert( iterator &p, const T &item )
+    template<typename T, typename Allocator>
+    typename SingleList<T, Allocator>::iterator SingleList<T, Allocator>::insert( iterator &p, const T &item )
     {
-        Node *new_node = new Node( item, p.current );
+        Node *new_node = p.object->create_node( p.current, item );
         p.object->count++;
 
         if( p.previous == nullptr && p.current == nullptr ) {
@@ -349,9 +516,9 @@ namespace spica {
     }
 
 
-    template<typename T>
+    template<typename T, typename Allocator>
     template<typename InputIterator>
-    typename SingleList<T>::iterator SingleList<T>::insert(
+    typename SingleList<T, Allocator>::iterator SingleList<T, Allocator>::insert(
         iterator &p, InputIterator first, InputIterator last )
     {
         iterator result( p );
@@ -364,15 +531,101 @@ namespace spica {
     }
 
 
-    template<typename T>
-    typename SingleList<T>::iterator SingleList<T>::begin( ) noexcept
+    template<typename T, typename Allocator>
+    void SingleList<T, Allocator>::splice( iterator &p, SingleList &other ) noexcept
+    {
+        if( other.head_node == nullptr || &other == this ) return;
+
+        if( p.previous == nullptr ) head_node = other.head_node;
+        else p.previous->next = other.head_node;
+        other.last_node->next = p.current;
+        if( p.current == nullptr ) last_node = other.last_node;
+        p.previous = other.last_node;
+        count += other.count;
+
+        other.head_node = nullptr;
+        other.last_node = nullptr;
+        other.count = 0;
+    }
+
+
+    template<typename T, typename Allocator>
+    void SingleList<T, Allocator>::splice_after( iterator p, SingleList &other ) noexcept
+    {
+        iterator after( this, p.current, p.current->next );
+        splice( after, other );
+    }
+
+
+    template<typename T, typename Allocator>
+    template<typename StrictWeakOrdering>
+    void SingleList<T, Allocator>::merge( SingleList &other, StrictWeakOrdering comp )
+    {
+        if( &other == this || other.head_node == nullptr ) return;
+
+        Node *tail;
+        head_node = merge_nodes( head_node, other.head_node, comp, tail );
+        last_node = tail;
+        count += other.count;
+
+        other.head_node = nullptr;
+        other.last_node = nullptr;
+        other.count = 0;
+    }
+
+
+    //
+    // sort
+    //
+    // Nodes are taken from the front of the list one at a time. The sorted chain in bins[i],
+    // if there is one, has 2^i nodes; adding a node works like incrementing a binary counter,
+    // merging equal sized chains as it carries. Each node takes part in lg(n) merges of chains
+    // that are usually still in the cache, unlike a merge sort that makes lg(n) passes over the
+    // whole list. Older chains are always the first argument of merge_nodes so the sort is
+    // stable. Sixty-four bins are enough for any list that fits in memory.
+    //
+    template<typename T, typename Allocator>
+    template<typename StrictWeakOrdering>
+    void SingleList<T, Allocator>::sort( StrictWeakOrdering comp )
+    {
+        if( count < 2 ) return;
+
+        Node *bins[64] = { };
+        int   used = 0;     // Number of bins that might be occupied.
+        Node *tail;
+
+        while( head_node != nullptr ) {
+            Node *carry = head_node;
+            head_node = head_node->next;
+            carry->next = nullptr;
+
+            int i = 0;
+            for( ; i < used && bins[i] != nullptr; ++i ) {
+                carry = merge_nodes( bins[i], carry, comp, tail );
+                bins[i] = nullptr;
+            }
+            bins[i] = carry;
+            if( i == used ) ++used;
+        }
+
+        Node *result = nullptr;
+        for( int i = 0; i < used; ++i ) {
+            if( bins[i] != nullptr ) result = merge_nodes( bins[i], result, comp, tail );
+        }
+        head_node = result;
+        last_node = tail;
+    }
+
+
+    template<typename T, typename Allocator>
+    typename SingleList<T, Allocator>::iterator SingleList<T, Allocator>::begin( ) noexcept
     {
         return iterator( this, nullptr, head_node );
     }
 
 
-    template<typename T>
-    typename SingleList<T>::iterator SingleList<T>::end( ) noexcept
+    template<typename T, typename Allocator>
+    typename SingleList<T, Allocator>::iterator SingleList<T, Allocator>::end( ) noexcept
     {
         return iterator( this, last_node, nullptr );
     }
@@ -23,15 +23,46 @@ namespace spica {
             static_cast< ThreadPool::ThreadInformation * >( raw_info );
         try {
             while( 1 ) {
+                std::function< void( ) > posted;
+                bool assigned;
+
+                #if defined(pLOCK_PROFILE)
+                unsigned long long idle_start = profile_clock( );
+                lock_profile *profile;
+                #endif
+
                 {
                     boost::unique_lock< boost::mutex > guard( info->lock );
-                    while( info->fresh_work == false || info->fresh_result == true )
+                    for( ;; ) {
+                        assigned = ( info->fresh_work == true && info->fresh_result == false );
+                        if( assigned || info->pool->take_posted( posted ) ) break;
+                        info->idle = true;
                         info->work_ready.wait( guard );
+                    }
+                    info->idle = false;
+
+                    #if defined(pLOCK_PROFILE)
+                    profile = info->profile;
+                    #endif
                 }
 
-                info->launcher( info->raw_parameters );
+                #if defined(pLOCK_PROFILE)
+                unsigned long long work_start = profile_clock( );
+                if( profile != 0 ) profile->wait_times( ).record( work_start - idle_start );
+                #endif
 
-                {
+                if( assigned ) {
+                    info->launcher( info->raw_parameters );
+                }
+                else {
+                    posted( );
+                }
+
+                #if defined(pLOCK_PROFILE)
+                if( profile != 0 ) profile->hold_times( ).record( profile_clock( ) - work_start );
+                #endif
+
+                if( assigned ) {
                     boost::lock_guard< boost::mutex > guard( info->lock );
                     info->fresh_result = true;
                     info->result_ready.notify_all( );
@@ -51,7 +82,8 @@ namespace spica {
 
     // Initialize a ThreadInformation's members.
     ThreadPool::ThreadInformation::ThreadInformation( )
-        : launcher( 0 ), raw_parameters( 0 ), fresh_work( false ), fresh_result( false )
+        : pool( 0 ), launcher( 0 ), raw_parameters( 0 ), fresh_work( false ),
+          fresh_result( false ), idle( false )
     { }
 
 
@@ -62,14 +94,7 @@ namespace spica {
           synchronize_termination( boost::thread::hardware_concurrency( ) + 1 )
     {
         pool_size = boost::thread::hardware_concurrency( );
-
-        // Prepare the ThreadInformation structures.
-        thread_information = new ThreadInformation[pool_size];
-        for( int i = 0; i < pool_size; ++i ) {
-            thread_information[i].termination = &synchronize_termination;
-            thread_information[i].worker =
-                new boost::thread( dispatching_function, &thread_information[i] );
-        }
+        start_workers( );
     }
 
 
@@ -78,7 +103,20 @@ namespace spica {
         : worker_count( thread_count ), synchronize_termination( thread_count + 1 )
     {
         pool_size = thread_count;
+        start_workers( );
+    }
+
+
+    // Prepares the ThreadInformation structures and launches a worker for each.
+    void ThreadPool::start_workers( )
+    {
         thread_information = new ThreadInformation[pool_size];
+        for( int i = 0; i < pool_size; ++i ) {
+            thread_information[i].pool = this;
+            thread_information[i].termination = &synchronize_termination;
+            thread_information[i].worker =
+                new boost::thread( dispatching_function, &thread_information[i] );
+        }
     }
 
 
@@ -88,11 +126,16 @@ namespace spica {
     {
         for( auto info = thread_information; info != thread_information + pool_size; ++info ) {
             info->worker->interrupt( );
-            delete info->worker;
         }
 
         // Wait for all threads to process the interruption before removing thread_information.
+        // The workers might still be inside the barrier when it releases this thread so join
+        // them before the barrier is destroyed.
         synchronize_termination.wait( );
+        for( auto info = thread_information; info != thread_information + pool_size; ++info ) {
+            info->worker->join( );
+            delete info->worker;
+        }
         delete [] thread_information;
     }
 
@@ -117,4 +160,54 @@ namespace spica {
         worker_count.up( );
     }
 
+
+    // Queues the work and then wakes one idle worker. If every worker is busy, the work is
+    // picked up by the first one to finish. A worker checks for posted work while holding its
+    // own lock. Since the notification below is done while holding that same lock, a worker
+    // can't miss the work by starting to wait just after checking.
+    //
+    void ThreadPool::post( std::function< void( ) > work )
+    {
+        {
+            boost::lock_guard< boost::mutex > guard( posted_lock );
+            posted_work.push_back( std::move( work ) );
+        }
+
+        for( auto info = thread_information; info != thread_information + pool_size; ++info ) {
+            boost::lock_guard< boost::mutex > guard( info->lock );
+            if( info->idle ) {
+                info->idle = false;
+                info->work_ready.notify_one( );
+                break;
+            }
+        }
+    }
+
+
+    bool ThreadPool::take_posted( std::function< void( ) > &work )
+    {
+        boost::lock_guard< boost::mutex > guard( posted_lock );
+        if( posted_work.empty( ) ) return false;
+        work = std::move( posted_work.front( ) );
+        posted_work.pop_front( );
+        return true;
+    }
+
+
+    void ThreadPool::set_profile_name( const char *name )
+    {
+        #if defined(pLOCK_PROFILE)
+        std::string base( name );
+        worker_count.set_profile_name( ( base + ".available" ).c_str( ) );
+
+        lock_profile *profile = lock_profile::find( base + ".workers" );
+        for( int i = 0; i < pool_size; ++i ) {
+            boost::lock_guard< boost::mutex > guard( thread_information[i].lock );
+            thread_information[i].profile = profile;
+        }
+        #else
+        (void)name;
+        #endif
+    }
+
 }
@@ -3,15 +3,27 @@
  *  \author  Peter Chapin <spicacality@kelseymountain.org>
  *
  * The thread pool defined here uses boost::threads as the underlying thread API.
+ *
+ * Work can be given to the pool in two ways. The start_work methods assign work to a specific
+ * worker and the caller must later collect the result with work_result. The post method queues
+ * work that is not associated with any particular worker and that produces no result. Any
+ * worker that is not busy with assigned work runs posted work. A pool can thus be used as an
+ * executor for coroutines (see task.hpp).
  */
 
 #ifndef THREADPOOL_HPP
 #define THREADPOOL_HPP
 
+#include <deque>
+#include <functional>
 #include <vector>
 #include <boost/thread.hpp>
 #include "Semaphore.hpp"
 
+#if defined(pLOCK_PROFILE)
+#include "lock_profile.hpp"
+#endif
+
 namespace spica {
 
     // Templates to hold thread parameters
@@ -84,16 +96,22 @@ namespace spica {
 
         // Describes the state of one of the worker threads.
         struct ThreadInformation {
+            ThreadPool     *pool;            // The pool to which this worker belongs.
             boost::mutex   lock;             // Used to enforce mutual exclusion to this ThreadInformation.
             boost::thread *worker;           // Pointer to actual thread object for this slot.
             void   ( *launcher )( void * );  // Pointer to helper function that launches thread into its callable.
             void     *raw_parameters;        // Points at an object containing the callable and its params.
             bool      fresh_work;            // true when this worker thread has work ready (or being processed).
             bool      fresh_result;          // true when there is a new result to pick up.
+            bool      idle;                  // true when waiting and not yet asked to wake up.
             boost::barrier *termination;     // Points at object used to synchronize thread termination.
             boost::condition_variable work_ready;
             boost::condition_variable result_ready;
 
+            #if defined(pLOCK_PROFILE)
+            lock_profile *profile = 0;       // Wait = idle time, hold = time spent doing work.
+            #endif
+
             ThreadInformation( );
 
         private:
@@ -107,6 +125,15 @@ namespace spica {
         ThreadInformation *thread_information;
         boost::barrier     synchronize_termination;
 
+        boost::mutex       posted_lock;      // Protects posted_work.
+        std::deque< std::function< void( ) > > posted_work;
+
+        // Creates the worker threads.
+        void start_workers( );
+
+        // Removes the next posted function into work, if there is one. Returns false otherwise.
+        bool take_posted( std::function< void( ) > &work );
+
         // Disable copying.
         ThreadPool( const ThreadPool & );
         ThreadPool &operator=( const ThreadPool & );
@@ -134,6 +161,17 @@ namespace spica {
                                const Parameter2Type &parameter_2 );
 
         void work_result( threadid_t ID );
+
+        // Queues a function to be run by the next worker that is not busy with assigned work.
+        // The function's result, if any, is discarded and it should not throw exceptions.
+        // Functions that have not started when the pool is destroyed are never run.
+        void post( std::function< void( ) > work );
+
+        // Names the lock profiles used by this pool. Does nothing unless pLOCK_PROFILE. The
+        // workers record the time they spend idle as wait time and the time they spend doing
+        // work as hold time in the profile "name.workers". The time spent waiting for a free
+        // worker in start_work is recorded as wait time in the profile "name.available".
+        void set_profile_name( const char *name );
     };
 
 
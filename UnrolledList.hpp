@@ -0,0 +1,640 @@
+/*! \file   UnrolledList.hpp
+ *  \brief  Implementation of an unrolled singly linked list.
+ *  \author Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef UNROLLEDLIST_HPP
+#define UNROLLEDLIST_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace spica {
+
+    namespace detail {
+
+        // Number of items in an UnrolledList node of about 256 bytes.
+        template<typename T>
+        constexpr std::size_t unrolled_capacity =
+            std::max( std::size_t( 4 ), ( 256 - 2 * sizeof( void * ) ) / sizeof( T ) );
+
+    }
+
+    //! Unrolled singly linked list class template.
+    /*!
+     * An UnrolledList is a singly linked list in which each node holds up to N items in an
+     * array. Compared with SingleList, the pointer and allocation overhead is shared by N
+     * items, so a list of small items uses much less memory, and traversal visits items that
+     * are next to each other in memory. The default N gives nodes of about 256 bytes.
+     *
+     * Inserting into a full node splits it into two half full nodes. Erasing from a node that
+     * becomes less than half full takes items from the next node, or absorbs the next node
+     * if their items fit in one node. Appending to a full last node starts a new node rather
+     * than splitting, and so does prepending to a full first node, so a list built with
+     * push_back or push_front has full nodes. Thus every node except the first and the last
+     * is at least half full.
+     *
+     * The interface follows SingleList. Inserting or erasing an item moves other items in the
+     * same node (and in a neighboring node when nodes are split or merged), so T must be move
+     * constructible and move assignable, and iterators into those nodes are invalidated. The
+     * iterator given to insert or erase is updated to remain valid.
+     *
+     * Nodes are obtained from an allocator of type Allocator rebound to the node type. With a
+     * PoolAllocator the nodes are packed into large chunks and clear( ) releases the chunks
+     * without visiting the nodes (if the items have trivial destructors).
+     */
+    template<typename T,
+             std::size_t N = detail::unrolled_capacity<T>,
+             typename Allocator = std::allocator<T>>
+    class UnrolledList {
+
+        static_assert( N >= 2, "An UnrolledList node must hold at least two items" );
+
+    public:
+        // The usual typedef names.
+        typedef       T  value_type;
+        typedef       T *pointer;
+        typedef const T *const_pointer;
+        typedef       T  &reference;
+        typedef const T  &const_reference;
+        typedef std::size_t    size_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef Allocator      allocator_type;
+
+        //! The number of items in each node.
+        static const size_type node_capacity = N;
+
+    private:
+        // Each node holds up to N items in raw storage. Items [0, count) are constructed.
+        struct Node {
+            Node     *next;   // Pointer to the next node in the list or nullptr.
+            size_type count;  // Number of items in this node.
+            alignas( T ) unsigned char storage[N * sizeof( T )];
+
+            Node( ) : next( nullptr ), count( 0 ) { }
+
+            T *items( ) noexcept
+                { return std::launder( reinterpret_cast<T *>( storage ) ); }
+        };
+
+        typedef typename std::allocator_traits<Allocator>::template rebind_alloc<Node> node_allocator;
+        typedef std::allocator_traits<node_allocator> node_traits;
+
+        Node *head_node;  // Points at first node in list (or nullptr if list is empty).
+        Node *last_node;  // Points at the last node in the list (or nullptr if list is empty).
+        size_type count;  // The number of items in the list.
+        [[no_unique_address]] node_allocator node_alloc;
+
+        // Allocates an empty node and links it after the given node (or at the front).
+        Node *create_node( Node *previous );
+
+        // Destroys the items in a node, then destroys and deallocates the node.
+        void destroy_node( Node *node ) noexcept;
+
+        // Destroys and deallocates every node.
+        void destroy_nodes( ) noexcept;
+
+        // Constructs an item at the given index of a node that is not full, moving the items
+        // at and after that index up by one.
+        template<typename... Args>
+        static void construct_at( Node *node, size_type index, Args &&...args );
+
+        // Moves the items [start, count) of one node to the end of another node.
+        static void move_items( Node *from, size_type start, Node *to );
+
+        // Removes the first n items of a node, moving the others down.
+        static void remove_front( Node *node, size_type n );
+
+        // Splits a full node by moving its upper half into a new node after it.
+        Node *split( Node *node );
+
+    public:
+        // Default constructor and destructor.
+        explicit UnrolledList( const Allocator &allocator = Allocator( ) );
+       ~UnrolledList( ) noexcept;
+
+        // Initializer list constructor.
+        UnrolledList(
+            const std::initializer_list<T> &initializers, const Allocator &allocator = Allocator( ) );
+
+        // Copy operations.
+        UnrolledList( const UnrolledList &other );
+        UnrolledList &operator=( const UnrolledList &other );
+
+        // Move operations.
+        UnrolledList( UnrolledList &&other ) noexcept;
+        UnrolledList &operator=( UnrolledList &&other ) noexcept;
+
+        // Iterators for UnrolledList are ForwardIterators.
+        class iterator {
+
+            friend class UnrolledList;
+
+        public:
+            typedef std::forward_iterator_tag iterator_category;
+            typedef T                         value_type;
+            typedef T                        *pointer;
+            typedef T                        &reference;
+            typedef std::ptrdiff_t           difference_type;
+
+        private:
+            UnrolledList *object;    // The object into which this iterator points.
+            Node         *previous;  // The node just before the current node.
+            Node         *current;   // The current node. If nullptr this iterator is "just off the end."
+            size_type     index;     // The position of the item in the current node.
+
+            //! Private constructor can only be used by UnrolledList's methods.
+            iterator( UnrolledList *o, Node *p, Node *c, size_type i ) noexcept :
+                object(o), previous(p), current(c), index(i) { }
+
+        public:
+            //! Default constructor creates a NULL iterator.
+            iterator( ) noexcept :
+                object(nullptr), previous(nullptr), current(nullptr), index(0) { }
+
+            //! Preincrement: Advances iterator to next item and returns a reference to itself.
+            iterator &operator++( ) noexcept
+            {
+                if( ++index == current->count ) {
+                    previous = current;
+                    current = current->next;
+                    index = 0;
+                }
+                return *this;
+            }
+
+            //! Postincrement: Advances iterator to next item and returns original iterator.
+            iterator operator++( int ) noexcept
+                { iterator copy( *this ); ++*this; return copy; }
+
+            //! Returns true if *this and other point at the same object.
+            bool operator==( const iterator &other ) const noexcept
+                { return current == other.current && index == other.index; }
+
+            //! Returns a reference to the item the iterator is pointing at.
+            reference operator*( ) const noexcept
+                { return current->items( )[index]; }
+
+            //! Returns a pointer to the item the iterator is pointing at.
+            pointer operator->( ) const noexcept
+                { return &current->items( )[index]; }
+        };  // End of iterator class.
+
+        //! Returns the number of items in the list.
+        size_type size( ) const noexcept
+            { return count; }
+
+        //! Returns true if the list contains no items.
+        bool empty( ) const noexcept
+            { return count == 0; }
+
+        //! Returns a copy of the allocator.
+        allocator_type get_allocator( ) const
+            { return allocator_type( node_alloc ); }
+
+        //! Removes every item from the list.
+        void clear( ) noexcept;
+
+        //! Adds item to the front of the list.
+        void push_front( const T &item )
+            { emplace_front( item ); }
+
+        void push_front( T &&item )
+            { emplace_front( std::move( item ) ); }
+
+        //! Adds item to the end of the list.
+        void push_back( const T &item )
+            { emplace_back( item ); }
+
+        void push_back( T &&item )
+            { emplace_back( std::move( item ) ); }
+
+        //! Constructs an item from the given arguments at the front of the list. O(N)
+        template<typename... Args>
+        reference emplace_front( Args &&...args );
+
+        //! Constructs an item from the given arguments at the end of the list. O(1)
+        template<typename... Args>
+        reference emplace_back( Args &&...args );
+
+        //! Inserts item before the iterator p. Returns iterator to the inserted item. O(N)
+        /*!
+         * The iterator p is updated so that it still points at the same item (or just past
+         * the end).
+         */
+        iterator insert( iterator &p, const T &item );
+
+        //! Inserts sequence from [first, last) before the iterator p.
+        //  Returns iterator to last inserted item.
+        template<typename InputIterator>
+        iterator insert( iterator &p, InputIterator first, InputIterator last );
+
+        //! Erases the item at p. Returns an iterator to the following item. O(N)
+        /*!
+         * The iterator p must point at an item. It is invalidated. Items are moved to close
+         * the gap, so this function may throw if T's move operations throw.
+         */
+        iterator erase( iterator p );
+
+        //! Returns an iterator to the first item in the list.
+        iterator begin( ) noexcept
+            { return iterator( this, nullptr, head_node, 0 ); }
+
+        //! Returns an iterator just past the last time in the list.
+        iterator end( ) noexcept
+            { return iterator( this, last_node, nullptr, 0 ); }
+    };
+
+    // ===========================
+    // IMPLEMENTATION BEGINS HERE!
+    // ===========================
+
+    template<typename T, std::size_t N, typename Allocator>
+    typename UnrolledList<T, N, Allocator>::Node *
+        UnrolledList<T, N, Allocator>::create_node( Node *previous )
+    {
+        Node *new_node = node_traits::allocate( node_alloc, 1 );
+        node_traits::construct( node_alloc, new_node );
+        if( previous == nullptr ) {
+            new_node->next = head_node;
+            head_node = new_node;
+        }
+        else {
+            new_node->next = previous->next;
+            previous->next = new_node;
+        }
+        if( last_node == previous ) last_node = new_node;
+        return new_node;
+    }
+
+
+    template<typename T, std::size_t N, typename Allocator>
+    void UnrolledList<T, N, Allocator>::destroy_node( Node *node ) noexcept
+    {
+        std::destroy_n( node->items( ), node->count );
+        node_traits::destroy( node_alloc, node );
+        node_traits::deallocate( node_alloc, node, 1 );
+    }
+
+
+    template<typename T, std::size_t N, typename Allocator>
+    void UnrolledList<T, N, Allocator>::destroy_nodes( ) noexcept
+    {
+        // If the allocator's pools belong to this list alone they can be released in one step.
+        if constexpr( std::is_trivially_destructible_v<T> &&
+                      requires( node_allocator &a ) { a.release( ); } ) {
+            if( node_alloc.release( ) ) return;
+        }
+
+        Node *current = head_node;
+        while( current != nullptr ) {
+            Node *temp = current->next;
+            destroy_node( current );
+            current = temp;
+        }
+    }
+
+
+    //
+    // construct_at
+    //
+    // The new item is constructed before anything is moved in case the arguments refer to an
+    // item in the node. If that construction throws, the node is unchanged.
+    //
+    template<typename T, std::size_t N, typename Allocator>
+    template<typename... Args>
+    void UnrolledList<T, N, Allocator>::construct_at( Node *node, size_type index, Args &&...args )
+    {
+        T *items = node->items( );
+        if( index == node->count ) {
+            new ( &items[index] ) T( std::forward<Args>( args )... );
+        }
+        else {
+            T temp( std::forward<Args>( args )... );
+            new ( &items[node->count] ) T( std::move( items[node->count - 1] ) );
+            std::move_backward( items + index, items + node->count - 1, items + node->count );
+            items[index] = std::move( temp );
+        }
+        ++node->count;
+    }
+
+
+    template<typename T, std::size_t N, typename Allocator>
+    void UnrolledList<T, N, Allocator>::move_items( Node *from, size_type start, Node *to )
+    {
+        T *source = from->items( );
+        T *target = to->items( );
+        for( size_type i = start; i < from->count; ++i ) {
+            new ( &target[to->count] ) T( std::move( source[i] ) );
+            ++to->count;
+        }
+        std::destroy( source + start, source + from->count );
+        from->count = start;
+    }
+
+
+    template<typename T, std::size_t N, typename Allocator>
+    void UnrolledList<T, N, Allocator>::remove_front( Node *node, size_type n )
+    {
+        T *items = node->items( );
+        std::move( items + n, items + node->count, items );
+        std::destroy( items + node->count - n, items + node->count );
+        node->count -= n;
+    }
+
+
+    template<typename T, std::size_t N, typename Allocator>
+    typename UnrolledList<T, N, Allocator>::Node *
+        UnrolledList<T, N, Allocator>::split( Node *node )
+    {
+        Node *new_node = create_node( node );
+        move_items( node, N / 2, new_node );
+        return new_node;
+    }
+
+
+    template<typename T, std::size_t N, typename Allocator>
+    UnrolledList<T, N, Allocator>::UnrolledList( const Allocator &allocator ) :
+        head_node( nullptr ), last_node( nullptr ), count( 0 ), node_alloc( allocator )
+    { }
+
+
+    template<typename T, std::size_t N, typename Allocator>
+    UnrolledList<T, N, Allocator>::~UnrolledList( ) noexcept
+    {
+        destroy_nodes( );
+    }
+
+
+    template<typename T, std::size_t N, typename Allocator>
+    UnrolledList<T, N, Allocator>::UnrolledList(
+        const std::initializer_list<T> &initializers, const Allocator &allocator ) :
+        head_node( nullptr ), last_node( nullptr ), count( 0 ), node_alloc( allocator )
+    {
+        try {
+            for( const T &item : initializers ) {
+                push_back( item );
+            }
+        }
+        catch( ... ) {
+            destroy_nodes( );
+            throw;
+        }
+    }
+
+
+    template<typename T, std::size_t N, typename Allocator>
+    UnrolledList<T, N, Allocator>::UnrolledList( const UnrolledList &other ) :
+        head_node( nullptr ),
+        last_node( nullptr ),
+        count( 0 ),
+        node_alloc( node_traits::select_on_container_copy_construction( other.node_alloc ) )
+    {
+        // Loop over the other list and push_back its items onto myself.
+        try {
+            for( Node *current = other.head_node; current != nullptr; current = current->next ) {
+                for( size_type i = 0; i < current->count; ++i ) {
+                    push_back( current->items( )[i] );
+                }
+            }
+        }
+        catch( ... ) {
+            destroy_nodes( );
+            throw;
+        }
+    }
+
+
+    template<typename T, std::size_t N, typename Allocator>
+    UnrolledList<T, N, Allocator> &UnrolledList<T, N, Allocator>::operator=( const UnrolledList &other )
+    {
+        if( this != &other ) {
+            // Copy the other value into a temporary list (for exception safety).
+            UnrolledList temp_list( other );
+
+            // It worked! Move the value from the temporary list into myself.
+            *this = std::move( temp_list );
+        }
+        return *this;
+    }
+
+
+    template<typename T, std::size_t N, typename Allocator>
+    UnrolledList<T, N, Allocator>::UnrolledList( UnrolledList &&other ) noexcept :
+        head_node( other.head_node ),
+        last_node( other.last_node ),
+        count( other.count ),
+        node_alloc( std::move( other.node_alloc ) )
+    {
+        // Leave the other object destructable.
+        other.head_node = nullptr;
+        other.last_node = nullptr;
+        other.count = 0;
+    }
+
+
+    template<typename T, std::size_t N, typename Allocator>
+    UnrolledList<T, N, Allocator> &UnrolledList<T, N, Allocator>::operator=( UnrolledList &&other ) noexcept
+    {
+        if( this != &other ) {
+            // Remove the value of the target object. The nodes of the other list must be
+            // freed by the other list's allocator, so the allocator is transferred as well.
+            // Allocators that don't propagate on move assignment are assumed to be equal.
+            //
+            destroy_nodes( );
+            if constexpr( node_traits::propagate_on_container_move_assignment::value ) {
+                node_alloc = std::move( other.node_alloc );
+            }
+
+            // Transfer the other value.
+            head_node = other.head_node;
+            last_node = other.last_node;
+            count = other.count;
+
+            // Leave the other object destructable.
+            other.head_node = nullptr;
+            other.last_node = nullptr;
+            other.count = 0;
+        }
+        return *this;
+    }
+
+
+    template<typename T, std::size_t N, typename Allocator>
+    void UnrolledList<T, N, Allocator>::clear( ) noexcept
+    {
+        destroy_nodes( );
+        head_node = nullptr;
+        last_node = nullptr;
+        count = 0;
+    }
+
+
+    template<typename T, std::size_t N, typename Allocator>
+    template<typename... Args>
+    typename UnrolledList<T, N, Allocator>::reference UnrolledList<T, N, Allocator>::emplace_front( Args &&...args )
+    {
+        // A full first node gets a new node in front of it rather than being split, so items
+        // added with push_front also fill their nodes.
+        bool fresh = ( head_node == nullptr || head_node->count == N );
+        if( fresh ) create_node( nullptr );
+        try {
+            construct_at( head_node, 0, std::forward<Args>( args )... );
+        }
+        catch( ... ) {
+            if( fresh ) {
+                Node *empty_node = head_node;
+                head_node = empty_node->next;
+                if( last_node == empty_node ) last_node = nullptr;
+                destroy_node( empty_node );
+            }
+            throw;
+        }
+        ++count;
+        return head_node->items( )[0];
+    }
+
+
+    template<typename T, std::size_t N, typename Allocator>
+    template<typename... Args>
+    typename UnrolledList<T, N, Allocator>::reference UnrolledList<T, N, Allocator>::emplace_back( Args &&...args )
+    {
+        Node *previous = last_node;
+        bool  fresh = ( last_node == nullptr || last_node->count == N );
+        if( fresh ) create_node( last_node );
+        try {
+            construct_at( last_node, last_node->count, std::forward<Args>( args )... );
+        }
+        catch( ... ) {
+            if( fresh ) {
+                Node *empty_node = last_node;
+                if( previous == nullptr ) head_node = nullptr;
+                else previous->next = nullptr;
+                last_node = previous;
+                destroy_node( empty_node );
+            }
+            throw;
+        }
+        ++count;
+        return last_node->items( )[last_node->count - 1];
+    }
+
+
+    template<typename T, std::size_t N, typename Allocator>
+    typename UnrolledList<T, N, Allocator>::iterator UnrolledList<T, N, Allocator>::insert( iterator &p, const T &item )
+    {
+        UnrolledList *list = p.object;
+        if( p.current == nullptr ) {
+            // p points just past the end. It remains there. If a new node was started, the
+            // old last node is its predecessor. Otherwise the item went into the last node
+            // after at least one other item and the predecessor of that node is not known.
+            // It is not needed: erase uses previous only when a node becomes empty, and the
+            // item at index 0 of this node can't be reached from the returned iterator.
+            Node *old_last = list->last_node;
+            list->emplace_back( item );
+            Node *last = list->last_node;
+            p.previous = last;
+            return iterator( list, ( last == old_last ) ? nullptr : old_last, last, last->count - 1 );
+        }
+
+        Node     *target   = p.current;
+        Node     *previous = p.previous;
+        size_type index    = p.index;
+        if( target->count == N ) {
+            // Splitting moves items, and item might be one of them, so copy it first.
+            T temp( item );
+            Node *upper = list->split( target );
+            if( index >= N / 2 ) {
+                previous = target;
+                target = upper;
+                index -= N / 2;
+            }
+            construct_at( target, index, std::move( temp ) );
+        }
+        else {
+            construct_at( target, index, item );
+        }
+        list->count++;
+
+        // The item p pointed at is now just after the new item, in the same node.
+        p.previous = previous;
+        p.current = target;
+        p.index = index + 1;
+        return iterator( list, previous, target, index );
+    }
+
+
+    template<typename T, std::size_t N, typename Allocator>
+    template<typename InputIterator>
+    typename UnrolledList<T, N, Allocator>::iterator UnrolledList<T, N, Allocator>::insert(
+        iterator &p, InputIterator first, InputIterator last )
+    {
+        iterator result( p );
+
+        while( first != last ) {
+            result = insert( p, *first );
+            ++first;
+        }
+        return result;
+    }
+
+
+    //
+    // erase
+    //
+    // A node that falls below half full is refilled from the next node: the two are merged if
+    // their items fit in one node, otherwise items are moved over until this node is half
+    // full. Either way the items that follow the erased item stay in order after index p.index,
+    // so the result is found there. The last node may be less than half full, and it is removed
+    // when it becomes empty.
+    //
+    template<typename T, std::size_t N, typename Allocator>
+    typename UnrolledList<T, N, Allocator>::iterator UnrolledList<T, N, Allocator>::erase( iterator p )
+    {
+        UnrolledList *list = p.object;
+        Node *node = p.current;
+        T    *items = node->items( );
+        std::move( items + p.index + 1, items + node->count, items + p.index );
+        std::destroy_at( &items[node->count - 1] );
+        --node->count;
+        list->count--;
+
+        Node *next = node->next;
+        if( node->count < N / 2 && next != nullptr ) {
+            if( node->count + next->count <= N ) {
+                move_items( next, 0, node );
+                node->next = next->next;
+                if( list->last_node == next ) list->last_node = node;
+                list->destroy_node( next );
+            }
+            else {
+                size_type needed = N / 2 - node->count;
+                for( size_type i = 0; i < needed; ++i ) {
+                    new ( &items[node->count] ) T( std::move( next->items( )[i] ) );
+                    ++node->count;
+                }
+                remove_front( next, needed );
+            }
+        }
+        else if( node->count == 0 ) {
+            // This was the last node.
+            if( p.previous == nullptr ) list->head_node = nullptr;
+            else p.previous->next = nullptr;
+            list->last_node = p.previous;
+            list->destroy_node( node );
+            return list->end( );
+        }
+
+        if( p.index < node->count ) return iterator( list, p.previous, node, p.index );
+        return iterator( list, node, node->next, 0 );
+    }
+
+}
+
+#endif
@@ -4,11 +4,20 @@
  *
  * This class facilitates thread communication. One thread can add entities to the queue while
  * another takes entities off the queue. This is the classic producer/consumer problem. This
- * solution uses the library queue template to provide a large work area. The constructor
+ * solution uses the library deque template to provide a large work area. The constructor
  * function sets a maximum size to prevent a very fast producer thread from overwhelming a slow
  * consumer thread and filling memory with queued work. This code works correctly when there are
  * multiple producers or multiple consumers.
  *
+ * The deque stores its elements in fixed size blocks so, unlike a list, it does not allocate
+ * memory for every item pushed. Programs that move a large number of small items through the
+ * queue should use the bulk operations. They transfer many items while paying for the locking
+ * overhead only once.
+ *
+ * Coroutines can take items from the queue with co_await queue.pop_async( executor ). A
+ * coroutine that finds the queue empty is suspended without blocking its thread. The next item
+ * pushed is handed directly to it and it is resumed on the executor. See task.hpp.
+ *
  * This code is exception safe in the sense that if an exception is thrown during either the
  * push or pop operations the threads will release any locks that they own and leave the queue
  * in a consistent state. This code currently does very little error checking on the various
@@ -19,20 +28,31 @@
 #define WORKQUEUE_H
 
 #include "environ.hpp"
-#include <list>
-#include <queue>
+#include <climits>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
 #include "synchronize.hpp"
 
 namespace spica {
 
     template< typename T > class WorkQueue {
     public:
-        WorkQueue( int max_size );
+        WorkQueue( int max_size, int spin_limit = 0 );
         // Although the queue grows and shrinks dynamically, max_size sets an upper bound on the
         // size of the queue. This is to prevent a fast producer thread from filling all of
-        // memory with unprocessed queue elements.
+        // memory with unprocessed queue elements. The spin limit is given to the internal
+        // semaphores. See mutex_sem for more information.
 
         void push( const T & );
+        void push(       T && );
         void pop (       T & );
         // The obvious operations. The push() function blocks if the queue is full and waits for
         // a free slot to become available. The pop() function blocks if the queue is empty and
@@ -42,7 +62,43 @@ namespace spica {
         // element and removes it from the queue. This was done to minimize locking overhead. It
         // does mean, however, that if an error occurs during the copy of the object, the object
         // might be lost. (That won't happen if the copy operation throws an exception on error.
-        // In that case the original object is left on the queue).
+        // In that case the original object is left on the queue). Objects are moved out of the
+        // queue when T's move assignment can't throw; otherwise they are copied.
+
+        template< typename... Args > void emplace( Args &&... args );
+        // Like push() except that the new item is constructed in place from the arguments.
+
+        bool try_pop( T & );
+        bool pop_for( T &, long milliseconds );
+        // Like pop() except that try_pop() returns false at once if the queue is empty and
+        // pop_for() returns false if nothing arrives before the timeout expires. Both return
+        // true if an item was removed from the queue.
+
+        template< typename Executor > class pop_awaiter;
+
+        template< typename Executor > pop_awaiter< Executor > pop_async( Executor &executor );
+        // Returns an awaitable that removes the next item from the queue. The result of the
+        // co_await expression is the item. If the queue is empty the coroutine is suspended
+        // until an item arrives and then resumed on the executor. Suspended coroutines are
+        // served before threads blocked in pop().
+
+        template< typename InputIterator >
+        InputIterator push_bulk( InputIterator first, InputIterator last );
+        // Pushes as many items from [first, last) as there are free slots, taking the lock only
+        // once. Blocks if the queue is full until at least one slot is free. Returns an
+        // iterator to the first item not pushed (last if everything was pushed). Pass move
+        // iterators to move the items into the queue.
+
+        template< typename OutputIterator >
+        std::size_t pop_bulk( OutputIterator destination, std::size_t max_count );
+        // Pops up to max_count items, taking the lock only once, and writes them to
+        // destination. Blocks if the queue is empty until at least one item arrives. Returns
+        // the number of items popped.
+
+        void set_profile_name( const std::string &name );
+        // Names the lock profiles of the internal semaphores "name.mutex", "name.free_slots",
+        // and "name.used_slots". Does nothing unless pLOCK_PROFILE is defined. See
+        // lock_profile.hpp.
 
         int size( );
         // Returns the number of items waiting in the queue.
@@ -51,13 +107,44 @@ namespace spica {
         // Returns true if there is nothing in the queue.
 
     private:
-        typedef std::list< T > supporting_container;
+        typedef std::deque< T > supporting_container;
+
+        // A coroutine waiting in pop_async( ).
+        struct async_waiter {
+            std::optional< T >      *slot;    // Where the item goes.
+            std::function< void( ) > resume;  // Posts the coroutine to its executor.
+        };
 
-        std::queue< T, supporting_container > the_queue;
+        supporting_container the_queue;
+        std::deque< async_waiter > async_waiters;
         mutex_sem     mutex;
         counting_sem  free_slots;
         counting_sem  used_slots;
 
+        // Removes the front item into outgoing. The caller must hold the mutex.
+        void take_front( T &outgoing );
+
+        // Adds an item, constructed from the arguments, to the queue or gives it to the first
+        // asynchronous waiter. The caller must have reserved a free slot.
+        template< typename... Args > void put( Args &&... args );
+
+    public:
+        template< typename Executor > class pop_awaiter {
+        public:
+            pop_awaiter( WorkQueue &q, Executor &e ) : queue( q ), executor( e ) { }
+
+            bool await_ready( ) { return false; }
+            bool await_suspend( std::coroutine_handle< > waiting );
+            T    await_resume( ) { return std::move( *result ); }
+
+        private:
+            WorkQueue         &queue;
+            Executor          &executor;
+            std::optional< T > result;
+        };
+
+    private:
+
         // Make copying WorkQueues illegal.
         WorkQueue( const WorkQueue< T > & );
         WorkQueue< T > &operator=( const WorkQueue< T > & );
@@ -70,11 +157,30 @@ namespace spica {
     // This function initializes the syncronization primitives needed to make this work. Do not
     // attempt to use a WorkQueue object until the thread calling its constructor has returned.
     //
-    template< typename T > inline WorkQueue< T >::WorkQueue( int max_size ) :
-        free_slots( max_size ), used_slots( 0 )
+    template< typename T > inline WorkQueue< T >::WorkQueue( int max_size, int spin_limit ) :
+        mutex( spin_limit ), free_slots( max_size, spin_limit ), used_slots( 0, spin_limit )
     { }
 
 
+    //
+    // void WorkQueue<T>::take_front(T &outgoing)
+    //
+    // Moves the item at the front of the queue into outgoing and removes it. If T's move
+    // assignment might throw, the item is copied instead so that a failure leaves it on the
+    // queue.
+    //
+    template< typename T > inline void WorkQueue< T >::take_front( T &outgoing )
+    {
+        if constexpr( std::is_nothrow_move_assignable_v< T > ) {
+            outgoing = std::move( the_queue.front( ) );
+        }
+        else {
+            outgoing = the_queue.front( );
+        }
+        the_queue.pop_front( );
+    }
+
+
     //
     // void WorkQueue<T>::push(const T &incoming)
     //
@@ -86,23 +192,78 @@ namespace spica {
     //
     // Here I assume that if push throws an exception, the incoming object is not left on the
     // queue in some sort of partially copied state. How true this is will depend on the
-    // exception safety of the library queue class.
+    // exception safety of the library deque class.
     //
     template< typename T > void WorkQueue< T >::push( const T &incoming )
     {
         free_slots.down( );
+        put( incoming );
+    }
+
+
+    //
+    // void WorkQueue<T>::push(T &&incoming)
+    //
+    // As above except that the incoming object is moved onto the queue.
+    //
+    template< typename T > void WorkQueue< T >::push( T &&incoming )
+    {
+        free_slots.down( );
+        put( std::move( incoming ) );
+    }
+
+
+    //
+    // void WorkQueue<T>::emplace(Args &&... args)
+    //
+    // As above except that the new object is constructed directly in the queue.
+    //
+    template< typename T >
+    template< typename... Args > void WorkQueue< T >::emplace( Args &&... args )
+    {
+        free_slots.down( );
+        put( std::forward< Args >( args )... );
+    }
+
+
+    //
+    // void WorkQueue<T>::put(Args &&... args)
+    //
+    // Does the work of push() after a slot has been reserved. If a coroutine is waiting for an
+    // item, the new item goes directly into the waiter's result and its slot is released at
+    // once. Otherwise the item is added to the queue. The used slot count is incremented while
+    // the mutex is held so that pop_async() sees a count that agrees with the queue.
+    //
+    template< typename T >
+    template< typename... Args > void WorkQueue< T >::put( Args &&... args )
+    {
+        std::function< void( ) > resume;
         {
             mutex_sem::grabber critical( mutex );
-            try { the_queue.push( incoming ); }
+            try {
+                if( async_waiters.empty( ) ) {
+                    the_queue.emplace_back( std::forward< Args >( args )... );
+                    used_slots.up( );
+                }
+                else {
+                    async_waiter &waiter = async_waiters.front( );
+                    waiter.slot->emplace( std::forward< Args >( args )... );
+                    resume = std::move( waiter.resume );
+                    async_waiters.pop_front( );
+                }
+            }
             catch( ... ) {
                 free_slots.up( );
                 throw;
             }
         }
-        used_slots.up( );
+        if( resume ) {
+            free_slots.up( );
+            resume( );
+        }
     }
 
-    
+
     //
     // void WorkQueue<T>::pop(T &outgoing)
     //
@@ -119,8 +280,7 @@ namespace spica {
         {
             mutex_sem::grabber critical( mutex );
             try {
-                outgoing = the_queue.front( );
-                the_queue.pop( );
+                take_front( outgoing );
             }
             catch( ... ) {
                 used_slots.up( );
@@ -131,6 +291,216 @@ namespace spica {
     }
 
 
+    //
+    // bool WorkQueue<T>::try_pop(T &outgoing)
+    //
+    // Like pop() except that it never blocks. Returns false if the queue is empty.
+    //
+    template< typename T > bool WorkQueue< T >::try_pop( T &outgoing )
+    {
+        if( !used_slots.try_down( ) ) return false;
+        {
+            mutex_sem::grabber critical( mutex );
+            try {
+                take_front( outgoing );
+            }
+            catch( ... ) {
+                used_slots.up( );
+                throw;
+            }
+        }
+        free_slots.up( );
+        return true;
+    }
+
+
+    //
+    // bool WorkQueue<T>::pop_for(T &outgoing, long milliseconds)
+    //
+    // Like pop() except that it gives up if nothing arrives in the given time. Returns false in
+    // that case.
+    //
+    template< typename T > bool WorkQueue< T >::pop_for( T &outgoing, long milliseconds )
+    {
+        if( !used_slots.down_for( milliseconds ) ) return false;
+        {
+            mutex_sem::grabber critical( mutex );
+            try {
+                take_front( outgoing );
+            }
+            catch( ... ) {
+                used_slots.up( );
+                throw;
+            }
+        }
+        free_slots.up( );
+        return true;
+    }
+
+
+    //
+    // pop_awaiter<Executor> WorkQueue<T>::pop_async(Executor &executor)
+    //
+    // Creates the awaitable. All the work is done when it is awaited.
+    //
+    template< typename T >
+    template< typename Executor >
+    inline typename WorkQueue< T >::template pop_awaiter< Executor >
+        WorkQueue< T >::pop_async( Executor &executor )
+    {
+        return pop_awaiter< Executor >( *this, executor );
+    }
+
+
+    //
+    // bool WorkQueue<T>::pop_awaiter<Executor>::await_suspend(std::coroutine_handle<> waiting)
+    //
+    // Takes an item at once if one is available and returns false so that the coroutine
+    // continues without suspending. Otherwise it registers the coroutine as a waiter. Since
+    // push() checks for waiters while holding the mutex, no item can slip past a waiter.
+    //
+    template< typename T >
+    template< typename Executor >
+    bool WorkQueue< T >::pop_awaiter< Executor >::await_suspend( std::coroutine_handle< > waiting )
+    {
+        {
+            mutex_sem::grabber critical( queue.mutex );
+            if( !queue.used_slots.try_down( ) ) {
+                Executor *target = &executor;
+                queue.async_waiters.push_back( async_waiter{
+                    &result, [target, waiting]( ) { target->post( [waiting]( ) { waiting.resume( ); } ); } } );
+                return true;
+            }
+            try {
+                result.emplace( std::move( queue.the_queue.front( ) ) );
+                queue.the_queue.pop_front( );
+            }
+            catch( ... ) {
+                queue.used_slots.up( );
+                throw;
+            }
+        }
+        queue.free_slots.up( );
+        return false;
+    }
+
+
+    //
+    // InputIterator WorkQueue<T>::push_bulk(InputIterator first, InputIterator last)
+    //
+    // Reserves as many free slots as it can (up to the length of the input sequence) and then
+    // pushes that many items while holding the lock once. If an exception occurs part way
+    // through, the items already pushed remain on the queue and the unused reservations are
+    // returned.
+    //
+    template< typename T >
+    template< typename InputIterator >
+    InputIterator WorkQueue< T >::push_bulk( InputIterator first, InputIterator last )
+    {
+        if( first == last ) return first;
+
+        // The distance isn't known for input iterators. In that case reserve as much as the
+        // queue allows and give back whatever isn't used.
+        int limit = INT_MAX;
+        typedef typename std::iterator_traits< InputIterator >::iterator_category category;
+        if constexpr( std::is_base_of_v< std::forward_iterator_tag, category > ) {
+            auto distance = std::distance( first, last );
+            if( distance < INT_MAX ) limit = static_cast< int >( distance );
+        }
+        int reserved = free_slots.down_some( limit );
+        int pushed   = 0;  // Number of items taken from the input sequence.
+        int queued   = 0;  // Number of those items that went into the queue.
+        std::vector< std::function< void( ) > > resumes;
+        {
+            mutex_sem::grabber critical( mutex );
+            try {
+                while( pushed < reserved && first != last ) {
+                    if( async_waiters.empty( ) ) {
+                        the_queue.push_back( *first );
+                        ++queued;
+                    }
+                    else {
+                        async_waiter &waiter = async_waiters.front( );
+                        waiter.slot->emplace( *first );
+                        resumes.push_back( std::move( waiter.resume ) );
+                        async_waiters.pop_front( );
+                    }
+                    ++first;
+                    ++pushed;
+                }
+            }
+            catch( ... ) {
+                used_slots.up( queued );
+                critical.unlock( );
+                free_slots.up( reserved - queued );
+                for( std::function< void( ) > &resume : resumes ) resume( );
+                throw;
+            }
+            used_slots.up( queued );
+        }
+        free_slots.up( reserved - queued );
+        for( std::function< void( ) > &resume : resumes ) resume( );
+        return first;
+    }
+
+
+    //
+    // std::size_t WorkQueue<T>::pop_bulk(OutputIterator destination, std::size_t max_count)
+    //
+    // Claims as many items as are available (up to max_count) and pops them while holding the
+    // lock once. If an exception occurs part way through, the items not yet popped remain on
+    // the queue.
+    //
+    template< typename T >
+    template< typename OutputIterator >
+    std::size_t WorkQueue< T >::pop_bulk( OutputIterator destination, std::size_t max_count )
+    {
+        if( max_count == 0 ) return 0;
+
+        int limit   = ( max_count > static_cast< std::size_t >( INT_MAX ) ) ?
+                          INT_MAX : static_cast< int >( max_count );
+        int claimed = used_slots.down_some( limit );
+        int popped  = 0;
+        {
+            mutex_sem::grabber critical( mutex );
+            try {
+                while( popped < claimed ) {
+                    if constexpr( std::is_nothrow_move_assignable_v< T > ) {
+                        *destination = std::move( the_queue.front( ) );
+                    }
+                    else {
+                        *destination = the_queue.front( );
+                    }
+                    ++destination;
+                    the_queue.pop_front( );
+                    ++popped;
+                }
+            }
+            catch( ... ) {
+                critical.unlock( );
+                used_slots.up( claimed - popped );
+                free_slots.up( popped );
+                throw;
+            }
+        }
+        free_slots.up( popped );
+        return static_cast< std::size_t >( popped );
+    }
+
+
+    //
+    // void WorkQueue<T>::set_profile_name(const std::string &name)
+    //
+    // Tags the semaphores with names derived from the given name. Several queues can share a
+    // name; their statistics are then combined.
+    //
+    template< typename T > void WorkQueue< T >::set_profile_name( const std::string &name )
+    {
+        mutex.set_profile_name( ( name + ".mutex" ).c_str( ) );
+        free_slots.set_profile_name( ( name + ".free_slots" ).c_str( ) );
+        used_slots.set_profile_name( ( name + ".used_slots" ).c_str( ) );
+    }
+
 
     //
     // int WorkQueue<T>::size()
@@ -0,0 +1,103 @@
+/*! \file    bounded_list_speed.cpp
+ *  \brief   Measures BoundedList iteration speed before and after compaction.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ *
+ * This file contains a program that fills a BoundedList with N items and then churns it by
+ * erasing N items at random and appending replacements, so that the order of the list no
+ * longer matches the order of the items in memory. It reports the time for PASS_COUNT passes
+ * over the churned list, the time to compact the list, and the time for PASS_COUNT passes over
+ * the compacted list. This is done with both 64 bit and 32 bit link indices. The value of N can
+ * be given on the command line; the default is 1000000. Build with something like:
+ *
+ *     g++ -std=c++20 -O2 -I. bench/bounded_list_speed.cpp Timer.cpp -o bounded_list_speed
+ */
+
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "BoundedList.hpp"
+#include "Timer.hpp"
+
+// Default number of items.
+const long ITEM_COUNT = 1000000;
+
+// Number of times the list is traversed for each measurement.
+const int PASS_COUNT = 20;
+
+template<typename List>
+long long traverse( List &list )
+{
+  long long sum = 0;
+  for( int pass = 0; pass < PASS_COUNT; ++pass ) {
+    for( typename List::iterator p = list.begin( ); p != list.end( ); ++p ) sum += *p;
+  }
+  return sum;
+}
+
+template<typename Index>
+void run( const char *name, long count )
+{
+  typedef spica::BoundedList<long, Index> List;
+  spica::Timer stopwatch;
+  long churned_time, compact_time, compacted_time;
+  long long checksum = 0;
+
+  List list( count );
+  std::vector<typename List::iterator> items;
+  for( long i = 0; i < count; ++i ) {
+    list.push_back( i );
+    items.push_back( --list.end( ) );
+  }
+
+  // Replace random items so that the list wanders all over the arrays.
+  std::mt19937 generator( 42 );
+  for( long i = 0; i < count; ++i ) {
+    std::size_t k = generator( ) % items.size( );
+    list.erase( items[k] );
+    list.push_back( count + i );
+    items[k] = --list.end( );
+  }
+
+  stopwatch.start( );
+  checksum += traverse( list );
+  stopwatch.stop( );
+  churned_time = stopwatch.time( );
+
+  stopwatch.reset( );
+  stopwatch.start( );
+  list.compact( );
+  stopwatch.stop( );
+  compact_time = stopwatch.time( );
+
+  stopwatch.reset( );
+  stopwatch.start( );
+  checksum -= traverse( list );
+  stopwatch.stop( );
+  compacted_time = stopwatch.time( );
+
+  std::cout << std::setw( 14 ) << name
+            << ": Links = "     << std::setw( 4 ) << 2 * ( count + 1 ) * sizeof( Index ) / ( 1024 * 1024 ) << "MB"
+            << "; Churned = "   << std::setw( 7 ) << std::setprecision( 3 ) << churned_time   / 1000.0 << "s"
+            << "; Compact = "   << std::setw( 7 ) << std::setprecision( 3 ) << compact_time   / 1000.0 << "s"
+            << "; Compacted = " << std::setw( 7 ) << std::setprecision( 3 ) << compacted_time / 1000.0 << "s"
+            << " (" << checksum << ")" << std::endl;
+}
+
+
+//
+// Main program just exercises each test.
+//
+int main( int argc, char **argv )
+{
+  long count = ( argc > 1 ) ? std::atol( argv[1] ) : ITEM_COUNT;
+
+  std::cout << std::setiosflags( std::ios::fixed );
+  std::cout << "Items = " << count << "; Passes = " << PASS_COUNT << std::endl;
+
+  run< std::size_t >( "size_t links", count );
+  run< std::uint32_t >( "uint32_t links", count );
+  return 0;
+}
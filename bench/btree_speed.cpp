@@ -0,0 +1,112 @@
+/*! \file    btree_speed.cpp
+ *  \brief   Compares BTreeSet with BinaryTree and std::set, with an emphasis on range scans.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ *
+ * This file contains a program that inserts N shuffled keys into BTreeSets with two node
+ * sizes, a red-black BinaryTree, and a std::set. It reports the time to insert the keys, to
+ * find each of them, and to do SCAN_COUNT range scans of SCAN_LENGTH keys each, starting at
+ * random keys. It also reports the time for BTreeSet to bulk load the sorted keys. The number
+ * of keys can be given on the command line; the default is 1000000. Build with something like:
+ *
+ *     g++ -std=c++20 -O2 -I. bench/btree_speed.cpp Timer.cpp -o btree_speed
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <set>
+#include <vector>
+#include "BinaryTree.hpp"
+#include "BTree.hpp"
+#include "Timer.hpp"
+
+// Default number of keys.
+const long KEY_COUNT = 1000000;
+
+// Number of range scans and the number of keys visited by each.
+const int SCAN_COUNT  = 100000;
+const int SCAN_LENGTH = 100;
+
+template<typename Tree>
+void run( const char *name, const std::vector<int> &keys, const std::vector<int> &starts )
+{
+  spica::Timer stopwatch;
+  long insert_time, find_time, scan_time;
+  long long checksum = 0;
+
+  Tree tree;
+  stopwatch.start( );
+  for( int key : keys ) tree.insert( key );
+  stopwatch.stop( );
+  insert_time = stopwatch.time( );
+
+  stopwatch.reset( );
+  stopwatch.start( );
+  for( int key : keys ) {
+    if( tree.find( key ) != tree.end( ) ) ++checksum;
+  }
+  stopwatch.stop( );
+  find_time = stopwatch.time( );
+
+  // BinaryTree has no lower_bound, but every start key is present so find works for all.
+  stopwatch.reset( );
+  stopwatch.start( );
+  for( int start : starts ) {
+    typename Tree::iterator p = tree.find( start );
+    for( int i = 0; i < SCAN_LENGTH && p != tree.end( ); ++i, ++p ) checksum += *p;
+  }
+  stopwatch.stop( );
+  scan_time = stopwatch.time( );
+
+  std::cout << std::setw( 16 ) << name
+            << ": Insert = " << std::setw( 7 ) << std::setprecision( 3 ) << insert_time / 1000.0 << "s"
+            << "; Find = "   << std::setw( 7 ) << std::setprecision( 3 ) << find_time   / 1000.0 << "s"
+            << "; Scan = "   << std::setw( 7 ) << std::setprecision( 3 ) << scan_time   / 1000.0 << "s"
+            << " (" << checksum << ")" << std::endl;
+}
+
+template<typename Tree>
+void bulk_load( const char *name, const std::vector<int> &sorted )
+{
+  spica::Timer stopwatch;
+  Tree tree;
+
+  stopwatch.start( );
+  tree.bulk_load( sorted.begin( ), sorted.end( ) );
+  stopwatch.stop( );
+
+  std::cout << std::setw( 16 ) << name
+            << ": Bulk load = " << std::setw( 7 ) << std::setprecision( 3 ) << stopwatch.time( ) / 1000.0 << "s"
+            << " (" << tree.size( ) << ")" << std::endl;
+}
+
+
+//
+// Main program just exercises each test.
+//
+int main( int argc, char **argv )
+{
+  long count = ( argc > 1 ) ? std::atol( argv[1] ) : KEY_COUNT;
+  std::vector<int> sorted( count );
+  for( long i = 0; i < count; ++i ) sorted[i] = static_cast<int>( i );
+  std::vector<int> shuffled( sorted );
+  std::mt19937 generator( 42 );
+  std::shuffle( shuffled.begin( ), shuffled.end( ), generator );
+  std::vector<int> starts( SCAN_COUNT );
+  for( int &start : starts ) start = static_cast<int>( generator( ) % count );
+
+  std::cout << std::setiosflags( std::ios::fixed );
+  std::cout << "Keys = " << count << "; Scans = " << SCAN_COUNT << " x " << SCAN_LENGTH << std::endl;
+
+  run< spica::BTreeSet<int> >( "BTreeSet (256)", shuffled, starts );
+  run< spica::BTreeSet<int, std::less<int>, 4096> >( "BTreeSet (4096)", shuffled, starts );
+  run< spica::BinaryTree<int> >( "BinaryTree", shuffled, starts );
+  run< std::set<int> >( "std::set", shuffled, starts );
+
+  bulk_load< spica::BTreeSet<int> >( "BTreeSet (256)", sorted );
+  bulk_load< spica::BTreeSet<int, std::less<int>, 4096> >( "BTreeSet (4096)", sorted );
+  return 0;
+}
@@ -0,0 +1,166 @@
+/*! \file    concurrent_hash_speed.cpp
+ *  \brief   Compares ConcurrentHashMap with a HashtableOpen protected by a mutex_sem.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ *
+ * This file contains a program that runs a mixture of lookups and updates against a shared
+ * table from a varying number of threads. Each update either inserts or erases a random key
+ * so the table stays about half full. The table starts small so the first test also includes
+ * the cost of growing it. Every configuration does the same total number of operations,
+ * divided among the threads, so the rates can be compared directly. Build with something
+ * like:
+ *
+ *     g++ -std=c++20 -O2 -I. bench/concurrent_hash_speed.cpp epoch.cpp synchronize.cpp \
+ *         Timer.cpp -o concurrent_hash_speed
+ */
+
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "ConcurrentHashMap.hpp"
+#include "HashtableOpen.hpp"
+#include "synchronize.hpp"
+#include "Timer.hpp"
+
+// Keys are drawn from [0, KEY_RANGE).
+const int KEY_RANGE = 1 << 20;
+
+// Total number of operations in each test.
+const long OPERATIONS = 4000000;
+
+// Fast per-thread random numbers.
+class xorshift {
+public:
+  explicit xorshift( std::uint64_t seed ) : state( seed * 0x9E3779B97F4A7C15ULL + 1 ) { }
+
+  std::uint64_t next( )
+  {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+  }
+
+private:
+  std::uint64_t state;
+};
+
+
+int hash_int( const int &value )
+{
+  return value;
+}
+
+// The baseline: a single table that every operation must lock.
+class locked_table {
+public:
+  locked_table( ) : table( 64, hash_int ) { }
+
+  bool find( int key )
+  {
+    spica::mutex_sem::grabber lock( mutex );
+    return table.find( key ) != table.end( );
+  }
+
+  void insert( int key )
+  {
+    spica::mutex_sem::grabber lock( mutex );
+    table.insert( key );
+  }
+
+  void erase( int key )
+  {
+    spica::mutex_sem::grabber lock( mutex );
+    table.erase( key );
+  }
+
+private:
+  spica::mutex_sem          mutex;
+  spica::HashtableOpen<int> table;
+};
+
+class concurrent_table {
+public:
+  bool find( int key )   { return table.contains( key ); }
+  void insert( int key ) { table.insert( key, key ); }
+  void erase( int key )  { table.erase( key ); }
+
+private:
+  spica::ConcurrentHashMap<int, int> table;
+};
+
+
+//
+// Runs the operations on the given number of threads. Returns the elapsed time in ms.
+//
+template<typename Table>
+long run( Table &table, int thread_count, int write_percent, long &found )
+{
+  spica::Timer stopwatch;
+  std::vector<std::thread> threads;
+  std::vector<long> hits( thread_count, 0 );
+  long per_thread = OPERATIONS / thread_count;
+
+  stopwatch.start( );
+  for( int t = 0; t < thread_count; ++t ) {
+    threads.emplace_back( [&, t]( ) {
+      xorshift random( t + 1 );
+      long count = 0;
+      for( long i = 0; i < per_thread; ++i ) {
+        std::uint64_t r = random.next( );
+        int key = static_cast<int>( r >> 40 ) & ( KEY_RANGE - 1 );
+        int choice = static_cast<int>( r % 100 );
+        if( choice >= write_percent ) {
+          if( table.find( key ) ) ++count;
+        }
+        else if( choice % 2 == 0 ) table.insert( key );
+        else table.erase( key );
+      }
+      hits[t] = count;
+    } );
+  }
+  for( std::thread &t : threads ) t.join( );
+  stopwatch.stop( );
+
+  for( long count : hits ) found += count;
+  return stopwatch.time( );
+}
+
+
+void report( const char *name, int thread_count, long milliseconds )
+{
+  double seconds = milliseconds / 1000.0;
+  double rate = ( seconds > 0.0 ) ? OPERATIONS / seconds / 1.0E6 : 0.0;
+  std::cout << std::setw( 10 ) << name
+            << "; Threads = " << std::setw( 2 ) << thread_count
+            << "; Time = " << std::setw( 6 ) << std::setprecision( 3 ) << seconds << "s"
+            << "; Rate = " << std::setw( 7 ) << std::setprecision( 2 ) << rate << " Mops/s"
+            << std::endl;
+}
+
+
+//
+// Main program just exercises each test.
+//
+int main( )
+{
+  long found = 0;
+  std::cout << std::setiosflags( std::ios::fixed );
+
+  for( int write_percent : { 10, 50 } ) {
+    std::cout << "Reads/writes = " << 100 - write_percent << "/" << write_percent << std::endl;
+
+    // The tables are shared by all the thread counts so later tests run on a full table.
+    locked_table     locked;
+    concurrent_table concurrent;
+    for( int thread_count = 1; thread_count <= 64; thread_count *= 2 ) {
+      report( "locked",     thread_count, run( locked,     thread_count, write_percent, found ) );
+      report( "concurrent", thread_count, run( concurrent, thread_count, write_percent, found ) );
+    }
+    std::cout << std::endl;
+  }
+
+  std::cout << "(Checksum = " << found << ")" << std::endl;
+  return 0;
+}
@@ -0,0 +1,184 @@
+/*! \file    concurrent_list_speed.cpp
+ *  \brief   Compares ConcurrentBoundedList with a BoundedList protected by a mutex_sem.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ *
+ * This file contains a program that uses a shared pool of objects from a varying number of
+ * threads. Each thread repeatedly allocates BURST objects and then frees them, so the threads
+ * hold a mixture of allocated objects while they run. The pools are a BoundedList locked by a
+ * mutex_sem, a ConcurrentBoundedList used directly, and a ConcurrentBoundedList used through
+ * a local_cache in each thread. Every configuration does the same total number of allocations,
+ * divided among the threads, so the rates can be compared directly. Build with something like:
+ *
+ *     g++ -std=c++20 -O2 -I. bench/concurrent_list_speed.cpp synchronize.cpp lock_profile.cpp \
+ *         Timer.cpp -o concurrent_list_speed
+ */
+
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "BoundedList.hpp"
+#include "ConcurrentBoundedList.hpp"
+#include "synchronize.hpp"
+#include "Timer.hpp"
+
+// Total number of allocations (and frees) in each test.
+const long OPERATIONS = 8000000;
+
+// Number of objects each thread allocates before freeing them.
+const int BURST = 16;
+
+// Largest number of threads.
+const int MAX_THREADS = 16;
+
+// The objects in the pool.
+struct job {
+  long id;
+  long data[3];
+};
+
+// The baseline: a BoundedList that every operation must lock.
+class locked_pool {
+public:
+  typedef spica::BoundedList<job>::iterator handle;
+
+  locked_pool( ) : list( MAX_THREADS * BURST ) { }
+
+  handle insert( const job &item )
+  {
+    spica::mutex_sem::grabber lock( mutex );
+    return list.insert( list.end( ), item );
+  }
+
+  void erase( handle item )
+  {
+    spica::mutex_sem::grabber lock( mutex );
+    list.erase( item );
+  }
+
+private:
+  spica::mutex_sem            mutex;
+  spica::BoundedList<job>     list;
+};
+
+class concurrent_pool {
+public:
+  typedef job *handle;
+
+  concurrent_pool( ) : pool( MAX_THREADS * BURST ) { }
+
+  handle insert( const job &item ) { return pool.insert( item ); }
+  void erase( handle item ) { pool.erase( item ); }
+
+  spica::ConcurrentBoundedList<job> pool;
+};
+
+// Each thread has a local_cache. The pool must also hold the slots that the caches keep.
+class cached_pool {
+public:
+  typedef job *handle;
+
+  cached_pool( ) :
+    pool( MAX_THREADS * ( BURST + spica::ConcurrentBoundedList<job>::local_cache::cache_size ) ) { }
+
+  spica::ConcurrentBoundedList<job> pool;
+};
+
+
+//
+// Runs the allocations on the given number of threads. Returns the elapsed time in ms.
+//
+template<typename Pool>
+long run( Pool &pool, int thread_count, long &checksum )
+{
+  spica::Timer stopwatch;
+  std::vector<std::thread> threads;
+  std::vector<long> sums( thread_count, 0 );
+  long per_thread = OPERATIONS / thread_count;
+
+  stopwatch.start( );
+  for( int t = 0; t < thread_count; ++t ) {
+    threads.emplace_back( [&, t]( ) {
+      typename Pool::handle items[BURST];
+      long sum = 0;
+      for( long i = 0; i < per_thread; i += BURST ) {
+        for( int j = 0; j < BURST; ++j ) items[j] = pool.insert( job{ i + j, { t, 0, 0 } } );
+        for( int j = 0; j < BURST; ++j ) {
+          sum += items[j]->id;
+          pool.erase( items[j] );
+        }
+      }
+      sums[t] = sum;
+    } );
+  }
+  for( std::thread &t : threads ) t.join( );
+  stopwatch.stop( );
+
+  for( long sum : sums ) checksum += sum;
+  return stopwatch.time( );
+}
+
+// The same thing, using a local_cache in each thread.
+long run( cached_pool &pool, int thread_count, long &checksum )
+{
+  spica::Timer stopwatch;
+  std::vector<std::thread> threads;
+  std::vector<long> sums( thread_count, 0 );
+  long per_thread = OPERATIONS / thread_count;
+
+  stopwatch.start( );
+  for( int t = 0; t < thread_count; ++t ) {
+    threads.emplace_back( [&, t]( ) {
+      spica::ConcurrentBoundedList<job>::local_cache cache( pool.pool );
+      job *items[BURST];
+      long sum = 0;
+      for( long i = 0; i < per_thread; i += BURST ) {
+        for( int j = 0; j < BURST; ++j ) items[j] = cache.insert( job{ i + j, { t, 0, 0 } } );
+        for( int j = 0; j < BURST; ++j ) {
+          sum += items[j]->id;
+          cache.erase( items[j] );
+        }
+      }
+      sums[t] = sum;
+    } );
+  }
+  for( std::thread &t : threads ) t.join( );
+  stopwatch.stop( );
+
+  for( long sum : sums ) checksum += sum;
+  return stopwatch.time( );
+}
+
+
+void report( const char *name, int thread_count, long milliseconds )
+{
+  double seconds = milliseconds / 1000.0;
+  double rate = ( seconds > 0.0 ) ? OPERATIONS / seconds / 1.0E6 : 0.0;
+  std::cout << std::setw( 10 ) << name
+            << "; Threads = " << std::setw( 2 ) << thread_count
+            << "; Time = " << std::setw( 6 ) << std::setprecision( 3 ) << seconds << "s"
+            << "; Rate = " << std::setw( 7 ) << std::setprecision( 2 ) << rate << " Mallocs/s"
+            << std::endl;
+}
+
+
+//
+// Main program just exercises each test.
+//
+int main( )
+{
+  long checksum = 0;
+  std::cout << std::setiosflags( std::ios::fixed );
+
+  locked_pool     locked;
+  concurrent_pool concurrent;
+  cached_pool     cached;
+  for( int thread_count = 1; thread_count <= MAX_THREADS; thread_count *= 2 ) {
+    report( "locked",     thread_count, run( locked,     thread_count, checksum ) );
+    report( "lock-free",  thread_count, run( concurrent, thread_count, checksum ) );
+    report( "cached",     thread_count, run( cached,     thread_count, checksum ) );
+  }
+
+  std::cout << "(Checksum = " << checksum << ")" << std::endl;
+  return 0;
+}
@@ -0,0 +1,77 @@
+/*! \file    filevector_growth.cpp
+ *  \brief   Compares FileVector growth with and without an address space reservation.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ *
+ * This file contains a program that appends integers to an empty FileVector. In the default
+ * mode each time the capacity doubles the mapping is replaced (or moved by mremap). In the
+ * reserved mode a large range of address space is reserved first and the mapping is extended in
+ * place so the elements never move. The number of elements can be given on the command line.
+ * The default of 10^9 needs 8 GB of free disk space. Build with something like:
+ *
+ *     g++ -std=c++20 -O2 -I. bench/filevector_growth.cpp Timer.cpp -o filevector_growth
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include "FileVector.hpp"
+#include "Timer.hpp"
+
+const char *FILE_NAME = "filevector_growth.fv";
+
+long append( long count, bool reserved, int &moves )
+{
+  spica::Timer stopwatch;
+
+  moves = 0;
+  stopwatch.start( );
+  {
+    spica::FileVector<long> data( FILE_NAME, 0 );
+    if( reserved && !data.reserve_address_space( ) ) {
+      std::cerr << "Address space reservation is not supported\n";
+    }
+    const long *previous = data.begin( );
+    for( long i = 0; i < count; ++i ) {
+      data.push_back( i );
+      if( data.begin( ) != previous ) {
+        previous = data.begin( );
+        ++moves;
+      }
+    }
+  }
+  stopwatch.stop( );
+  std::remove( FILE_NAME );
+  return stopwatch.time( );
+}
+
+void report( const char *name, long count, int moves, long milliseconds )
+{
+  double seconds = milliseconds / 1000.0;
+  double rate = ( seconds > 0.0 ) ? count / seconds / 1.0E6 : 0.0;
+  std::cout << std::setw( 8 ) << name
+            << "; N = " << std::setw( 10 ) << count
+            << "; Moves = " << std::setw( 3 ) << moves
+            << "; Time = " << std::setw( 7 ) << std::setprecision( 3 ) << seconds << "s"
+            << "; Rate = " << std::setw( 7 ) << std::setprecision( 1 ) << rate << " M/s"
+            << std::endl;
+}
+
+
+//
+// Main program just exercises each test.
+//
+int main( int argc, char **argv )
+{
+  long count = ( argc > 1 ) ? std::atol( argv[1] ) : 1000000000L;
+  int  moves;
+  long time;
+
+  std::cout << std::setiosflags( std::ios::fixed );
+
+  time = append( count, false, moves );
+  report( "remap", count, moves, time );
+  time = append( count, true, moves );
+  report( "reserved", count, moves, time );
+  return 0;
+}
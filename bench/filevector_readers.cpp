@@ -0,0 +1,117 @@
+/*! \file    filevector_readers.cpp
+ *  \brief   Measures FileVectorReaders in several processes following one writer.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ *
+ * This file contains a program that appends integers to a FileVector, committing after each
+ * batch, while a number of child processes follow along with FileVectorReaders. Each reader
+ * refreshes its snapshot, checks the new elements, and repeats until it has seen them all. The
+ * elements are read directly from the shared mapping; nothing is copied. The program reports
+ * the total time for each number of readers and the rate at which elements were read by all of
+ * the readers together. The number of elements can be given on the command line. This program
+ * requires a POSIX system (it uses fork). Build with something like:
+ *
+ *     g++ -std=c++20 -O2 -I. bench/filevector_readers.cpp Timer.cpp -o filevector_readers
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+#include <sched.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "FileVector.hpp"
+#include "Timer.hpp"
+
+// Number of elements appended between commits.
+const long BATCH_SIZE = 4096;
+
+const char *FILE_NAME = "filevector_readers.fv";
+
+//
+// Follows the writer until count elements have been seen. Returns the process exit status.
+//
+int follow( long count )
+{
+  spica::FileVectorReader<long> reader( FILE_NAME );
+  long seen = 0;
+  bool good = true;
+
+  while( seen < count ) {
+    if( !reader.refresh( ) ) {
+      sched_yield( );
+      continue;
+    }
+    for( ; seen < static_cast<long>( reader.size( ) ); ++seen ) {
+      if( reader[seen] != seen ) good = false;
+    }
+  }
+  return good ? 0 : 1;
+}
+
+
+long run( long count, int reader_count, bool &good )
+{
+  spica::Timer stopwatch;
+  std::vector<pid_t> readers;
+
+  spica::FileVector<long> data( FILE_NAME, 0 );
+  data.reserve_address_space( );
+
+  // The readers inherit the writer's object but must not destroy it.
+  std::cout.flush( );
+  for( int i = 0; i < reader_count; ++i ) {
+    pid_t child = fork( );
+    if( child == 0 ) _exit( follow( count ) );
+    readers.push_back( child );
+  }
+
+  stopwatch.start( );
+  for( long i = 0; i < count; ++i ) {
+    data.push_back( i );
+    if( ( i + 1 ) % BATCH_SIZE == 0 ) data.commit( );
+  }
+  data.commit( );
+
+  good = true;
+  for( pid_t child : readers ) {
+    int status;
+    if( waitpid( child, &status, 0 ) != child || !WIFEXITED( status ) || WEXITSTATUS( status ) != 0 )
+      good = false;
+  }
+  stopwatch.stop( );
+  return stopwatch.time( );
+}
+
+
+void report( int reader_count, long count, long milliseconds, bool good )
+{
+  double seconds = milliseconds / 1000.0;
+  double rate = ( seconds > 0.0 ) ? reader_count * static_cast<double>( count ) / seconds / 1.0E6 : 0.0;
+  std::cout << "Readers = " << std::setw( 2 ) << reader_count
+            << "; N = " << std::setw( 10 ) << count
+            << "; Time = " << std::setw( 7 ) << std::setprecision( 3 ) << seconds << "s"
+            << "; Read rate = " << std::setw( 8 ) << std::setprecision( 1 ) << rate << " M/s"
+            << ( good ? "" : " (READER FAILED!)" )
+            << std::endl;
+}
+
+
+//
+// Main program just exercises each test.
+//
+int main( int argc, char **argv )
+{
+  long count = ( argc > 1 ) ? std::atol( argv[1] ) : 100000000L;
+  bool good;
+
+  std::cout << std::setiosflags( std::ios::fixed );
+
+  for( int reader_count = 1; reader_count <= 8; reader_count *= 2 ) {
+    long time = run( count, reader_count, good );
+    report( reader_count, count, time, good );
+    std::remove( FILE_NAME );
+  }
+  return 0;
+}
@@ -0,0 +1,119 @@
+/*! \file    filevector_speed.cpp
+ *  \brief   Compares FileVector with std::vector plus explicit file output.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ *
+ * This file contains a program that builds a persistent array of integers in two ways. The first
+ * appends to a FileVector so the data goes directly into the memory mapped file. The second
+ * appends to a std::vector and then writes the result to a file with fwrite. It also compares
+ * the cost of updating a few random elements of an existing file, where FileVector only touches
+ * the affected pages while the std::vector approach must read and rewrite the whole file. Build
+ * with something like:
+ *
+ *     g++ -std=c++20 -O2 -I. bench/filevector_speed.cpp Timer.cpp -o filevector_speed
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+#include "FileVector.hpp"
+#include "Timer.hpp"
+
+// Number of random updates done to the existing file.
+const int UPDATES = 1000;
+
+const char *FILE_VECTOR_NAME = "filevector_speed.fv";
+const char *STD_VECTOR_NAME  = "filevector_speed.dat";
+
+long file_vector_append( long count )
+{
+  spica::Timer stopwatch;
+
+  stopwatch.start( );
+  {
+    spica::FileVector<long> data( FILE_VECTOR_NAME, 0 );
+    data.advise( spica::access_pattern::sequential );
+    for( long i = 0; i < count; ++i ) data.push_back( i );
+  }
+  stopwatch.stop( );
+  return stopwatch.time( );
+}
+
+long std_vector_append( long count )
+{
+  spica::Timer stopwatch;
+
+  stopwatch.start( );
+  std::vector<long> data;
+  for( long i = 0; i < count; ++i ) data.push_back( i );
+  std::FILE *output = std::fopen( STD_VECTOR_NAME, "wb" );
+  std::fwrite( data.data( ), sizeof( long ), data.size( ), output );
+  std::fclose( output );
+  stopwatch.stop( );
+  return stopwatch.time( );
+}
+
+long file_vector_update( long count )
+{
+  spica::Timer stopwatch;
+
+  stopwatch.start( );
+  {
+    spica::FileVector<long> data( FILE_VECTOR_NAME );
+    data.advise( spica::access_pattern::random );
+    for( int i = 0; i < UPDATES; ++i ) data[std::rand( ) % count] += 1;
+  }
+  stopwatch.stop( );
+  return stopwatch.time( );
+}
+
+long std_vector_update( long count )
+{
+  spica::Timer stopwatch;
+
+  stopwatch.start( );
+  std::vector<long> data( count );
+  std::FILE *file = std::fopen( STD_VECTOR_NAME, "rb" );
+  if( std::fread( data.data( ), sizeof( long ), data.size( ), file ) != data.size( ) ) {
+    std::cerr << "Short read!\n";
+  }
+  std::fclose( file );
+  for( int i = 0; i < UPDATES; ++i ) data[std::rand( ) % count] += 1;
+  file = std::fopen( STD_VECTOR_NAME, "wb" );
+  std::fwrite( data.data( ), sizeof( long ), data.size( ), file );
+  std::fclose( file );
+  stopwatch.stop( );
+  return stopwatch.time( );
+}
+
+void report( const char *name, long count, long milliseconds )
+{
+  double seconds = milliseconds / 1000.0;
+  std::cout << std::setw( 20 ) << name
+            << "; N = " << std::setw( 9 ) << count
+            << "; Time = " << std::setw( 7 ) << std::setprecision( 3 ) << seconds << "s"
+            << std::endl;
+}
+
+
+//
+// Main program just exercises each test.
+//
+int main( )
+{
+  std::srand( 0 );
+  std::cout << std::setiosflags( std::ios::fixed );
+
+  for( long count = 1000000L; count <= 64000000L; count *= 4 ) {
+    report( "FileVector append",  count, file_vector_append( count ) );
+    report( "std::vector append", count, std_vector_append( count ) );
+    report( "FileVector update",  count, file_vector_update( count ) );
+    report( "std::vector update", count, std_vector_update( count ) );
+    std::cout << std::endl;
+  }
+
+  std::remove( FILE_VECTOR_NAME );
+  std::remove( STD_VECTOR_NAME );
+  return 0;
+}
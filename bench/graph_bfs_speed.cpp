@@ -0,0 +1,134 @@
+/*! \file    graph_bfs_speed.cpp
+ *  \brief   Compares breadth first search on a Graph and on its CSRGraph copies.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ *
+ * This file contains a program that builds a random directed graph with V vertices and E
+ * edges, adding the edges in random order, and then does SEARCH_COUNT breadth first searches
+ * from different starting vertices. The searches are done on the Graph itself and on the
+ * CSRGraph copies made by freeze( ) in each of the three layouts. The program also reports
+ * the time to freeze the graph. V and E can be given on the command line; the defaults are
+ * 1000000 and 16000000. Build with something like:
+ *
+ *     g++ -std=c++20 -O2 -I. bench/graph_bfs_speed.cpp Timer.cpp -o graph_bfs_speed
+ */
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "Graph.hpp"
+#include "Timer.hpp"
+
+typedef spica::Graph<double> graph_t;
+typedef graph_t::count_t count_t;
+
+// Default size of the graph.
+const long VERTEX_COUNT = 1000000;
+const long EDGE_COUNT   = 16000000;
+
+// Number of searches for each representation.
+const int SEARCH_COUNT = 5;
+
+// Returns the sum of the distances from start to the vertices it reaches.
+long long bfs( graph_t &graph, count_t start )
+{
+  std::vector<count_t> distance( graph.num_vertices( ), graph_t::nil );
+  std::vector<count_t> queue;
+  queue.reserve( graph.num_vertices( ) );
+  long long total = 0;
+
+  distance[start] = 0;
+  queue.push_back( start );
+  for( std::size_t head = 0; head < queue.size( ); ++head ) {
+    count_t v = queue[head];
+    total += distance[v];
+    for( graph_t::edge_iterator p = graph.ebegin( v ); p != graph.eend( v ); ++p ) {
+      if( distance[p->remote_vertex] == graph_t::nil ) {
+        distance[p->remote_vertex] = distance[v] + 1;
+        queue.push_back( p->remote_vertex );
+      }
+    }
+  }
+  return total;
+}
+
+template<spica::csr_layout Layout>
+long long bfs( const spica::CSRGraph<double, Layout> &graph, count_t start )
+{
+  std::vector<count_t> distance( graph.num_vertices( ), graph_t::nil );
+  std::vector<count_t> queue;
+  queue.reserve( graph.num_vertices( ) );
+  long long total = 0;
+
+  distance[start] = 0;
+  queue.push_back( start );
+  for( std::size_t head = 0; head < queue.size( ); ++head ) {
+    count_t v = queue[head];
+    total += distance[v];
+    for( count_t e = graph.edge_begin( v ); e != graph.edge_end( v ); ++e ) {
+      count_t w = graph.target( e );
+      if( distance[w] == graph_t::nil ) {
+        distance[w] = distance[v] + 1;
+        queue.push_back( w );
+      }
+    }
+  }
+  return total;
+}
+
+template<typename Graph>
+void run( const char *name, Graph &graph, long freeze_time )
+{
+  spica::Timer stopwatch;
+  long long checksum = 0;
+
+  stopwatch.start( );
+  for( int i = 0; i < SEARCH_COUNT; ++i ) {
+    checksum += bfs( graph, static_cast<count_t>( i * 7919 % graph.num_vertices( ) ) );
+  }
+  stopwatch.stop( );
+
+  std::cout << std::setw( 22 ) << name
+            << ": Freeze = " << std::setw( 6 ) << std::setprecision( 3 ) << freeze_time / 1000.0 << "s"
+            << "; BFS = "    << std::setw( 6 ) << std::setprecision( 3 ) << stopwatch.time( ) / 1000.0 << "s"
+            << " (" << checksum << ")" << std::endl;
+}
+
+template<spica::csr_layout Layout>
+void run_frozen( const char *name, graph_t &graph )
+{
+  spica::Timer stopwatch;
+  stopwatch.start( );
+  spica::CSRGraph<double, Layout> frozen = graph.freeze<Layout>( );
+  stopwatch.stop( );
+  run( name, frozen, stopwatch.time( ) );
+}
+
+
+//
+// Main program just exercises each test.
+//
+int main( int argc, char **argv )
+{
+  long vertices = ( argc > 1 ) ? std::atol( argv[1] ) : VERTEX_COUNT;
+  long edges    = ( argc > 2 ) ? std::atol( argv[2] ) : EDGE_COUNT;
+
+  graph_t graph;
+  std::mt19937 generator( 42 );
+  graph.create_vertex( static_cast<count_t>( vertices - 1 ) );
+  for( long i = 0; i < edges; ++i ) {
+    count_t source = static_cast<count_t>( generator( ) % vertices );
+    count_t target = static_cast<count_t>( generator( ) % vertices );
+    graph.create_edge( source, target, static_cast<double>( i ) );
+  }
+
+  std::cout << std::setiosflags( std::ios::fixed );
+  std::cout << "Vertices = " << vertices << "; Edges = " << edges << "; Searches = " << SEARCH_COUNT << std::endl;
+
+  run( "Graph", graph, 0 );
+  run_frozen<spica::csr_layout::separate>( "CSRGraph (separate)", graph );
+  run_frozen<spica::csr_layout::interleaved>( "CSRGraph (interleaved)", graph );
+  run_frozen<spica::csr_layout::unweighted>( "CSRGraph (unweighted)", graph );
+  return 0;
+}
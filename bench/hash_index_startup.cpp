@@ -0,0 +1,120 @@
+/*! \file    hash_index_startup.cpp
+ *  \brief   Compares reopening a FileHashIndex with rebuilding an in-memory index.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ *
+ * This file contains a program that writes a number of records to a FileVector and builds a
+ * FileHashIndex of their keys. It then measures what a program pays at startup to get an index
+ * it can use: rebuilding a HashMapFlat from the records versus reopening the FileHashIndex. A
+ * batch of random lookups follows each one since the reopened index must read its pages from
+ * the file as they are touched. The number of records can be given on the command line. Build
+ * with something like:
+ *
+ *     g++ -std=c++20 -O2 -I. bench/hash_index_startup.cpp Timer.cpp -o hash_index_startup
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include "FileHashIndex.hpp"
+#include "FileVector.hpp"
+#include "HashMapFlat.hpp"
+#include "Timer.hpp"
+
+// Default number of records.
+const long RECORD_COUNT = 10000000;
+
+// Number of lookups after the index is ready.
+const long LOOKUPS = 1000000;
+
+const char *record_file = "hash_index_records.dat";
+const char *index_file  = "hash_index_startup.dat";
+
+struct record {
+  std::uint64_t key;
+  std::uint64_t payload[3];
+};
+
+std::uint64_t record_key( long i )
+{
+  return static_cast<std::uint64_t>( i ) * 0x9E3779B97F4A7C15ULL;
+}
+
+void report( const char *name, long milliseconds )
+{
+  std::cout << std::setw( 28 ) << name << ": "
+            << std::setw( 8 ) << std::setprecision( 3 ) << milliseconds / 1000.0 << "s"
+            << std::endl;
+}
+
+
+//
+// Main program just exercises each test.
+//
+int main( int argc, char **argv )
+{
+  long count = ( argc > 1 ) ? std::atol( argv[1] ) : RECORD_COUNT;
+  spica::Timer stopwatch;
+  std::uint64_t checksum = 0;
+
+  std::cout << std::setiosflags( std::ios::fixed );
+  std::cout << "Records = " << count << std::endl;
+  std::remove( record_file );
+  std::remove( index_file );
+
+  // Create the records and the persistent index. This is done once.
+  stopwatch.start( );
+  {
+    spica::FileVector<record> records( record_file );
+    spica::FileHashIndex<std::uint64_t, std::uint64_t> index( index_file );
+    for( long i = 0; i < count; ++i ) {
+      records.push_back( record{ record_key( i ), { 1, 2, 3 } } );
+      index.insert( record_key( i ), static_cast<std::uint64_t>( i ) );
+    }
+    index.sync( );
+  }
+  stopwatch.stop( );
+  report( "create records and index", stopwatch.time( ) );
+
+  // Startup by rebuilding an in-memory index from the records.
+  stopwatch.reset( );
+  stopwatch.start( );
+  {
+    spica::FileVector<record> records( record_file );
+    spica::HashMapFlat<std::uint64_t, std::uint64_t> index;
+    for( std::size_t i = 0; i < records.size( ); ++i ) index.try_emplace( records[i].key, i );
+    stopwatch.stop( );
+    report( "rebuild HashMapFlat", stopwatch.time( ) );
+
+    stopwatch.reset( );
+    stopwatch.start( );
+    for( long i = 0; i < LOOKUPS; ++i ) {
+      checksum += index.find( record_key( ( i * 7919 ) % count ) )->second;
+    }
+    stopwatch.stop( );
+    report( "lookups (HashMapFlat)", stopwatch.time( ) );
+  }
+
+  // Startup by reopening the persistent index.
+  stopwatch.reset( );
+  stopwatch.start( );
+  {
+    spica::FileHashIndex<std::uint64_t, std::uint64_t> index( index_file );
+    stopwatch.stop( );
+    report( "reopen FileHashIndex", stopwatch.time( ) );
+
+    stopwatch.reset( );
+    stopwatch.start( );
+    for( long i = 0; i < LOOKUPS; ++i ) {
+      checksum += *index.find( record_key( ( i * 7919 ) % count ) );
+    }
+    stopwatch.stop( );
+    report( "lookups (FileHashIndex)", stopwatch.time( ) );
+  }
+
+  std::cout << "(Checksum = " << checksum << ")" << std::endl;
+  std::remove( record_file );
+  std::remove( index_file );
+  return 0;
+}
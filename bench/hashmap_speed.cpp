@@ -0,0 +1,101 @@
+/*! \file    hashmap_speed.cpp
+ *  \brief   Compares HashMapFlat with std::unordered_map.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ *
+ * This file contains a program that inserts N random 64 bit keys (with 64 bit values) into a
+ * HashMapFlat and into a std::unordered_map and then looks up N keys that are present and N
+ * keys that are not. It reports the throughput of each operation in millions per second. The
+ * sizes to test can be given on the command line; the default is 1000000 and 100000000. At
+ * 100 million entries HashMapFlat needs about 4 GB and std::unordered_map considerably more.
+ * Build with something like:
+ *
+ *     g++ -std=c++20 -O2 -I. bench/hashmap_speed.cpp Timer.cpp -o hashmap_speed
+ */
+
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <unordered_map>
+#include <vector>
+#include "HashMapFlat.hpp"
+#include "Timer.hpp"
+
+typedef std::uint64_t key_type;
+
+// Keys with the low bit clear are inserted. The same keys with the low bit set are misses.
+std::vector<key_type> make_keys( long count )
+{
+  std::mt19937_64 generator( 42 );
+  std::vector<key_type> keys( count );
+  for( key_type &key : keys ) key = generator( ) & ~static_cast<key_type>( 1 );
+  return keys;
+}
+
+double rate( long count, long milliseconds )
+{
+  return ( milliseconds > 0 ) ? count / ( milliseconds / 1000.0 ) / 1.0E6 : 0.0;
+}
+
+template<typename Map>
+void run( const char *name, const std::vector<key_type> &keys )
+{
+  spica::Timer stopwatch;
+  long count = static_cast<long>( keys.size( ) );
+  long found = 0;
+  long insert_time, hit_time, miss_time;
+
+  Map table;
+  stopwatch.start( );
+  for( long i = 0; i < count; ++i ) table.emplace( keys[i], i );
+  stopwatch.stop( );
+  insert_time = stopwatch.time( );
+
+  stopwatch.reset( );
+  stopwatch.start( );
+  for( key_type key : keys ) {
+    if( table.find( key ) != table.end( ) ) ++found;
+  }
+  stopwatch.stop( );
+  hit_time = stopwatch.time( );
+
+  stopwatch.reset( );
+  stopwatch.start( );
+  for( key_type key : keys ) {
+    if( table.find( key | 1 ) != table.end( ) ) ++found;
+  }
+  stopwatch.stop( );
+  miss_time = stopwatch.time( );
+
+  std::cout << std::setw( 18 ) << name
+            << "; N = " << std::setw( 10 ) << count
+            << "; Insert = " << std::setw( 6 ) << std::setprecision( 1 ) << rate( count, insert_time ) << " M/s"
+            << "; Find = "   << std::setw( 6 ) << std::setprecision( 1 ) << rate( count, hit_time )    << " M/s"
+            << "; Miss = "   << std::setw( 6 ) << std::setprecision( 1 ) << rate( count, miss_time )   << " M/s"
+            << " (" << found << ")"
+            << std::endl;
+}
+
+
+//
+// Main program just exercises each test.
+//
+int main( int argc, char **argv )
+{
+  std::vector<long> sizes;
+  for( int i = 1; i < argc; ++i ) sizes.push_back( std::atol( argv[i] ) );
+  if( sizes.empty( ) ) {
+    sizes.push_back( 1000000L );
+    sizes.push_back( 100000000L );
+  }
+
+  std::cout << std::setiosflags( std::ios::fixed );
+  for( long count : sizes ) {
+    std::vector<key_type> keys = make_keys( count );
+    run< spica::HashMapFlat<key_type, key_type> >( "HashMapFlat", keys );
+    run< std::unordered_map<key_type, key_type> >( "std::unordered_map", keys );
+    std::cout << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,119 @@
+/*! \file    hashtable_speed.cpp
+ *  \brief   Compares HashtableOpen with std::unordered_set.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ *
+ * This file contains a program that inserts random integers into a HashtableOpen and into a
+ * std::unordered_set and then times successful lookups, unsuccessful lookups, and erasing
+ * half of the items. Both tables start small so the cost of growing is included in the insert
+ * times. Build with something like:
+ *
+ *     g++ -std=c++20 -O2 -I. bench/hashtable_speed.cpp Timer.cpp -o hashtable_speed
+ */
+
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <unordered_set>
+#include <vector>
+#include "HashtableOpen.hpp"
+#include "Timer.hpp"
+
+// Number of lookups in each lookup test.
+const int LOOKUPS = 2000000;
+
+// The times for one table.
+struct results {
+  long insert_time;
+  long hit_time;
+  long miss_time;
+  long erase_time;
+  long checksum;      // Keeps the compiler from removing the lookups.
+};
+
+int hash_int( const int &value )
+{
+  return value;
+}
+
+// Even keys are inserted. Odd keys are used for unsuccessful lookups.
+std::vector<int> make_keys( int count )
+{
+  std::vector<int> keys( count );
+  for( int i = 0; i < count; ++i ) keys[i] = ( std::rand( ) & 0x3FFFFFFF ) * 2;
+  return keys;
+}
+
+template<typename Table>
+results run( Table &table, const std::vector<int> &keys )
+{
+  spica::Timer stopwatch;
+  results times;
+  long found = 0;
+  int  count = static_cast<int>( keys.size( ) );
+
+  stopwatch.start( );
+  for( int key : keys ) table.insert( key );
+  stopwatch.stop( );
+  times.insert_time = stopwatch.time( );
+
+  stopwatch.reset( );
+  stopwatch.start( );
+  for( int i = 0; i < LOOKUPS; ++i ) {
+    if( table.find( keys[i % count] ) != table.end( ) ) ++found;
+  }
+  stopwatch.stop( );
+  times.hit_time = stopwatch.time( );
+
+  stopwatch.reset( );
+  stopwatch.start( );
+  for( int i = 0; i < LOOKUPS; ++i ) {
+    if( table.find( keys[i % count] + 1 ) != table.end( ) ) ++found;
+  }
+  stopwatch.stop( );
+  times.miss_time = stopwatch.time( );
+
+  stopwatch.reset( );
+  stopwatch.start( );
+  for( int i = 0; i < count; i += 2 ) table.erase( keys[i] );
+  stopwatch.stop( );
+  times.erase_time = stopwatch.time( );
+
+  times.checksum = found + static_cast<long>( table.size( ) );
+  return times;
+}
+
+void report( const char *name, int count, const results &times )
+{
+  std::cout << std::setw( 20 ) << name
+            << "; N = " << std::setw( 8 ) << count
+            << "; Insert = " << std::setw( 5 ) << times.insert_time << "ms"
+            << "; Hit = "    << std::setw( 5 ) << times.hit_time    << "ms"
+            << "; Miss = "   << std::setw( 5 ) << times.miss_time   << "ms"
+            << "; Erase = "  << std::setw( 5 ) << times.erase_time  << "ms"
+            << " (" << times.checksum << ")"
+            << std::endl;
+}
+
+
+//
+// Main program just exercises each test.
+//
+int main( )
+{
+  std::srand( 0 );
+
+  for( int count = 1000; count <= 4000000; count *= 4 ) {
+    std::vector<int> keys = make_keys( count );
+    {
+      spica::HashtableOpen<int> table( 8, hash_int );
+      report( "HashtableOpen", count, run( table, keys ) );
+    }
+    {
+      std::unordered_set<int> table;
+      report( "std::unordered_set", count, run( table, keys ) );
+    }
+    std::cout << std::endl;
+  }
+  return 0;
+}
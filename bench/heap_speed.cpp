@@ -0,0 +1,214 @@
+/*! \file    heap_speed.cpp
+ *  \brief   Compares the priority queue templates on several mixes of operations.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ *
+ * This file contains a program that times BinomialHeap, PairingHeap, FibonacciHeap, and
+ * DaryHeap (with arities 2, 4, and 8) on four workloads: pushing N random items and then
+ * popping them all, a "hold" model that keeps N items in the heap while alternately popping
+ * the front and pushing a slightly larger item, merging MERGE_COUNT small heaps into one, and
+ * Dijkstra's algorithm on a random graph with N vertices and EDGE_FACTOR * N edges. The heaps
+ * with handles run Dijkstra's algorithm with decrease_key; DaryHeap pushes duplicate entries
+ * instead and skips the stale ones as they are popped. The value of N can be given on the
+ * command line; the default is 1000000. Build with something like:
+ *
+ *     g++ -std=c++20 -O2 -I. bench/heap_speed.cpp Timer.cpp -o heap_speed
+ */
+
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <utility>
+#include <vector>
+#include "BinomialHeap.hpp"
+#include "DaryHeap.hpp"
+#include "FibonacciHeap.hpp"
+#include "PairingHeap.hpp"
+#include "Timer.hpp"
+
+// Default number of items (and number of graph vertices).
+const long ITEM_COUNT = 1000000;
+
+// Number of small heaps merged together and the size of each.
+const int MERGE_COUNT = 10000;
+const int MERGE_SIZE  = 20;
+
+// Average number of edges leaving each vertex.
+const int EDGE_FACTOR = 8;
+
+struct Edge {
+  int  target;
+  long weight;
+};
+
+typedef std::vector< std::vector<Edge> > AdjacencyList;
+typedef std::pair<long, int> Entry;   // (distance, vertex)
+
+// Dijkstra's algorithm using decrease_key.
+template<typename Heap>
+long long dijkstra( const AdjacencyList &graph )
+{
+  const long infinity = std::numeric_limits<long>::max( );
+  std::vector<long> distance( graph.size( ), infinity );
+  std::vector<typename Heap::handle> handles( graph.size( ) );
+  std::vector<bool> queued( graph.size( ), false );
+  Heap queue;
+
+  distance[0] = 0;
+  handles[0] = queue.push( Entry( 0, 0 ) );
+  queued[0] = true;
+  while( !queue.empty( ) ) {
+    int vertex = queue.front( ).second;
+    queue.pop( );
+    queued[vertex] = false;
+    for( const Edge &edge : graph[vertex] ) {
+      long new_distance = distance[vertex] + edge.weight;
+      if( new_distance >= distance[edge.target] ) continue;
+      if( queued[edge.target] ) {
+        queue.decrease_key( handles[edge.target], Entry( new_distance, edge.target ) );
+      }
+      else if( distance[edge.target] == infinity ) {
+        handles[edge.target] = queue.push( Entry( new_distance, edge.target ) );
+        queued[edge.target] = true;
+      }
+      distance[edge.target] = new_distance;
+    }
+  }
+
+  long long checksum = 0;
+  for( long d : distance ) if( d != infinity ) checksum += d;
+  return checksum;
+}
+
+// Dijkstra's algorithm pushing duplicate entries (for heaps without handles).
+template<typename Heap>
+long long dijkstra_lazy( const AdjacencyList &graph )
+{
+  const long infinity = std::numeric_limits<long>::max( );
+  std::vector<long> distance( graph.size( ), infinity );
+  Heap queue;
+
+  distance[0] = 0;
+  queue.push( Entry( 0, 0 ) );
+  while( !queue.empty( ) ) {
+    Entry current = queue.front( );
+    queue.pop( );
+    if( current.first != distance[current.second] ) continue;
+    for( const Edge &edge : graph[current.second] ) {
+      long new_distance = current.first + edge.weight;
+      if( new_distance >= distance[edge.target] ) continue;
+      distance[edge.target] = new_distance;
+      queue.push( Entry( new_distance, edge.target ) );
+    }
+  }
+
+  long long checksum = 0;
+  for( long d : distance ) if( d != infinity ) checksum += d;
+  return checksum;
+}
+
+template<typename IntHeap, typename EntryHeap, bool has_handles>
+void run( const char *name, const std::vector<int> &items, const AdjacencyList &graph )
+{
+  spica::Timer stopwatch;
+  long push_pop_time, hold_time, merge_time, dijkstra_time;
+  long long checksum = 0;
+
+  // Push everything and then pop everything.
+  {
+    IntHeap heap;
+    stopwatch.start( );
+    for( int item : items ) heap.push( item );
+    while( !heap.empty( ) ) {
+      checksum += heap.front( );
+      heap.pop( );
+    }
+    stopwatch.stop( );
+    push_pop_time = stopwatch.time( );
+  }
+
+  // The hold model: the heap stays the same size while the front item moves forward.
+  {
+    IntHeap heap;
+    for( int item : items ) heap.push( item );
+    stopwatch.reset( );
+    stopwatch.start( );
+    for( int item : items ) {
+      int front = heap.front( );
+      heap.pop( );
+      heap.push( front + item % 1024 );
+    }
+    stopwatch.stop( );
+    hold_time = stopwatch.time( );
+    checksum += heap.front( );
+  }
+
+  // Merge many small heaps into one.
+  {
+    std::vector<IntHeap> heaps( MERGE_COUNT );
+    for( int i = 0; i < MERGE_COUNT; ++i ) {
+      for( int j = 0; j < MERGE_SIZE; ++j ) heaps[i].push( items[( i * MERGE_SIZE + j ) % items.size( )] );
+    }
+    IntHeap result;
+    stopwatch.reset( );
+    stopwatch.start( );
+    for( IntHeap &heap : heaps ) result.merge( heap );
+    stopwatch.stop( );
+    merge_time = stopwatch.time( );
+    checksum += static_cast<long long>( result.size( ) );
+  }
+
+  stopwatch.reset( );
+  stopwatch.start( );
+  if constexpr( has_handles ) checksum += dijkstra<EntryHeap>( graph );
+  else checksum += dijkstra_lazy<EntryHeap>( graph );
+  stopwatch.stop( );
+  dijkstra_time = stopwatch.time( );
+
+  std::cout << std::setw( 14 ) << name
+            << ": Push/Pop = " << std::setw( 6 ) << std::setprecision( 3 ) << push_pop_time / 1000.0 << "s"
+            << "; Hold = "     << std::setw( 6 ) << std::setprecision( 3 ) << hold_time     / 1000.0 << "s"
+            << "; Merge = "    << std::setw( 6 ) << std::setprecision( 3 ) << merge_time    / 1000.0 << "s"
+            << "; Dijkstra = " << std::setw( 6 ) << std::setprecision( 3 ) << dijkstra_time / 1000.0 << "s"
+            << " (" << checksum << ")" << std::endl;
+}
+
+
+//
+// Main program just exercises each test.
+//
+int main( int argc, char **argv )
+{
+  using spica::BinomialHeap;
+  using spica::DaryHeap;
+  using spica::FibonacciHeap;
+  using spica::PairingHeap;
+
+  long count = ( argc > 1 ) ? std::atol( argv[1] ) : ITEM_COUNT;
+  std::mt19937 generator( 42 );
+  std::vector<int> items( count );
+  for( int &item : items ) item = static_cast<int>( generator( ) % 1000000000 );
+
+  AdjacencyList graph( count );
+  for( long i = 0; i < count * EDGE_FACTOR; ++i ) {
+    int source = static_cast<int>( generator( ) % count );
+    Edge edge = { static_cast<int>( generator( ) % count ), static_cast<long>( generator( ) % 1000 ) + 1 };
+    graph[source].push_back( edge );
+  }
+
+  std::cout << std::setiosflags( std::ios::fixed );
+  std::cout << "Items = " << count << "; Merges = " << MERGE_COUNT << " x " << MERGE_SIZE
+            << "; Edges = " << count * EDGE_FACTOR << std::endl;
+
+  run< BinomialHeap<int>,  BinomialHeap<Entry>,  true >( "BinomialHeap", items, graph );
+  run< PairingHeap<int>,   PairingHeap<Entry>,   true >( "PairingHeap", items, graph );
+  run< FibonacciHeap<int>, FibonacciHeap<Entry>, true >( "FibonacciHeap", items, graph );
+  run< DaryHeap<int, std::less<int>, std::allocator<int>, 2>,
+       DaryHeap<Entry, std::less<Entry>, std::allocator<Entry>, 2>, false >( "DaryHeap (2)", items, graph );
+  run< DaryHeap<int>, DaryHeap<Entry>, false >( "DaryHeap (4)", items, graph );
+  run< DaryHeap<int, std::less<int>, std::allocator<int>, 8>,
+       DaryHeap<Entry, std::less<Entry>, std::allocator<Entry>, 8>, false >( "DaryHeap (8)", items, graph );
+  return 0;
+}
@@ -0,0 +1,96 @@
+/*! \file    list_sort_speed.cpp
+ *  \brief   Compares SingleList::sort with sorting a copy of the list in a vector.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ *
+ * This file contains a program that fills a SingleList with N random integers and sorts it
+ * two ways: with SingleList::sort, which relinks the nodes, and by copying the items into a
+ * std::vector, sorting the vector with std::stable_sort, and copying the items back into the
+ * nodes. Each method is timed on a list whose nodes were allocated in order and on a list
+ * whose nodes are scattered in memory (the nodes of a list that was built in order and then
+ * sorted by a random key). The value of N can be given on the command line; the default is
+ * 10000000. Build with something like:
+ *
+ *     g++ -std=c++20 -O2 -I. bench/list_sort_speed.cpp Timer.cpp -o list_sort_speed
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <utility>
+#include <vector>
+#include "SingleList.hpp"
+#include "Timer.hpp"
+
+// Default number of nodes.
+const long NODE_COUNT = 10000000;
+
+// Fills the list with random numbers. If scattered, the nodes are shuffled in memory.
+void fill( spica::SingleList<long> &list, long count, bool scattered )
+{
+  std::mt19937_64 generator( 42 );
+  if( !scattered ) {
+    for( long i = 0; i < count; ++i ) list.push_back( static_cast<long>( generator( ) % 1000000000 ) );
+    return;
+  }
+
+  // Sort by a random key so the node order no longer follows the allocation order, then
+  // overwrite the items.
+  for( long i = 0; i < count; ++i ) list.push_back( static_cast<long>( generator( ) ) );
+  list.sort( );
+  for( long &item : list ) item = static_cast<long>( generator( ) % 1000000000 );
+}
+
+long list_sort( spica::SingleList<long> &list )
+{
+  spica::Timer stopwatch;
+  stopwatch.start( );
+  list.sort( );
+  stopwatch.stop( );
+  return stopwatch.time( );
+}
+
+long vector_sort( spica::SingleList<long> &list )
+{
+  spica::Timer stopwatch;
+  stopwatch.start( );
+  std::vector<long> items( list.begin( ), list.end( ) );
+  std::stable_sort( items.begin( ), items.end( ) );
+  std::copy( items.begin( ), items.end( ), list.begin( ) );
+  stopwatch.stop( );
+  return stopwatch.time( );
+}
+
+template<typename Sorter>
+void run( const char *name, long count, bool scattered, Sorter sorter )
+{
+  spica::SingleList<long> list;
+  fill( list, count, scattered );
+  long milliseconds = sorter( list );
+
+  // Check the result and make sure the sort isn't optimized away.
+  bool sorted = std::is_sorted( list.begin( ), list.end( ) );
+  std::cout << std::setw( 24 ) << name
+            << ( scattered ? " (scattered)" : " (in order) " )
+            << ": Time = " << std::setw( 7 ) << std::setprecision( 3 ) << milliseconds / 1000.0 << "s"
+            << ( sorted ? "" : " NOT SORTED" ) << std::endl;
+}
+
+
+//
+// Main program just exercises each test.
+//
+int main( int argc, char **argv )
+{
+  long count = ( argc > 1 ) ? std::atol( argv[1] ) : NODE_COUNT;
+
+  std::cout << std::setiosflags( std::ios::fixed );
+  std::cout << "Nodes = " << count << std::endl;
+
+  for( bool scattered : { false, true } ) {
+    run( "SingleList::sort", count, scattered, list_sort );
+    run( "vector/stable_sort/copy", count, scattered, vector_sort );
+  }
+  return 0;
+}
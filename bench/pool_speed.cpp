@@ -0,0 +1,148 @@
+/*! \file    pool_speed.cpp
+ *  \brief   Compares node based containers with and without PoolAllocator.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ *
+ * This file contains a program that fills a SingleList, a BinaryTree, and a BinomialHeap with
+ * N items, iterates over them, and then clears them. Each container is tried with the default
+ * allocator and with PoolAllocator. The keys for the tree are shuffled so that it stays
+ * reasonably balanced. The number of items can be given on the command line; the default is
+ * 10000000. Build with something like:
+ *
+ *     g++ -std=c++20 -O2 -I. bench/pool_speed.cpp PoolAllocator.cpp Timer.cpp -o pool_speed
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+#include "BinaryTree.hpp"
+#include "BinomialHeap.hpp"
+#include "PoolAllocator.hpp"
+#include "SingleList.hpp"
+#include "Timer.hpp"
+
+// Default number of items.
+const long ITEM_COUNT = 10000000;
+
+struct times {
+  long insert;
+  long iterate;
+  long clear;
+};
+
+void report( const char *name, const times &result, long long checksum )
+{
+  std::cout << std::setw( 28 ) << name
+            << ": Insert = "  << std::setw( 7 ) << std::setprecision( 3 ) << result.insert  / 1000.0 << "s"
+            << "; Iterate = " << std::setw( 7 ) << std::setprecision( 3 ) << result.iterate / 1000.0 << "s"
+            << "; Clear = "   << std::setw( 7 ) << std::setprecision( 3 ) << result.clear   / 1000.0 << "s"
+            << " (" << checksum << ")" << std::endl;
+}
+
+template<typename List>
+void list_test( const char *name, const std::vector<int> &keys )
+{
+  spica::Timer stopwatch;
+  times result;
+  long long checksum = 0;
+  List list;
+
+  stopwatch.start( );
+  for( int key : keys ) list.push_back( key );
+  stopwatch.stop( );
+  result.insert = stopwatch.time( );
+
+  stopwatch.reset( );
+  stopwatch.start( );
+  for( int item : list ) checksum += item;
+  stopwatch.stop( );
+  result.iterate = stopwatch.time( );
+
+  stopwatch.reset( );
+  stopwatch.start( );
+  list.clear( );
+  stopwatch.stop( );
+  result.clear = stopwatch.time( );
+  report( name, result, checksum );
+}
+
+template<typename Tree>
+void tree_test( const char *name, const std::vector<int> &keys )
+{
+  spica::Timer stopwatch;
+  times result;
+  long long checksum = 0;
+  Tree tree;
+
+  stopwatch.start( );
+  for( int key : keys ) tree.insert( key );
+  stopwatch.stop( );
+  result.insert = stopwatch.time( );
+
+  stopwatch.reset( );
+  stopwatch.start( );
+  for( typename Tree::iterator p = tree.begin( ); p != tree.end( ); ++p ) checksum += *p;
+  stopwatch.stop( );
+  result.iterate = stopwatch.time( );
+
+  stopwatch.reset( );
+  stopwatch.start( );
+  tree.clear( );
+  stopwatch.stop( );
+  result.clear = stopwatch.time( );
+  report( name, result, checksum );
+}
+
+template<typename Heap>
+void heap_test( const char *name, const std::vector<int> &keys )
+{
+  spica::Timer stopwatch;
+  times result;
+  long long checksum = 0;
+  Heap heap;
+
+  stopwatch.start( );
+  for( int key : keys ) heap.insert( key );
+  stopwatch.stop( );
+  result.insert = stopwatch.time( );
+
+  stopwatch.reset( );
+  stopwatch.start( );
+  for( typename Heap::iterator p = heap.begin( ); p != heap.end( ); ++p ) checksum += *p;
+  stopwatch.stop( );
+  result.iterate = stopwatch.time( );
+
+  stopwatch.reset( );
+  stopwatch.start( );
+  heap.clear( );
+  stopwatch.stop( );
+  result.clear = stopwatch.time( );
+  report( name, result, checksum );
+}
+
+
+//
+// Main program just exercises each test.
+//
+int main( int argc, char **argv )
+{
+  long count = ( argc > 1 ) ? std::atol( argv[1] ) : ITEM_COUNT;
+  std::vector<int> keys( count );
+  for( long i = 0; i < count; ++i ) keys[i] = static_cast<int>( i );
+  std::shuffle( keys.begin( ), keys.end( ), std::mt19937( 42 ) );
+
+  std::cout << std::setiosflags( std::ios::fixed );
+  std::cout << "Items = " << count << std::endl;
+
+  list_test< spica::SingleList<int> >( "SingleList", keys );
+  list_test< spica::SingleList<int, spica::PoolAllocator<int>> >( "SingleList (pool)", keys );
+  tree_test< spica::BinaryTree<int> >( "BinaryTree", keys );
+  tree_test< spica::BinaryTree<int, std::less<int>, spica::PoolAllocator<int>> >( "BinaryTree (pool)", keys );
+  heap_test< spica::BinomialHeap<int> >( "BinomialHeap", keys );
+  heap_test< spica::BinomialHeap<int, std::less<int>, spica::PoolAllocator<int>> >( "BinomialHeap (pool)", keys );
+  return 0;
+}
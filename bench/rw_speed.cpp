@@ -0,0 +1,130 @@
+/*! \file    rw_speed.cpp
+ *  \brief   Measures the performance of the reader/writer semaphores.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ *
+ * This file contains a program that compares mutex_sem, rw_sem, and br_sem when protecting a
+ * small shared table that is read 99% of the time and written 1% of the time, and then
+ * compares the read throughput of rw_sem and br_sem when the table is only read. The number
+ * of threads is varied from 1 to 64. Build with something like:
+ *
+ *     g++ -std=c++20 -O2 -I. bench/rw_speed.cpp synchronize.cpp Timer.cpp -o rw_speed
+ */
+
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "synchronize.hpp"
+#include "Timer.hpp"
+
+// Total number of lock operations done for each test (divided among the threads).
+const long OPERATIONS = 4000000L;
+
+// Every WRITE_PERIOD-th operation of the mixed workload is a write.
+const int WRITE_PERIOD = 100;
+
+// The shared data. Readers sum it; writers update it.
+const int TABLE_SIZE = 16;
+long table[TABLE_SIZE];
+
+// Adapters so that each semaphore can be used by the same test driver.
+struct mutex_adapter {
+  spica::mutex_sem sem;
+  void r_lock( )   { sem.lock( ); }
+  void r_unlock( ) { sem.unlock( ); }
+  void w_lock( )   { sem.lock( ); }
+  void w_unlock( ) { sem.unlock( ); }
+};
+
+struct rw_adapter {
+  spica::rw_sem sem;
+  void r_lock( )   { sem.r_lock( ); }
+  void r_unlock( ) { sem.r_unlock( ); }
+  void w_lock( )   { sem.w_lock( ); }
+  void w_unlock( ) { sem.w_unlock( ); }
+};
+
+struct br_adapter {
+  spica::br_sem sem;
+  void r_lock( )   { sem.r_lock( ); }
+  void r_unlock( ) { sem.r_unlock( ); }
+  void w_lock( )   { sem.w_lock( ); }
+  void w_unlock( ) { sem.w_unlock( ); }
+};
+
+
+//
+// Runs the workload with the given number of threads and returns the elapsed time in
+// milliseconds. Every write_period-th operation is a write, or none if write_period is zero.
+//
+template<typename Lock>
+long run_test( int thread_count, int write_period )
+{
+  Lock lock;
+  std::vector<std::thread> threads;
+  spica::Timer stopwatch;
+  long per_thread = OPERATIONS / thread_count;
+
+  stopwatch.start( );
+  for( int t = 0; t < thread_count; ++t ) {
+    threads.emplace_back( [&lock, per_thread, t, write_period]( ) {
+      volatile long sink = 0;
+      for( long i = 0; i < per_thread; ++i ) {
+        if( write_period != 0 && ( i + t ) % write_period == 0 ) {
+          lock.w_lock( );
+          for( int j = 0; j < TABLE_SIZE; ++j ) table[j] += j;
+          lock.w_unlock( );
+        }
+        else {
+          long sum = 0;
+          lock.r_lock( );
+          for( int j = 0; j < TABLE_SIZE; ++j ) sum += table[j];
+          lock.r_unlock( );
+          sink = sum;
+        }
+      }
+      (void)sink;
+    } );
+  }
+  for( std::thread &thread : threads ) thread.join( );
+  stopwatch.stop( );
+  return stopwatch.time( );
+}
+
+
+void report( const char *name, int thread_count, long milliseconds )
+{
+  double seconds = milliseconds / 1000.0;
+  double rate = ( seconds > 0.0 ) ? OPERATIONS / seconds / 1.0e6 : 0.0;
+  std::cout << std::setw( 10 ) << name
+            << "; Threads = " << std::setw( 2 ) << thread_count
+            << "; Time = " << std::setw( 7 ) << std::setprecision( 3 ) << seconds << "s"
+            << "; Rate = " << std::setw( 7 ) << std::setprecision( 2 ) << rate << " Mops/s"
+            << std::endl;
+}
+
+
+//
+// Main program just exercises each test.
+//
+int main( )
+{
+  std::cout << std::setiosflags( std::ios::fixed );
+
+  std::cout << "99% reads, 1% writes" << std::endl;
+  for( int thread_count = 1; thread_count <= 64; thread_count *= 2 ) {
+    report( "mutex_sem", thread_count, run_test<mutex_adapter>( thread_count, WRITE_PERIOD ) );
+    report( "rw_sem",    thread_count, run_test<rw_adapter>( thread_count, WRITE_PERIOD ) );
+    report( "br_sem",    thread_count, run_test<br_adapter>( thread_count, WRITE_PERIOD ) );
+    std::cout << std::endl;
+  }
+
+  std::cout << "Reads only" << std::endl;
+  for( int thread_count = 1; thread_count <= 64; thread_count *= 2 ) {
+    report( "rw_sem", thread_count, run_test<rw_adapter>( thread_count, 0 ) );
+    report( "br_sem", thread_count, run_test<br_adapter>( thread_count, 0 ) );
+    std::cout << std::endl;
+  }
+
+  return 0;
+}
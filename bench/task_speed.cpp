@@ -0,0 +1,125 @@
+/*! \file    task_speed.cpp
+ *  \brief   Compares coroutine tasks with blocking ThreadPool work.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ *
+ * This file contains a program that runs a number of jobs on a ThreadPool. Each job waits for a
+ * simulated I/O operation and then does a small computation. The blocking version uses
+ * start_work/work_result and sleeps in the worker. The coroutine version awaits sleep_for so
+ * that the worker is free to run other jobs while the "I/O" is pending. Build with something
+ * like:
+ *
+ *     g++ -std=c++20 -O2 -I. bench/task_speed.cpp task.cpp ThreadPool.cpp Semaphore.cpp \
+ *         synchronize.cpp Timer.cpp -lboost_thread -lboost_system -o task_speed
+ */
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "task.hpp"
+#include "ThreadPool.hpp"
+#include "Timer.hpp"
+#include "WorkQueue.hpp"
+
+// Number of jobs in each test.
+const int JOB_COUNT = 400;
+
+// Simulated I/O time for each job, in milliseconds.
+const long IO_TIME = 5;
+
+// Number of loop iterations in each job's computation.
+const long WORK_SIZE = 20000;
+
+long compute( int job )
+{
+  long sum = 0;
+  for( long i = 0; i < WORK_SIZE; ++i ) sum += ( i ^ job ) & 0xFF;
+  return sum;
+}
+
+
+//
+// The blocking version. Jobs are started in batches of one per worker and each batch must be
+// collected before the next can start.
+//
+long blocking_test( spica::ThreadPool &pool )
+{
+  spica::Timer stopwatch;
+  std::vector<long> results( JOB_COUNT );
+  std::vector<spica::ThreadPool::threadid_t> ids;
+
+  stopwatch.start( );
+  for( int first = 0; first < JOB_COUNT; first += pool.count( ) ) {
+    ids.clear( );
+    for( int job = first; job < JOB_COUNT && job < first + pool.count( ); ++job ) {
+      ids.push_back( pool.start_work( [job, &results]( ) {
+        std::this_thread::sleep_for( std::chrono::milliseconds( IO_TIME ) );
+        results[job] = compute( job );
+      } ) );
+    }
+    for( spica::ThreadPool::threadid_t id : ids ) pool.work_result( id );
+  }
+  stopwatch.stop( );
+  return stopwatch.time( );
+}
+
+
+//
+// The coroutine version. All jobs are started at once and report through a WorkQueue.
+//
+spica::task<> coroutine_job( spica::ThreadPool &pool, spica::WorkQueue<long> &done, int job )
+{
+  co_await spica::sleep_for( pool, IO_TIME );
+  done.push( compute( job ) );
+}
+
+spica::task<long> coroutine_driver( spica::ThreadPool &pool )
+{
+  spica::WorkQueue<long> done( JOB_COUNT );
+  for( int job = 0; job < JOB_COUNT; ++job ) spica::spawn( coroutine_job( pool, done, job ) );
+
+  long total = 0;
+  for( int job = 0; job < JOB_COUNT; ++job ) total += co_await done.pop_async( pool );
+  co_return total;
+}
+
+long coroutine_test( spica::ThreadPool &pool )
+{
+  spica::Timer stopwatch;
+
+  stopwatch.start( );
+  spica::sync_wait( coroutine_driver( pool ) );
+  stopwatch.stop( );
+  return stopwatch.time( );
+}
+
+
+void report( const char *name, int thread_count, long milliseconds )
+{
+  double seconds = milliseconds / 1000.0;
+  double rate = ( seconds > 0.0 ) ? JOB_COUNT / seconds : 0.0;
+  std::cout << std::setw( 10 ) << name
+            << "; Threads = " << std::setw( 2 ) << thread_count
+            << "; Time = " << std::setw( 7 ) << std::setprecision( 3 ) << seconds << "s"
+            << "; Rate = " << std::setw( 9 ) << std::setprecision( 1 ) << rate << " jobs/s"
+            << std::endl;
+}
+
+
+//
+// Main program just exercises each test.
+//
+int main( )
+{
+  std::cout << std::setiosflags( std::ios::fixed );
+
+  for( int thread_count = 1; thread_count <= 8; thread_count *= 2 ) {
+    spica::ThreadPool pool( thread_count );
+    report( "blocking",  thread_count, blocking_test( pool ) );
+    report( "coroutine", thread_count, coroutine_test( pool ) );
+    std::cout << std::endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,104 @@
+/*! \file    tree_speed.cpp
+ *  \brief   Compares the balancing modes of BinaryTree with std::set.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ *
+ * This file contains a program that inserts N sorted keys and then N shuffled keys into an
+ * unbalanced BinaryTree, a red-black BinaryTree, an AVL BinaryTree, and a std::set. It reports
+ * the time to insert the keys, to find each of them, to iterate over the tree, and to destroy
+ * it. Sorted keys make the unbalanced tree a linked list, so it takes quadratic time; it is
+ * only given the first SORTED_LIMIT sorted keys. The number of keys can be given on the
+ * command line; the default is 10000000. Build with something like:
+ *
+ *     g++ -std=c++20 -O2 -I. bench/tree_speed.cpp Timer.cpp -o tree_speed
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <set>
+#include <vector>
+#include "BinaryTree.hpp"
+#include "Timer.hpp"
+
+// Default number of keys.
+const long KEY_COUNT = 10000000;
+
+// Largest number of sorted keys given to the unbalanced tree.
+const long SORTED_LIMIT = 50000;
+
+template<typename Tree>
+void run( const char *name, const char *order, const std::vector<int> &keys )
+{
+  spica::Timer stopwatch;
+  long insert_time, find_time, iterate_time, destroy_time;
+  long long checksum = 0;
+
+  Tree *tree = new Tree;
+  stopwatch.start( );
+  for( int key : keys ) tree->insert( key );
+  stopwatch.stop( );
+  insert_time = stopwatch.time( );
+
+  stopwatch.reset( );
+  stopwatch.start( );
+  for( int key : keys ) {
+    if( tree->find( key ) != tree->end( ) ) ++checksum;
+  }
+  stopwatch.stop( );
+  find_time = stopwatch.time( );
+
+  stopwatch.reset( );
+  stopwatch.start( );
+  for( typename Tree::iterator p = tree->begin( ); p != tree->end( ); ++p ) checksum += *p;
+  stopwatch.stop( );
+  iterate_time = stopwatch.time( );
+
+  stopwatch.reset( );
+  stopwatch.start( );
+  delete tree;
+  stopwatch.stop( );
+  destroy_time = stopwatch.time( );
+
+  std::cout << std::setw( 12 ) << name << std::setw( 10 ) << order
+            << "; N = " << std::setw( 9 ) << keys.size( )
+            << "; Insert = "  << std::setw( 7 ) << std::setprecision( 3 ) << insert_time  / 1000.0 << "s"
+            << "; Find = "    << std::setw( 7 ) << std::setprecision( 3 ) << find_time    / 1000.0 << "s"
+            << "; Iterate = " << std::setw( 6 ) << std::setprecision( 3 ) << iterate_time / 1000.0 << "s"
+            << "; Destroy = " << std::setw( 6 ) << std::setprecision( 3 ) << destroy_time / 1000.0 << "s"
+            << " (" << checksum << ")" << std::endl;
+}
+
+template<spica::tree_balance Balance>
+using Tree = spica::BinaryTree< int, std::less<int>, std::allocator<int>, Balance >;
+
+
+//
+// Main program just exercises each test.
+//
+int main( int argc, char **argv )
+{
+  long count = ( argc > 1 ) ? std::atol( argv[1] ) : KEY_COUNT;
+  std::vector<int> sorted( count );
+  for( long i = 0; i < count; ++i ) sorted[i] = static_cast<int>( i );
+  std::vector<int> shuffled( sorted );
+  std::shuffle( shuffled.begin( ), shuffled.end( ), std::mt19937( 42 ) );
+  std::vector<int> few_sorted( sorted.begin( ), sorted.begin( ) + std::min( count, SORTED_LIMIT ) );
+
+  std::cout << std::setiosflags( std::ios::fixed );
+
+  run< Tree<spica::tree_balance::none> >( "unbalanced", "sorted", few_sorted );
+  run< Tree<spica::tree_balance::red_black> >( "red-black", "sorted", few_sorted );
+  run< Tree<spica::tree_balance::red_black> >( "red-black", "sorted", sorted );
+  run< Tree<spica::tree_balance::avl> >( "AVL", "sorted", sorted );
+  run< std::set<int> >( "std::set", "sorted", sorted );
+
+  run< Tree<spica::tree_balance::none> >( "unbalanced", "random", shuffled );
+  run< Tree<spica::tree_balance::red_black> >( "red-black", "random", shuffled );
+  run< Tree<spica::tree_balance::avl> >( "AVL", "random", shuffled );
+  run< std::set<int> >( "std::set", "random", shuffled );
+  return 0;
+}
@@ -0,0 +1,97 @@
+/*! \file    unrolled_speed.cpp
+ *  \brief   Compares UnrolledList with SingleList and std::list.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ *
+ * This file contains a program that appends N integers to each kind of list, traverses the
+ * list PASS_COUNT times, makes one pass over the list inserting a new item before every
+ * fourth item, and then traverses the (larger) list PASS_COUNT times again. The value of N
+ * can be given on the command line; the default is 1000000. Build with something like:
+ *
+ *     g++ -std=c++20 -O2 -I. bench/unrolled_speed.cpp Timer.cpp -o unrolled_speed
+ */
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <list>
+#include "SingleList.hpp"
+#include "Timer.hpp"
+#include "UnrolledList.hpp"
+
+// Default number of items.
+const long ITEM_COUNT = 1000000;
+
+// Number of times the list is traversed for each measurement.
+const int PASS_COUNT = 20;
+
+template<typename List>
+long long traverse( List &list )
+{
+  long long sum = 0;
+  for( int pass = 0; pass < PASS_COUNT; ++pass ) {
+    for( typename List::iterator p = list.begin( ); p != list.end( ); ++p ) sum += *p;
+  }
+  return sum;
+}
+
+template<typename List>
+void run( const char *name, long count )
+{
+  spica::Timer stopwatch;
+  long append_time, traverse_time, insert_time, after_time;
+  long long checksum = 0;
+
+  List list;
+  stopwatch.start( );
+  for( long i = 0; i < count; ++i ) list.push_back( static_cast<int>( i ) );
+  stopwatch.stop( );
+  append_time = stopwatch.time( );
+
+  stopwatch.reset( );
+  stopwatch.start( );
+  checksum += traverse( list );
+  stopwatch.stop( );
+  traverse_time = stopwatch.time( );
+
+  // SingleList::insert updates p to keep pointing at the same item. For std::list p is not
+  // affected by the insertion.
+  stopwatch.reset( );
+  stopwatch.start( );
+  long position = 0;
+  for( typename List::iterator p = list.begin( ); p != list.end( ); ++p, ++position ) {
+    if( position % 4 == 0 ) list.insert( p, -1 );
+  }
+  stopwatch.stop( );
+  insert_time = stopwatch.time( );
+
+  stopwatch.reset( );
+  stopwatch.start( );
+  checksum += traverse( list );
+  stopwatch.stop( );
+  after_time = stopwatch.time( );
+
+  std::cout << std::setw( 20 ) << name
+            << ": Append = "   << std::setw( 6 ) << std::setprecision( 3 ) << append_time   / 1000.0 << "s"
+            << "; Traverse = " << std::setw( 6 ) << std::setprecision( 3 ) << traverse_time / 1000.0 << "s"
+            << "; Insert = "   << std::setw( 6 ) << std::setprecision( 3 ) << insert_time   / 1000.0 << "s"
+            << "; Traverse = " << std::setw( 6 ) << std::setprecision( 3 ) << after_time    / 1000.0 << "s"
+            << " (" << checksum << ")" << std::endl;
+}
+
+
+//
+// Main program just exercises each test.
+//
+int main( int argc, char **argv )
+{
+  long count = ( argc > 1 ) ? std::atol( argv[1] ) : ITEM_COUNT;
+
+  std::cout << std::setiosflags( std::ios::fixed );
+  std::cout << "Items = " << count << "; Passes = " << PASS_COUNT << std::endl;
+
+  run< spica::UnrolledList<int> >( "UnrolledList (60)", count );
+  run< spica::UnrolledList<int, 16> >( "UnrolledList (16)", count );
+  run< spica::SingleList<int> >( "SingleList", count );
+  run< std::list<int> >( "std::list", count );
+  return 0;
+}
@@ -0,0 +1,233 @@
+/*! \file    epoch.cpp
+ *  \brief   Implementation of epoch based memory reclamation.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include "epoch.hpp"
+
+namespace spica {
+
+    namespace {
+
+        // Number of objects a thread retires before it first tries to reclaim some of them.
+        const std::size_t reclaim_threshold = 128;
+
+        struct retired_object {
+            void          *object;
+            void         ( *deleter )( void * );
+            std::uint64_t  epoch;   // Global epoch when the object was retired.
+        };
+
+        //
+        // One record per thread that has used the reclamation system. Records are never freed;
+        // when a thread exits its record is marked unused and later reused by a new thread.
+        //
+        struct thread_record {
+            // The announced epoch shifted left one bit. The low bit is set inside a guard.
+            std::atomic< std::uint64_t > state{ 0 };
+            std::atomic< bool >          in_use{ true };
+            thread_record               *next = nullptr;
+
+            // These members are only used by the thread that owns the record.
+            int                           nesting = 0;
+            std::vector< retired_object > limbo;
+            std::size_t                   next_scan = reclaim_threshold;  // Limbo size.
+        };
+
+        std::atomic< std::uint64_t >   global_epoch{ 0 };
+        std::atomic< thread_record * > record_list{ nullptr };
+        std::atomic< std::size_t >     pending_count{ 0 };
+
+        // Objects left behind by threads that exited before they could be deleted.
+        struct orphan_list {
+            std::mutex                    lock;
+            std::vector< retired_object > objects;
+        };
+
+        orphan_list &orphans( )
+        {
+            static orphan_list list;
+            return list;
+        }
+
+        //
+        // Deletes the objects in the list that were retired at least two epochs before the
+        // given epoch. The deleters are called after the list is updated so that a deleter can
+        // safely retire other objects.
+        //
+        void free_eligible( std::vector< retired_object > &list, std::uint64_t epoch )
+        {
+            std::vector< retired_object > eligible;
+            std::size_t kept = 0;
+            for( std::size_t i = 0; i < list.size( ); ++i ) {
+                if( list[i].epoch + 2 <= epoch )
+                    eligible.push_back( list[i] );
+                else
+                    list[kept++] = list[i];
+            }
+            list.resize( kept );
+            for( const retired_object &item : eligible ) item.deleter( item.object );
+            pending_count.fetch_sub( eligible.size( ) );
+        }
+
+        //
+        // Advances the global epoch if every thread inside a guard has announced the current
+        // epoch. Returns the global epoch after the attempt.
+        //
+        std::uint64_t try_advance( )
+        {
+            std::uint64_t epoch = global_epoch.load( );
+            for( thread_record *r = record_list.load( ); r != nullptr; r = r->next ) {
+                std::uint64_t state = r->state.load( );
+                if( ( state & 1 ) != 0 && ( state >> 1 ) != epoch ) return epoch;
+            }
+            if( global_epoch.compare_exchange_strong( epoch, epoch + 1 ) ) return epoch + 1;
+            return epoch;  // Another thread advanced it; the exchange loaded the new value.
+        }
+
+        void reclaim_orphans( std::uint64_t epoch, bool wait )
+        {
+            orphan_list &list = orphans( );
+            std::unique_lock< std::mutex > guard( list.lock, std::defer_lock );
+            if( wait ) guard.lock( ); else if( !guard.try_lock( ) ) return;
+            if( list.objects.empty( ) ) return;
+            std::vector< retired_object > objects( std::move( list.objects ) );
+            list.objects.clear( );
+            guard.unlock( );
+
+            free_eligible( objects, epoch );
+            if( !objects.empty( ) ) {
+                guard.lock( );
+                list.objects.insert( list.objects.end( ), objects.begin( ), objects.end( ) );
+            }
+        }
+
+        // Finds an unused record or adds a new one to the list.
+        thread_record *acquire_record( )
+        {
+            for( thread_record *r = record_list.load( ); r != nullptr; r = r->next ) {
+                bool expected = false;
+                if( !r->in_use.load( std::memory_order_relaxed ) &&
+                     r->in_use.compare_exchange_strong( expected, true ) ) return r;
+            }
+            thread_record *fresh = new thread_record;
+            thread_record *head  = record_list.load( );
+            do {
+                fresh->next = head;
+            } while( !record_list.compare_exchange_weak( head, fresh ) );
+            return fresh;
+        }
+
+        //
+        // Gives each thread its record and releases the record when the thread exits.
+        //
+        class record_owner {
+        public:
+            thread_record *get( )
+            {
+                if( record == nullptr ) record = acquire_record( );
+                return record;
+            }
+
+           ~record_owner( )
+            {
+                if( record == nullptr ) return;
+                std::uint64_t epoch = try_advance( );
+                free_eligible( record->limbo, epoch );
+                if( !record->limbo.empty( ) ) {
+                    orphan_list &list = orphans( );
+                    std::lock_guard< std::mutex > guard( list.lock );
+                    list.objects.insert(
+                        list.objects.end( ), record->limbo.begin( ), record->limbo.end( ) );
+                    record->limbo.clear( );
+                }
+                record->next_scan = reclaim_threshold;
+                record->state.store( 0 );
+                record->in_use.store( false );
+            }
+
+        private:
+            thread_record *record = nullptr;
+        };
+
+        thread_local record_owner local_record;
+
+    }
+
+
+    //
+    // epoch_guard
+    //
+    // The loop handles the case where the epoch advances between loading it and announcing
+    // it. Once the announcement is visible with the current epoch, the epoch can't advance
+    // more than once before this guard is destroyed.
+    //
+    epoch_guard::epoch_guard( )
+    {
+        thread_record *record = local_record.get( );
+        if( record->nesting++ > 0 ) return;
+
+        std::uint64_t epoch = global_epoch.load( );
+        for( ;; ) {
+            record->state.store( ( epoch << 1 ) | 1 );
+            std::uint64_t now = global_epoch.load( );
+            if( now == epoch ) break;
+            epoch = now;
+        }
+    }
+
+
+    epoch_guard::~epoch_guard( )
+    {
+        thread_record *record = local_record.get( );
+        if( --record->nesting > 0 ) return;
+        record->state.store( record->state.load( std::memory_order_relaxed ) & ~std::uint64_t( 1 ),
+                             std::memory_order_release );
+    }
+
+
+    //
+    // epoch_retire
+    //
+    // If a thread stays inside a guard (for example because it was preempted) the epoch can't
+    // advance and the limbo list grows. Scanning it again after every few retirements would
+    // then take quadratic time, so the next scan waits until the list has doubled.
+    //
+    void epoch_retire( void *object, void ( *deleter )( void * ) )
+    {
+        thread_record *record = local_record.get( );
+        record->limbo.push_back( retired_object{ object, deleter, global_epoch.load( ) } );
+        pending_count.fetch_add( 1 );
+        if( record->limbo.size( ) >= record->next_scan ) {
+            std::uint64_t epoch = try_advance( );
+            free_eligible( record->limbo, epoch );
+            reclaim_orphans( epoch, false );
+            record->next_scan = std::max( reclaim_threshold, 2 * record->limbo.size( ) );
+        }
+    }
+
+
+    //
+    // epoch_reclaim
+    //
+    // Objects retired in the current epoch need two advances before they can be deleted. The
+    // third attempt covers an advance made by another thread between our attempts.
+    //
+    std::size_t epoch_reclaim( )
+    {
+        thread_record *record = local_record.get( );
+        for( int i = 0; i < 3; ++i ) {
+            std::uint64_t epoch = try_advance( );
+            free_eligible( record->limbo, epoch );
+            reclaim_orphans( epoch, true );
+        }
+        return pending_count.load( );
+    }
+
+}
@@ -0,0 +1,71 @@
+/*! \file    epoch.hpp
+ *  \brief   Interface to epoch based memory reclamation.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ *
+ * Lock-free data structures let readers traverse nodes that writers are removing at the same
+ * time. A removed node can't be deleted at once because some reader might still be looking at
+ * it. Epoch based reclamation solves this problem. A thread wraps each access to a shared
+ * structure in an epoch_guard. A writer that removes a node passes it to epoch_retire instead
+ * of deleting it. The node is deleted later, after every thread that was inside a guard when
+ * the node was retired has left its guard.
+ *
+ * The library keeps a global epoch counter. A thread entering a guard announces the epoch it
+ * saw. The counter can only advance when every thread inside a guard has announced the current
+ * epoch. An object retired during epoch e is deleted once the counter reaches e + 2. At that
+ * point no thread can hold a reference to it. Guards are cheap (two atomic stores and a load)
+ * and can be nested.
+ *
+ * Retired objects are kept on a list that belongs to the retiring thread. If the thread exits
+ * with objects still on its list they are handed to a shared list and deleted by some other
+ * thread later. A thread that stays inside a guard for a long time prevents all reclamation.
+ * Guards should only cover short operations.
+ */
+
+#ifndef EPOCH_HPP
+#define EPOCH_HPP
+
+#include <cstddef>
+
+namespace spica {
+
+    //! Marks the calling thread as accessing shared objects that might be retired.
+    /*!
+        Pointers loaded from a lock-free structure while a guard exists remain valid until the
+        guard is destroyed. Guards must be destroyed by the thread that created them.
+    */
+    class epoch_guard {
+    public:
+        epoch_guard( );
+       ~epoch_guard( );
+
+    private:
+        // Inhibit copying.
+        epoch_guard( const epoch_guard & );
+        epoch_guard &operator=( const epoch_guard & );
+    };
+
+    //! Arranges for deleter( object ) to be called when no thread can be using the object.
+    /*!
+        The object must already be unreachable for threads entering a guard after this call.
+        The deleter might be called on a different thread.
+    */
+    void epoch_retire( void *object, void ( *deleter )( void * ) );
+
+    //! Arranges for the object to be deleted when no thread can be using it.
+    template<typename T>
+    void epoch_retire( T *object )
+    {
+        epoch_retire( object, []( void *p ) { delete static_cast<T *>( p ); } );
+    }
+
+    //! Tries to advance the epoch and deletes the retired objects that are now safe to delete.
+    /*!
+        Reclamation happens automatically as objects are retired. This function is useful in
+        tests and before a program checks its memory use. It must not be called inside a guard.
+        Returns the number of retired objects that are still waiting.
+    */
+    std::size_t epoch_reclaim( );
+
+}
+
+#endif
@@ -0,0 +1,199 @@
+/*! \file    lock_profile.cpp
+ *  \brief   Implementation of the lock contention profiler.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+
+#include "lock_profile.hpp"
+
+namespace spica {
+
+    //==================================
+    //           lock_histogram
+    //==================================
+
+    lock_histogram::lock_histogram( ) :
+        sample_count( 0 ), total_nanoseconds( 0 ), maximum_nanoseconds( 0 )
+    {
+        for( int i = 0; i < bucket_count; ++i ) buckets[i].store( 0, std::memory_order_relaxed );
+    }
+
+    int lock_histogram::bucket_index( unsigned long long nanoseconds )
+    {
+        // The bucket index is the number of significant bits in the duration.
+        int index = 0;
+        while( nanoseconds != 0 && index < bucket_count - 1 ) {
+            nanoseconds >>= 1;
+            ++index;
+        }
+        return index;
+    }
+
+    void lock_histogram::record( unsigned long long nanoseconds )
+    {
+        buckets[bucket_index( nanoseconds )].fetch_add( 1, std::memory_order_relaxed );
+        sample_count.fetch_add( 1, std::memory_order_relaxed );
+        total_nanoseconds.fetch_add( nanoseconds, std::memory_order_relaxed );
+
+        unsigned long long current = maximum_nanoseconds.load( std::memory_order_relaxed );
+        while( nanoseconds > current &&
+               !maximum_nanoseconds.compare_exchange_weak(
+                   current, nanoseconds, std::memory_order_relaxed ) ) ;
+    }
+
+    void lock_histogram::reset( )
+    {
+        for( int i = 0; i < bucket_count; ++i ) buckets[i].store( 0, std::memory_order_relaxed );
+        sample_count.store( 0, std::memory_order_relaxed );
+        total_nanoseconds.store( 0, std::memory_order_relaxed );
+        maximum_nanoseconds.store( 0, std::memory_order_relaxed );
+    }
+
+
+    //=================================
+    //           lock_registry
+    //=================================
+
+    // Holds all the profiles. Profiles are never removed so pointers to them stay valid.
+    class lock_registry {
+    public:
+        typedef std::map< std::string, std::unique_ptr< lock_profile > > profile_map;
+
+        // Locks may be created during static initialization so the registry is created on
+        // first use.
+        static lock_registry &instance( )
+        {
+            static lock_registry the_registry;
+            return the_registry;
+        }
+
+        lock_profile *find( const std::string &name )
+        {
+            std::lock_guard< std::mutex > guard( lock );
+            std::unique_ptr< lock_profile > &entry = profiles[name];
+            if( !entry ) entry.reset( new lock_profile( name ) );
+            return entry.get( );
+        }
+
+        std::mutex  lock;
+        profile_map profiles;
+    };
+
+    lock_profile *lock_profile::find( const std::string &name )
+    {
+        return lock_registry::instance( ).find( name );
+    }
+
+
+    //=====================================
+    //           Dump functions
+    //=====================================
+
+    namespace {
+
+        void write_json_string( std::ostream &os, const std::string &value )
+        {
+            os << '"';
+            for( char ch : value ) {
+                switch( ch ) {
+                case '"':  os << "\\\""; break;
+                case '\\': os << "\\\\"; break;
+                case '\n': os << "\\n";  break;
+                case '\t': os << "\\t";  break;
+                default:
+                    if( static_cast< unsigned char >( ch ) < 0x20 ) {
+                        os << "\\u" << std::hex << std::setw( 4 ) << std::setfill( '0' )
+                           << static_cast< int >( ch ) << std::dec << std::setfill( ' ' );
+                    }
+                    else {
+                        os << ch;
+                    }
+                    break;
+                }
+            }
+            os << '"';
+        }
+
+        void write_text( std::ostream &os, const char *label, const lock_histogram &histogram )
+        {
+            unsigned long long count = histogram.count( );
+            os << "  " << label << ": count = " << count
+               << "; total = " << histogram.total( ) << " ns"
+               << "; mean = " << ( count == 0 ? 0 : histogram.total( ) / count ) << " ns"
+               << "; max = " << histogram.maximum( ) << " ns\n";
+
+            for( int i = 0; i < lock_histogram::bucket_count; ++i ) {
+                unsigned long long n = histogram.bucket( i );
+                if( n == 0 ) continue;
+                os << "    >= " << std::setw( 20 ) << lock_histogram::bucket_lower( i )
+                   << " ns: " << n << "\n";
+            }
+        }
+
+        void write_json( std::ostream &os, const lock_histogram &histogram )
+        {
+            os << "{\"count\": " << histogram.count( )
+               << ", \"total_ns\": " << histogram.total( )
+               << ", \"max_ns\": " << histogram.maximum( )
+               << ", \"buckets\": [";
+
+            // Only non-empty buckets are written. Each is identified by its lower bound.
+            bool first = true;
+            for( int i = 0; i < lock_histogram::bucket_count; ++i ) {
+                unsigned long long n = histogram.bucket( i );
+                if( n == 0 ) continue;
+                if( !first ) os << ", ";
+                os << "{\"lower_ns\": " << lock_histogram::bucket_lower( i )
+                   << ", \"count\": " << n << "}";
+                first = false;
+            }
+            os << "]}";
+        }
+
+    }
+
+    void dump_lock_profiles( std::ostream &os, profile_format format )
+    {
+        lock_registry &registry = lock_registry::instance( );
+        std::lock_guard< std::mutex > guard( registry.lock );
+
+        if( format == profile_format::text ) {
+            for( const auto &entry : registry.profiles ) {
+                os << "Lock \"" << entry.first << "\"\n";
+                write_text( os, "wait", entry.second->wait_times( ) );
+                write_text( os, "hold", entry.second->hold_times( ) );
+            }
+        }
+        else {
+            os << "{\"locks\": [";
+            bool first = true;
+            for( const auto &entry : registry.profiles ) {
+                os << ( first ? "\n  " : ",\n  " ) << "{\"name\": ";
+                write_json_string( os, entry.first );
+                os << ", \"wait\": ";
+                write_json( os, entry.second->wait_times( ) );
+                os << ", \"hold\": ";
+                write_json( os, entry.second->hold_times( ) );
+                os << "}";
+                first = false;
+            }
+            os << "\n]}\n";
+        }
+    }
+
+    void reset_lock_profiles( )
+    {
+        lock_registry &registry = lock_registry::instance( );
+        std::lock_guard< std::mutex > guard( registry.lock );
+        for( auto &entry : registry.profiles ) {
+            entry.second->wait_times( ).reset( );
+            entry.second->hold_times( ).reset( );
+        }
+    }
+
+}
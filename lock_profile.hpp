@@ -0,0 +1,129 @@
+/*! \file    lock_profile.hpp
+ *  \brief   Interface to the lock contention profiler.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ *
+ * The lock profiler records how long threads wait for the Spica synchronization primitives and
+ * how long they hold them. Each lock is tagged with a name and every lock with the same name
+ * shares one profile. For example all WorkQueues named "jobs" contribute to the profiles
+ * "jobs.mutex", "jobs.free_slots", and "jobs.used_slots". The times are kept in histograms
+ * with power of two bucket sizes so they are cheap to update and show the shape of the
+ * distribution.
+ *
+ * The hooks in the synchronization primitives are only compiled when the symbol pLOCK_PROFILE
+ * is defined. Otherwise the set_profile_name methods do nothing and the primitives carry no
+ * extra state. The library and the programs using it must be compiled with the same setting.
+ * The registry and dump functions declared here are always available; without pLOCK_PROFILE
+ * they just report whatever profiles were updated explicitly (usually none).
+ */
+
+#ifndef LOCK_PROFILE_HPP
+#define LOCK_PROFILE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <iosfwd>
+#include <string>
+
+namespace spica {
+
+    //! Histogram of durations with power of two bucket sizes.
+    /*!
+        Bucket zero holds durations of zero nanoseconds. Bucket n (n > 0) holds durations in
+        the range [2^(n-1), 2^n) nanoseconds. Histograms can be updated by many threads at once.
+    */
+    class lock_histogram {
+    public:
+        static const int bucket_count = 64;
+
+        lock_histogram( );
+
+        //! Adds one duration to the histogram.
+        void record( unsigned long long nanoseconds );
+
+        //! Number of durations recorded.
+        unsigned long long count( ) const
+            { return sample_count.load( std::memory_order_relaxed ); }
+
+        //! Sum of all durations recorded.
+        unsigned long long total( ) const
+            { return total_nanoseconds.load( std::memory_order_relaxed ); }
+
+        //! Longest duration recorded.
+        unsigned long long maximum( ) const
+            { return maximum_nanoseconds.load( std::memory_order_relaxed ); }
+
+        //! Number of durations in the given bucket.
+        unsigned long long bucket( int index ) const
+            { return buckets[index].load( std::memory_order_relaxed ); }
+
+        //! Smallest duration that falls into the given bucket.
+        static unsigned long long bucket_lower( int index )
+            { return ( index == 0 ) ? 0 : 1ULL << ( index - 1 ); }
+
+        //! Index of the bucket that holds the given duration.
+        static int bucket_index( unsigned long long nanoseconds );
+
+        //! Removes all recorded durations.
+        void reset( );
+
+    private:
+        std::atomic<unsigned long long> buckets[bucket_count];
+        std::atomic<unsigned long long> sample_count;
+        std::atomic<unsigned long long> total_nanoseconds;
+        std::atomic<unsigned long long> maximum_nanoseconds;
+
+        // Inhibit copying.
+        lock_histogram( const lock_histogram & );
+        lock_histogram &operator=( const lock_histogram & );
+    };
+
+
+    //! Wait and hold time histograms for one named lock.
+    /*!
+        Profiles are created by the registry and live until the program ends. Locks hold
+        pointers to their profiles so that no lookup is needed when they are used.
+    */
+    class lock_profile {
+    public:
+        //! Returns the profile with the given name, creating it if necessary.
+        static lock_profile *find( const std::string &name );
+
+        const std::string &name( ) const { return profile_name; }
+
+        //! Time spent waiting to acquire the lock (zero for immediate acquisitions).
+        lock_histogram &wait_times( ) { return waits; }
+        const lock_histogram &wait_times( ) const { return waits; }
+
+        //! Time spent holding the lock. Not used by counting semaphores.
+        lock_histogram &hold_times( ) { return holds; }
+        const lock_histogram &hold_times( ) const { return holds; }
+
+    private:
+        std::string    profile_name;
+        lock_histogram waits;
+        lock_histogram holds;
+
+        explicit lock_profile( const std::string &name ) : profile_name( name ) { }
+        friend class lock_registry;
+    };
+
+
+    //! Output formats supported by dump_lock_profiles.
+    enum class profile_format { text, json };
+
+    //! Writes every profile, in order by name, to the given stream.
+    void dump_lock_profiles( std::ostream &os, profile_format format = profile_format::text );
+
+    //! Clears the histograms of every profile.
+    void reset_lock_profiles( );
+
+    //! Returns a time stamp in nanoseconds. Only differences between time stamps are meaningful.
+    inline unsigned long long profile_clock( )
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now( ).time_since_epoch( ) ).count( );
+    }
+
+}
+
+#endif
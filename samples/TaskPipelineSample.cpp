@@ -0,0 +1,90 @@
+/*! \file   TaskPipelineSample.cpp
+ *  \brief  Coroutine pipeline demonstration program.
+ *  \author Peter Chapin <spicacality@kelseymountain.org>
+ *
+ * This program shows how task, ThreadPool, WorkQueue, and Semaphore work together. A number of
+ * "fetch" coroutines simulate I/O by sleeping. A Semaphore limits how many fetches run at once.
+ * Fetched blocks are passed through a WorkQueue to "compute" coroutines that checksum them. A
+ * final WorkQueue carries the checksums back to the main task. None of the coroutines block a
+ * pool thread while waiting so a small pool can keep many requests in flight. Build with
+ * something like:
+ *
+ *     g++ -std=c++20 -I. samples/TaskPipelineSample.cpp task.cpp ThreadPool.cpp Semaphore.cpp \
+ *         synchronize.cpp -lboost_thread -lboost_system -o TaskPipelineSample
+ */
+
+#include <iostream>
+#include <vector>
+
+#include "Semaphore.hpp"
+#include "task.hpp"
+#include "ThreadPool.hpp"
+#include "WorkQueue.hpp"
+
+using namespace std;
+using namespace spica;
+
+const int BLOCK_COUNT    = 100;  // Number of blocks to fetch.
+const int BLOCK_SIZE     = 4096;
+const int MAX_FETCHES    = 8;    // Number of simulated I/O requests allowed at once.
+const int COMPUTE_STAGES = 2;
+
+// The queues are large enough that pushes from coroutines never block a pool thread.
+WorkQueue< vector< int > > fetched( BLOCK_COUNT + COMPUTE_STAGES );
+WorkQueue< long >          checksums( BLOCK_COUNT + COMPUTE_STAGES );
+Semaphore                  fetch_limit( MAX_FETCHES );
+
+
+// Simulates reading a block from a slow device.
+task< > fetch( ThreadPool &pool, int block_number )
+{
+    co_await fetch_limit.down_async( pool );
+    co_await sleep_for( pool, 10 );
+    fetch_limit.up( );
+
+    vector< int > block( BLOCK_SIZE );
+    for( int i = 0; i < BLOCK_SIZE; ++i ) block[i] = block_number * BLOCK_SIZE + i;
+    fetched.push( std::move( block ) );
+}
+
+
+// Checksums blocks until it receives an empty one.
+task< > compute( ThreadPool &pool )
+{
+    for( ;; ) {
+        vector< int > block = co_await fetched.pop_async( pool );
+        if( block.empty( ) ) break;
+
+        long sum = 0;
+        for( int value : block ) sum += value;
+        checksums.push( sum );
+    }
+}
+
+
+task< long > run_pipeline( ThreadPool &pool )
+{
+    for( int i = 0; i < COMPUTE_STAGES; ++i ) spawn( compute( pool ) );
+    for( int i = 0; i < BLOCK_COUNT; ++i ) spawn( fetch( pool, i ) );
+
+    long total = 0;
+    for( int i = 0; i < BLOCK_COUNT; ++i ) total += co_await checksums.pop_async( pool );
+
+    // Tell the compute stages to stop.
+    for( int i = 0; i < COMPUTE_STAGES; ++i ) fetched.push( vector< int >( ) );
+    co_return total;
+}
+
+
+int main( )
+{
+    ThreadPool pool( 2 );
+
+    long total    = sync_wait( run_pipeline( pool ) );
+    long n        = static_cast< long >( BLOCK_COUNT ) * BLOCK_SIZE;
+    long expected = n * ( n - 1 ) / 2;
+
+    cout << "Total of all checksums = " << total;
+    cout << ( total == expected ? " (correct)\n" : " (WRONG!)\n" );
+    return 0;
+}
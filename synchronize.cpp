@@ -3,18 +3,125 @@
  *  \author  Peter Chapin <spicacality@kelseymountain.org>
  */
 
+#include <atomic>
+#include <cerrno>
+#include <chrono>
 #include <climits>
+#include <ctime>
+#include <thread>
 #include "synchronize.hpp"
 
 namespace spica {
 
+    namespace {
+
+        // The longest delay between attempts while spinning, in pause instructions.
+        const int maximum_backoff = 64;
+
+        //
+        // Spins with exponential backoff until ready( ) returns true or the budget of pause
+        // instructions is exhausted. Returns the final value of ready( ).
+        //
+        template<typename Predicate>
+        bool spin_wait( int budget, Predicate ready )
+        {
+            int backoff = 1;
+            int spent   = 0;
+            while( spent < budget ) {
+                for( int i = 0; i < backoff; ++i ) cpu_relax( );
+                spent += backoff;
+                if( ready( ) ) return true;
+                if( backoff < maximum_backoff ) backoff *= 2;
+            }
+            return false;
+        }
+
+        //
+        // Adds to a counter that is only modified by one thread at a time (typically, the
+        // thread holding some lock). Other threads may read the counter at any time.
+        //
+        template<typename Integer>
+        inline void locked_add( std::atomic<Integer> &counter, Integer amount )
+        {
+            counter.store(
+                counter.load( std::memory_order_relaxed ) + amount, std::memory_order_relaxed );
+        }
+
+        // Returns the number of nanoseconds since the given time.
+        inline unsigned long long nanoseconds_since( std::chrono::steady_clock::time_point start )
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now( ) - start ).count( );
+        }
+
+    }
+
+
+    //==============================
+    //           mutex_sem
+    //==============================
+
+    void mutex_sem::lock_contended( )
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now( );
+
+        if( !spin_wait( spin_limit( ), [this]( ) { return try_acquire( ); } ) )
+            acquire( );
+
+        // We now own the semaphore.
+        unsigned long long waited = nanoseconds_since( start );
+        locked_add( contended_acquisitions, 1ULL );
+        locked_add( wait_nanoseconds, waited );
+
+        #if defined(pLOCK_PROFILE)
+        if( profile != 0 ) profile->wait_times( ).record( waited );
+        #endif
+    }
+
+    sem_statistics mutex_sem::statistics( ) const
+    {
+        sem_statistics result;
+        result.acquisitions           = acquisitions.load( std::memory_order_relaxed );
+        result.contended_acquisitions = contended_acquisitions.load( std::memory_order_relaxed );
+        result.wait_nanoseconds       = wait_nanoseconds.load( std::memory_order_relaxed );
+        return result;
+    }
+
+    // The counters are only updated by the owner, but the caller might be the owner, so the
+    // semaphore isn't locked here.
+    void mutex_sem::reset_statistics( )
+    {
+        acquisitions.store( 0, std::memory_order_relaxed );
+        contended_acquisitions.store( 0, std::memory_order_relaxed );
+        wait_nanoseconds.store( 0, std::memory_order_relaxed );
+    }
+
+
     //=================================
     //           counting_sem
     //=================================
 
+    sem_statistics counting_sem::statistics( ) const
+    {
+        sem_statistics result;
+        result.acquisitions           = acquisitions.load( std::memory_order_relaxed );
+        result.contended_acquisitions = contended_acquisitions.load( std::memory_order_relaxed );
+        result.wait_nanoseconds       = wait_nanoseconds.load( std::memory_order_relaxed );
+        return result;
+    }
+
+    void counting_sem::reset_statistics( )
+    {
+        acquisitions.store( 0, std::memory_order_relaxed );
+        contended_acquisitions.store( 0, std::memory_order_relaxed );
+        wait_nanoseconds.store( 0, std::memory_order_relaxed );
+    }
+
     #if eOPSYS == ePOSIX
 
-    counting_sem::counting_sem( int initial )
+    counting_sem::counting_sem( int initial, int spin_limit ) :
+        spin_budget( spin_limit ), acquisitions( 0 ), contended_acquisitions( 0 ),
+        wait_nanoseconds( 0 )
     {
         if( initial < 0 ) initial = 0;
 
@@ -29,22 +136,139 @@ namespace spica {
         pthread_cond_destroy( &non_zero );
     }
 
-    void counting_sem::up( )
+    // The caller must hold the lock.
+    void counting_sem::record( unsigned long long count, bool contended, unsigned long long nanoseconds )
+    {
+        locked_add( acquisitions, count );
+        if( contended ) {
+            locked_add( contended_acquisitions, count );
+            locked_add( wait_nanoseconds, nanoseconds );
+        }
+
+        #if defined(pLOCK_PROFILE)
+        if( profile != 0 ) profile->wait_times( ).record( nanoseconds );
+        #endif
+    }
+
+    void counting_sem::up( int n )
     {
+        if( n <= 0 ) return;
+
         pthread_mutex_lock( &lock );
-        raw_count++;
+        locked_add( raw_count, n );
         pthread_mutex_unlock( &lock );
-        pthread_cond_signal( &non_zero );
+
+        // Several units may have been made available. Wake enough waiters to consume them.
+        if( n == 1 )
+            pthread_cond_signal( &non_zero );
+        else
+            pthread_cond_broadcast( &non_zero );
     }
 
     void counting_sem::down( )
     {
         pthread_mutex_lock( &lock );
-        while ( raw_count == 0 )
+        if( raw_count.load( std::memory_order_relaxed ) > 0 ) {
+            locked_add( raw_count, -1 );
+            record( 1, false, 0 );
+            pthread_mutex_unlock( &lock );
+            return;
+        }
+        pthread_mutex_unlock( &lock );
+
+        // The count is zero. Spin for a while hoping that it will change soon and then block.
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now( );
+        spin_wait( spin_limit( ), [this]( ) {
+            return raw_count.load( std::memory_order_relaxed ) > 0;
+        } );
+
+        pthread_mutex_lock( &lock );
+        while ( raw_count.load( std::memory_order_relaxed ) == 0 )
+            pthread_cond_wait( &non_zero, &lock );
+
+        locked_add( raw_count, -1 );
+        record( 1, true, nanoseconds_since( start ) );
+        pthread_mutex_unlock( &lock );
+    }
+
+    bool counting_sem::try_down( )
+    {
+        bool result = false;
+
+        pthread_mutex_lock( &lock );
+        if( raw_count.load( std::memory_order_relaxed ) > 0 ) {
+            locked_add( raw_count, -1 );
+            record( 1, false, 0 );
+            result = true;
+        }
+        pthread_mutex_unlock( &lock );
+        return result;
+    }
+
+    bool counting_sem::down_for( long milliseconds )
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now( );
+
+        // Condition variables wait until an absolute time. Compute it now.
+        timespec deadline;
+        clock_gettime( CLOCK_REALTIME, &deadline );
+        deadline.tv_sec  += milliseconds / 1000;
+        deadline.tv_nsec += ( milliseconds % 1000 ) * 1000000L;
+        if( deadline.tv_nsec >= 1000000000L ) {
+            deadline.tv_sec  += 1;
+            deadline.tv_nsec -= 1000000000L;
+        }
+
+        bool result    = true;
+        bool contended = false;
+        pthread_mutex_lock( &lock );
+        while( raw_count.load( std::memory_order_relaxed ) == 0 ) {
+            contended = true;
+            if( pthread_cond_timedwait( &non_zero, &lock, &deadline ) == ETIMEDOUT ) {
+                // The count might have changed just as the timeout expired.
+                if( raw_count.load( std::memory_order_relaxed ) == 0 ) result = false;
+                break;
+            }
+        }
+        if( result ) {
+            locked_add( raw_count, -1 );
+            record( 1, contended, contended ? nanoseconds_since( start ) : 0 );
+        }
+        pthread_mutex_unlock( &lock );
+        return result;
+    }
+
+    int counting_sem::down_some( int max_count )
+    {
+        if( max_count <= 0 ) return 0;
+
+        std::chrono::steady_clock::time_point start;
+        bool contended = false;
+
+        pthread_mutex_lock( &lock );
+        if( raw_count.load( std::memory_order_relaxed ) == 0 ) {
+            pthread_mutex_unlock( &lock );
+            contended = true;
+            start = std::chrono::steady_clock::now( );
+            spin_wait( spin_limit( ), [this]( ) {
+                return raw_count.load( std::memory_order_relaxed ) > 0;
+            } );
+            pthread_mutex_lock( &lock );
+        }
+        while ( raw_count.load( std::memory_order_relaxed ) == 0 )
             pthread_cond_wait( &non_zero, &lock );
 
-        raw_count--;
+        int available = raw_count.load( std::memory_order_relaxed );
+        int taken = ( available < max_count ) ? available : max_count;
+        locked_add( raw_count, -taken );
+        record( taken, contended, contended ? nanoseconds_since( start ) : 0 );
+        bool leftovers = ( available > taken );
         pthread_mutex_unlock( &lock );
+
+        // We might have been woken by a multi-unit up. Pass the wake up along if we didn't use
+        // everything so that other waiters don't sleep while units are available.
+        if( leftovers ) pthread_cond_signal( &non_zero );
+        return taken;
     }
 
     #endif
@@ -52,7 +276,9 @@ namespace spica {
 
     #if eOPSYS == eOS2
 
-    counting_sem::counting_sem( int initial )
+    counting_sem::counting_sem( int initial, int spin_limit ) :
+        spin_budget( spin_limit ), acquisitions( 0 ), contended_acquisitions( 0 ),
+        wait_nanoseconds( 0 )
     {
         if( initial < 0 ) initial = 0;
 
@@ -67,11 +293,27 @@ namespace spica {
         DosCloseEventSem( non_zero );
     }
 
-    void counting_sem::up( )
+    // The caller must hold the lock.
+    void counting_sem::record( unsigned long long count, bool contended, unsigned long long nanoseconds )
+    {
+        locked_add( acquisitions, count );
+        if( contended ) {
+            locked_add( contended_acquisitions, count );
+            locked_add( wait_nanoseconds, nanoseconds );
+        }
+
+        #if defined(pLOCK_PROFILE)
+        if( profile != 0 ) profile->wait_times( ).record( nanoseconds );
+        #endif
+    }
+
+    void counting_sem::up( int n )
     {
+        if( n <= 0 ) return;
+
         DosRequestMutexSem( lock, SEM_INDEFINITE_WAIT );
-        raw_count++;
-        if( raw_count == 1 ) DosPostEventSem( non_zero );
+        locked_add( raw_count, n );
+        if( raw_count == n ) DosPostEventSem( non_zero );
         DosReleaseMutexSem( lock );
     }
 
@@ -83,26 +325,107 @@ namespace spica {
 
         // If we are downing a non-zero semaphore, proceed without complications.
         if( raw_count > 0 ) {
-            raw_count--;
+            locked_add( raw_count, -1 );
             if( raw_count == 0 ) DosResetEventSem( non_zero, &post_count );
+            record( 1, false, 0 );
         }
 
         // Otherwise we are trying to down a zero.
         else {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now( );
+
+            // Spin for a while hoping that the count will change soon.
+            DosReleaseMutexSem( lock );
+            spin_wait( spin_limit( ), [this]( ) {
+                return raw_count.load( std::memory_order_relaxed ) > 0;
+            } );
+            DosRequestMutexSem( lock, SEM_INDEFINITE_WAIT );
 
             // This loop deals with various race conditions.
-            do {
+            while( raw_count == 0 ) {
                 DosReleaseMutexSem( lock );
                 DosWaitEventSem( non_zero, SEM_INDEFINITE_WAIT );
                 DosRequestMutexSem( lock, SEM_INDEFINITE_WAIT );
-            } while( raw_count == 0 );
+            }
 
             // We own the lock and the raw count is not zero. We won the race!
-            raw_count--;
+            locked_add( raw_count, -1 );
+            if( raw_count == 0 ) DosResetEventSem( non_zero, &post_count );
+            record( 1, true, nanoseconds_since( start ) );
+        }
+
+        DosReleaseMutexSem( lock );
+    }
+
+    bool counting_sem::try_down( )
+    {
+        ULONG post_count;
+        bool  result = false;
+
+        DosRequestMutexSem( lock, SEM_INDEFINITE_WAIT );
+        if( raw_count > 0 ) {
+            locked_add( raw_count, -1 );
             if( raw_count == 0 ) DosResetEventSem( non_zero, &post_count );
+            record( 1, false, 0 );
+            result = true;
+        }
+        DosReleaseMutexSem( lock );
+        return result;
+    }
+
+    bool counting_sem::down_for( long milliseconds )
+    {
+        ULONG post_count;
+        bool  contended = false;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now( );
+
+        DosRequestMutexSem( lock, SEM_INDEFINITE_WAIT );
+        while( raw_count == 0 ) {
+            contended = true;
+            DosReleaseMutexSem( lock );
+
+            // This is approximate: a wake up that loses the race restarts the full timeout.
+            if( DosWaitEventSem( non_zero, milliseconds ) != 0 ) {
+                DosRequestMutexSem( lock, SEM_INDEFINITE_WAIT );
+                if( raw_count == 0 ) {
+                    DosReleaseMutexSem( lock );
+                    return false;
+                }
+                break;
+            }
+            DosRequestMutexSem( lock, SEM_INDEFINITE_WAIT );
         }
 
+        locked_add( raw_count, -1 );
+        if( raw_count == 0 ) DosResetEventSem( non_zero, &post_count );
+        record( 1, contended, contended ? nanoseconds_since( start ) : 0 );
         DosReleaseMutexSem( lock );
+        return true;
+    }
+
+    int counting_sem::down_some( int max_count )
+    {
+        ULONG post_count;
+        bool  contended = false;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now( );
+
+        if( max_count <= 0 ) return 0;
+
+        DosRequestMutexSem( lock, SEM_INDEFINITE_WAIT );
+        while( raw_count == 0 ) {
+            contended = true;
+            DosReleaseMutexSem( lock );
+            DosWaitEventSem( non_zero, SEM_INDEFINITE_WAIT );
+            DosRequestMutexSem( lock, SEM_INDEFINITE_WAIT );
+        }
+
+        int available = raw_count;
+        int taken = ( available < max_count ) ? available : max_count;
+        locked_add( raw_count, -taken );
+        if( raw_count == 0 ) DosResetEventSem( non_zero, &post_count );
+        record( taken, contended, contended ? nanoseconds_since( start ) : 0 );
+        DosReleaseMutexSem( lock );
+        return taken;
     }
 
     #endif
@@ -110,12 +433,78 @@ namespace spica {
 
     #if eOPSYS == eWIN32
 
-    counting_sem::counting_sem( int initial )
+    counting_sem::counting_sem( int initial, int spin_limit ) :
+        spin_budget( spin_limit ), acquisitions( 0 ), contended_acquisitions( 0 ),
+        wait_nanoseconds( 0 )
     {
         if( initial < 0 ) initial = 0;
         the_sem = CreateSemaphore( 0, initial, INT_MAX, 0 );
     }
 
+    // Windows semaphores don't have a lock of our own so the counters are updated atomically.
+    void counting_sem::record( unsigned long long count, bool contended, unsigned long long nanoseconds )
+    {
+        acquisitions.fetch_add( count, std::memory_order_relaxed );
+        if( contended ) {
+            contended_acquisitions.fetch_add( count, std::memory_order_relaxed );
+            wait_nanoseconds.fetch_add( nanoseconds, std::memory_order_relaxed );
+        }
+
+        #if defined(pLOCK_PROFILE)
+        if( profile != 0 ) profile->wait_times( ).record( nanoseconds );
+        #endif
+    }
+
+    void counting_sem::down( )
+    {
+        if( WaitForSingleObject( the_sem, 0 ) == WAIT_OBJECT_0 ) {
+            record( 1, false, 0 );
+            return;
+        }
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now( );
+        if( !spin_wait( spin_limit( ), [this]( ) {
+                return WaitForSingleObject( the_sem, 0 ) == WAIT_OBJECT_0;
+            } ) ) {
+            WaitForSingleObject( the_sem, INFINITE );
+        }
+        record( 1, true, nanoseconds_since( start ) );
+    }
+
+    bool counting_sem::try_down( )
+    {
+        if( WaitForSingleObject( the_sem, 0 ) != WAIT_OBJECT_0 ) return false;
+        record( 1, false, 0 );
+        return true;
+    }
+
+    bool counting_sem::down_for( long milliseconds )
+    {
+        if( WaitForSingleObject( the_sem, 0 ) == WAIT_OBJECT_0 ) {
+            record( 1, false, 0 );
+            return true;
+        }
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now( );
+        if( WaitForSingleObject( the_sem, static_cast<DWORD>( milliseconds ) ) != WAIT_OBJECT_0 )
+            return false;
+        record( 1, true, nanoseconds_since( start ) );
+        return true;
+    }
+
+    int counting_sem::down_some( int max_count )
+    {
+        if( max_count <= 0 ) return 0;
+
+        // Windows semaphores can't be decremented by more than one at a time. Block for the
+        // first unit and then take whatever else is immediately available.
+        down( );
+        int taken = 1;
+        while( taken < max_count && WaitForSingleObject( the_sem, 0 ) == WAIT_OBJECT_0 ) ++taken;
+        acquisitions.fetch_add( taken - 1, std::memory_order_relaxed );
+        return taken;
+    }
+
     #endif
 
 
@@ -123,9 +512,276 @@ namespace spica {
     //           rw_sem
     //===========================
 
+    #if eOPSYS == ePOSIX
+
+    rw_sem::rw_sem( ) : active_readers( 0 ), waiting_writers( 0 ), writer_active( false )
+    {
+        pthread_mutex_init( &lock, 0 );
+        pthread_cond_init( &readers_ok, 0 );
+        pthread_cond_init( &writers_ok, 0 );
+    }
+
+    rw_sem::~rw_sem( )
+    {
+        pthread_mutex_destroy( &lock );
+        pthread_cond_destroy( &readers_ok );
+        pthread_cond_destroy( &writers_ok );
+    }
+
+    void rw_sem::r_lock( )
+    {
+        pthread_mutex_lock( &lock );
+
+        // Waiting writers hold back new readers. This gives writers priority.
+        while( writer_active || waiting_writers > 0 )
+            pthread_cond_wait( &readers_ok, &lock );
+
+        active_readers++;
+        pthread_mutex_unlock( &lock );
+    }
+
+    void rw_sem::r_unlock( )
+    {
+        pthread_mutex_lock( &lock );
+        active_readers--;
+        bool wake_writer = ( active_readers == 0 && waiting_writers > 0 );
+        pthread_mutex_unlock( &lock );
+
+        if( wake_writer ) pthread_cond_signal( &writers_ok );
+    }
+
+    void rw_sem::w_lock( )
+    {
+        pthread_mutex_lock( &lock );
+        waiting_writers++;
+        while( writer_active || active_readers > 0 )
+            pthread_cond_wait( &writers_ok, &lock );
+
+        waiting_writers--;
+        writer_active = true;
+        pthread_mutex_unlock( &lock );
+    }
+
+    void rw_sem::w_unlock( )
+    {
+        pthread_mutex_lock( &lock );
+        writer_active = false;
+        bool wake_writer = ( waiting_writers > 0 );
+        pthread_mutex_unlock( &lock );
+
+        // Give the lock to the next writer if there is one. Otherwise release all readers.
+        if( wake_writer )
+            pthread_cond_signal( &writers_ok );
+        else
+            pthread_cond_broadcast( &readers_ok );
+    }
+
+    #endif
+
+
+    #if eOPSYS == eOS2
+
+    rw_sem::rw_sem( ) : active_readers( 0 ), waiting_writers( 0 ), writer_active( false )
+    {
+        DosCreateMutexSem( 0, &lock, 0, FALSE );
+        DosCreateEventSem( 0, &readers_ok, 0, FALSE );
+        DosCreateEventSem( 0, &writers_ok, 0, FALSE );
+    }
+
+    rw_sem::~rw_sem( )
+    {
+        DosCloseMutexSem( lock );
+        DosCloseEventSem( readers_ok );
+        DosCloseEventSem( writers_ok );
+    }
+
+    // The event semaphores are used as "something changed" signals. Threads that wake up
+    // recheck the state under the mutex and go back to waiting if necessary, just as
+    // counting_sem::down does.
+
+    void rw_sem::r_lock( )
+    {
+        ULONG post_count;
+
+        DosRequestMutexSem( lock, SEM_INDEFINITE_WAIT );
+        while( writer_active || waiting_writers > 0 ) {
+            DosResetEventSem( readers_ok, &post_count );
+            DosReleaseMutexSem( lock );
+            DosWaitEventSem( readers_ok, SEM_INDEFINITE_WAIT );
+            DosRequestMutexSem( lock, SEM_INDEFINITE_WAIT );
+        }
+        active_readers++;
+        DosReleaseMutexSem( lock );
+    }
+
+    void rw_sem::r_unlock( )
+    {
+        DosRequestMutexSem( lock, SEM_INDEFINITE_WAIT );
+        active_readers--;
+        if( active_readers == 0 && waiting_writers > 0 ) DosPostEventSem( writers_ok );
+        DosReleaseMutexSem( lock );
+    }
+
+    void rw_sem::w_lock( )
+    {
+        ULONG post_count;
+
+        DosRequestMutexSem( lock, SEM_INDEFINITE_WAIT );
+        waiting_writers++;
+        while( writer_active || active_readers > 0 ) {
+            DosResetEventSem( writers_ok, &post_count );
+            DosReleaseMutexSem( lock );
+            DosWaitEventSem( writers_ok, SEM_INDEFINITE_WAIT );
+            DosRequestMutexSem( lock, SEM_INDEFINITE_WAIT );
+        }
+        waiting_writers--;
+        writer_active = true;
+        DosReleaseMutexSem( lock );
+    }
+
+    void rw_sem::w_unlock( )
+    {
+        DosRequestMutexSem( lock, SEM_INDEFINITE_WAIT );
+        writer_active = false;
+        if( waiting_writers > 0 )
+            DosPostEventSem( writers_ok );
+        else
+            DosPostEventSem( readers_ok );
+        DosReleaseMutexSem( lock );
+    }
+
+    #endif
+
+
+    #if eOPSYS == eWIN32
+
+    rw_sem::rw_sem( ) : active_readers( 0 ), waiting_writers( 0 ), writer_active( false )
+    {
+        InitializeCriticalSection( &lock );
+        InitializeConditionVariable( &readers_ok );
+        InitializeConditionVariable( &writers_ok );
+    }
+
+    rw_sem::~rw_sem( )
+    {
+        // Windows condition variables don't need to be destroyed.
+        DeleteCriticalSection( &lock );
+    }
+
+    void rw_sem::r_lock( )
+    {
+        EnterCriticalSection( &lock );
+        while( writer_active || waiting_writers > 0 )
+            SleepConditionVariableCS( &readers_ok, &lock, INFINITE );
+        active_readers++;
+        LeaveCriticalSection( &lock );
+    }
+
+    void rw_sem::r_unlock( )
+    {
+        EnterCriticalSection( &lock );
+        active_readers--;
+        bool wake_writer = ( active_readers == 0 && waiting_writers > 0 );
+        LeaveCriticalSection( &lock );
+
+        if( wake_writer ) WakeConditionVariable( &writers_ok );
+    }
+
+    void rw_sem::w_lock( )
+    {
+        EnterCriticalSection( &lock );
+        waiting_writers++;
+        while( writer_active || active_readers > 0 )
+            SleepConditionVariableCS( &writers_ok, &lock, INFINITE );
+        waiting_writers--;
+        writer_active = true;
+        LeaveCriticalSection( &lock );
+    }
+
+    void rw_sem::w_unlock( )
+    {
+        EnterCriticalSection( &lock );
+        writer_active = false;
+        bool wake_writer = ( waiting_writers > 0 );
+        LeaveCriticalSection( &lock );
+
+        if( wake_writer )
+            WakeConditionVariable( &writers_ok );
+        else
+            WakeAllConditionVariable( &readers_ok );
+    }
+
+    #endif
+
+
+    //===========================
+    //           br_sem
+    //===========================
+
+    br_sem::br_sem( unsigned slot_count ) : writer_active( false )
+    {
+        if( slot_count == 0 ) slot_count = std::thread::hardware_concurrency( );
+        if( slot_count == 0 ) slot_count = 1;
+
+        // Round up to a power of two so that a slot can be selected with a mask.
+        unsigned actual_count = 1;
+        while( actual_count < slot_count ) actual_count *= 2;
+
+        slots     = new slot[actual_count];
+        slot_mask = actual_count - 1;
+    }
+
+    br_sem::~br_sem( )
+    {
+        delete [] slots;
+    }
+
+    // Each thread is given the next number in sequence the first time it uses any br_sem. The
+    // numbers are handed out round robin so threads are spread evenly over the slots.
+    //
+    unsigned br_sem::thread_slot( )
+    {
+        static std::atomic<unsigned> next_slot( 0 );
+        thread_local unsigned my_slot = next_slot.fetch_add( 1, std::memory_order_relaxed );
+        return my_slot;
+    }
+
+    // A reader increments its slot's count before it looks at writer_active, and a writer sets
+    // writer_active before it looks at the counts (all with sequentially consistent
+    // operations), so either the reader sees the flag or the writer sees the reader.
     //
-    // THIS CLASS IS CURRENTLY UNIMPLEMENTED!
+    // A reader that sees the flag takes its count back out, so that the writer isn't kept
+    // waiting, and sleeps until the writer releases writer_lock.
     //
+    void br_sem::r_lock_contended( std::atomic<int> &readers )
+    {
+        do {
+            readers.fetch_sub( 1, std::memory_order_release );
+            writer_lock.lock( );
+            writer_lock.unlock( );
+            readers.fetch_add( 1 );
+        } while( writer_active.load( ) );
+    }
+
+    void br_sem::w_lock( )
+    {
+        // Pause instructions to spend on a slot before yielding the processor.
+        const int slot_spin_limit = 1000;
+
+        writer_lock.lock( );
+        writer_active.store( true );
+        for( unsigned i = 0; i <= slot_mask; ++i ) {
+            std::atomic<int> &readers = slots[i].readers;
+            if( spin_wait( slot_spin_limit, [&readers]( ) { return readers.load( ) == 0; } ) ) continue;
+            while( readers.load( ) != 0 ) std::this_thread::yield( );
+        }
+    }
+
+    void br_sem::w_unlock( )
+    {
+        writer_active.store( false );
+        writer_lock.unlock( );
+    }
 
 }
 
@@ -8,6 +8,9 @@
  * synchronize multiple threads in that process. Future versions of these classes may support
  * named semaphores that can be used to synchronize threads in different processes.
  *
+ * If pLOCK_PROFILE is defined the mutex and counting semaphores record their wait and hold
+ * times in the lock profiler under the name given to set_profile_name. See lock_profile.hpp.
+ *
  * These classes currently have no error handling. They assume that all their primitive
  * operations work. This assumption should be removed eventually.
  */
@@ -16,6 +19,11 @@
 #define SYNCHRONIZE_HPP
 
 #include "environ.hpp"
+#include <atomic>
+
+#if defined(pLOCK_PROFILE)
+#include "lock_profile.hpp"
+#endif
 
 #if eOPSYS == ePOSIX
 #include <pthread.h>
@@ -32,12 +40,56 @@
 
 namespace spica {
 
+    //! Tells the processor that the calling thread is in a spin loop.
+    /*!
+        On processors that support it, this reduces the power consumed by the loop and the
+        penalty paid when the loop exits. It also yields execution resources to a sibling
+        hyper-thread, which might be the thread holding the lock.
+    */
+    inline void cpu_relax( )
+    {
+        #if eOPSYS == eWIN32
+        YieldProcessor( );
+        #elif defined(__i386__) || defined(__x86_64__)
+        __builtin_ia32_pause( );
+        #elif defined(__aarch64__) || defined(__arm__)
+        __asm__ __volatile__( "yield" );
+        #endif
+    }
+
+
+    //! Contention statistics gathered by the semaphore classes.
+    /*!
+        An acquisition is a successful lock or down operation. Each unit taken by down_some
+        counts as one acquisition. An acquisition is contended if the calling thread could not
+        proceed at once. The wait time only includes contended acquisitions.
+    */
+    struct sem_statistics {
+        unsigned long long acquisitions;
+        unsigned long long contended_acquisitions;
+        unsigned long long wait_nanoseconds;
+    };
+
+
     //! Mutex semaphores provide for exclusive access to a shared resource.
-    //
+    /*!
+        A mutex semaphore can optionally spin for a while before blocking a thread that tries
+        to lock it when it is already owned. This is worthwhile when the semaphore protects
+        critical sections that are only a few instructions long. In that case the owner will
+        probably release the semaphore before a sleeping thread could even be rescheduled. The
+        spin limit is the maximum number of "pause" instructions executed before giving up and
+        blocking. The delay between attempts doubles after each failed attempt. A spin limit of
+        zero (the default) blocks at once.
+    */
     class mutex_sem {
     public:
         //! Constructor puts semaphore into an initially unowned state.
-        mutex_sem( );
+        mutex_sem( int spin_limit = 0 );
+
+        //! Constructor that also names the semaphore's lock profile. See set_profile_name.
+        explicit mutex_sem( const char *profile_name, int spin_limit = 0 ) :
+            mutex_sem( spin_limit )
+            { set_profile_name( profile_name ); }
 
         //! Destructor releases semaphore if it is currently owned.
        ~mutex_sem( );
@@ -48,6 +100,31 @@ namespace spica {
         //! Releases ownership of the semaphore.
         void unlock( );
 
+        //! Changes the number of pause instructions executed before blocking.
+        void set_spin_limit( int spin_limit )
+            { spin_budget.store( spin_limit, std::memory_order_relaxed ); }
+
+        //! Returns the number of pause instructions executed before blocking.
+        int spin_limit( ) const
+            { return spin_budget.load( std::memory_order_relaxed ); }
+
+        //! Returns the contention statistics gathered so far.
+        /*!
+            The statistics can be read while other threads use the semaphore. In that case the
+            values are approximate.
+        */
+        sem_statistics statistics( ) const;
+
+        //! Sets all the contention statistics to zero.
+        /*!
+            The semaphore is not locked, so this can be called by its owner. If another thread
+            acquires the semaphore at the same time its acquisition might not be cleared.
+        */
+        void reset_statistics( );
+
+        //! Names the lock profile used by this semaphore. Does nothing unless pLOCK_PROFILE.
+        void set_profile_name( const char *name );
+
        //! Provides for locking and unlocking using RAI idiom.
         class grabber {
         public:
@@ -85,6 +162,30 @@ namespace spica {
         CRITICAL_SECTION raw_object;
         #endif
 
+        std::atomic<int> spin_budget;
+
+        // These counters are only updated by the thread that owns the semaphore.
+        std::atomic<unsigned long long> acquisitions;
+        std::atomic<unsigned long long> contended_acquisitions;
+        std::atomic<unsigned long long> wait_nanoseconds;
+
+        // Acquires the semaphore if it is free. Returns true if successful.
+        bool try_acquire( );
+
+        // Acquires the semaphore, blocking if necessary.
+        void acquire( );
+
+        // Releases the semaphore.
+        void release( );
+
+        // Spins and then blocks. Used when the semaphore isn't free at the time of lock( ).
+        void lock_contended( );
+
+        #if defined(pLOCK_PROFILE)
+        lock_profile      *profile     = 0;
+        unsigned long long acquired_at = 0;  // Time stamp of the last lock( ).
+        #endif
+
         // Inhibit copying.
         mutex_sem( const mutex_sem & );
         mutex_sem &operator=( const mutex_sem & );
@@ -99,18 +200,42 @@ namespace spica {
         useful for keeping track of a limited resource that is being used by multiple threads. A
         thread should decrement a counting semaphore before trying to use a unit of the resource
         to first "reserve" a unit for itself.
+
+        Like mutex semaphores, counting semaphores can spin for a while before blocking a thread
+        that tries to decrement a zero. See mutex_sem for more information.
     */
     class counting_sem {
     public:
-        counting_sem( int initial = 0 );
+        counting_sem( int initial = 0, int spin_limit = 0 );
        ~counting_sem( );
 
+        //! Changes the number of pause instructions executed before blocking.
+        void set_spin_limit( int spin_limit )
+            { spin_budget.store( spin_limit, std::memory_order_relaxed ); }
+
+        //! Returns the number of pause instructions executed before blocking.
+        int spin_limit( ) const
+            { return spin_budget.load( std::memory_order_relaxed ); }
+
+        //! Returns the contention statistics gathered so far.
+        sem_statistics statistics( ) const;
+
+        //! Sets all the contention statistics to zero.
+        void reset_statistics( );
+
+        //! Names the lock profile used by this semaphore. Does nothing unless pLOCK_PROFILE.
+        /*!
+            Only wait times are recorded. A unit taken from a counting semaphore is usually
+            returned by a different thread so hold times are not meaningful.
+        */
+        void set_profile_name( const char *name );
+
         //! Increments the count.
         /*!
             This method never blocks (for long). It might unblock another
-            thread.
+            thread. The count is advanced by `n` in a single operation.
          */
-        void up( );
+        void up( int n = 1 );
 
         //! Decrements the count.
         /*!
@@ -119,24 +244,56 @@ namespace spica {
         */
         void down( );
 
+        //! Decrements the count if that can be done without blocking.
+        /*!
+            Returns true if the count was decremented and false if the count was zero.
+        */
+        bool try_down( );
+
+        //! Decrements the count, blocking for at most the given number of milliseconds.
+        /*!
+            Returns true if the count was decremented and false if the timeout expired first.
+        */
+        bool down_for( long milliseconds );
+
+        //! Decrements the count by as much as possible up to `max_count`.
+        /*!
+            Blocks the calling thread until the count is non-zero and then takes as many units
+            as are available, but no more than `max_count`. Returns the number of units taken
+            (at least one, provided `max_count` is positive).
+        */
+        int down_some( int max_count );
+
     private:
 
         #if eOPSYS == ePOSIX
         pthread_mutex_t lock;
         pthread_cond_t  non_zero;
-        int             raw_count;
+        std::atomic<int> raw_count;  // Only modified while holding lock.
         #endif
 
         #if eOPSYS == eOS2
         HMTX            lock;
         HEV             non_zero;
-        int             raw_count;
+        std::atomic<int> raw_count;  // Only modified while holding lock.
         #endif
 
         #if eOPSYS == eWIN32
         HANDLE          the_sem;
         #endif
 
+        std::atomic<int> spin_budget;
+        std::atomic<unsigned long long> acquisitions;
+        std::atomic<unsigned long long> contended_acquisitions;
+        std::atomic<unsigned long long> wait_nanoseconds;
+
+        // Records a successful decrement. Wait time is zero for uncontended decrements.
+        void record( unsigned long long count, bool contended, unsigned long long nanoseconds );
+
+        #if defined(pLOCK_PROFILE)
+        lock_profile *profile = 0;
+        #endif
+
         // Inhibit copying.
         counting_sem( const counting_sem & );
         counting_sem &operator=( const counting_sem & );
@@ -148,9 +305,9 @@ namespace spica {
         Read/Write semaphores allow multiple readers to access a shared resource but give
         exclusive access to a single writer. This type of locking is appropriate when a shared
         resource can be read simultaneously safely and when most access is, in fact, read
-        access. This implementation gives writers priority over readers.
-
-        THIS CLASS IS CURRENTLY UNIMPLEMENTED!
+        access. This implementation gives writers priority over readers: once a writer is
+        waiting, new readers are held back until the writer has had its turn. This prevents a
+        steady stream of readers from starving the writers.
     */
     class rw_sem {
     public:
@@ -159,7 +316,8 @@ namespace spica {
 
         //! Read lock.
         /*!
-            Asking for a read lock always returns at once unless a writer has locked.
+            Asking for a read lock returns at once unless a writer has locked or a writer is
+            waiting for the lock.
         */
         void r_lock( );
 
@@ -177,41 +335,79 @@ namespace spica {
         //! Release a write lock.
         void w_unlock( );
 
-        //! Grabs a read lock using RAI idiom.
-        class r_grabber {
+        //! Provides for read locking and unlocking using RAI idiom.
+        class read_grabber {
         public:
-            r_grabber( rw_sem &sem ) : the_sem( sem )
-                { the_sem.r_lock( ); }
+            read_grabber( rw_sem &sem, bool lock_now = true ) : the_sem( sem )
+                { if( lock_now ) the_sem.r_lock( ); locked = lock_now; }
 
-           ~r_grabber( )
-                { the_sem.r_unlock( ); }
+            void lock( )
+                { if( !locked ) { the_sem.r_lock( ); locked = true; } }
+
+            void unlock( )
+                { if( locked ) { the_sem.r_unlock( ); locked = false; } }
+
+           ~read_grabber( )
+                { if( locked ) the_sem.r_unlock( ); }
 
         private:
             rw_sem &the_sem;
+            bool    locked;
+
+            // Inhibit copying.
+            read_grabber( const read_grabber & );
+            read_grabber &operator=( const read_grabber & );
         };
 
-        //! Grabs a write lock using RAI idiom.
-        class w_grabber {
+        //! Provides for write locking and unlocking using RAI idiom.
+        class write_grabber {
         public:
-            w_grabber( rw_sem &sem ) : the_sem( sem )
-                { the_sem.w_lock( ); }
+            write_grabber( rw_sem &sem, bool lock_now = true ) : the_sem( sem )
+                { if( lock_now ) the_sem.w_lock( ); locked = lock_now; }
+
+            void lock( )
+                { if( !locked ) { the_sem.w_lock( ); locked = true; } }
+
+            void unlock( )
+                { if( locked ) { the_sem.w_unlock( ); locked = false; } }
 
-           ~w_grabber( )
-                { the_sem.w_unlock( ); }
+           ~write_grabber( )
+                { if( locked ) the_sem.w_unlock( ); }
 
         private:
             rw_sem &the_sem;
+            bool    locked;
+
+            // Inhibit copying.
+            write_grabber( const write_grabber & );
+            write_grabber &operator=( const write_grabber & );
         };
 
+        // The older names for the grabbers.
+        typedef read_grabber  r_grabber;
+        typedef write_grabber w_grabber;
+
     private:
+        int  active_readers;   // Number of threads holding a read lock.
+        int  waiting_writers;  // Number of threads blocked in w_lock.
+        bool writer_active;    // True if some thread holds the write lock.
 
         #if eOPSYS == ePOSIX
+        pthread_mutex_t lock;
+        pthread_cond_t  readers_ok;
+        pthread_cond_t  writers_ok;
         #endif
 
         #if eOPSYS == eOS2
+        HMTX            lock;
+        HEV             readers_ok;
+        HEV             writers_ok;
         #endif
 
         #if eOPSYS == eWIN32
+        CRITICAL_SECTION   lock;
+        CONDITION_VARIABLE readers_ok;
+        CONDITION_VARIABLE writers_ok;
         #endif
 
         // Inhibit copying.
@@ -220,22 +416,183 @@ namespace spica {
     };
 
 
+    //! Big reader semaphore
+    /*!
+        Big reader semaphores have the same interface as rw_sem but are tuned for resources
+        that are read very often and written very rarely. Each reader only updates the reader
+        count in one of several independent "slots" so readers running on different processors
+        do not contend for the same cache line. Threads that share a slot still read at the
+        same time. A writer sets a flag that holds back new readers and then waits for the
+        count in every slot to drop to zero, which makes write locking much more expensive than
+        with an rw_sem. Like rw_sem, writers have priority over readers.
+
+        A thread always uses the same slot so read locks must be released by the thread that
+        acquired them.
+    */
+    class br_sem {
+    public:
+        //! Creates a semaphore with the given number of reader slots.
+        /*!
+            The slot count is rounded up to a power of two. If it is zero the number of
+            processors is used.
+        */
+        br_sem( unsigned slot_count = 0 );
+       ~br_sem( );
+
+        //! Read lock.
+        /*!
+            Asking for a read lock returns at once unless a writer has locked or a writer is
+            waiting for the lock. As with rw_sem, a thread that holds a read lock can ask for
+            another one, but not if a writer might be waiting: the writer waits for the first
+            read lock to be released and the second waits for the writer.
+        */
+        void r_lock( )
+        {
+            std::atomic<int> &readers = slots[thread_slot( ) & slot_mask].readers;
+            readers.fetch_add( 1 );
+            if( writer_active.load( ) ) r_lock_contended( readers );
+        }
+
+        //! Release a read lock.
+        void r_unlock( )
+            { slots[thread_slot( ) & slot_mask].readers.fetch_sub( 1, std::memory_order_release ); }
+
+        //! Write lock. Waits until the readers in every slot have left.
+        void w_lock( );
+
+        //! Release a write lock.
+        void w_unlock( );
+
+        //! Provides for read locking and unlocking using RAI idiom.
+        class read_grabber {
+        public:
+            read_grabber( br_sem &sem, bool lock_now = true ) : the_sem( sem )
+                { if( lock_now ) the_sem.r_lock( ); locked = lock_now; }
+
+            void lock( )
+                { if( !locked ) { the_sem.r_lock( ); locked = true; } }
+
+            void unlock( )
+                { if( locked ) { the_sem.r_unlock( ); locked = false; } }
+
+           ~read_grabber( )
+                { if( locked ) the_sem.r_unlock( ); }
+
+        private:
+            br_sem &the_sem;
+            bool    locked;
+
+            // Inhibit copying.
+            read_grabber( const read_grabber & );
+            read_grabber &operator=( const read_grabber & );
+        };
+
+        //! Provides for write locking and unlocking using RAI idiom.
+        class write_grabber {
+        public:
+            write_grabber( br_sem &sem, bool lock_now = true ) : the_sem( sem )
+                { if( lock_now ) the_sem.w_lock( ); locked = lock_now; }
+
+            void lock( )
+                { if( !locked ) { the_sem.w_lock( ); locked = true; } }
+
+            void unlock( )
+                { if( locked ) { the_sem.w_unlock( ); locked = false; } }
+
+           ~write_grabber( )
+                { if( locked ) the_sem.w_unlock( ); }
+
+        private:
+            br_sem &the_sem;
+            bool    locked;
+
+            // Inhibit copying.
+            write_grabber( const write_grabber & );
+            write_grabber &operator=( const write_grabber & );
+        };
+
+    private:
+        // Each slot occupies its own cache line to avoid false sharing between readers.
+        struct alignas( 64 ) slot {
+            std::atomic<int> readers{ 0 };  // Number of read locks held through this slot.
+        };
+
+        slot     *slots;
+        unsigned  slot_mask;
+        mutex_sem writer_lock;  // Held by the writer, from w_lock to w_unlock.
+
+        // True while a writer holds or is waiting for the lock. Readers read it on every
+        // r_lock, so it is kept away from the writer_lock.
+        alignas( 64 ) std::atomic<bool> writer_active;
+
+        // Returns a small integer that is unique to the calling thread (modulo wrap around).
+        static unsigned thread_slot( );
+
+        // Waits for the writer after r_lock found writer_active set.
+        void r_lock_contended( std::atomic<int> &readers );
+
+        // Inhibit copying.
+        br_sem( const br_sem & );
+        br_sem &operator=( const br_sem & );
+    };
+
+
    //==============================
     //           mutex_sem
     //==============================
 
+    inline void mutex_sem::lock( )
+    {
+        bool immediate = try_acquire( );
+        if( !immediate ) lock_contended( );
+
+        // The semaphore is owned so a plain increment is safe.
+        acquisitions.store(
+            acquisitions.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+
+        #if defined(pLOCK_PROFILE)
+        if( profile != 0 ) {
+            if( immediate ) profile->wait_times( ).record( 0 );
+            acquired_at = profile_clock( );
+        }
+        #endif
+    }
+
+    inline void mutex_sem::unlock( )
+    {
+        #if defined(pLOCK_PROFILE)
+        if( profile != 0 ) profile->hold_times( ).record( profile_clock( ) - acquired_at );
+        #endif
+
+        release( );
+    }
+
+    inline void mutex_sem::set_profile_name( const char *name )
+    {
+        #if defined(pLOCK_PROFILE)
+        profile = lock_profile::find( name );
+        #else
+        (void)name;
+        #endif
+    }
+
     #if eOPSYS == ePOSIX
 
-    inline mutex_sem::mutex_sem( )
+    inline mutex_sem::mutex_sem( int spin_limit ) :
+        spin_budget( spin_limit ), acquisitions( 0 ), contended_acquisitions( 0 ),
+        wait_nanoseconds( 0 )
         { pthread_mutex_init( &raw_object, 0 ); }
 
     inline mutex_sem::~mutex_sem( )
         { pthread_mutex_destroy( &raw_object ); }
 
-    inline void mutex_sem::lock( )
+    inline bool mutex_sem::try_acquire( )
+        { return pthread_mutex_trylock( &raw_object ) == 0; }
+
+    inline void mutex_sem::acquire( )
         { pthread_mutex_lock( &raw_object ); }
 
-    inline void mutex_sem::unlock( )
+    inline void mutex_sem::release( )
         { pthread_mutex_unlock( &raw_object ); }
 
     #endif
@@ -243,16 +600,21 @@ namespace spica {
 
     #if eOPSYS == eOS2
 
-    inline mutex_sem::mutex_sem( )
+    inline mutex_sem::mutex_sem( int spin_limit ) :
+        spin_budget( spin_limit ), acquisitions( 0 ), contended_acquisitions( 0 ),
+        wait_nanoseconds( 0 )
         { DosCreateMutexSem( 0, &raw_object, 0, FALSE ); }
 
     inline mutex_sem::~mutex_sem( )
         { DosCloseMutexSem( raw_object ); }
 
-    inline void mutex_sem::lock( )
+    inline bool mutex_sem::try_acquire( )
+        { return DosRequestMutexSem( raw_object, SEM_IMMEDIATE_RETURN ) == 0; }
+
+    inline void mutex_sem::acquire( )
         { DosRequestMutexSem( raw_object, SEM_INDEFINITE_WAIT ); }
 
-    inline void mutex_sem::unlock( )
+    inline void mutex_sem::release( )
         { DosReleaseMutexSem( raw_object ); }
 
     #endif
@@ -260,16 +622,21 @@ namespace spica {
 
     #if eOPSYS == eWIN32
 
-    inline mutex_sem::mutex_sem( )
+    inline mutex_sem::mutex_sem( int spin_limit ) :
+        spin_budget( spin_limit ), acquisitions( 0 ), contended_acquisitions( 0 ),
+        wait_nanoseconds( 0 )
         { InitializeCriticalSection( &raw_object ); }
 
     inline mutex_sem::~mutex_sem( )
         { DeleteCriticalSection( &raw_object ); }
 
-    inline void mutex_sem::lock( )
+    inline bool mutex_sem::try_acquire( )
+        { return TryEnterCriticalSection( &raw_object ) != 0; }
+
+    inline void mutex_sem::acquire( )
         { EnterCriticalSection( &raw_object ); }
 
-    inline void mutex_sem::unlock( )
+    inline void mutex_sem::release( )
         { LeaveCriticalSection( &raw_object ); }
 
     #endif
@@ -279,16 +646,22 @@ namespace spica {
     //           counting_sem
     //=================================
 
+    inline void counting_sem::set_profile_name( const char *name )
+    {
+        #if defined(pLOCK_PROFILE)
+        profile = lock_profile::find( name );
+        #else
+        (void)name;
+        #endif
+    }
+
     #if eOPSYS == eWIN32
 
     inline counting_sem::~counting_sem( )
         { CloseHandle( the_sem ); }
 
-    inline void counting_sem::up( )
-        { ReleaseSemaphore( the_sem, 1, 0 ); }
-
-    inline void counting_sem::down( )
-        { WaitForSingleObject( the_sem, INFINITE ); }
+    inline void counting_sem::up( int n )
+        { if( n > 0 ) ReleaseSemaphore( the_sem, n, 0 ); }
 
     #endif
 
@@ -0,0 +1,75 @@
+/*! \file    task.cpp
+ *  \brief   Implementation of the coroutine support services.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include "task.hpp"
+
+namespace spica {
+
+    timer_service::timer_service( ) :
+        next_sequence( 0 ), stopping( false ), worker( &timer_service::run, this )
+    { }
+
+
+    // Actions that have not yet been called are discarded.
+    timer_service::~timer_service( )
+    {
+        {
+            std::lock_guard< std::mutex > guard( lock );
+            stopping = true;
+        }
+        changed.notify_one( );
+        worker.join( );
+    }
+
+
+    timer_service &timer_service::instance( )
+    {
+        static timer_service the_service;
+        return the_service;
+    }
+
+
+    void timer_service::call_after( long milliseconds, std::function< void( ) > action )
+    {
+        entry incoming;
+        incoming.deadline = clock::now( ) + std::chrono::milliseconds( milliseconds );
+        incoming.action   = std::move( action );
+        {
+            std::lock_guard< std::mutex > guard( lock );
+            incoming.sequence = next_sequence++;
+            pending.push( std::move( incoming ) );
+        }
+
+        // The new entry might have the earliest deadline. Let the worker check.
+        changed.notify_one( );
+    }
+
+
+    void timer_service::run( )
+    {
+        std::unique_lock< std::mutex > guard( lock );
+        while( !stopping ) {
+            if( pending.empty( ) ) {
+                changed.wait( guard );
+                continue;
+            }
+
+            if( pending.top( ).deadline > clock::now( ) ) {
+                changed.wait_until( guard, pending.top( ).deadline );
+                continue;
+            }
+
+            // The priority queue only gives const access to its top so the action is copied.
+            std::function< void( ) > action = pending.top( ).action;
+            pending.pop( );
+
+            // Don't hold the lock while the action runs. It might schedule another action.
+            guard.unlock( );
+            action( );
+            guard.lock( );
+        }
+    }
+
+}
@@ -0,0 +1,353 @@
+/*! \file    task.hpp
+ *  \brief   Interface to a coroutine task type.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ *
+ * A task<T> is a C++20 coroutine that eventually produces a value of type T (or nothing if T is
+ * void). Tasks are lazy: a task does not begin executing until it is awaited. When a task
+ * finishes, the coroutine awaiting it resumes immediately on the same thread without any
+ * scheduling overhead.
+ *
+ * Coroutines move between threads by awaiting the awaitables defined here and in other Spica
+ * components. In each case the coroutine is resumed by posting it to an executor. An executor
+ * is any object with a method post( std::function< void( ) > ) that arranges for the function
+ * to be called, usually on another thread. ThreadPool is an executor.
+ *
+ * + co_await schedule_on( executor ) resumes the coroutine on the executor.
+ * + co_await sleep_for( executor, milliseconds ) resumes the coroutine on the executor after
+ *   the delay.
+ * + co_await queue.pop_async( executor ) takes an item from a WorkQueue.
+ * + co_await semaphore.down_async( executor ) decrements a Semaphore.
+ *
+ * None of these block the calling thread while they wait. The function sync_wait is provided
+ * so that an ordinary function can run a task and block until it completes. The function spawn
+ * starts a task<void> that runs independently of its creator.
+ */
+
+#ifndef TASK_HPP
+#define TASK_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace spica {
+
+    template< typename T > class task;
+
+    namespace detail {
+
+        // Resumes the awaiting coroutine (if any) when a task finishes.
+        struct final_awaiter {
+            bool await_ready( ) noexcept { return false; }
+
+            template< typename Promise >
+            std::coroutine_handle< > await_suspend( std::coroutine_handle< Promise > finished ) noexcept
+            {
+                std::coroutine_handle< > continuation = finished.promise( ).continuation;
+                return continuation ? continuation : std::noop_coroutine( );
+            }
+
+            void await_resume( ) noexcept { }
+        };
+
+        // The parts of a task's promise that don't depend on the result type.
+        struct promise_base {
+            std::coroutine_handle< > continuation;
+            std::exception_ptr       error;
+
+            std::suspend_always initial_suspend( ) noexcept { return { }; }
+            final_awaiter       final_suspend( )   noexcept { return { }; }
+            void unhandled_exception( ) { error = std::current_exception( ); }
+        };
+
+        template< typename T >
+        struct task_promise : promise_base {
+            std::optional< T > value;
+
+            task< T > get_return_object( );
+
+            template< typename U >
+            void return_value( U &&result ) { value.emplace( std::forward< U >( result ) ); }
+
+            T take( )
+            {
+                if( error ) std::rethrow_exception( error );
+                return std::move( *value );
+            }
+        };
+
+        template< >
+        struct task_promise< void > : promise_base {
+            task< void > get_return_object( );
+
+            void return_void( ) { }
+
+            void take( )
+            {
+                if( error ) std::rethrow_exception( error );
+            }
+        };
+
+        // A coroutine that starts at once and destroys itself when it finishes. Used to
+        // implement sync_wait and spawn.
+        struct detached {
+            struct promise_type {
+                detached get_return_object( ) { return { }; }
+                std::suspend_never initial_suspend( ) noexcept { return { }; }
+                std::suspend_never final_suspend( )   noexcept { return { }; }
+                void return_void( ) { }
+                void unhandled_exception( ) { std::terminate( ); }
+            };
+        };
+
+    }
+
+
+    //! Coroutine that produces a T.
+    /*!
+        Tasks are move-only. A task can be awaited only once. If the coroutine exits with an
+        exception, the exception is rethrown in the awaiting coroutine.
+    */
+    template< typename T = void >
+    class task {
+    public:
+        typedef detail::task_promise< T > promise_type;
+
+        task( ) : handle( ) { }
+        task( task &&other ) noexcept : handle( std::exchange( other.handle, nullptr ) ) { }
+
+        task &operator=( task &&other ) noexcept
+        {
+            if( this != &other ) {
+                if( handle ) handle.destroy( );
+                handle = std::exchange( other.handle, nullptr );
+            }
+            return *this;
+        }
+
+       ~task( )
+            { if( handle ) handle.destroy( ); }
+
+        //! Returns true if the coroutine has run to completion.
+        bool done( ) const { return !handle || handle.done( ); }
+
+        struct awaiter {
+            std::coroutine_handle< promise_type > handle;
+
+            bool await_ready( ) { return !handle || handle.done( ); }
+
+            std::coroutine_handle< > await_suspend( std::coroutine_handle< > awaiting )
+            {
+                // Start the task. It resumes the awaiting coroutine when it finishes.
+                handle.promise( ).continuation = awaiting;
+                return handle;
+            }
+
+            T await_resume( ) { return handle.promise( ).take( ); }
+        };
+
+        awaiter operator co_await( ) && { return awaiter{ handle }; }
+        awaiter operator co_await( ) &  { return awaiter{ handle }; }
+
+    private:
+        friend struct detail::task_promise< T >;
+
+        explicit task( std::coroutine_handle< promise_type > h ) : handle( h ) { }
+
+        std::coroutine_handle< promise_type > handle;
+
+        // Inhibit copying.
+        task( const task & );
+        task &operator=( const task & );
+    };
+
+
+    namespace detail {
+
+        template< typename T >
+        inline task< T > task_promise< T >::get_return_object( )
+        {
+            return task< T >( std::coroutine_handle< task_promise< T > >::from_promise( *this ) );
+        }
+
+        inline task< void > task_promise< void >::get_return_object( )
+        {
+            return task< void >( std::coroutine_handle< task_promise< void > >::from_promise( *this ) );
+        }
+
+        // Used by sync_wait to block the calling thread until the task finishes.
+        struct completion {
+            std::mutex              lock;
+            std::condition_variable finished;
+            bool                    done = false;
+            std::exception_ptr      error;
+
+            void signal( )
+            {
+                std::lock_guard< std::mutex > guard( lock );
+                done = true;
+                finished.notify_all( );
+            }
+
+            void wait( )
+            {
+                std::unique_lock< std::mutex > guard( lock );
+                while( !done ) finished.wait( guard );
+            }
+        };
+
+        template< typename T >
+        detached run_and_signal( task< T > &work, std::optional< T > &result, completion &state )
+        {
+            try { result.emplace( co_await work ); }
+            catch( ... ) { state.error = std::current_exception( ); }
+            state.signal( );
+        }
+
+        inline detached run_and_signal( task< void > &work, completion &state )
+        {
+            try { co_await work; }
+            catch( ... ) { state.error = std::current_exception( ); }
+            state.signal( );
+        }
+
+        inline detached run_detached( task< void > work )
+        {
+            co_await work;
+        }
+
+    }
+
+
+    //! Runs a task and blocks the calling thread until it completes.
+    /*!
+        The task starts on the calling thread and runs there until it first suspends. Do not
+        call sync_wait from a thread that the task needs in order to make progress (for example
+        from the only worker of a ThreadPool that the task schedules itself on).
+    */
+    template< typename T >
+    T sync_wait( task< T > work )
+    {
+        std::optional< T > result;
+        detail::completion state;
+        detail::run_and_signal( work, result, state );
+        state.wait( );
+        if( state.error ) std::rethrow_exception( state.error );
+        return std::move( *result );
+    }
+
+    inline void sync_wait( task< void > work )
+    {
+        detail::completion state;
+        detail::run_and_signal( work, state );
+        state.wait( );
+        if( state.error ) std::rethrow_exception( state.error );
+    }
+
+
+    //! Starts a task that runs independently of the caller.
+    /*!
+        The task starts on the calling thread and runs there until it first suspends. The task
+        owns itself and is destroyed when it finishes. An exception escaping the task
+        terminates the program, as it does for std::thread.
+    */
+    inline void spawn( task< void > work )
+    {
+        detail::run_detached( std::move( work ) );
+    }
+
+
+    //! Returns an awaitable that resumes the awaiting coroutine on the given executor.
+    template< typename Executor >
+    auto schedule_on( Executor &executor )
+    {
+        struct awaiter {
+            Executor &executor;
+
+            bool await_ready( ) { return false; }
+            void await_suspend( std::coroutine_handle< > waiting )
+                { executor.post( [waiting]( ) { waiting.resume( ); } ); }
+            void await_resume( ) { }
+        };
+        return awaiter{ executor };
+    }
+
+
+    //! Thread that calls functions after a delay.
+    /*!
+        The timer service uses a single thread to wait for all deadlines. The actions it calls
+        should be brief; typically they post more substantial work to an executor.
+    */
+    class timer_service {
+    public:
+        timer_service( );
+       ~timer_service( );
+
+        //! Returns a timer service that exists for the life of the program.
+        static timer_service &instance( );
+
+        //! Arranges for action to be called (on the timer thread) after the delay.
+        void call_after( long milliseconds, std::function< void( ) > action );
+
+    private:
+        typedef std::chrono::steady_clock clock;
+
+        struct entry {
+            clock::time_point     deadline;
+            unsigned long long    sequence;   // Keeps actions with equal deadlines in order.
+            std::function< void( ) > action;
+
+            bool operator>( const entry &other ) const
+            {
+                if( deadline != other.deadline ) return deadline > other.deadline;
+                return sequence > other.sequence;
+            }
+        };
+
+        std::mutex              lock;
+        std::condition_variable changed;
+        std::priority_queue< entry, std::vector< entry >, std::greater< entry > > pending;
+        unsigned long long      next_sequence;
+        bool                    stopping;
+        std::thread             worker;
+
+        void run( );
+
+        // Inhibit copying.
+        timer_service( const timer_service & );
+        timer_service &operator=( const timer_service & );
+    };
+
+
+    //! Returns an awaitable that resumes the awaiting coroutine on the executor after a delay.
+    template< typename Executor >
+    auto sleep_for( Executor &executor, long milliseconds )
+    {
+        struct awaiter {
+            Executor &executor;
+            long      milliseconds;
+
+            bool await_ready( ) { return false; }
+            void await_suspend( std::coroutine_handle< > waiting )
+            {
+                Executor *target = &executor;
+                timer_service::instance( ).call_after( milliseconds, [target, waiting]( ) {
+                    target->post( [waiting]( ) { waiting.resume( ); } );
+                } );
+            }
+            void await_resume( ) { }
+        };
+        return awaiter{ executor, milliseconds };
+    }
+
+}
+
+#endif
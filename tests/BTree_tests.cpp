@@ -0,0 +1,270 @@
+/*! \file    BTree_tests.cpp
+ *  \brief   Exercise spica::BTreeSet and spica::BTreeMap.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../BTree.hpp"
+#include "../u_tests.hpp"
+#include "../UnitTestManager.hpp"
+
+using namespace spica;
+
+#define MAXCOUNT 20000
+
+// Small nodes give deep trees, so splits and merges happen at every level.
+typedef BTreeSet< int, std::less<int>, 64 > SmallSet;
+
+// Returns true if the set holds exactly the (sorted, unique) numbers, in both directions.
+template<typename Set>
+static bool same_contents( const Set &my_set, const std::vector<int> &numbers )
+{
+    if( my_set.size( ) != numbers.size( ) ) return false;
+
+    typename Set::iterator p = my_set.begin( );
+    for( int number : numbers ) {
+        if( p == my_set.end( ) || *p != number ) return false;
+        ++p;
+    }
+    if( p != my_set.end( ) ) return false;
+
+    for( auto current = numbers.rbegin( ); current != numbers.rend( ); ++current ) {
+        --p;
+        if( *p != *current ) return false;
+    }
+    return p == my_set.begin( );
+}
+
+
+template<typename Set>
+static void random_test( const char *name )
+{
+    UnitTestManager::UnitTest test( name );
+
+    Set my_set;
+    std::vector<int> numbers;
+    std::vector<bool> present( 4 * MAXCOUNT, false );
+    std::mt19937 generator( 42 );
+
+    // Add random numbers to the set. The set should notice duplicates.
+    bool duplicates_ok = true;
+    for( int i = 0; i < MAXCOUNT; ++i ) {
+        int number = static_cast<int>( generator( ) % ( 4 * MAXCOUNT ) );
+        bool is_new = !present[number];
+        if( is_new ) {
+            numbers.push_back( number );
+            present[number] = true;
+        }
+        std::pair<typename Set::iterator, bool> result = my_set.insert( number );
+        if( result.second != is_new || *result.first != number ) duplicates_ok = false;
+    }
+    UNIT_CHECK( duplicates_ok );
+
+    bool all_found = true;
+    for( int number : numbers ) {
+        if( my_set.find( number ) == my_set.end( ) || !my_set.contains( number ) ) all_found = false;
+    }
+    UNIT_CHECK( all_found );
+    UNIT_CHECK( my_set.find( -1 ) == my_set.end( ) );
+
+    std::vector<int> sorted( numbers );
+    std::sort( sorted.begin( ), sorted.end( ) );
+    UNIT_CHECK( same_contents( my_set, sorted ) );
+
+    // Erase half of the items in random order, alternating between the two forms of erase.
+    std::shuffle( numbers.begin( ), numbers.end( ), generator );
+    std::size_t half = numbers.size( ) / 2;
+    bool vanished = true;
+    for( std::size_t i = 0; i < half; ++i ) {
+        if( i % 2 == 0 ) my_set.erase( my_set.find( numbers[i] ) );
+        else if( my_set.erase( numbers[i] ) != 1 ) vanished = false;
+        if( my_set.find( numbers[i] ) != my_set.end( ) ) vanished = false;
+    }
+    UNIT_CHECK( vanished );
+    UNIT_CHECK( my_set.erase( numbers[0] ) == 0 );
+
+    sorted.assign( numbers.begin( ) + half, numbers.end( ) );
+    std::sort( sorted.begin( ), sorted.end( ) );
+    UNIT_CHECK( same_contents( my_set, sorted ) );
+
+    // Erase the rest.
+    for( std::size_t i = half; i < numbers.size( ); ++i ) my_set.erase( numbers[i] );
+    UNIT_CHECK( my_set.size( ) == 0 && my_set.empty( ) && my_set.begin( ) == my_set.end( ) );
+
+    // The empty tree can be used again.
+    my_set.insert( 7 );
+    UNIT_CHECK( my_set.size( ) == 1 && *my_set.begin( ) == 7 );
+}
+
+
+static void sorted_test( )
+{
+    UnitTestManager::UnitTest test( "sorted" );
+
+    const int count = 200000;
+    SmallSet ascending;
+    SmallSet descending;
+    for( int i = 0; i < count; ++i ) {
+        ascending.insert( i );
+        descending.insert( count - 1 - i );
+    }
+    UNIT_CHECK( ascending.size( ) == static_cast<std::size_t>( count ) );
+    UNIT_CHECK( descending.size( ) == static_cast<std::size_t>( count ) );
+
+    bool in_order = true;
+    int expected = 0;
+    for( int item : ascending ) {
+        if( item != expected++ ) in_order = false;
+    }
+    UNIT_CHECK( in_order && expected == count );
+    UNIT_CHECK( std::equal( ascending.begin( ), ascending.end( ), descending.begin( ), descending.end( ) ) );
+
+    // Erase from the front, which empties the leftmost leaves first.
+    for( int i = 0; i < count / 2; ++i ) ascending.erase( ascending.begin( ) );
+    UNIT_CHECK( *ascending.begin( ) == count / 2 );
+    SmallSet::iterator last = ascending.end( );
+    --last;
+    UNIT_CHECK( *last == count - 1 );
+}
+
+
+static void bound_test( )
+{
+    UnitTestManager::UnitTest test( "bounds" );
+
+    SmallSet my_set;
+    for( int i = 0; i < 1000; ++i ) my_set.insert( 2 * i );
+
+    bool bounds_ok = true;
+    for( int i = -1; i < 2001; ++i ) {
+        SmallSet::iterator lower = my_set.lower_bound( i );
+        SmallSet::iterator upper = my_set.upper_bound( i );
+        int expected_lower = ( i < 0 ) ? 0 : ( i + 1 ) / 2 * 2;
+        int expected_upper = ( i < 0 ) ? 0 : i / 2 * 2 + 2;
+        if( expected_lower < 2000 ) {
+            if( lower == my_set.end( ) || *lower != expected_lower ) bounds_ok = false;
+        }
+        else if( lower != my_set.end( ) ) bounds_ok = false;
+        if( expected_upper < 2000 ) {
+            if( upper == my_set.end( ) || *upper != expected_upper ) bounds_ok = false;
+        }
+        else if( upper != my_set.end( ) ) bounds_ok = false;
+    }
+    UNIT_CHECK( bounds_ok );
+
+    // A range scan.
+    int total = 0;
+    for( SmallSet::iterator p = my_set.lower_bound( 100 ); p != my_set.upper_bound( 200 ); ++p ) total += *p;
+    UNIT_CHECK( total == 7650 );
+}
+
+
+static void bulk_load_test( )
+{
+    UnitTestManager::UnitTest test( "bulk load" );
+
+    // Try sizes around the node capacities so that the last nodes on each level are small.
+    bool loads_ok = true;
+    for( int count : { 0, 1, 2, 13, 14, 15, 16, 17, 100, 1000, 12345 } ) {
+        std::vector<int> numbers( count );
+        for( int i = 0; i < count; ++i ) numbers[i] = 3 * i;
+        SmallSet my_set( numbers.begin( ), numbers.end( ) );
+        if( !same_contents( my_set, numbers ) ) loads_ok = false;
+
+        // The loaded tree must be updated correctly.
+        for( int i = 0; i < count; ++i ) my_set.insert( 3 * i + 1 );
+        for( int i = 0; i < count; ++i ) my_set.erase( 3 * i );
+        for( int i = 0; i < count; ++i ) numbers[i] = 3 * i + 1;
+        if( !same_contents( my_set, numbers ) ) loads_ok = false;
+    }
+    UNIT_CHECK( loads_ok );
+
+    // Duplicates are skipped and unsorted input is rejected.
+    std::vector<int> duplicates = { 1, 1, 2, 3, 3, 3, 4 };
+    SmallSet my_set;
+    my_set.bulk_load( duplicates.begin( ), duplicates.end( ) );
+    UNIT_CHECK( same_contents( my_set, std::vector<int>{ 1, 2, 3, 4 } ) );
+
+    std::vector<int> unsorted = { 1, 2, 4, 3 };
+    bool caught = false;
+    try {
+        my_set.bulk_load( unsorted.begin( ), unsorted.end( ) );
+    }
+    catch( std::invalid_argument & ) {
+        caught = true;
+    }
+    UNIT_CHECK( caught && my_set.empty( ) );
+}
+
+
+static void map_test( )
+{
+    typedef BTreeMap< int, std::string, std::less<int>, 128 > Map;
+    UnitTestManager::UnitTest test( "BTreeMap" );
+
+    Map my_map;
+    std::map< int, std::string > reference;
+    std::mt19937 generator( 7 );
+
+    for( int i = 0; i < MAXCOUNT; ++i ) {
+        int key = static_cast<int>( generator( ) % MAXCOUNT );
+        std::string value = std::to_string( i );
+        switch( generator( ) % 4 ) {
+        case 0:
+            my_map.insert( std::make_pair( key, value ) );
+            reference.insert( std::make_pair( key, value ) );
+            break;
+        case 1:
+            my_map.insert_or_assign( key, value );
+            reference.insert_or_assign( key, value );
+            break;
+        case 2:
+            my_map[key] += "x";
+            reference[key] += "x";
+            break;
+        case 3:
+            UNIT_CHECK( my_map.erase( key ) == reference.erase( key ) );
+            break;
+        }
+    }
+    UNIT_CHECK( my_map.size( ) == reference.size( ) );
+
+    bool same = true;
+    auto expected = reference.begin( );
+    for( auto [key, value] : my_map ) {
+        if( expected == reference.end( ) || key != expected->first || value != expected->second ) same = false;
+        ++expected;
+    }
+    UNIT_CHECK( same && expected == reference.end( ) );
+
+    // Values can be changed through iterators.
+    Map::iterator p = my_map.find( reference.begin( )->first );
+    p->second = "changed";
+    const Map &constant = my_map;
+    UNIT_CHECK( constant.find( reference.begin( )->first )->second == "changed" );
+    UNIT_CHECK( my_map.find( -1 ) == my_map.end( ) );
+
+    // Bulk load from the std::map.
+    Map loaded( reference.begin( ), reference.end( ) );
+    UNIT_CHECK( loaded.size( ) == reference.size( ) );
+    UNIT_CHECK( std::equal( loaded.begin( ), loaded.end( ), reference.begin( ), reference.end( ),
+        []( auto a, auto b ) { return a.first == b.first && a.second == b.second; } ) );
+}
+
+
+bool BTree_tests( )
+{
+    random_test< BTreeSet<int> >( "random" );
+    random_test< SmallSet >( "random, small nodes" );
+    sorted_test( );
+    bound_test( );
+    bulk_load_test( );
+    map_test( );
+    return true;
+}
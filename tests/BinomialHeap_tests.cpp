@@ -7,9 +7,14 @@
 #include <cstdlib>
 #include <ctime>
 #include <iostream>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <utility>
 #include <vector>
 
 #include "../BinomialHeap.hpp"
+#include "../Graph.hpp"
 #include "../u_tests.hpp"
 #include "../UnitTestManager.hpp"
 
@@ -45,6 +50,130 @@ void check_heap( spica::BinomialHeap<int> &my_heap, std::vector<int> &numbers )
 }
 
 
+// Decrease and erase random items through their handles, comparing with a sorted vector.
+static void handle_test( )
+{
+    UnitTestManager::UnitTest test( "handles" );
+
+    typedef spica::BinomialHeap<int> Heap;
+    Heap my_heap;
+    std::vector<Heap::handle> handles;
+    std::mt19937 generator( 3 );
+    for( int i = 0; i < N; ++i ) {
+        int number = static_cast<int>( generator( ) % 1000000 );
+        handles.push_back( my_heap.push( number ) );
+        UNIT_CHECK( *handles.back( ) == number );
+    }
+
+    // The iterator visits every item exactly once.
+    std::vector<int> visited( my_heap.begin( ), my_heap.end( ) );
+    std::vector<int> expected;
+    for( Heap::handle item : handles ) expected.push_back( *item );
+    std::sort( visited.begin( ), visited.end( ) );
+    std::sort( expected.begin( ), expected.end( ) );
+    UNIT_CHECK( visited == expected );
+
+    // Items without handles trade places with the items that move.
+    std::vector<int> remaining;
+    for( int i = 0; i < N / 2; ++i ) {
+        int number = static_cast<int>( generator( ) % 1000000 );
+        my_heap.insert( number );
+        remaining.push_back( number );
+    }
+
+    // Decrease a third of the items, erase another third, and leave the rest alone.
+    std::shuffle( handles.begin( ), handles.end( ), generator );
+    bool handles_ok = true;
+    for( std::size_t i = 0; i < handles.size( ); ++i ) {
+        if( i % 3 == 0 ) {
+            int new_value = *handles[i] - static_cast<int>( generator( ) % 2000000 );
+            my_heap.decrease_key( handles[i], new_value );
+            if( *handles[i] != new_value ) handles_ok = false;
+            remaining.push_back( new_value );
+        }
+        else if( i % 3 == 1 ) {
+            my_heap.erase( handles[i] );
+        }
+        else {
+            remaining.push_back( *handles[i] );
+        }
+    }
+    UNIT_CHECK( handles_ok );
+    UNIT_CHECK( my_heap.size( ) == remaining.size( ) );
+
+    bool caught = false;
+    try {
+        my_heap.decrease_key( handles[2], *handles[2] + 1 );
+    }
+    catch( std::invalid_argument & ) {
+        caught = true;
+    }
+    UNIT_CHECK( caught );
+
+    check_heap( my_heap, remaining );
+}
+
+
+// Dijkstra's algorithm with one heap entry per vertex. The distances are compared with the
+// Bellman-Ford algorithm.
+static void dijkstra_test( )
+{
+    UnitTestManager::UnitTest test( "Dijkstra" );
+
+    typedef spica::Graph<int> Graph;
+    const Graph::count_t vertex_count = 500;
+    const int infinity = std::numeric_limits<int>::max( );
+    Graph my_graph;
+    std::mt19937 generator( 5 );
+    my_graph.create_vertex( vertex_count - 1 );
+    for( int i = 0; i < 4000; ++i ) {
+        my_graph.create_edge( generator( ) % vertex_count, generator( ) % vertex_count, generator( ) % 100 );
+    }
+
+    typedef std::pair<int, Graph::count_t> Entry;  // Distance and vertex.
+    spica::BinomialHeap<Entry> queue;
+    std::vector<spica::BinomialHeap<Entry>::handle> entries( vertex_count );
+    std::vector<int> distance( vertex_count, infinity );
+    std::vector<bool> queued( vertex_count, false );
+    distance[0] = 0;
+    entries[0] = queue.push( Entry( 0, 0 ) );
+    queued[0] = true;
+    std::size_t largest_queue = 0;
+    while( !queue.empty( ) ) {
+        largest_queue = std::max( largest_queue, queue.size( ) );
+        Graph::count_t vertex = queue.front( ).second;
+        queue.pop( );
+        queued[vertex] = false;
+        for( Graph::edge_iterator p = my_graph.ebegin( vertex ); p != my_graph.eend( vertex ); ++p ) {
+            int candidate = distance[vertex] + p->edge_weight;
+            Graph::count_t remote = p->remote_vertex;
+            if( candidate >= distance[remote] ) continue;
+            distance[remote] = candidate;
+            if( queued[remote] ) {
+                queue.decrease_key( entries[remote], Entry( candidate, remote ) );
+            }
+            else {
+                entries[remote] = queue.push( Entry( candidate, remote ) );
+                queued[remote] = true;
+            }
+        }
+    }
+    UNIT_CHECK( largest_queue <= vertex_count );
+
+    std::vector<int> expected( vertex_count, infinity );
+    expected[0] = 0;
+    for( Graph::count_t round = 1; round < vertex_count; ++round ) {
+        for( Graph::count_t vertex = 0; vertex < vertex_count; ++vertex ) {
+            if( expected[vertex] == infinity ) continue;
+            for( Graph::edge_iterator p = my_graph.ebegin( vertex ); p != my_graph.eend( vertex ); ++p ) {
+                expected[p->remote_vertex] = std::min( expected[p->remote_vertex], expected[vertex] + p->edge_weight );
+            }
+        }
+    }
+    UNIT_CHECK( distance == expected );
+}
+
+
 bool BinomialHeap_tests( )
 {
     {
@@ -70,5 +199,7 @@ bool BinomialHeap_tests( )
         check_heap( heap1, numbers1 );
     }
 
+    handle_test( );
+    dijkstra_test( );
     return true;
 }
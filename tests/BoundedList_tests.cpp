@@ -3,7 +3,11 @@
  *  \author  Peter Chapin <spicacality@kelseymountain.org>
  */
 
+#include <cstdint>
+#include <list>
+#include <random>
 #include <stdexcept>
+#include <string>
 
 #include "../BoundedList.hpp"
 #include "../u_tests.hpp"
@@ -201,6 +205,186 @@ static void erase_test( )
 }
 
 
+static void growth_test( )
+{
+    UnitTestManager::UnitTest test( "growth" );
+
+    BoundedList<int> my_list( 0, list_growth::doubling );
+    UNIT_CHECK( my_list.growth_policy( ) == list_growth::doubling );
+    my_list.push_back( 0 );
+    BoundedList<int>::iterator first( my_list.begin( ) );
+    for( int i = 1; i < 1000; ++i ) {
+        if( i % 2 == 0 ) my_list.push_back( i );
+        else my_list.insert( my_list.end( ), i );
+    }
+    UNIT_CHECK( my_list.size( ) == 1000 );
+    UNIT_CHECK( my_list.max_size( ) >= 1000 );
+
+    // Iterators remain valid as the list grows.
+    UNIT_CHECK( first == my_list.begin( ) && *first == 0 );
+    int i = 0;
+    for( BoundedList<int>::iterator p = my_list.begin( ); p != my_list.end( ); ++p, ++i ) {
+        UNIT_CHECK( *p == i );
+    }
+    UNIT_CHECK( i == 1000 );
+
+    // Adding a copy of an item in a full list, which moves the items when it grows.
+    BoundedList<std::string> strings( 2, list_growth::doubling );
+    strings.push_back( "first item" );
+    strings.push_back( "second item" );
+    strings.push_back( strings.front( ) );
+    UNIT_CHECK( strings.size( ) == 3 && strings.back( ) == "first item" );
+    while( strings.size( ) < strings.max_size( ) ) strings.push_back( "filler" );
+    strings.insert( strings.begin( ), *++strings.begin( ) );
+    UNIT_CHECK( strings.front( ) == "second item" && *++strings.begin( ) == "first item" );
+
+    // Any list can be enlarged explicitly.
+    BoundedList<std::string> fixed_list( 2 );
+    fixed_list.push_back( "a" );
+    fixed_list.push_back( "b" );
+    fixed_list.reserve( 3 );
+    fixed_list.push_back( "c" );
+    UNIT_CHECK( fixed_list.size( ) == 3 && fixed_list.front( ) == "a" && fixed_list.back( ) == "c" );
+    UNIT_CHECK( fixed_list.max_size( ) == 3 );
+    try {
+        fixed_list.push_back( "d" );
+        UNIT_FAIL( "Unexpectedly able to push_back to a full BoundedList with a fixed capacity" );
+    }
+    catch( std::length_error & ) {
+        // okay.
+    }
+
+    // The index type limits the capacity.
+    BoundedList<int, std::uint8_t> small_list( 200, list_growth::doubling );
+    for( int j = 0; j < 255; ++j ) small_list.push_back( j );
+    UNIT_CHECK( small_list.max_size( ) == 255 );
+    try {
+        small_list.push_back( 255 );
+        UNIT_FAIL( "Unexpectedly able to grow a BoundedList beyond its index type" );
+    }
+    catch( std::length_error & ) {
+        // okay.
+    }
+    try {
+        BoundedList<int, std::uint8_t> too_big( 256 );
+        UNIT_FAIL( "Unexpectedly able to create a BoundedList too large for its index type" );
+    }
+    catch( std::length_error & ) {
+        // okay.
+    }
+}
+
+
+// Insert and erase at random places, then check that compact( ) preserves the contents and
+// puts them in memory order.
+template<typename Index>
+static void compact_test( const char *name )
+{
+    UnitTestManager::UnitTest test( name );
+    std::mt19937 generator( 7 );
+
+    BoundedList<std::string, Index> my_list( 500 );
+    std::list<std::string> reference;
+    for( int i = 0; i < 5000; ++i ) {
+        std::size_t position = generator( ) % ( reference.size( ) + 1 );
+        typename BoundedList<std::string, Index>::iterator p( my_list.begin( ) );
+        std::list<std::string>::iterator q( reference.begin( ) );
+        for( std::size_t j = 0; j < position; ++j, ++p, ++q ) ;
+        if( reference.size( ) < 400 && ( p == my_list.end( ) || generator( ) % 2 == 0 ) ) {
+            std::string item = "item " + std::to_string( i );
+            my_list.insert( p, item );
+            reference.insert( q, item );
+        }
+        else if( p != my_list.end( ) ) {
+            my_list.erase( p );
+            reference.erase( q );
+        }
+    }
+    UNIT_CHECK( my_list.size( ) == reference.size( ) );
+
+    my_list.compact( );
+    UNIT_CHECK( my_list.size( ) == reference.size( ) );
+    typename BoundedList<std::string, Index>::iterator p( my_list.begin( ) );
+    const std::string *first = &*p;
+    std::size_t offset = 0;
+    for( const std::string &item : reference ) {
+        UNIT_CHECK( *p == item );
+        UNIT_CHECK( &*p == first + offset );
+        ++p;
+        ++offset;
+    }
+    UNIT_CHECK( p == my_list.end( ) );
+    --p;
+    UNIT_CHECK( *p == reference.back( ) );
+
+    // The list still works and appends go into the next slot.
+    my_list.push_back( "last" );
+    UNIT_CHECK( my_list.back( ) == "last" && &my_list.back( ) == first + offset );
+    while( !my_list.empty( ) ) my_list.pop_back( );
+    my_list.compact( );
+    UNIT_CHECK( my_list.empty( ) && my_list.begin( ) == my_list.end( ) );
+    for( int i = 0; i < 500; ++i ) my_list.push_back( std::to_string( i ) );
+    my_list.compact( );
+    UNIT_CHECK( my_list.size( ) == 500 && my_list.back( ) == "499" );
+}
+
+
+// An item type that counts the live objects and whose moves throw on demand.
+struct Fragile {
+    static int live;
+    static int moves_left;
+    int value;
+
+    explicit Fragile( int v ) : value( v ) { ++live; }
+    Fragile( const Fragile &other ) : value( other.value ) { ++live; }
+    Fragile( Fragile &&other ) : value( other.value )
+    {
+        if( --moves_left == 0 ) throw std::runtime_error( "Fragile move" );
+        ++live;
+    }
+    Fragile &operator=( Fragile &&other )
+    {
+        if( --moves_left == 0 ) throw std::runtime_error( "Fragile move" );
+        value = other.value;
+        return *this;
+    }
+   ~Fragile( ) { --live; }
+};
+
+int Fragile::live = 0;
+int Fragile::moves_left = 0;
+
+
+// If moving an item throws, compact( ) destroys the items, leaves the list empty, and
+// rethrows the exception.
+static void compact_exception_test( )
+{
+    UnitTestManager::UnitTest test( "compact exception" );
+
+    {
+        BoundedList<Fragile> my_list( 10 );
+        for( int i = 0; i < 10; ++i ) my_list.insert( my_list.begin( ), Fragile( i ) );
+        Fragile::moves_left = 3;
+        bool caught = false;
+        try {
+            my_list.compact( );
+        }
+        catch( const std::runtime_error & ) {
+            caught = true;
+        }
+        Fragile::moves_left = 0;
+        UNIT_CHECK( caught );
+        UNIT_CHECK( my_list.empty( ) && my_list.begin( ) == my_list.end( ) );
+        UNIT_CHECK( Fragile::live == 0 );
+
+        // The list is usable afterwards.
+        for( int i = 0; i < 10; ++i ) my_list.push_back( Fragile( i ) );
+        UNIT_CHECK( my_list.size( ) == 10 && my_list.front( ).value == 0 && my_list.back( ).value == 9 );
+    }
+    UNIT_CHECK( Fragile::live == 0 );
+}
+
+
 bool BoundedList_tests( )
 {
     constructor_test( );
@@ -209,5 +393,9 @@ bool BoundedList_tests( )
     iterator_test( );
     insert_test( );
     erase_test( );
+    growth_test( );
+    compact_test<std::size_t>( "compact" );
+    compact_test<std::uint16_t>( "compact, 16 bit indices" );
+    compact_exception_test( );
     return true;
 }
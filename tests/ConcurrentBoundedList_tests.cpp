@@ -0,0 +1,184 @@
+/*! \file    ConcurrentBoundedList_tests.cpp
+ *  \brief   Exercise spica::ConcurrentBoundedList.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../ConcurrentBoundedList.hpp"
+#include "../u_tests.hpp"
+#include "../UnitTestManager.hpp"
+
+using namespace spica;
+
+namespace {
+
+    // Counts the live instances so the tests can check that items are destroyed.
+    struct Counted {
+        static std::atomic< long > live;
+
+        int value;
+
+        Counted( int v = 0 ) : value( v ) { ++live; }
+        Counted( const Counted &other ) : value( other.value ) { ++live; }
+       ~Counted( ) { --live; }
+    };
+
+    std::atomic< long > Counted::live{ 0 };
+
+}
+
+
+static void basic_test( )
+{
+    UnitTestManager::UnitTest test( "basic" );
+
+    {
+        ConcurrentBoundedList< Counted > pool( 100 );
+        UNIT_CHECK( pool.max_size( ) == 100 );
+
+        // Every slot can be used, and the slots are distinct.
+        std::vector< Counted * > items;
+        std::set< Counted * > distinct;
+        for( int i = 0; i < 100; ++i ) {
+            items.push_back( pool.insert( Counted( i ) ) );
+            distinct.insert( items.back( ) );
+        }
+        UNIT_CHECK( distinct.size( ) == 100 );
+        UNIT_CHECK( Counted::live == 100 );
+        try {
+            pool.insert( Counted( 100 ) );
+            UNIT_FAIL( "Unexpectedly able to insert into a full ConcurrentBoundedList" );
+        }
+        catch( std::length_error & ) {
+            // okay.
+        }
+        for( int i = 0; i < 100; ++i ) UNIT_CHECK( items[i]->value == i );
+
+        // Erased slots are reused.
+        for( int i = 0; i < 100; i += 2 ) pool.erase( items[i] );
+        UNIT_CHECK( Counted::live == 50 );
+        for( int i = 0; i < 100; i += 2 ) items[i] = pool.insert( Counted( -i ) );
+        for( int i = 0; i < 100; ++i ) UNIT_CHECK( items[i]->value == ( ( i % 2 == 0 ) ? -i : i ) );
+
+        // The destructor destroys the remaining items.
+        for( int i = 0; i < 10; ++i ) pool.erase( items[i] );
+    }
+    UNIT_CHECK( Counted::live == 0 );
+
+    ConcurrentBoundedList< int, std::uint8_t > small_pool( 255 );
+    UNIT_CHECK( small_pool.max_size( ) == 255 );
+    try {
+        ConcurrentBoundedList< int, std::uint8_t > too_big( 256 );
+        UNIT_FAIL( "Unexpectedly able to create a ConcurrentBoundedList too large for its index type" );
+    }
+    catch( std::length_error & ) {
+        // okay.
+    }
+
+    ConcurrentBoundedList< int > empty_pool( 0 );
+    try {
+        empty_pool.insert( 1 );
+        UNIT_FAIL( "Unexpectedly able to insert into an empty ConcurrentBoundedList" );
+    }
+    catch( std::length_error & ) {
+        // okay.
+    }
+}
+
+
+static void cache_test( )
+{
+    UnitTestManager::UnitTest test( "local_cache" );
+
+    typedef ConcurrentBoundedList< std::string > Pool;
+    Pool pool( 200 );
+    std::vector< std::string * > items;
+    {
+        Pool::local_cache cache1( pool );
+        Pool::local_cache cache2( pool );
+        for( int i = 0; i < 150; ++i ) {
+            items.push_back( cache1.insert( std::to_string( i ) ) );
+        }
+
+        // The slots held by cache1 are not available to cache2.
+        int inserted = 0;
+        try {
+            for( ; inserted < 200; ++inserted ) items.push_back( cache2.insert( "x" ) );
+        }
+        catch( std::length_error & ) {
+            // okay.
+        }
+        UNIT_CHECK( inserted >= 200 - 150 - static_cast< int >( Pool::local_cache::cache_size ) );
+        UNIT_CHECK( inserted < 50 );
+        UNIT_CHECK( *items[42] == "42" );
+
+        // Items can be erased through any cache.
+        for( std::string *item : items ) cache2.erase( item );
+        items.clear( );
+    }
+
+    // With the caches gone every slot is available again.
+    for( int i = 0; i < 200; ++i ) items.push_back( pool.insert( std::to_string( i ) ) );
+    UNIT_CHECK( *items[199] == "199" );
+    for( std::string *item : items ) pool.erase( item );
+}
+
+
+// Each thread repeatedly allocates a batch of items holding its own number, checks that no
+// other thread has written to them, and frees them.
+static void thread_test( )
+{
+    UnitTestManager::UnitTest test( "threads" );
+
+    typedef ConcurrentBoundedList< long > Pool;
+    const int thread_count = 4;
+    const int batch_size = 100;
+    const int rounds = 2000;
+    const int capacity = thread_count * ( batch_size + static_cast< int >( Pool::local_cache::cache_size ) );
+    Pool pool( capacity );
+
+    std::atomic< int > errors{ 0 };
+    std::vector< std::thread > threads;
+    for( int t = 0; t < thread_count; ++t ) {
+        threads.emplace_back( [&, t]( ) {
+            Pool::local_cache cache( pool );
+            std::vector< long * > items;
+            for( int round = 0; round < rounds; ++round ) {
+                for( int i = 0; i < batch_size; ++i ) {
+                    // Odd rounds bypass the cache so both paths share the free list.
+                    long value = t * 1000000L + i;
+                    items.push_back( ( round % 2 == 0 ) ? cache.insert( value ) : pool.insert( value ) );
+                }
+                for( int i = 0; i < batch_size; ++i ) {
+                    if( *items[i] != t * 1000000L + i ) ++errors;
+                    if( i % 2 == 0 ) cache.erase( items[i] );
+                    else pool.erase( items[i] );
+                }
+                items.clear( );
+            }
+        } );
+    }
+    for( std::thread &thread : threads ) thread.join( );
+    UNIT_CHECK( errors == 0 );
+
+    // No slot was lost or duplicated.
+    std::set< long * > distinct;
+    for( int i = 0; i < capacity; ++i ) distinct.insert( pool.insert( i ) );
+    UNIT_CHECK( distinct.size( ) == static_cast< std::size_t >( capacity ) );
+}
+
+
+bool ConcurrentBoundedList_tests( )
+{
+    basic_test( );
+    cache_test( );
+    thread_test( );
+    return true;
+}
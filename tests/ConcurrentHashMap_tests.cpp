@@ -0,0 +1,210 @@
+/*! \file    ConcurrentHashMap_tests.cpp
+ *  \brief   Exercise spica::ConcurrentHashMap and spica::ConcurrentHashSet.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <atomic>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../ConcurrentHashMap.hpp"
+#include "../epoch.hpp"
+#include "../u_tests.hpp"
+#include "../UnitTestManager.hpp"
+
+using namespace spica;
+
+// Counts the live instances so the tests can check that retired nodes are deleted.
+struct Counted {
+    static std::atomic< long > live;
+
+    int value;
+
+    Counted( int v = 0 ) : value( v ) { ++live; }
+    Counted( const Counted &other ) : value( other.value ) { ++live; }
+   ~Counted( ) { --live; }
+    Counted &operator=( const Counted &other ) { value = other.value; return *this; }
+};
+
+std::atomic< long > Counted::live{ 0 };
+
+
+typedef ConcurrentHashMap< int, int > IntMap;
+
+static void insert_find_test( )
+{
+    UnitTestManager::UnitTest test( "insert/find" );
+
+    IntMap table;
+    UNIT_CHECK( table.empty( ) );
+    UNIT_CHECK( table.bucket_count( ) == IntMap::stripe_count );
+    UNIT_CHECK( !table.contains( 1 ) );
+    UNIT_CHECK( !table.get( 1 ).has_value( ) );
+
+    for( int i = 0; i < 10000; ++i ) {
+        UNIT_CHECK( table.insert( i, 2 * i ) );
+    }
+    UNIT_CHECK( table.size( ) == 10000 );
+    UNIT_CHECK( table.bucket_count( ) >= 8192 );
+    UNIT_CHECK( !table.insert( 5, 0 ) );
+
+    bool all_found = true;
+    for( int i = 0; i < 10000; ++i ) {
+        int value = -1;
+        if( !table.find( i, value ) || value != 2 * i ) all_found = false;
+        if( table.contains( i + 10000 ) ) all_found = false;
+    }
+    UNIT_CHECK( all_found );
+
+    UNIT_CHECK( !table.insert_or_assign( 5, 50 ) );
+    UNIT_CHECK( table.get( 5 ) == std::optional< int >( 50 ) );
+    UNIT_CHECK( table.insert_or_assign( -5, 7 ) );
+    UNIT_CHECK( table.update( -5, []( int old ) { return old + 1; } ) );
+    UNIT_CHECK( table.get( -5 ) == std::optional< int >( 8 ) );
+    UNIT_CHECK( !table.update( -6, []( int old ) { return old + 1; } ) );
+    UNIT_CHECK( table.size( ) == 10001 );
+
+    for( int i = 0; i < 10000; i += 2 ) {
+        UNIT_CHECK( table.erase( i ) );
+    }
+    UNIT_CHECK( !table.erase( 0 ) );
+    UNIT_CHECK( table.size( ) == 5001 );
+
+    long sum = 0;
+    int  count = 0;
+    table.for_each( [&]( int key, int value ) { sum += value - 2 * key; ++count; } );
+    UNIT_CHECK( count == 5001 );
+    UNIT_CHECK( sum == ( 8 + 10 ) + ( 50 - 10 ) );   // The entries -5 -> 8 and 5 -> 50.
+
+    table.clear( );
+    UNIT_CHECK( table.empty( ) && !table.contains( 1 ) );
+    UNIT_CHECK( table.bucket_count( ) == IntMap::stripe_count );
+    UNIT_CHECK( table.insert( 1, 1 ) && table.size( ) == 1 );
+}
+
+
+static void set_test( )
+{
+    UnitTestManager::UnitTest test( "ConcurrentHashSet" );
+
+    ConcurrentHashSet< std::string > words( 1000 );
+    UNIT_CHECK( words.bucket_count( ) == 1024 );
+    UNIT_CHECK( words.insert( "alpha" ) );
+    UNIT_CHECK( words.insert( "beta" ) );
+    UNIT_CHECK( !words.insert( "alpha" ) );
+    UNIT_CHECK( words.contains( "beta" ) && !words.contains( "gamma" ) );
+    UNIT_CHECK( words.size( ) == 2 );
+
+    std::string joined;
+    words.for_each( [&]( const std::string &word ) { joined += word; } );
+    UNIT_CHECK( joined == "alphabeta" || joined == "betaalpha" );
+
+    UNIT_CHECK( words.erase( "alpha" ) && !words.erase( "alpha" ) );
+    UNIT_CHECK( words.size( ) == 1 );
+}
+
+
+static void reclamation_test( )
+{
+    UnitTestManager::UnitTest test( "reclamation" );
+
+    long initial = Counted::live;
+    {
+        ConcurrentHashMap< int, Counted > table;
+        for( int i = 0; i < 5000; ++i ) table.insert( i, Counted( i ) );
+        for( int i = 0; i < 5000; i += 3 ) table.insert_or_assign( i, Counted( -i ) );
+        for( int i = 1; i < 5000; i += 3 ) table.erase( i );
+        table.clear( );
+        for( int i = 0; i < 100; ++i ) table.insert( i, Counted( i ) );
+    }
+
+    // Once the map is gone and the epoch has advanced, every retired node is deleted.
+    UNIT_CHECK( epoch_reclaim( ) == 0 );
+    UNIT_CHECK( Counted::live == initial );
+
+    // Nested guards are allowed. Objects retired inside a guard wait for it to end.
+    Counted *item = new Counted( 1 );
+    {
+        epoch_guard outer;
+        epoch_guard inner;
+        epoch_retire( item );
+    }
+    UNIT_CHECK( epoch_reclaim( ) == 0 );
+    UNIT_CHECK( Counted::live == initial );
+}
+
+
+//
+// Readers look up keys that are always present while writers insert and remove other keys,
+// forcing several resizes. Every lookup of a stable key must succeed with the right value.
+//
+static void concurrent_test( )
+{
+    UnitTestManager::UnitTest test( "concurrent readers and writers" );
+
+    const int stable_count = 2000;
+    const int writer_count = 4;
+    const int reader_count = 4;
+    const int per_writer   = 20000;
+
+    ConcurrentHashMap< int, long > table;
+    for( int i = 0; i < stable_count; ++i ) table.insert( -i - 1, 3L * i );
+
+    std::atomic< bool > writers_done{ false };
+    std::atomic< long > failures{ 0 };
+    std::atomic< long > lookups{ 0 };
+    std::vector< std::thread > threads;
+
+    for( int w = 0; w < writer_count; ++w ) {
+        threads.emplace_back( [&, w]( ) {
+            int base = w * per_writer;
+            for( int i = 0; i < per_writer; ++i ) {
+                if( !table.insert( base + i, base + i ) ) ++failures;
+                if( i % 4 == 3 && !table.erase( base + i - 2 ) ) ++failures;
+            }
+            for( int i = 0; i < stable_count; i += writer_count ) {
+                table.update( -i - 1 - w, []( long old ) { return old; } );
+            }
+        } );
+    }
+    for( int r = 0; r < reader_count; ++r ) {
+        threads.emplace_back( [&, r]( ) {
+            long count = 0;
+            do {
+                for( int i = r; i < stable_count; i += reader_count ) {
+                    long value;
+                    if( !table.find( -i - 1, value ) || value != 3L * i ) ++failures;
+                    ++count;
+                }
+            } while( !writers_done.load( ) );
+            lookups += count;
+        } );
+    }
+    for( int w = 0; w < writer_count; ++w ) threads[w].join( );
+    writers_done = true;
+    for( int r = 0; r < reader_count; ++r ) threads[writer_count + r].join( );
+
+    UNIT_CHECK( failures == 0 );
+    UNIT_CHECK( lookups > 0 );
+    UNIT_CHECK( table.size( ) ==
+        static_cast< std::size_t >( stable_count + writer_count * per_writer * 3 / 4 ) );
+
+    bool contents_ok = true;
+    for( int key = 0; key < writer_count * per_writer; ++key ) {
+        bool expected = ( key % per_writer ) % 4 != 1;
+        if( table.contains( key ) != expected ) contents_ok = false;
+    }
+    UNIT_CHECK( contents_ok );
+}
+
+
+bool ConcurrentHashMap_tests( )
+{
+    insert_find_test( );
+    set_test( );
+    reclamation_test( );
+    concurrent_test( );
+    return true;
+}
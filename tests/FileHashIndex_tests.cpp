@@ -0,0 +1,216 @@
+/*! \file    FileHashIndex_tests.cpp
+ *  \brief   Exercise spica::FileHashIndex.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+
+#include "../FileHashIndex.hpp"
+#include "../u_tests.hpp"
+#include "../UnitTestManager.hpp"
+
+#if eOPSYS == ePOSIX
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using namespace spica;
+
+// The tests share this file. It is removed when they finish.
+static const char *test_file = "FileHashIndex_tests.dat";
+
+struct Record {
+    std::uint32_t id;
+    std::uint32_t flags;
+    std::uint64_t position;
+};
+
+typedef FileHashIndex< std::uint64_t, Record > Index;
+
+
+static void insert_find_test( )
+{
+    UnitTestManager::UnitTest test( "insert/find" );
+
+    std::remove( test_file );
+    std::uint64_t seed;
+    {
+        Index index( test_file );
+        UNIT_CHECK( index.empty( ) && index.capacity( ) == 16 && !index.resizing( ) );
+        UNIT_CHECK( index.find( 1 ) == nullptr );
+        seed = index.seed( );
+
+        for( std::uint64_t i = 0; i < 10000; ++i ) {
+            UNIT_CHECK( index.insert( i * 7, Record{ static_cast<std::uint32_t>( i ), 0, i * 100 } ) );
+        }
+        UNIT_CHECK( index.size( ) == 10000 );
+        UNIT_CHECK( !index.insert( 70, Record{ 0, 0, 0 } ) );
+
+        bool all_found = true;
+        for( std::uint64_t i = 0; i < 10000; ++i ) {
+            const Record *r = index.find( i * 7 );
+            if( r == nullptr || r->id != i || r->position != i * 100 ) all_found = false;
+            if( index.contains( i * 7 + 1 ) ) all_found = false;
+        }
+        UNIT_CHECK( all_found );
+
+        // Values can be changed in place.
+        index.find( 70 )->flags = 3;
+        UNIT_CHECK( !index.insert_or_assign( 7, Record{ 99, 1, 1 } ) );
+        UNIT_CHECK( index.insert_or_assign( 5, Record{ 55, 0, 0 } ) );
+
+        for( std::uint64_t i = 0; i < 10000; i += 2 ) {
+            UNIT_CHECK( index.erase( i * 7 ) );
+        }
+        UNIT_CHECK( !index.erase( 0 ) );
+        UNIT_CHECK( index.size( ) == 5001 );
+    }
+
+    // Reopening maps the same table; nothing is rebuilt.
+    const Index index( test_file );
+    UNIT_CHECK( index.seed( ) == seed );
+    UNIT_CHECK( index.size( ) == 5001 );
+    UNIT_CHECK( index.find( 7 ) != nullptr && index.find( 7 )->id == 99 );
+    UNIT_CHECK( index.find( 5 ) != nullptr && index.find( 5 )->id == 55 );
+    UNIT_CHECK( index.find( 70 ) == nullptr );
+    UNIT_CHECK( index.find( 77 ) != nullptr && index.find( 77 )->position == 1100 );
+
+    bool contents_ok = true;
+    for( std::uint64_t i = 0; i < 10000; ++i ) {
+        if( index.contains( i * 7 ) != ( i % 2 == 1 ) ) contents_ok = false;
+    }
+    UNIT_CHECK( contents_ok );
+}
+
+
+//
+// Updates during a resize must find keys in either table. The resize can be interrupted by
+// closing the index and continues when it is reopened.
+//
+static void resize_test( )
+{
+    UnitTestManager::UnitTest test( "lazy resize" );
+
+    std::remove( test_file );
+    std::uint64_t key = 0;
+    {
+        Index index( test_file, 1000 );
+        UNIT_CHECK( index.capacity( ) == 2048 );
+        while( !index.resizing( ) ) {
+            ++key;
+            index.insert( key, Record{ 0, 0, key } );
+        }
+        UNIT_CHECK( index.capacity( ) == 4096 && key == 1537 );
+
+        // Keys in the old table can be found, replaced, and erased.
+        UNIT_CHECK( index.find( 1 ) != nullptr && index.find( 1 )->position == 1 );
+        UNIT_CHECK( !index.insert_or_assign( 1000, Record{ 0, 0, 0 } ) );
+        UNIT_CHECK( index.erase( 1001 ) );
+        UNIT_CHECK( index.resizing( ) );
+    }
+
+    {
+        Index index( test_file );
+        UNIT_CHECK( index.resizing( ) && index.size( ) == key - 1 );
+        UNIT_CHECK( index.find( 1000 )->position == 0 && !index.contains( 1001 ) );
+
+        // The migration finishes long before the new table fills.
+        while( index.resizing( ) ) {
+            ++key;
+            index.insert( key, Record{ 0, 0, key } );
+        }
+        UNIT_CHECK( index.capacity( ) == 4096 );
+
+        bool all_found = true;
+        for( std::uint64_t k = 1; k <= key; ++k ) {
+            const Record *r = index.find( k );
+            if( k == 1001 ) {
+                if( r != nullptr ) all_found = false;
+            }
+            else if( r == nullptr || r->position != ( k == 1000 ? 0 : k ) ) {
+                all_found = false;
+            }
+        }
+        UNIT_CHECK( all_found );
+
+        index.reserve( 100000 );
+        UNIT_CHECK( !index.resizing( ) && index.capacity( ) == 262144 );
+        UNIT_CHECK( index.size( ) == key - 1 && index.find( key )->position == key );
+        index.sync( );
+    }
+}
+
+
+static void bad_file_test( )
+{
+    UnitTestManager::UnitTest test( "bad files" );
+
+    std::remove( test_file );
+    {
+        Index index( test_file );
+        index.insert( 1, Record{ 1, 1, 1 } );
+    }
+
+    // Wrong slot type.
+    bool caught = false;
+    try {
+        FileHashIndex< std::uint64_t, std::uint64_t > index( test_file );
+    }
+    catch( const std::runtime_error & ) {
+        caught = true;
+    }
+    UNIT_CHECK( caught );
+
+    // A plain FileVector with elements of the right size.
+    {
+        FileVector< detail::hash_index_slot< std::uint64_t, Record > > vector(
+            test_file, FileVector< detail::hash_index_slot< std::uint64_t, Record > >::size_type( 4 ) );
+    }
+    caught = false;
+    try {
+        Index index( test_file );
+    }
+    catch( const std::runtime_error & ) {
+        caught = true;
+    }
+    UNIT_CHECK( caught );
+
+    #if eOPSYS == ePOSIX
+    // The child crashes after an update, leaving the index dirty.
+    std::remove( test_file );
+    {
+        Index index( test_file );
+        index.insert( 1, Record{ 1, 1, 1 } );
+    }
+    std::fflush( 0 );
+    pid_t child = fork( );
+    if( child == 0 ) {
+        Index child_index( test_file );
+        child_index.insert( 2, Record{ 2, 2, 2 } );
+        _exit( 0 );
+    }
+    int status;
+    UNIT_CHECK( child > 0 && waitpid( child, &status, 0 ) == child );
+
+    caught = false;
+    try {
+        Index index( test_file );
+    }
+    catch( const std::runtime_error & ) {
+        caught = true;
+    }
+    UNIT_CHECK( caught );
+    #endif
+}
+
+
+bool FileHashIndex_tests( )
+{
+    insert_find_test( );
+    resize_test( );
+    bad_file_test( );
+    std::remove( test_file );
+    return true;
+}
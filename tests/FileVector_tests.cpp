@@ -3,71 +3,425 @@
  *  \author  Peter Chapin <spicacality@kelseymountain.org>
  */
 
-#include "environ.hpp"
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
-#include <algorithm>
-#include <iostream>
-#include "FileVector.hpp"
+#include "../FileVector.hpp"
+#include "../u_tests.hpp"
+#include "../UnitTestManager.hpp"
+
+#if eOPSYS == ePOSIX
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using namespace spica;
+
+// The tests share this file. It is removed when they finish.
+static const char *test_file = "FileVector_tests.dat";
 
 //
 // Function to test operator[]( )
 //
 static void access_test( )
 {
-    int i;
+    UnitTestManager::UnitTest test( "operator[]" );
 
-    std::cout << "Testing operator[]( )...";
-    spica::FileVector<int> my_file( "test.dat", 1024 );
-    for( i = 0; i < 1024; ++i ) {
+    FileVector<int> my_file( test_file, 1024 );
+    UNIT_CHECK( my_file.size( ) == 1024 );
+    for( int i = 0; i < 1024; ++i ) {
         my_file[i] = i;
     }
 
-    for( i = 0; i < 1024; ++i ) {
-        if( my_file[i] != i ) {
-            std::cout << "FAILED!\n";
-            break;
-        }
+    bool all_match = true;
+    for( int i = 0; i < 1024; ++i ) {
+        if( my_file[i] != i ) all_match = false;
     }
-    if( i == 1024 ) std::cout << "passed\n";
+    UNIT_CHECK( all_match );
 }
 
 
 //
-// Function to test push_back( )
+// Function to test push_back( ). This relies on the file left by access_test( ).
 //
 static void push_back_test( )
 {
-    int i;
+    UnitTestManager::UnitTest test( "push_back" );
 
-    std::cout << "Testing push_back( )...";
-    spica::FileVector<int> my_file( "test.dat" );
-    if( my_file.size( ) != 1024 ) {
-        std::cout << "FAILED! size( ) not as expected!\n";
-        return;
-    }
+    FileVector<int> my_file( test_file );
+    UNIT_CHECK( my_file.size( ) == 1024 );
+    UNIT_CHECK( my_file[1023] == 1023 );
 
-    for( i = 0; i < 1024; ++i ) {
+    for( int i = 0; i < 1024; ++i ) {
         my_file.push_back( 2 * i );
     }
+    UNIT_CHECK( my_file.size( ) == 2048 );
+    UNIT_CHECK( my_file.capacity( ) >= 2048 );
+
+    bool all_match = true;
+    for( int i = 1024; i < 2048; ++i ) {
+        if( my_file[i] != 2 * (i - 1024) ) all_match = false;
+    }
+    UNIT_CHECK( all_match );
+}
+
+
+//
+// Function to test that the file is trimmed to size when the vector is destroyed.
+//
+static void reopen_test( )
+{
+    UnitTestManager::UnitTest test( "reopen" );
+
+    {
+        FileVector<int> my_file( test_file, 0 );
+        for( int i = 0; i < 1000; ++i ) my_file.push_back( i );
+        my_file.pop_back( );
+    }
 
-    for(i = 1024; i < 2048; ++i ) {
-        if( my_file[i] != 2 * (i - 1024) ) {
-            std::cout << "FAILED!\n";
-            break;
+    FileVector<int> my_file( test_file );
+    UNIT_CHECK( my_file.size( ) == 999 );
+    UNIT_CHECK( my_file.back( ) == 998 );
+}
+
+
+//
+// Function to test insert( ) and erase( ).
+//
+static void insert_erase_test( )
+{
+    UnitTestManager::UnitTest test( "insert/erase" );
+
+    FileVector<int> my_file( test_file, 0 );
+    for( int i = 0; i < 10; ++i ) my_file.push_back( i );
+
+    // Inserting in the middle forces a reallocation.
+    FileVector<int>::iterator p = my_file.insert( my_file.begin( ) + 5, 100 );
+    UNIT_CHECK( *p == 100 );
+    UNIT_CHECK( my_file.size( ) == 11 );
+    my_file.insert( my_file.begin( ), FileVector<int>::size_type( 20 ), -1 );
+    UNIT_CHECK( my_file.size( ) == 31 );
+    UNIT_CHECK( my_file[19] == -1 && my_file[20] == 0 && my_file[25] == 100 );
+
+    my_file.erase( my_file.begin( ), my_file.begin( ) + 20 );
+    my_file.erase( my_file.begin( ) + 5 );
+    UNIT_CHECK( my_file.size( ) == 10 );
+    bool all_match = true;
+    for( int i = 0; i < 10; ++i ) {
+        if( my_file[i] != i ) all_match = false;
+    }
+    UNIT_CHECK( all_match );
+
+    my_file.clear( );
+    UNIT_CHECK( my_file.empty( ) );
+}
+
+
+//
+// Function to test advise( ). The hints have no visible effect but must be accepted.
+//
+static void advise_test( )
+{
+    UnitTestManager::UnitTest test( "advise" );
+
+    FileVector<double> my_file( test_file, 100000, 1.0 );
+    my_file.advise( access_pattern::sequential );
+    my_file.advise( 50000, 1000, access_pattern::will_need );
+    my_file.advise( 99999, 1000, access_pattern::random );
+    my_file.advise( access_pattern::normal );
+    UNIT_CHECK( my_file[99999] == 1.0 );
+}
+
+
+//
+// Function to test that elements don't move after reserve_address_space( ).
+//
+static void reserve_address_space_test( )
+{
+    UnitTestManager::UnitTest test( "reserve_address_space" );
+
+    {
+        FileVector<int> my_file( test_file, FileVector<int>::size_type( 10 ), 7 );
+        if( !my_file.reserve_address_space( ) ) {
+            // Not supported on this system.
+            UNIT_CHECK( !my_file.stable_addresses( ) );
+            return;
         }
+        UNIT_CHECK( my_file.stable_addresses( ) );
+        UNIT_CHECK( my_file.size( ) == 10 && my_file[9] == 7 );
+
+        int *original = my_file.begin( );
+        for( int i = 0; i < 1000000; ++i ) my_file.push_back( i );
+        UNIT_CHECK( my_file.begin( ) == original );
+        UNIT_CHECK( my_file[10] == 0 && my_file.back( ) == 999999 );
+    }
+
+    // The file is trimmed properly when it is closed.
+    {
+        FileVector<int> my_file( test_file );
+        UNIT_CHECK( my_file.size( ) == 1000010 );
+        UNIT_CHECK( my_file.back( ) == 999999 );
+
+        // Growing past a small reservation fails rather than moving the elements.
+        UNIT_CHECK( my_file.reserve_address_space( 8 * 1024 * 1024 ) );
+        bool caught = false;
+        try {
+            my_file.reserve( 4 * 1024 * 1024 );
+        }
+        catch( const std::bad_alloc & ) {
+            caught = true;
+        }
+        UNIT_CHECK( caught );
+        UNIT_CHECK( my_file.size( ) == 1000010 );
     }
-    if( i == 2048 ) std::cout << "passed\n";
 }
 
 
-int main( int, char ** )
+//
+// Function to test commit( ), flush( ), and sync( ).
+//
+static void commit_test( )
 {
+    UnitTestManager::UnitTest test( "commit/sync" );
+
+    {
+        FileVector<int> my_file( test_file, 0 );
+        for( int i = 0; i < 100; ++i ) my_file.push_back( i );
+        my_file.flush( 0, 50, flush_mode::async );
+        my_file.flush( flush_mode::async );
+        my_file.sync( );
+    }
+
+    FileVector<int> my_file( test_file );
+    UNIT_CHECK( my_file.size( ) == 100 );
+    UNIT_CHECK( my_file.back( ) == 99 );
+
+    #if eOPSYS == ePOSIX
+    // The child process crashes (exits without running destructors) after adding elements
+    // that it didn't commit. Only the committed elements are seen when the file is reopened.
+    std::fflush( 0 );
+    pid_t child = fork( );
+    if( child == 0 ) {
+        FileVector<int> child_file( test_file );
+        for( int i = 0; i < 100; ++i ) child_file.push_back( 1000 + i );
+        child_file.commit( );
+        for( int i = 0; i < 100000; ++i ) child_file.push_back( -1 );
+        _exit( 0 );
+    }
+    int status;
+    UNIT_CHECK( child > 0 && waitpid( child, &status, 0 ) == child );
+
+    FileVector<int> crashed_file( test_file );
+    UNIT_CHECK( crashed_file.size( ) == 200 );
+    UNIT_CHECK( crashed_file[100] == 1000 && crashed_file.back( ) == 1099 );
+    #endif
+}
+
+
+//
+// Function to test that unsuitable files are rejected.
+//
+static void bad_file_test( )
+{
+    UnitTestManager::UnitTest test( "bad files" );
+
+    {
+        FileVector<int> my_file( test_file, FileVector<int>::size_type( 10 ), 1 );
+    }
+
+    // Wrong element type.
+    bool caught = false;
+    try {
+        FileVector<double> my_file( test_file );
+    }
+    catch( const std::runtime_error & ) {
+        caught = true;
+    }
+    UNIT_CHECK( caught );
+
+    // Not a FileVector at all.
+    std::FILE *output = std::fopen( test_file, "wb" );
+    std::fputs( "This is not a FileVector", output );
+    std::fclose( output );
+    caught = false;
     try {
-        access_test( );
-        push_back_test( );
+        FileVector<int> my_file( test_file );
     }
-    catch( std::bad_alloc ) {
-        std::cout << "Out of memory!" << "\n";
+    catch( const std::runtime_error & ) {
+        caught = true;
+    }
+    UNIT_CHECK( caught );
+
+    // The file is left unchanged.
+    output = std::fopen( test_file, "rb" );
+    char buffer[64] = { 0 };
+    UNIT_CHECK( output != 0 && std::fgets( buffer, sizeof( buffer ), output ) != 0 );
+    UNIT_CHECK( std::string( buffer ) == "This is not a FileVector" );
+    if( output != 0 ) std::fclose( output );
+}
+
+
+//
+// Function to test FileVectorReader.
+//
+static void reader_test( )
+{
+    UnitTestManager::UnitTest test( "FileVectorReader" );
+
+    FileVector<int> writer( test_file, 0 );
+    for( int i = 0; i < 100; ++i ) writer.push_back( i );
+    writer.commit( );
+
+    FileVectorReader<int> reader( test_file );
+    UNIT_CHECK( reader.size( ) == 100 );
+    UNIT_CHECK( reader.front( ) == 0 && reader.back( ) == 99 );
+
+    // The snapshot doesn't change until it is refreshed.
+    for( int i = 100; i < 200; ++i ) writer.push_back( i );
+    UNIT_CHECK( reader.size( ) == 100 && reader.committed_size( ) == 100 );
+    writer.commit( );
+    UNIT_CHECK( reader.size( ) == 100 && reader.committed_size( ) == 200 );
+    UNIT_CHECK( reader.refresh( ) );
+    UNIT_CHECK( reader.size( ) == 200 && reader[150] == 150 );
+    UNIT_CHECK( !reader.refresh( ) );
+
+    // The reader remaps the file when it grows.
+    for( int i = 200; i < 1000000; ++i ) writer.push_back( i );
+    writer.commit( );
+    UNIT_CHECK( reader.refresh( ) );
+    UNIT_CHECK( reader.size( ) == 1000000 && reader.back( ) == 999999 );
+
+    bool all_match = true;
+    int expected = 0;
+    for( int value : reader ) {
+        if( value != expected++ ) all_match = false;
+    }
+    UNIT_CHECK( all_match );
+
+    // Files that aren't FileVectors of the right type are rejected.
+    bool caught = false;
+    try {
+        FileVectorReader<char> wrong_reader( test_file );
+    }
+    catch( const std::runtime_error & ) {
+        caught = true;
+    }
+    UNIT_CHECK( caught );
+}
+
+
+//
+// Function to test the range members and append( ).
+//
+static void range_test( )
+{
+    UnitTestManager::UnitTest test( "range insert/assign" );
+
+    std::vector<int> source;
+    for( int i = 0; i < 1000; ++i ) source.push_back( i );
+
+    FileVector<int> my_file( test_file, source.begin( ), source.end( ) );
+    UNIT_CHECK( my_file.size( ) == 1000 && my_file[999] == 999 );
+
+    // Forward iterators.
+    int block[] = { -1, -2, -3 };
+    my_file.insert( my_file.begin( ) + 10, std::begin( block ), std::end( block ) );
+    UNIT_CHECK( my_file.size( ) == 1003 );
+    UNIT_CHECK( my_file[9] == 9 && my_file[10] == -1 && my_file[12] == -3 && my_file[13] == 10 );
+
+    // Input iterators.
+    std::istringstream input( "100 200 300" );
+    my_file.insert( my_file.begin( ) + 1,
+                    std::istream_iterator<int>( input ), std::istream_iterator<int>( ) );
+    UNIT_CHECK( my_file.size( ) == 1006 );
+    UNIT_CHECK( my_file[0] == 0 && my_file[1] == 100 && my_file[3] == 300 && my_file[4] == 1 );
+    UNIT_CHECK( my_file.back( ) == 999 );
+
+    // Two integers select the fill version.
+    my_file.insert( my_file.end( ), 3, 7 );
+    UNIT_CHECK( my_file.size( ) == 1009 && my_file.back( ) == 7 );
+
+    my_file.assign( source.begin( ) + 500, source.end( ) );
+    UNIT_CHECK( my_file.size( ) == 500 && my_file.front( ) == 500 );
+    my_file.assign( 5, 42 );
+    UNIT_CHECK( my_file.size( ) == 5 && my_file[4] == 42 );
+
+    my_file.resize( 10, 1 );
+    UNIT_CHECK( my_file.size( ) == 10 && my_file[4] == 42 && my_file[5] == 1 );
+    my_file.resize( 2 );
+    UNIT_CHECK( my_file.size( ) == 2 );
+
+    my_file.append( source.data( ), source.size( ) );
+    UNIT_CHECK( my_file.size( ) == 1002 && my_file[2] == 0 && my_file.back( ) == 999 );
+}
+
+
+//
+// Function to test the user header, resize_for_overwrite( ), and discard( ).
+//
+static void user_header_test( )
+{
+    UnitTestManager::UnitTest test( "user header/discard" );
+
+    const int count = 8192;
+    {
+        FileVector<int> my_file( test_file, FileVector<int>::size_type( 0 ) );
+        const char *area = static_cast<const char *>( my_file.user_header( ) );
+        bool all_zero = true;
+        for( std::size_t i = 0; i < FileVector<int>::user_header_bytes; ++i ) {
+            if( area[i] != 0 ) all_zero = false;
+        }
+        UNIT_CHECK( all_zero );
+        std::strcpy( static_cast<char *>( my_file.user_header( ) ), "program data" );
+
+        // A new file is zero where it hasn't been written.
+        my_file.resize_for_overwrite( count );
+        UNIT_CHECK( my_file.size( ) == count );
+        UNIT_CHECK( my_file[0] == 0 && my_file[count - 1] == 0 );
+        for( int i = 0; i < count; ++i ) my_file[i] = i + 1;
+
+        my_file.discard( 100, 5000 );
+        bool discarded = true;
+        for( int i = 0; i < count; ++i ) {
+            int expected = ( i >= 100 && i < 5100 ) ? 0 : i + 1;
+            if( my_file[i] != expected ) discarded = false;
+        }
+        UNIT_CHECK( discarded );
+        UNIT_CHECK( my_file.size( ) == count );
+
+        my_file.resize_for_overwrite( 10 );
+        UNIT_CHECK( my_file.size( ) == 10 && my_file[9] == 10 );
+        my_file.resize_for_overwrite( count );
     }
-    return 0;
+
+    FileVector<int> my_file( test_file );
+    UNIT_CHECK( std::strcmp( static_cast<const char *>( my_file.user_header( ) ), "program data" ) == 0 );
+    UNIT_CHECK( my_file.size( ) == count && my_file[99] == 100 && my_file[100] == 0 );
+
+    FileVectorReader<int> reader( test_file );
+    UNIT_CHECK( std::strcmp( static_cast<const char *>( reader.user_header( ) ), "program data" ) == 0 );
+}
+
+
+bool FileVector_tests( )
+{
+    access_test( );
+    push_back_test( );
+    reopen_test( );
+    insert_erase_test( );
+    advise_test( );
+    reserve_address_space_test( );
+    commit_test( );
+    bad_file_test( );
+    reader_test( );
+    range_test( );
+    user_header_test( );
+    std::remove( test_file );
+    return true;
 }
@@ -4,6 +4,8 @@
  */
 
 #include <iostream>
+#include <random>
+#include <vector>
 
 #include "../Graph.hpp"
 #include "../u_tests.hpp"
@@ -11,7 +13,7 @@
 
 using namespace spica;
 
-bool Graph_tests( )
+static void all_graph_test( )
 {
     // TODO: Split the graph tests into several smaller test functions.
     UnitTestManager::UnitTest test( "all graph tests" );
@@ -50,6 +52,61 @@ bool Graph_tests( )
             ++expected;
         }
     }
+}
+
+
+// Freeze a random graph and check that the CSR copy has the same edges in the same order.
+template<csr_layout Layout>
+static void freeze_test( const char *name )
+{
+    UnitTestManager::UnitTest test( name );
+    std::mt19937 generator( 5 );
+
+    Graph<double> my_graph;
+    for( int i = 0; i < 5000; ++i ) {
+        Graph<double>::count_t source = generator( ) % 1000;
+        Graph<double>::count_t target = generator( ) % 1000;
+        my_graph.create_edge( source, target, i / 8.0 );
+    }
+    my_graph.create_vertex( 1100 );  // Some vertices with no edges at the end.
+    UNIT_CHECK( my_graph.num_edges( ) == 5000 );
+
+    CSRGraph<double, Layout> frozen = my_graph.template freeze<Layout>( );
+    UNIT_CHECK( frozen.num_vertices( ) == my_graph.num_vertices( ) );
+    UNIT_CHECK( frozen.num_edges( ) == my_graph.num_edges( ) );
+
+    bool same = true;
+    Graph<double>::count_t total = 0;
+    for( Graph<double>::count_t v = 0; v < my_graph.num_vertices( ); ++v ) {
+        Graph<double>::count_t e = frozen.edge_begin( v );
+        for( Graph<double>::edge_iterator p = my_graph.ebegin( v ); p != my_graph.eend( v ); ++p, ++e ) {
+            if( e == frozen.edge_end( v ) || frozen.target( e ) != p->remote_vertex ) same = false;
+            if constexpr( Layout != csr_layout::unweighted ) {
+                if( frozen.weight( e ) != p->edge_weight ) same = false;
+            }
+        }
+        if( e != frozen.edge_end( v ) ) same = false;
+        total += frozen.degree( v );
+    }
+    UNIT_CHECK( same );
+    UNIT_CHECK( total == 5000 );
+
+    // The frozen copy is independent of the graph.
+    my_graph.create_edge( 0, 1, 0.0 );
+    UNIT_CHECK( my_graph.num_edges( ) == 5001 && frozen.num_edges( ) == 5000 );
+
+    Graph<double> empty_graph;
+    CSRGraph<double, Layout> empty_frozen( empty_graph );
+    UNIT_CHECK( empty_frozen.num_vertices( ) == 0 && empty_frozen.num_edges( ) == 0 );
+}
+
+
+bool Graph_tests( )
+{
+    all_graph_test( );
+    freeze_test<csr_layout::separate>( "freeze, separate weights" );
+    freeze_test<csr_layout::interleaved>( "freeze, interleaved weights" );
+    freeze_test<csr_layout::unweighted>( "freeze, unweighted" );
     return true;
 }
 
@@ -0,0 +1,162 @@
+/*! \file    HashMapFlat_tests.cpp
+ *  \brief   Exercise spica::HashMapFlat.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "../HashMapFlat.hpp"
+#include "../u_tests.hpp"
+#include "../UnitTestManager.hpp"
+
+using namespace spica;
+
+static void insert_find_test( )
+{
+    UnitTestManager::UnitTest test( "insert/find" );
+
+    HashMapFlat< int, int > table;
+    UNIT_CHECK( table.empty( ) && table.bucket_count( ) == 0 );
+    UNIT_CHECK( table.find( 1 ) == table.end( ) );
+
+    for( int i = 0; i < 10000; ++i ) {
+        UNIT_CHECK( table.insert( std::make_pair( i, 2 * i ) ).second );
+    }
+    UNIT_CHECK( table.size( ) == 10000 );
+    UNIT_CHECK( table.load_factor( ) <= 0.875f );
+    UNIT_CHECK( !table.insert( std::make_pair( 5, 0 ) ).second );
+    UNIT_CHECK( table.at( 5 ) == 10 );
+
+    bool all_found = true;
+    for( int i = 0; i < 10000; ++i ) {
+        HashMapFlat< int, int >::iterator p = table.find( i );
+        if( p == table.end( ) || p->first != i || p->second != 2 * i ) all_found = false;
+        if( table.contains( i + 10000 ) ) all_found = false;
+    }
+    UNIT_CHECK( all_found );
+
+    // Iteration visits every element once.
+    long sum = 0;
+    int  count = 0;
+    for( const std::pair< const int, int > &item : table ) {
+        sum += item.first;
+        ++count;
+    }
+    UNIT_CHECK( count == 10000 && sum == 10000L * 9999 / 2 );
+
+    table[3] = -3;
+    table[20000] = 7;
+    UNIT_CHECK( table.at( 3 ) == -3 && table.at( 20000 ) == 7 && table.size( ) == 10001 );
+    table.insert_or_assign( 20000, 8 );
+    UNIT_CHECK( table.at( 20000 ) == 8 );
+
+    bool caught = false;
+    try {
+        table.at( -1 );
+    }
+    catch( const std::out_of_range & ) {
+        caught = true;
+    }
+    UNIT_CHECK( caught );
+
+    // Copies are independent.
+    HashMapFlat< int, int > copy( table );
+    copy[3] = 3;
+    UNIT_CHECK( copy.size( ) == table.size( ) && table.at( 3 ) == -3 && copy.at( 3 ) == 3 );
+    HashMapFlat< int, int > moved( std::move( copy ) );
+    UNIT_CHECK( moved.size( ) == 10001 && copy.empty( ) );
+}
+
+
+static void erase_test( )
+{
+    UnitTestManager::UnitTest test( "erase" );
+
+    HashMapFlat< int, int > table;
+    std::map< int, int > reference;
+
+    // Random inserts and erases checked against std::map.
+    std::srand( 2 );
+    for( int i = 0; i < 50000; ++i ) {
+        int key = std::rand( ) % 3000;
+        if( std::rand( ) % 2 == 0 ) {
+            UNIT_CHECK( table.erase( key ) == reference.erase( key ) );
+        }
+        else {
+            UNIT_CHECK( table.try_emplace( key, i ).second == reference.emplace( key, i ).second );
+        }
+    }
+    UNIT_CHECK( table.size( ) == reference.size( ) );
+
+    bool all_match = true;
+    for( const std::pair< const int, int > &item : reference ) {
+        HashMapFlat< int, int >::const_iterator p = table.find( item.first );
+        if( p == table.end( ) || p->second != item.second ) all_match = false;
+    }
+    UNIT_CHECK( all_match );
+
+    // Churn at a constant size reuses deleted slots instead of growing without bound.
+    std::size_t buckets = table.bucket_count( );
+    for( int i = 0; i < 100000; ++i ) {
+        table.erase( table.begin( ) );
+        table.try_emplace( 100000 + i, i );
+    }
+    UNIT_CHECK( table.size( ) == reference.size( ) );
+    UNIT_CHECK( table.bucket_count( ) <= 2 * buckets );
+
+    table.clear( );
+    UNIT_CHECK( table.empty( ) && table.begin( ) == table.end( ) );
+}
+
+
+static void emplace_test( )
+{
+    UnitTestManager::UnitTest test( "emplace" );
+
+    // Move-only values are constructed in place.
+    HashMapFlat< int, std::unique_ptr< int > > owners;
+    owners.try_emplace( 1, new int( 10 ) );
+    owners.emplace( 2, std::make_unique< int >( 20 ) );
+    for( int i = 3; i < 1000; ++i ) owners.try_emplace( i, new int( i * 10 ) );
+    UNIT_CHECK( *owners.at( 1 ) == 10 && *owners.at( 2 ) == 20 && *owners.at( 999 ) == 9990 );
+
+    // The arguments aren't used if the key is present.
+    std::unique_ptr< int > spare( new int( 0 ) );
+    UNIT_CHECK( !owners.try_emplace( 1, std::move( spare ) ).second );
+    UNIT_CHECK( spare != nullptr );
+}
+
+
+static void heterogeneous_test( )
+{
+    UnitTestManager::UnitTest test( "heterogeneous lookup" );
+
+    HashMapFlat< std::string, int, string_hash, std::equal_to< > > symbols;
+    symbols.try_emplace( "alpha", 1 );
+    symbols.try_emplace( "beta",  2 );
+    symbols[std::string( "gamma" )] = 3;
+
+    std::string_view name( "beta and more" );
+    UNIT_CHECK( symbols.find( name.substr( 0, 4 ) ) != symbols.end( ) );
+    UNIT_CHECK( symbols.find( name.substr( 0, 4 ) )->second == 2 );
+    UNIT_CHECK( symbols.contains( "gamma" ) );
+    UNIT_CHECK( !symbols.contains( std::string_view( "delta" ) ) );
+    UNIT_CHECK( symbols.erase( std::string_view( "alpha" ) ) == 1 );
+    UNIT_CHECK( symbols.size( ) == 2 );
+}
+
+
+bool HashMapFlat_tests( )
+{
+    insert_find_test( );
+    erase_test( );
+    emplace_test( );
+    heterogeneous_test( );
+    return true;
+}
@@ -0,0 +1,164 @@
+/*! \file    HashtableOpen_tests.cpp
+ *  \brief   Exercise spica::HashtableOpen.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <cstdlib>
+#include <set>
+#include <string>
+
+#include "../HashtableOpen.hpp"
+#include "../u_tests.hpp"
+#include "../UnitTestManager.hpp"
+
+using namespace spica;
+
+static int identity_hash( const int &value )
+{
+    return value;
+}
+
+// Every key collides. This produces probe distances too large for the metadata bytes.
+static int constant_hash( const int & )
+{
+    return 42;
+}
+
+static int string_hash( const std::string &value )
+{
+    unsigned hash = 0;
+    for( char ch : value ) hash = 31 * hash + static_cast< unsigned char >( ch );
+    return static_cast< int >( hash );
+}
+
+
+static void insert_find_test( )
+{
+    UnitTestManager::UnitTest test( "insert/find" );
+
+    HashtableOpen< int > table( 4, identity_hash );
+    UNIT_CHECK( table.empty( ) );
+    UNIT_CHECK( table.bucket_count( ) == 8 );
+
+    for( int i = 0; i < 1000; ++i ) {
+        std::pair< HashtableOpen< int >::iterator, bool > result = table.insert( i * 16 );
+        UNIT_CHECK( result.second );
+        UNIT_CHECK( *result.first == i * 16 );
+    }
+    UNIT_CHECK( table.size( ) == 1000 );
+    UNIT_CHECK( table.load_factor( ) <= table.max_load_factor( ) );
+
+    // Inserting again has no effect.
+    std::pair< HashtableOpen< int >::iterator, bool > result = table.insert( 160 );
+    UNIT_CHECK( !result.second && *result.first == 160 );
+    UNIT_CHECK( table.size( ) == 1000 );
+
+    bool all_found = true;
+    for( int i = 0; i < 1000; ++i ) {
+        if( table.find( i * 16 ) == table.end( ) || *table.find( i * 16 ) != i * 16 ) all_found = false;
+        if( table.find( i * 16 + 1 ) != table.end( ) ) all_found = false;
+    }
+    UNIT_CHECK( all_found );
+
+    HashtableOpen< std::string > strings( 16, string_hash );
+    strings.insert( "Hello" );
+    strings.insert( "World" );
+    UNIT_CHECK( strings.find( "Hello" ) != strings.end( ) );
+    UNIT_CHECK( strings.find( "Goodbye" ) == strings.end( ) );
+}
+
+
+static void erase_test( )
+{
+    UnitTestManager::UnitTest test( "erase" );
+
+    HashtableOpen< int > table( 16, identity_hash );
+    std::set< int > reference;
+
+    // Random inserts and erases checked against std::set.
+    std::srand( 1 );
+    for( int i = 0; i < 20000; ++i ) {
+        int value = std::rand( ) % 2000;
+        if( std::rand( ) % 3 == 0 ) {
+            UNIT_CHECK( table.erase( value ) == reference.erase( value ) );
+        }
+        else {
+            UNIT_CHECK( table.insert( value ).second == reference.insert( value ).second );
+        }
+    }
+    UNIT_CHECK( table.size( ) == reference.size( ) );
+
+    bool all_match = true;
+    for( int value = 0; value < 2000; ++value ) {
+        bool in_table = table.find( value ) != table.end( );
+        if( in_table != ( reference.count( value ) == 1 ) ) all_match = false;
+    }
+    UNIT_CHECK( all_match );
+
+    // Erasing through an iterator.
+    while( !table.empty( ) ) table.erase( table.begin( ) );
+    UNIT_CHECK( table.begin( ) == table.end( ) );
+}
+
+
+static void iterator_test( )
+{
+    UnitTestManager::UnitTest test( "iterator" );
+
+    HashtableOpen< int > table( 8, identity_hash );
+    std::set< int > seen;
+
+    for( int i = 0; i < 100; ++i ) table.insert( i );
+    for( HashtableOpen< int >::iterator p = table.begin( ); p != table.end( ); ++p ) {
+        seen.insert( *p );
+    }
+    UNIT_CHECK( seen.size( ) == 100 );
+    UNIT_CHECK( *seen.begin( ) == 0 && *seen.rbegin( ) == 99 );
+
+    HashtableOpen< int >::iterator last = table.end( );
+    --last;
+    UNIT_CHECK( seen.count( *last ) == 1 );
+
+    table.clear( );
+    UNIT_CHECK( table.empty( ) && table.begin( ) == table.end( ) );
+}
+
+
+static void growth_test( )
+{
+    UnitTestManager::UnitTest test( "load factor" );
+
+    HashtableOpen< int > table( 8, identity_hash, 0.5f );
+    for( int i = 0; i < 100; ++i ) table.insert( i );
+    UNIT_CHECK( table.load_factor( ) <= 0.5f );
+
+    table.max_load_factor( 0.25f );
+    UNIT_CHECK( table.load_factor( ) <= 0.25f );
+    UNIT_CHECK( table.size( ) == 100 );
+
+    table.reserve( 10000 );
+    std::size_t buckets = table.bucket_count( );
+    for( int i = 100; i < 10000; ++i ) table.insert( i );
+    UNIT_CHECK( table.bucket_count( ) == buckets );
+
+    // Long probe sequences still work.
+    HashtableOpen< int > colliding( 8, constant_hash );
+    for( int i = 0; i < 600; ++i ) colliding.insert( i );
+    for( int i = 0; i < 600; i += 2 ) colliding.erase( i );
+    bool all_match = true;
+    for( int i = 0; i < 600; ++i ) {
+        if( ( colliding.find( i ) != colliding.end( ) ) != ( i % 2 == 1 ) ) all_match = false;
+    }
+    UNIT_CHECK( all_match );
+    UNIT_CHECK( colliding.size( ) == 300 );
+}
+
+
+bool HashtableOpen_tests( )
+{
+    insert_find_test( );
+    erase_test( );
+    iterator_test( );
+    growth_test( );
+    return true;
+}
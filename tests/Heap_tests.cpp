@@ -0,0 +1,185 @@
+/*! \file    Heap_tests.cpp
+ *  \brief   Exercise spica::DaryHeap, spica::PairingHeap, and spica::FibonacciHeap.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <algorithm>
+#include <functional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../DaryHeap.hpp"
+#include "../FibonacciHeap.hpp"
+#include "../PairingHeap.hpp"
+#include "../PoolAllocator.hpp"
+#include "../u_tests.hpp"
+#include "../UnitTestManager.hpp"
+
+using namespace spica;
+
+#define N 10000  // The number of items in the heap during primary testing.
+
+// Returns true if the heap holds exactly the given numbers (in any order) and pops them in
+// ascending order. Empties the heap.
+template<typename Heap>
+static bool drains_in_order( Heap &my_heap, std::vector<int> numbers )
+{
+    std::vector<int> visited( my_heap.begin( ), my_heap.end( ) );
+    std::sort( visited.begin( ), visited.end( ) );
+    std::sort( numbers.begin( ), numbers.end( ) );
+    if( visited != numbers || my_heap.size( ) != numbers.size( ) ) return false;
+
+    for( int number : numbers ) {
+        if( my_heap.front( ) != number ) return false;
+        my_heap.pop( );
+    }
+    return my_heap.empty( );
+}
+
+
+template<typename Heap>
+static void basic_test( const char *name )
+{
+    UnitTestManager::UnitTest test( name );
+    std::mt19937 generator( 1 );
+
+    std::vector<int> numbers1( N );
+    std::vector<int> numbers2( N / 3 );
+    for( int &number : numbers1 ) number = static_cast<int>( generator( ) % 100000 );
+    for( int &number : numbers2 ) number = static_cast<int>( generator( ) % 100000 );
+
+    Heap heap1( numbers1.begin( ), numbers1.end( ) );
+    UNIT_CHECK( heap1.size( ) == N );
+    UNIT_CHECK( drains_in_order( heap1, numbers1 ) );
+
+    // Merge, including merges with empty heaps.
+    Heap heap2( numbers1.begin( ), numbers1.end( ) );
+    Heap heap3;
+    for( int number : numbers2 ) heap3.push( number );
+    Heap empty;
+    heap2.merge( empty );
+    empty.merge( heap3 );
+    heap2.merge( empty );
+    UNIT_CHECK( heap3.empty( ) && empty.empty( ) );
+    std::vector<int> both( numbers1 );
+    both.insert( both.end( ), numbers2.begin( ), numbers2.end( ) );
+    UNIT_CHECK( drains_in_order( heap2, both ) );
+
+    // Interleaved pushes and pops.
+    Heap heap4;
+    std::vector<int> reference;
+    bool interleaved_ok = true;
+    for( int i = 0; i < N; ++i ) {
+        int number = static_cast<int>( generator( ) % 1000 );
+        heap4.push( number );
+        reference.push_back( number );
+        std::push_heap( reference.begin( ), reference.end( ), std::greater<int>( ) );
+        if( i % 3 == 2 ) {
+            if( heap4.front( ) != reference.front( ) ) interleaved_ok = false;
+            heap4.pop( );
+            std::pop_heap( reference.begin( ), reference.end( ), std::greater<int>( ) );
+            reference.pop_back( );
+        }
+    }
+    UNIT_CHECK( interleaved_ok );
+    UNIT_CHECK( drains_in_order( heap4, reference ) );
+
+    // The heap can be cleared and used again.
+    Heap heap5( numbers2.begin( ), numbers2.end( ) );
+    heap5.clear( );
+    UNIT_CHECK( heap5.empty( ) && heap5.begin( ) == heap5.end( ) );
+    heap5.push( 42 );
+    UNIT_CHECK( heap5.size( ) == 1 && heap5.front( ) == 42 );
+}
+
+
+// Decrease and erase random items through their handles, comparing with a sorted vector.
+template<typename Heap>
+static void handle_test( const char *name )
+{
+    UnitTestManager::UnitTest test( name );
+    std::mt19937 generator( 3 );
+
+    Heap my_heap;
+    std::vector<typename Heap::handle> handles;
+    for( int i = 0; i < N; ++i ) {
+        handles.push_back( my_heap.push( static_cast<int>( generator( ) % 1000000 ) ) );
+    }
+
+    // Pop a few items first so that the trees have some structure. These items come before
+    // all the others, so none of the handles are affected.
+    for( int i = 0; i < 10; ++i ) my_heap.push( -1 - i );
+    for( int i = 0; i < 10; ++i ) my_heap.pop( );
+    UNIT_CHECK( handles.size( ) == my_heap.size( ) );
+
+    std::shuffle( handles.begin( ), handles.end( ), generator );
+    std::vector<int> remaining;
+    bool handles_ok = true;
+    for( std::size_t i = 0; i < handles.size( ); ++i ) {
+        if( i % 3 == 0 ) {
+            int new_value = *handles[i] - static_cast<int>( generator( ) % 2000000 );
+            my_heap.decrease_key( handles[i], new_value );
+            if( *handles[i] != new_value ) handles_ok = false;
+            remaining.push_back( new_value );
+        }
+        else if( i % 3 == 1 ) {
+            my_heap.erase( handles[i] );
+        }
+        else {
+            remaining.push_back( *handles[i] );
+        }
+
+        // The front must stay correct as the trees are rearranged.
+        if( i % 100 == 99 ) {
+            if( my_heap.front( ) != *std::min_element( remaining.begin( ), remaining.end( ) ) ) handles_ok = false;
+        }
+    }
+    UNIT_CHECK( handles_ok );
+
+    bool caught = false;
+    try {
+        my_heap.decrease_key( handles[2], *handles[2] + 1 );
+    }
+    catch( std::invalid_argument & ) {
+        caught = true;
+    }
+    UNIT_CHECK( caught );
+    UNIT_CHECK( drains_in_order( my_heap, remaining ) );
+}
+
+
+// Non-trivial items, a different ordering, and a pool allocator.
+template<template<typename, typename, typename> class Heap>
+static void string_test( const char *name )
+{
+    UnitTestManager::UnitTest test( name );
+
+    Heap< std::string, std::greater<std::string>, PoolAllocator<std::string> > strings;
+    for( int i = 0; i < 1000; ++i ) strings.push( std::to_string( i ) );
+    UNIT_CHECK( strings.front( ) == "999" );
+    strings.pop( );
+    UNIT_CHECK( strings.front( ) == "998" );
+    UNIT_CHECK( strings.size( ) == 999 );
+}
+
+
+template<typename T, typename Compare, typename Allocator>
+using BinaryHeap = DaryHeap<T, Compare, Allocator, 2>;
+
+
+bool Heap_tests( )
+{
+    basic_test< DaryHeap<int> >( "DaryHeap" );
+    basic_test< DaryHeap<int, std::less<int>, std::allocator<int>, 2> >( "DaryHeap, arity 2" );
+    basic_test< DaryHeap<int, std::less<int>, std::allocator<int>, 7> >( "DaryHeap, arity 7" );
+    basic_test< PairingHeap<int> >( "PairingHeap" );
+    basic_test< FibonacciHeap<int> >( "FibonacciHeap" );
+    handle_test< PairingHeap<int> >( "PairingHeap handles" );
+    handle_test< FibonacciHeap<int> >( "FibonacciHeap handles" );
+    string_test< BinaryHeap >( "DaryHeap strings" );
+    string_test< PairingHeap >( "PairingHeap strings" );
+    string_test< FibonacciHeap >( "FibonacciHeap strings" );
+    return true;
+}
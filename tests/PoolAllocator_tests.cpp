@@ -0,0 +1,242 @@
+/*! \file    PoolAllocator_tests.cpp
+ *  \brief   Exercise spica::MemoryPool, spica::PoolAllocator, and the containers that use them.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <cstdint>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "../BinaryTree.hpp"
+#include "../BinomialHeap.hpp"
+#include "../PoolAllocator.hpp"
+#include "../SingleList.hpp"
+#include "../u_tests.hpp"
+#include "../UnitTestManager.hpp"
+
+using namespace spica;
+
+typedef SingleList< int, PoolAllocator<int> > PoolList;
+typedef BinaryTree< int, std::less<int>, PoolAllocator<int> > PoolTree;
+typedef BinomialHeap< int, std::less<int>, PoolAllocator<int> > PoolHeap;
+
+
+static void memory_pool_test( )
+{
+    UnitTestManager::UnitTest test( "MemoryPool" );
+
+    MemoryPool pool( 20 );
+    UNIT_CHECK( pool.block_size( ) >= 20 && pool.block_size( ) % alignof( std::max_align_t ) == 0 );
+    UNIT_CHECK( pool.in_use( ) == 0 && pool.capacity( ) == 0 );
+
+    // Blocks from a new chunk are contiguous.
+    char *first  = static_cast<char *>( pool.allocate( ) );
+    char *second = static_cast<char *>( pool.allocate( ) );
+    UNIT_CHECK( second == first + pool.block_size( ) );
+    UNIT_CHECK( pool.in_use( ) == 2 && pool.capacity( ) > 0 );
+
+    // Freed blocks are reused first.
+    pool.deallocate( first );
+    UNIT_CHECK( pool.in_use( ) == 1 );
+    UNIT_CHECK( pool.allocate( ) == first );
+
+    std::set< void * > blocks;
+    blocks.insert( first );
+    blocks.insert( second );
+    for( int i = 0; i < 10000; ++i ) blocks.insert( pool.allocate( ) );
+    UNIT_CHECK( blocks.size( ) == 10002 && pool.in_use( ) == 10002 );
+
+    bool aligned = true;
+    for( void *block : blocks ) {
+        if( reinterpret_cast<std::uintptr_t>( block ) % alignof( std::max_align_t ) != 0 ) aligned = false;
+    }
+    UNIT_CHECK( aligned );
+
+    pool.release( );
+    UNIT_CHECK( pool.in_use( ) == 0 && pool.capacity( ) == 0 );
+    UNIT_CHECK( pool.allocate( ) != nullptr && pool.in_use( ) == 1 );
+}
+
+
+static void allocator_test( )
+{
+    UnitTestManager::UnitTest test( "PoolAllocator" );
+
+    PoolAllocator<int> a;
+    PoolAllocator<int> b( a );
+    PoolAllocator<double> c( a );
+    PoolAllocator<int> d;
+    UNIT_CHECK( a == b && a == c && !( a == d ) );
+
+    // Copies can free each other's objects. Arrays come from the global allocator.
+    int *p = a.allocate( 1 );
+    b.deallocate( p, 1 );
+    int *q = b.allocate( 1 );
+    UNIT_CHECK( p == q );
+    int *array = a.allocate( 100 );
+    array[99] = 1;
+    a.deallocate( array, 100 );
+
+    // Shared pools can't be released.
+    UNIT_CHECK( !a.release( ) );
+    b.deallocate( q, 1 );
+
+    // A container copy gets its own pools.
+    UNIT_CHECK( !( a.select_on_container_copy_construction( ) == a ) );
+
+    // A moved-from allocator makes new pools if it is used again.
+    PoolAllocator<int> e( std::move( d ) );
+    int *r = d.allocate( 1 );
+    d.deallocate( r, 1 );
+    UNIT_CHECK( d.release( ) && e.release( ) );
+}
+
+
+namespace {
+
+// Counts live objects so the tests can see that pooled containers destroy their items.
+struct Counted {
+    static int live;
+    int value;
+
+    Counted( int v ) : value( v ) { ++live; }
+    Counted( const Counted &other ) : value( other.value ) { ++live; }
+   ~Counted( ) { --live; }
+    bool operator<( const Counted &other ) const { return value < other.value; }
+};
+
+int Counted::live = 0;
+
+}
+
+
+static void single_list_test( )
+{
+    UnitTestManager::UnitTest test( "SingleList with pool" );
+
+    PoolList list;
+    for( int i = 0; i < 1000; ++i ) list.push_back( i );
+    list.push_front( -1 );
+    UNIT_CHECK( list.size( ) == 1001 && *list.begin( ) == -1 );
+
+    PoolList copy( list );
+    UNIT_CHECK( !( copy.get_allocator( ) == list.get_allocator( ) ) );
+    list.clear( );
+    UNIT_CHECK( list.size( ) == 0 && list.begin( ) == list.end( ) );
+
+    int sum = 0;
+    for( int item : copy ) sum += item;
+    UNIT_CHECK( copy.size( ) == 1001 && sum == 999 * 1000 / 2 - 1 );
+
+    // The list is usable after its pool is released.
+    list.push_back( 42 );
+    UNIT_CHECK( list.size( ) == 1 && *list.begin( ) == 42 );
+
+    list = std::move( copy );
+    UNIT_CHECK( list.size( ) == 1001 && copy.size( ) == 0 );
+    copy.push_back( 7 );
+    UNIT_CHECK( *copy.begin( ) == 7 );
+
+    {
+        SingleList< Counted, PoolAllocator<Counted> > counted;
+        for( int i = 0; i < 100; ++i ) counted.push_back( Counted( i ) );
+        UNIT_CHECK( Counted::live == 100 );
+        counted.clear( );
+        UNIT_CHECK( Counted::live == 0 );
+        counted.push_front( Counted( 1 ) );
+    }
+    UNIT_CHECK( Counted::live == 0 );
+}
+
+
+static void binary_tree_test( )
+{
+    UnitTestManager::UnitTest test( "BinaryTree with pool" );
+
+    PoolTree tree;
+    for( int i = 0; i < 1000; ++i ) tree.insert( ( i * 7919 ) % 1000 );
+    UNIT_CHECK( tree.size( ) == 1000 && !tree.insert( 5 ).second );
+
+    for( int i = 0; i < 1000; i += 2 ) tree.erase( tree.find( i ) );
+    UNIT_CHECK( tree.size( ) == 500 );
+
+    int expected = 1;
+    bool ordered = true;
+    for( PoolTree::iterator p = tree.begin( ); p != tree.end( ); ++p ) {
+        if( *p != expected ) ordered = false;
+        expected += 2;
+    }
+    UNIT_CHECK( ordered && expected == 1001 );
+
+    tree.clear( );
+    UNIT_CHECK( tree.size( ) == 0 && tree.begin( ) == tree.end( ) );
+    tree.insert( 3 );
+    UNIT_CHECK( tree.find( 3 ) != tree.end( ) && tree.find( 4 ) == tree.end( ) );
+
+    {
+        BinaryTree< Counted, std::less<Counted>, PoolAllocator<Counted> > counted;
+        for( int i = 0; i < 100; ++i ) counted.insert( Counted( i ) );
+        counted.insert( Counted( 5 ) );
+        UNIT_CHECK( Counted::live == 100 );
+    }
+    UNIT_CHECK( Counted::live == 0 );
+}
+
+
+static void binomial_heap_test( )
+{
+    UnitTestManager::UnitTest test( "BinomialHeap with pool" );
+
+    PoolHeap heap;
+    for( int i = 1000; i > 0; --i ) heap.insert( i );
+    bool ordered = true;
+    for( int i = 1; i <= 500; ++i ) {
+        if( heap.front( ) != i ) ordered = false;
+        heap.pop( );
+    }
+    UNIT_CHECK( ordered && heap.size( ) == 500 );
+
+    // Heaps that share an allocator can be merged. Clearing one leaves the other intact.
+    PoolAllocator<int> shared;
+    PoolHeap heap1( std::less<int>( ), shared );
+    PoolHeap heap2( std::less<int>( ), shared );
+    for( int i = 0; i < 100; ++i ) {
+        heap1.push( 2 * i );
+        heap2.push( 2 * i + 1 );
+    }
+    heap1.merge( heap2 );
+    UNIT_CHECK( heap1.size( ) == 200 && heap2.empty( ) );
+    heap2.push( -1 );
+    heap2.clear( );
+    UNIT_CHECK( heap2.empty( ) );
+    for( int i = 0; i < 200; ++i ) {
+        if( heap1.front( ) != i ) ordered = false;
+        heap1.pop( );
+    }
+    UNIT_CHECK( ordered && heap1.empty( ) );
+
+    heap.clear( );
+    UNIT_CHECK( heap.empty( ) && heap.begin( ) == heap.end( ) );
+    heap.push( 9 );
+    UNIT_CHECK( heap.front( ) == 9 );
+
+    // Custom orderings work since pop no longer builds a heap with the default ordering.
+    BinomialHeap< std::string, std::greater<std::string>, PoolAllocator<std::string> > strings;
+    strings.push( "alpha" );
+    strings.push( "gamma" );
+    strings.push( "beta" );
+    strings.pop( );
+    UNIT_CHECK( strings.front( ) == "beta" && strings.size( ) == 2 );
+}
+
+
+bool PoolAllocator_tests( )
+{
+    memory_pool_test( );
+    allocator_test( );
+    single_list_test( );
+    binary_tree_test( );
+    binomial_heap_test( );
+    return true;
+}
@@ -3,9 +3,12 @@
  *  \author  Peter Chapin <spicacality@kelseymountain.org>
  */
 
+#include <algorithm>
 #include <cassert>
 #include <cstdlib>
 #include <iostream>
+#include <memory>
+#include <random>
 #include <string>
 #include <utility>
 #include <vector>
@@ -105,9 +108,130 @@ static void test_insertions( )
 }
 
 
+static void test_emplace( )
+{
+    SingleList<std::unique_ptr<int>> pointers;
+    pointers.push_back( std::make_unique<int>( 2 ) );   // Move only items.
+    pointers.emplace_front( new int( 1 ) );
+    assert( *pointers.emplace_back( std::make_unique<int>( 3 ) ) == 3 );
+    int expected = 1;
+    for( auto &pointer : pointers ) {
+        assert( *pointer == expected );
+        ++expected;
+    }
+    assert( pointers.size( ) == 3 );
+
+    SingleList<std::pair<int, std::string>> pairs;
+    pairs.emplace_back( 1, "one" );
+    pairs.emplace_front( 0, "zero" );
+    assert( pairs.begin( )->second == "zero" );
+    assert( pairs.size( ) == 2 );
+}
+
+
+static void test_splice( )
+{
+    // Splice into the middle, then at both ends, then into an empty list.
+    SingleList<int> list1 = { 1, 2, 5 };
+    SingleList<int> list2 = { 3, 4 };
+    auto it = list1.begin( );
+    ++it;
+    ++it;
+    list1.splice( it, list2 );
+    assert( *it == 5 );
+    assert( list2.size( ) == 0 && list2.begin( ) == list2.end( ) );
+    print_list( "list1", list1, "1 2 3 4 5", 5 );
+
+    SingleList<int> list3 = { 0 };
+    SingleList<int> list4 = { 6, 7 };
+    auto front = list1.begin( );
+    list1.splice( front, list3 );
+    auto back = list1.end( );
+    list1.splice( back, list4 );
+    list1.push_back( 8 );
+    print_list( "list1", list1, "0 1 2 3 4 5 6 7 8", 9 );
+
+    SingleList<int> list5;
+    auto empty = list5.begin( );
+    list5.splice( empty, list1 );
+    list5.push_back( 9 );
+    assert( list1.size( ) == 0 );
+    print_list( "list5", list5, "0 1 2 3 4 5 6 7 8 9", 10 );
+
+    // Splice after the first and the last items.
+    SingleList<int> list6 = { 1, 4 };
+    SingleList<int> list7 = { 2, 3 };
+    SingleList<int> list8 = { 5 };
+    list6.splice_after( list6.begin( ), list7 );
+    auto last = list6.begin( );
+    for( int i = 0; i < 3; ++i ) ++last;
+    list6.splice_after( last, list8 );
+    list6.push_back( 6 );
+    print_list( "list6", list6, "1 2 3 4 5 6", 6 );
+}
+
+
+static void test_sort_merge( )
+{
+    SingleList<int> list1 = { 5, 3, 9, 1, 3, 7 };
+    list1.sort( );
+    list1.push_back( 10 );
+    print_list( "list1", list1, "1 3 3 5 7 9 10", 7 );
+
+    SingleList<int> list2 = { 0, 3, 4, 11 };
+    list1.merge( list2 );
+    list1.push_back( 12 );
+    assert( list2.size( ) == 0 );
+    print_list( "list1", list1, "0 1 3 3 3 4 5 7 9 10 11 12", 12 );
+
+    SingleList<int> list3 = { 1, 2, 3 };
+    list3.sort( std::greater<int>( ) );
+    print_list( "list3", list3, "3 2 1", 3 );
+
+    // Compare with std::stable_sort on random lists of many sizes. The second member of each
+    // pair records the original position so the stability of the sort can be checked.
+    typedef std::pair<int, int> Item;
+    auto first_less = []( const Item &x, const Item &y ) { return x.first < y.first; };
+    std::mt19937 generator( 1 );
+    for( int size = 0; size < 300; size += 1 + size / 10 ) {
+        std::vector<Item> items;
+        SingleList<Item> list;
+        for( int i = 0; i < size; ++i ) {
+            items.emplace_back( static_cast<int>( generator( ) % 20 ), i );
+            list.push_back( items.back( ) );
+        }
+        std::stable_sort( items.begin( ), items.end( ), first_less );
+        list.sort( first_less );
+        assert( list.size( ) == items.size( ) );
+        assert( std::equal( items.begin( ), items.end( ), list.begin( ) ) );
+
+        // The last node must be correct after sorting.
+        list.push_back( Item( 99, -1 ) );
+        auto it = list.begin( );
+        for( int i = 0; i < size; ++i ) ++it;
+        assert( it->first == 99 );
+
+        // Merging is also stable: the items of the target come first.
+        SingleList<Item> other;
+        for( int i = 0; i < size; i += 3 ) other.push_back( Item( items[i].first, 1000 + i ) );
+        std::vector<Item> expected( items );
+        expected.push_back( Item( 99, -1 ) );
+        std::vector<Item> other_items( other.begin( ), other.end( ) );
+        std::vector<Item> merged;
+        std::merge( expected.begin( ), expected.end( ), other_items.begin( ), other_items.end( ),
+                    std::back_inserter( merged ), first_less );
+        list.merge( other, first_less );
+        assert( std::equal( merged.begin( ), merged.end( ), list.begin( ), list.end( ) ) );
+    }
+}
+
+
 int main( )
 {
     test_constructions( );
     test_insertions( );
+    test_emplace( );
+    test_splice( );
+    test_sort_merge( );
     return EXIT_SUCCESS;
 }
@@ -3,78 +3,282 @@
  *  \author  Peter Chapin <spicacality@kelseymountain.org>
  */
 
-#include <cstdlib>
-#include <ctime>
-#include <iostream>
+#include <algorithm>
+#include <memory>
+#include <random>
 #include <vector>
+
 #include "../BinaryTree.hpp"
+#include "../u_tests.hpp"
+#include "../UnitTestManager.hpp"
+
+using namespace spica;
 
 #define MAXCOUNT 10000
 
-int main( )
-{
-    spica::BinaryTree<int>           my_tree;
-    spica::BinaryTree<int>::iterator p;
-    std::vector<int>           numbers;
-    std::vector<int>::iterator current, last;
+namespace spica {
 
-    // Create a vector full of random numbers. Add the numbers to the tree.
-    std::srand( std::time(NULL ) );
-    for( int i = 0; i < MAXCOUNT; ++i ) {
-        int number = std::rand( );
-        numbers.push_back( number );
-        std::pair<spica::BinaryTree<int>::iterator, bool> result = my_tree.insert( number );
-        if( result.second == false ) {
-            // The tree claims the item was already inserted. Is that true?
-            bool bad = true;
-            for( int j = 0; j < i; ++j ) {
-                if( numbers[j] == number ) bad = false;
+    // Checks the links, subtree sizes, and balance information of a tree.
+    template<typename T, typename StrictWeakOrdering, typename Allocator, tree_balance Balance>
+    struct tree_invariants< BinaryTree<T, StrictWeakOrdering, Allocator, Balance> > {
+        typedef BinaryTree<T, StrictWeakOrdering, Allocator, Balance> Tree;
+        typedef typename Tree::TreeNode TreeNode;
+
+        // Returns true if the parent links and the subtree sizes are right.
+        static bool links_ok( const TreeNode *n, const TreeNode *parent )
+        {
+            if( n == nullptr ) return true;
+            if( n->parent != parent ) return false;
+            if( n->size != 1 + Tree::subtree_size( n->left ) + Tree::subtree_size( n->right ) ) return false;
+            return links_ok( n->left, n ) && links_ok( n->right, n );
+        }
+
+        // Returns the number of black nodes on every path down from n (empty subtrees count as
+        // black), or -1 if the paths differ, a red node has a red child, or a color is invalid.
+        static int black_height( const TreeNode *n )
+        {
+            if( n == nullptr ) return 1;
+            if( n->balance != Tree::red && n->balance != Tree::black ) return -1;
+            if( Tree::is_red( n ) && ( Tree::is_red( n->left ) || Tree::is_red( n->right ) ) ) return -1;
+            int left = black_height( n->left );
+            int right = black_height( n->right );
+            if( left < 0 || left != right ) return -1;
+            return left + ( Tree::is_red( n ) ? 0 : 1 );
+        }
+
+        // Returns the height of the subtree at n, or -1 if a stored height is wrong or the
+        // heights of two sibling subtrees differ by more than one.
+        static int avl_height( const TreeNode *n )
+        {
+            if( n == nullptr ) return 0;
+            int left = avl_height( n->left );
+            int right = avl_height( n->right );
+            if( left < 0 || right < 0 || left - right > 1 || right - left > 1 ) return -1;
+            int result = 1 + std::max( left, right );
+            return ( n->balance == result ) ? result : -1;
+        }
+
+        static bool check( const Tree &tree )
+        {
+            if( !links_ok( tree.root, nullptr ) || Tree::subtree_size( tree.root ) != tree.size( ) ) return false;
+            if constexpr( Balance == tree_balance::red_black ) {
+                return !Tree::is_red( tree.root ) && black_height( tree.root ) > 0;
+            }
+            else if constexpr( Balance == tree_balance::avl ) {
+                return avl_height( tree.root ) >= 0;
             }
-            if( bad )
-                std::cout << "BAD THING: Tree falsely misreports double insertions!\n";
+            return true;
         }
+    };
+
+}
+
+// Returns true if the tree holds exactly the (sorted, unique) numbers, in both directions.
+template<typename Tree>
+static bool same_contents( const Tree &my_tree, const std::vector<int> &numbers )
+{
+    if( my_tree.size( ) != numbers.size( ) ) return false;
+
+    typename Tree::iterator p = my_tree.begin( );
+    for( int number : numbers ) {
+        if( p == my_tree.end( ) || *p != number ) return false;
+        ++p;
+    }
+    if( p != my_tree.end( ) ) return false;
+
+    for( auto current = numbers.rbegin( ); current != numbers.rend( ); ++current ) {
+        --p;
+        if( *p != *current ) return false;
     }
+    return p == my_tree.begin( );
+}
+
+
+template<tree_balance Balance>
+static void random_test( const char *name )
+{
+    typedef BinaryTree< int, std::less<int>, std::allocator<int>, Balance > Tree;
+    UnitTestManager::UnitTest test( name );
 
-    // Verify that everything put into the tree can be found.
+    Tree my_tree;
+    std::vector<int> numbers;
+    std::mt19937 generator( 42 );
+
+    // Add random numbers to the tree. The tree should notice duplicates.
+    bool duplicates_ok = true;
     for( int i = 0; i < MAXCOUNT; ++i ) {
-        int number = numbers[i];
-        p = my_tree.find( number );
-        if( p == my_tree.end( ) )
-            std::cout << "BAD THING: Lost item(s)!\n";
+        int number = static_cast<int>( generator( ) % ( 4 * MAXCOUNT ) );
+        bool is_new = std::find( numbers.begin( ), numbers.end( ), number ) == numbers.end( );
+        if( is_new ) numbers.push_back( number );
+        std::pair<typename Tree::iterator, bool> result = my_tree.insert( number );
+        if( result.second != is_new || *result.first != number ) duplicates_ok = false;
     }
+    UNIT_CHECK( duplicates_ok );
 
-    // Verify that forward iteration returns items in sorted order.
-    std::sort( numbers.begin( ), numbers.end( ) );
-    current = numbers.begin( );
-    last = std::unique( numbers.begin( ), numbers.end( ) );
-    p = my_tree.begin( );
-
-    while (p != my_tree.end( ) ) {
-        if( current == last )
-            std::cout << "BAD THING: Too many items in tree!\n";
-        if( *current != *p )
-            std::cout << "BAD THING: Items in wrong order!\n";
-        ++current;
-        ++p;
+    // Verify that everything put into the tree can be found and that iteration in both
+    // directions returns the items in order.
+    bool all_found = true;
+    for( int number : numbers ) {
+        if( my_tree.find( number ) == my_tree.end( ) ) all_found = false;
+    }
+    UNIT_CHECK( all_found );
+    UNIT_CHECK( my_tree.find( -1 ) == my_tree.end( ) );
+
+    std::vector<int> sorted( numbers );
+    std::sort( sorted.begin( ), sorted.end( ) );
+    UNIT_CHECK( same_contents( my_tree, sorted ) );
+
+    // Erase half of the items in random order. Iterators to other items must stay valid.
+    std::shuffle( numbers.begin( ), numbers.end( ), generator );
+    typename Tree::iterator survivor = my_tree.find( numbers.back( ) );
+    std::size_t half = numbers.size( ) / 2;
+    bool vanished = true;
+    for( std::size_t i = 0; i < half; ++i ) {
+        my_tree.erase( my_tree.find( numbers[i] ) );
+        if( my_tree.find( numbers[i] ) != my_tree.end( ) ) vanished = false;
+    }
+    UNIT_CHECK( vanished );
+    UNIT_CHECK( *survivor == numbers.back( ) );
+
+    sorted.assign( numbers.begin( ) + half, numbers.end( ) );
+    std::sort( sorted.begin( ), sorted.end( ) );
+    UNIT_CHECK( same_contents( my_tree, sorted ) );
+
+    // Erase the rest.
+    for( std::size_t i = half; i < numbers.size( ); ++i ) {
+        my_tree.erase( my_tree.find( numbers[i] ) );
     }
-    if( current != last )
-        std::cout << "BAD THING: Not enough items in tree!\n";
-
-    // Verify that reverse iteration returns items in reverse order.
-    // EXTRA CREDIT (5 pts).
-
-    std::random_shuffle( numbers.begin( ), last );
-    for ( current = numbers.begin( ); current != last; ++current ) {
-        p = my_tree.find( *current );
-        my_tree.erase(p);
-        p = my_tree.find( *current );
-        if( p != my_tree.end( ) ) {
-            std::cout << "BAD THING: Erasing an item doesn't cause it to vanish!\n";
+    UNIT_CHECK( my_tree.size( ) == 0 && my_tree.begin( ) == my_tree.end( ) );
+}
+
+
+//
+// Sorted input makes an unbalanced tree a linked list. The balanced trees must handle a large
+// number of sorted items quickly, and destroying them must not recurse.
+//
+template<tree_balance Balance>
+static void sorted_test( const char *name, int count )
+{
+    typedef BinaryTree< int, std::less<int>, std::allocator<int>, Balance > Tree;
+    UnitTestManager::UnitTest test( name );
+
+    Tree my_tree;
+    for( int i = 0; i < count; ++i ) my_tree.insert( i );
+    UNIT_CHECK( my_tree.size( ) == static_cast<std::size_t>( count ) );
+
+    bool all_found = true;
+    for( int i = 0; i < count; ++i ) {
+        if( my_tree.find( i ) == my_tree.end( ) ) all_found = false;
+    }
+    UNIT_CHECK( all_found );
+
+    // Erase from the front, which pulls the tree out of shape the other way.
+    for( int i = 0; i < count / 2; ++i ) my_tree.erase( my_tree.begin( ) );
+    UNIT_CHECK( *my_tree.begin( ) == count / 2 );
+    typename Tree::iterator last = my_tree.end( );
+    --last;
+    UNIT_CHECK( *last == count - 1 );
+}
+
+
+//
+// The subtree sizes must survive the rotations done by insert and erase. Compare every order
+// statistic query against a sorted vector after each batch of changes.
+//
+template<tree_balance Balance>
+static void order_test( const char *name )
+{
+    typedef BinaryTree< int, std::less<int>, std::allocator<int>, Balance > Tree;
+    UnitTestManager::UnitTest test( name );
+
+    Tree my_tree;
+    std::vector<int> sorted;
+    std::mt19937 generator( 11 );
+
+    bool queries_ok = true;
+    for( int round = 0; round < 10; ++round ) {
+        for( int i = 0; i < 300; ++i ) {
+            int number = static_cast<int>( generator( ) % 2000 );
+            typename Tree::iterator p = my_tree.find( number );
+            if( round % 3 == 2 && p != my_tree.end( ) ) my_tree.erase( p );
+            else my_tree.insert( number );
+        }
+        sorted.assign( my_tree.begin( ), my_tree.end( ) );
+
+        for( std::size_t i = 0; i < sorted.size( ); ++i ) {
+            if( *my_tree.nth( i ) != sorted[i] ) queries_ok = false;
         }
+        if( my_tree.nth( sorted.size( ) ) != my_tree.end( ) ) queries_ok = false;
+
+        for( int key = -1; key <= 2000; key += 7 ) {
+            auto lower = std::lower_bound( sorted.begin( ), sorted.end( ), key );
+            auto upper = std::upper_bound( sorted.begin( ), sorted.end( ), key );
+            if( my_tree.rank( key ) != static_cast<std::size_t>( lower - sorted.begin( ) ) ) queries_ok = false;
+
+            typename Tree::iterator tree_lower = my_tree.lower_bound( key );
+            typename Tree::iterator tree_upper = my_tree.upper_bound( key );
+            if( lower == sorted.end( ) ? tree_lower != my_tree.end( ) : *tree_lower != *lower ) queries_ok = false;
+            if( upper == sorted.end( ) ? tree_upper != my_tree.end( ) : *tree_upper != *upper ) queries_ok = false;
+
+            int high = key + 150;
+            auto range_end = std::lower_bound( sorted.begin( ), sorted.end( ), high );
+            if( my_tree.count_range( key, high ) != static_cast<std::size_t>( range_end - lower ) ) queries_ok = false;
+        }
+    }
+    UNIT_CHECK( queries_ok );
+    UNIT_CHECK( my_tree.count_range( 10, 5 ) == 0 );
+    UNIT_CHECK( my_tree.rank( 3000 ) == my_tree.size( ) );
+}
+
+
+//
+// Check the balance invariants after every change while inserting and erasing random items.
+// The small key range makes erasures succeed often, so the tree grows and shrinks.
+//
+template<tree_balance Balance>
+static void invariant_test( const char *name )
+{
+    typedef BinaryTree< int, std::less<int>, std::allocator<int>, Balance > Tree;
+    UnitTestManager::UnitTest test( name );
+
+    Tree my_tree;
+    std::mt19937 generator( 17 );
+    bool invariants_ok = true;
+    for( int i = 0; i < 4000; ++i ) {
+        int number = static_cast<int>( generator( ) % 500 );
+        if( generator( ) % 3 == 0 ) {
+            typename Tree::iterator p = my_tree.find( number );
+            if( p != my_tree.end( ) ) my_tree.erase( p );
+        }
+        else {
+            my_tree.insert( number );
+        }
+        if( !tree_invariants<Tree>::check( my_tree ) ) invariants_ok = false;
     }
-    if( my_tree.size( ) != 0 ) {
-        std::cout << "BAD THING: Tree has non-zero size after erasing all.\n";
+    UNIT_CHECK( invariants_ok );
+    UNIT_CHECK( my_tree.size( ) > 100 );
+
+    // Erasing everything from the front takes the tree through every size.
+    while( my_tree.size( ) > 0 ) {
+        my_tree.erase( my_tree.begin( ) );
+        if( !tree_invariants<Tree>::check( my_tree ) ) invariants_ok = false;
     }
+    UNIT_CHECK( invariants_ok );
+}
 
-    std::cout << "Testing complete.\n";
+
+bool Tree_tests( )
+{
+    random_test<tree_balance::none>( "unbalanced" );
+    random_test<tree_balance::red_black>( "red-black" );
+    random_test<tree_balance::avl>( "AVL" );
+    sorted_test<tree_balance::none>( "unbalanced sorted", 5000 );
+    sorted_test<tree_balance::red_black>( "red-black sorted", 200000 );
+    sorted_test<tree_balance::avl>( "AVL sorted", 200000 );
+    order_test<tree_balance::none>( "unbalanced order statistics" );
+    order_test<tree_balance::red_black>( "red-black order statistics" );
+    order_test<tree_balance::avl>( "AVL order statistics" );
+    invariant_test<tree_balance::red_black>( "red-black invariants" );
+    invariant_test<tree_balance::avl>( "AVL invariants" );
+    return true;
 }
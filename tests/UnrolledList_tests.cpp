@@ -0,0 +1,197 @@
+/*! \file    UnrolledList_tests.cpp
+ *  \brief   Exercise spica::UnrolledList.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <algorithm>
+#include <list>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../PoolAllocator.hpp"
+#include "../UnrolledList.hpp"
+#include "../u_tests.hpp"
+#include "../UnitTestManager.hpp"
+
+using namespace spica;
+
+// Returns true if the list holds the same items as the reference.
+template<typename List, typename Reference>
+static bool same_items( List &my_list, const Reference &reference )
+{
+    return my_list.size( ) == reference.size( ) &&
+           std::equal( reference.begin( ), reference.end( ), my_list.begin( ), my_list.end( ) );
+}
+
+
+static void basic_test( )
+{
+    UnitTestManager::UnitTest test( "basic" );
+
+    UnrolledList<int, 4> list1;
+    UNIT_CHECK( list1.empty( ) && list1.begin( ) == list1.end( ) );
+    for( int i = 0; i < 10; ++i ) list1.push_back( i );
+    for( int i = -1; i > -10; --i ) list1.push_front( i );
+    std::vector<int> expected;
+    for( int i = -9; i < 10; ++i ) expected.push_back( i );
+    UNIT_CHECK( same_items( list1, expected ) );
+
+    // Copy and move operations.
+    UnrolledList<int, 4> list2( list1 );
+    UNIT_CHECK( same_items( list2, expected ) );
+    UnrolledList<int, 4> list3( std::move( list2 ) );
+    UNIT_CHECK( same_items( list3, expected ) && list2.empty( ) );
+    list2 = list3;
+    list3.clear( );
+    UNIT_CHECK( same_items( list2, expected ) && list3.empty( ) );
+    list3 = std::move( list2 );
+    UNIT_CHECK( same_items( list3, expected ) );
+    list3.push_back( 10 );
+    UNIT_CHECK( list3.size( ) == 20 );
+
+    UnrolledList<std::string> list4 = { "one", "two", "three" };
+    UNIT_CHECK( list4.size( ) == 3 && *list4.begin( ) == "one" );
+    UNIT_CHECK( UnrolledList<char>::node_capacity > UnrolledList<double>::node_capacity );
+
+    // Move only items.
+    UnrolledList<std::unique_ptr<int>, 3> pointers;
+    for( int i = 0; i < 10; ++i ) pointers.emplace_back( new int( i ) );
+    pointers.push_front( std::make_unique<int>( -1 ) );
+    auto p = pointers.begin( );
+    for( int i = 0; i < 5; ++i ) ++p;
+    pointers.erase( p );
+    int sum = 0;
+    for( auto &pointer : pointers ) sum += *pointer;
+    UNIT_CHECK( sum == 45 - 1 - 4 && pointers.size( ) == 10 );
+}
+
+
+// Random inserts and erases with small nodes so that nodes split and merge often.
+template<std::size_t N>
+static void random_test( const char *name )
+{
+    UnitTestManager::UnitTest test( name );
+    std::mt19937 generator( 11 );
+
+    UnrolledList<std::string, N, PoolAllocator<std::string>> my_list;
+    std::list<std::string> reference;
+    bool consistent = true;
+    for( int i = 0; i < 20000; ++i ) {
+        std::size_t position = generator( ) % ( reference.size( ) + 1 );
+        auto p = my_list.begin( );
+        auto q = reference.begin( );
+        for( std::size_t j = 0; j < position; ++j, ++p, ++q ) ;
+
+        if( reference.size( ) < 300 && ( q == reference.end( ) || generator( ) % 2 == 0 ) ) {
+            std::string item = std::to_string( i );
+            auto result = my_list.insert( p, item );
+            reference.insert( q, item );
+            if( *result != item ) consistent = false;
+            if( q != reference.end( ) && *p != *q ) consistent = false;
+            if( q == reference.end( ) && p != my_list.end( ) ) consistent = false;
+        }
+        else if( q != reference.end( ) ) {
+            auto result = my_list.erase( p );
+            q = reference.erase( q );
+            if( q == reference.end( ) ? result != my_list.end( ) : *result != *q ) consistent = false;
+        }
+        if( i % 100 == 0 && !same_items( my_list, reference ) ) consistent = false;
+    }
+    UNIT_CHECK( consistent );
+    UNIT_CHECK( same_items( my_list, reference ) );
+
+    // Erase everything, sometimes from the front and sometimes from the back.
+    while( !reference.empty( ) ) {
+        if( generator( ) % 2 == 0 ) {
+            my_list.erase( my_list.begin( ) );
+            reference.pop_front( );
+        }
+        else {
+            auto p = my_list.begin( );
+            for( std::size_t j = 1; j < reference.size( ); ++j ) ++p;
+            UNIT_CHECK( my_list.erase( p ) == my_list.end( ) );
+            reference.pop_back( );
+        }
+    }
+    UNIT_CHECK( my_list.empty( ) && my_list.begin( ) == my_list.end( ) );
+    my_list.push_back( "again" );
+    UNIT_CHECK( my_list.size( ) == 1 && *my_list.begin( ) == "again" );
+}
+
+
+static void range_insert_test( )
+{
+    UnitTestManager::UnitTest test( "range insert" );
+
+    UnrolledList<int, 5> my_list = { 0, 1, 2, 3 };
+    std::vector<int> middle;
+    for( int i = 100; i < 120; ++i ) middle.push_back( i );
+    auto p = my_list.begin( );
+    ++p;
+    auto result = my_list.insert( p, middle.begin( ), middle.end( ) );
+    UNIT_CHECK( *result == 119 && *p == 1 );
+
+    std::vector<int> expected = { 0 };
+    expected.insert( expected.end( ), middle.begin( ), middle.end( ) );
+    expected.insert( expected.end( ), { 1, 2, 3 } );
+    UNIT_CHECK( same_items( my_list, expected ) );
+}
+
+
+// Erasing an item appended by insert at the end, when the item starts a new last node.
+static void insert_at_end_test( )
+{
+    UnitTestManager::UnitTest test( "insert at end" );
+
+    UnrolledList<int, 4> my_list;
+    for( int i = 0; i < 4; ++i ) my_list.push_back( i );
+    auto p = my_list.end( );
+    auto it = my_list.insert( p, 99 );
+    UNIT_CHECK( *it == 99 && p == my_list.end( ) && my_list.size( ) == 5 );
+    UNIT_CHECK( my_list.erase( it ) == my_list.end( ) );
+    UNIT_CHECK( same_items( my_list, std::vector<int>{ 0, 1, 2, 3 } ) );
+    my_list.push_back( 4 );
+    UNIT_CHECK( same_items( my_list, std::vector<int>{ 0, 1, 2, 3, 4 } ) );
+
+    // The same with an item that goes into the existing last node.
+    it = my_list.insert( p = my_list.end( ), 5 );
+    UNIT_CHECK( my_list.erase( it ) == my_list.end( ) );
+    UNIT_CHECK( same_items( my_list, std::vector<int>{ 0, 1, 2, 3, 4 } ) );
+}
+
+
+// Inserting a copy of an item in the same node, which is full and gets split.
+static void self_insert_test( )
+{
+    UnitTestManager::UnitTest test( "self insert" );
+
+    UnrolledList<std::string, 4> my_list = { "aaaa", "bbbb", "cccc", "dddd" };
+    auto last = my_list.begin( );
+    for( int i = 0; i < 3; ++i ) ++last;
+    auto p = my_list.begin( );
+    my_list.insert( p, *last );
+    UNIT_CHECK( same_items( my_list, std::vector<std::string>{ "dddd", "aaaa", "bbbb", "cccc", "dddd" } ) );
+
+    UnrolledList<std::string, 4> other_list = { "aaaa", "bbbb", "cccc", "dddd" };
+    auto first = other_list.begin( );
+    p = other_list.begin( );
+    for( int i = 0; i < 3; ++i ) ++p;
+    other_list.insert( p, *first );
+    UNIT_CHECK( same_items( other_list, std::vector<std::string>{ "aaaa", "bbbb", "cccc", "aaaa", "dddd" } ) );
+}
+
+
+bool UnrolledList_tests( )
+{
+    basic_test( );
+    random_test<2>( "random, N = 2" );
+    random_test<3>( "random, N = 3" );
+    random_test<8>( "random, N = 8" );
+    range_insert_test( );
+    insert_at_end_test( );
+    self_insert_test( );
+    return true;
+}
@@ -0,0 +1,132 @@
+/*! \file    WorkQueue_tests.cpp
+ *  \brief   Exercise spica::WorkQueue.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../WorkQueue.hpp"
+#include "../u_tests.hpp"
+#include "../UnitTestManager.hpp"
+
+using namespace spica;
+
+static void push_pop_test( )
+{
+    UnitTestManager::UnitTest test( "push/pop" );
+
+    WorkQueue<std::string> my_queue( 10 );
+    std::string item = "moved";
+
+    UNIT_CHECK( my_queue.empty( ) );
+    my_queue.push( std::string( "copied" ) );
+    my_queue.push( std::move( item ) );
+    my_queue.emplace( 3, 'x' );
+    UNIT_CHECK( my_queue.size( ) == 3 );
+
+    std::string result;
+    my_queue.pop( result );
+    UNIT_CHECK( result == "copied" );
+    my_queue.pop( result );
+    UNIT_CHECK( result == "moved" );
+    my_queue.pop( result );
+    UNIT_CHECK( result == "xxx" );
+    UNIT_CHECK( my_queue.empty( ) );
+}
+
+
+static void try_pop_test( )
+{
+    UnitTestManager::UnitTest test( "try_pop/pop_for" );
+
+    WorkQueue<int> my_queue( 10 );
+    int result = 0;
+
+    UNIT_CHECK( !my_queue.try_pop( result ) );
+    UNIT_CHECK( !my_queue.pop_for( result, 10 ) );
+
+    my_queue.push( 42 );
+    UNIT_CHECK( my_queue.try_pop( result ) );
+    UNIT_CHECK( result == 42 );
+
+    my_queue.push( 43 );
+    UNIT_CHECK( my_queue.pop_for( result, 10 ) );
+    UNIT_CHECK( result == 43 );
+    UNIT_CHECK( my_queue.empty( ) );
+}
+
+
+static void bulk_test( )
+{
+    UnitTestManager::UnitTest test( "bulk" );
+
+    WorkQueue<int> my_queue( 8 );
+    std::vector<int> incoming = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+
+    // Only eight items fit.
+    std::vector<int>::iterator rest = my_queue.push_bulk( incoming.begin( ), incoming.end( ) );
+    UNIT_CHECK( rest == incoming.begin( ) + 8 );
+    UNIT_CHECK( my_queue.size( ) == 8 );
+
+    std::vector<int> outgoing;
+    UNIT_CHECK( my_queue.pop_bulk( std::back_inserter( outgoing ), 5 ) == 5 );
+    UNIT_CHECK( my_queue.size( ) == 3 );
+
+    rest = my_queue.push_bulk( rest, incoming.end( ) );
+    UNIT_CHECK( rest == incoming.end( ) );
+    UNIT_CHECK( my_queue.pop_bulk( std::back_inserter( outgoing ), 100 ) == 5 );
+    UNIT_CHECK( outgoing == incoming );
+    UNIT_CHECK( my_queue.empty( ) );
+}
+
+
+static void threaded_test( )
+{
+    UnitTestManager::UnitTest test( "producer/consumer" );
+
+    const int count = 100000;
+    WorkQueue<int> my_queue( 64, 200 );
+
+    std::thread producer( [&my_queue]( ) {
+        std::vector<int> batch;
+        for( int i = 0; i < count; ) {
+            batch.clear( );
+            for( int j = 0; j < 16 && i < count; ++j, ++i ) batch.push_back( i );
+            std::vector<int>::iterator p = batch.begin( );
+            while( p != batch.end( ) ) p = my_queue.push_bulk( p, batch.end( ) );
+        }
+    } );
+
+    long long sum = 0;
+    int received = 0;
+    int expected = 0;
+    bool in_order = true;
+    std::vector<int> batch;
+    while( received < count ) {
+        batch.clear( );
+        received += my_queue.pop_bulk( std::back_inserter( batch ), 32 );
+        for( int value : batch ) {
+            if( value != expected ) in_order = false;
+            ++expected;
+            sum += value;
+        }
+    }
+    producer.join( );
+
+    UNIT_CHECK( in_order );
+    UNIT_CHECK( sum == static_cast<long long>( count ) * ( count - 1 ) / 2 );
+    UNIT_CHECK( my_queue.empty( ) );
+}
+
+
+bool WorkQueue_tests( )
+{
+    push_pop_test( );
+    try_pop_test( );
+    bulk_test( );
+    threaded_test( );
+    return true;
+}
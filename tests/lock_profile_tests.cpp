@@ -0,0 +1,100 @@
+/*! \file    lock_profile_tests.cpp
+ *  \brief   Exercise the lock contention profiler.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <sstream>
+#include <string>
+
+#include "../lock_profile.hpp"
+#include "../synchronize.hpp"
+#include "../u_tests.hpp"
+#include "../UnitTestManager.hpp"
+
+using namespace spica;
+
+static void histogram_test( )
+{
+    UnitTestManager::UnitTest test( "histogram" );
+
+    UNIT_CHECK( lock_histogram::bucket_index( 0 ) == 0 );
+    UNIT_CHECK( lock_histogram::bucket_index( 1 ) == 1 );
+    UNIT_CHECK( lock_histogram::bucket_index( 2 ) == 2 );
+    UNIT_CHECK( lock_histogram::bucket_index( 3 ) == 2 );
+    UNIT_CHECK( lock_histogram::bucket_index( 1024 ) == 11 );
+    UNIT_CHECK( lock_histogram::bucket_index( ~0ULL ) == lock_histogram::bucket_count - 1 );
+    UNIT_CHECK( lock_histogram::bucket_lower( 11 ) == 1024 );
+
+    lock_histogram histogram;
+    histogram.record( 0 );
+    histogram.record( 3 );
+    histogram.record( 1500 );
+    UNIT_CHECK( histogram.count( ) == 3 );
+    UNIT_CHECK( histogram.total( ) == 1503 );
+    UNIT_CHECK( histogram.maximum( ) == 1500 );
+    UNIT_CHECK( histogram.bucket( 0 ) == 1 );
+    UNIT_CHECK( histogram.bucket( 2 ) == 1 );
+    UNIT_CHECK( histogram.bucket( 11 ) == 1 );
+
+    histogram.reset( );
+    UNIT_CHECK( histogram.count( ) == 0 );
+    UNIT_CHECK( histogram.maximum( ) == 0 );
+}
+
+
+static void dump_test( )
+{
+    UnitTestManager::UnitTest test( "dump" );
+
+    lock_profile *profile = lock_profile::find( "test \"profile\"" );
+    UNIT_CHECK( profile == lock_profile::find( "test \"profile\"" ) );
+    profile->wait_times( ).record( 100 );
+    profile->hold_times( ).record( 200 );
+
+    std::ostringstream text;
+    dump_lock_profiles( text );
+    UNIT_CHECK( text.str( ).find( "Lock \"test \"profile\"\"" ) != std::string::npos );
+    UNIT_CHECK( text.str( ).find( "wait: count = 1; total = 100 ns" ) != std::string::npos );
+
+    std::ostringstream json;
+    dump_lock_profiles( json, profile_format::json );
+    UNIT_CHECK( json.str( ).find( "\"name\": \"test \\\"profile\\\"\"" ) != std::string::npos );
+    UNIT_CHECK( json.str( ).find( "\"hold\": {\"count\": 1, \"total_ns\": 200" ) != std::string::npos );
+
+    reset_lock_profiles( );
+    UNIT_CHECK( profile->wait_times( ).count( ) == 0 );
+    UNIT_CHECK( profile->hold_times( ).count( ) == 0 );
+}
+
+
+static void hook_test( )
+{
+    UnitTestManager::UnitTest test( "hooks" );
+
+    mutex_sem mutex( "test.mutex" );
+    counting_sem counter( 1 );
+    counter.set_profile_name( "test.counter" );
+
+    mutex.lock( );
+    mutex.unlock( );
+    counter.down( );
+
+    // The hooks only exist when profiling is compiled in.
+    #if defined(pLOCK_PROFILE)
+    const unsigned long long expected = 1;
+    #else
+    const unsigned long long expected = 0;
+    #endif
+    UNIT_CHECK( lock_profile::find( "test.mutex" )->wait_times( ).count( ) == expected );
+    UNIT_CHECK( lock_profile::find( "test.mutex" )->hold_times( ).count( ) == expected );
+    UNIT_CHECK( lock_profile::find( "test.counter" )->wait_times( ).count( ) == expected );
+}
+
+
+bool lock_profile_tests( )
+{
+    histogram_test( );
+    dump_test( );
+    hook_test( );
+    return true;
+}
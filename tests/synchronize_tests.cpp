@@ -0,0 +1,223 @@
+/*! \file    synchronize_tests.cpp
+ *  \brief   Exercise the spica semaphore classes.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "../synchronize.hpp"
+#include "../u_tests.hpp"
+#include "../UnitTestManager.hpp"
+
+using namespace spica;
+
+// Writers keep these two values equal. Readers check that they never see them differ.
+struct SharedPair {
+    long first  = 0;
+    long second = 0;
+};
+
+
+// Runs a mixture of readers and writers against the given lock and checks for consistency.
+template<typename Lock>
+static void reader_writer_exercise( Lock &lock )
+{
+    const int thread_count = 8;
+    const int iterations   = 20000;
+
+    SharedPair shared;
+    std::vector<int> inconsistent( thread_count, 0 );
+    std::vector<std::thread> threads;
+
+    for( int t = 0; t < thread_count; ++t ) {
+        threads.emplace_back( [&, t]( ) {
+            for( int i = 0; i < iterations; ++i ) {
+                // One operation in 32 is a write.
+                if( i % 32 == t % 32 ) {
+                    typename Lock::write_grabber critical( lock );
+                    shared.first++;
+                    shared.second++;
+                }
+                else {
+                    typename Lock::read_grabber critical( lock );
+                    if( shared.first != shared.second ) inconsistent[t]++;
+                }
+            }
+        } );
+    }
+    for( std::thread &t : threads ) t.join( );
+
+    int total_inconsistent = 0;
+    for( int count : inconsistent ) total_inconsistent += count;
+    UNIT_CHECK( total_inconsistent == 0 );
+
+    // Every thread does iterations/32 writes (rounded up for low thread numbers).
+    long expected_writes = 0;
+    for( int t = 0; t < thread_count; ++t ) {
+        expected_writes += ( iterations - t % 32 + 31 ) / 32;
+    }
+    UNIT_CHECK( shared.first == expected_writes );
+    UNIT_CHECK( shared.second == expected_writes );
+}
+
+
+static void rw_sem_test( )
+{
+    UnitTestManager::UnitTest test( "rw_sem" );
+
+    rw_sem lock;
+
+    // Several read locks can be held at once.
+    lock.r_lock( );
+    lock.r_lock( );
+    lock.r_unlock( );
+    lock.r_unlock( );
+
+    // The grabbers can lock and unlock on demand.
+    {
+        rw_sem::write_grabber critical( lock, false );
+        critical.lock( );
+        critical.unlock( );
+        critical.lock( );
+    }
+
+    reader_writer_exercise( lock );
+}
+
+
+static void statistics_test( )
+{
+    UnitTestManager::UnitTest test( "statistics" );
+
+    mutex_sem mutex;
+    UNIT_CHECK( mutex.spin_limit( ) == 0 );
+    mutex.lock( );
+    mutex.unlock( );
+    mutex.lock( );
+    mutex.unlock( );
+
+    sem_statistics mutex_statistics = mutex.statistics( );
+    UNIT_CHECK( mutex_statistics.acquisitions == 2 );
+    UNIT_CHECK( mutex_statistics.contended_acquisitions == 0 );
+    UNIT_CHECK( mutex_statistics.wait_nanoseconds == 0 );
+
+    mutex.reset_statistics( );
+    UNIT_CHECK( mutex.statistics( ).acquisitions == 0 );
+
+    // The owner can reset the statistics.
+    mutex.lock( );
+    mutex.reset_statistics( );
+    mutex.unlock( );
+    UNIT_CHECK( mutex.statistics( ).acquisitions == 0 );
+
+    counting_sem counter( 2, 100 );
+    UNIT_CHECK( counter.spin_limit( ) == 100 );
+    counter.down( );
+    UNIT_CHECK( counter.try_down( ) );
+    UNIT_CHECK( !counter.try_down( ) );
+    UNIT_CHECK( !counter.down_for( 1 ) );
+    counter.up( 3 );
+    UNIT_CHECK( counter.down_some( 5 ) == 3 );
+
+    // Each unit taken by down_some counts.
+    sem_statistics counter_statistics = counter.statistics( );
+    UNIT_CHECK( counter_statistics.acquisitions == 5 );
+    UNIT_CHECK( counter_statistics.contended_acquisitions == 0 );
+}
+
+
+// Hammers a mutex_sem with short critical sections using the given spin limit.
+static void spinning_exercise( int spin_limit )
+{
+    const int thread_count = 4;
+    const int iterations   = 50000;
+
+    mutex_sem mutex( spin_limit );
+    long counter = 0;
+    std::vector<std::thread> threads;
+
+    for( int t = 0; t < thread_count; ++t ) {
+        threads.emplace_back( [&]( ) {
+            for( int i = 0; i < iterations; ++i ) {
+                mutex_sem::grabber critical( mutex );
+                ++counter;
+            }
+        } );
+    }
+    for( std::thread &t : threads ) t.join( );
+
+    sem_statistics result = mutex.statistics( );
+    UNIT_CHECK( counter == static_cast<long>( thread_count ) * iterations );
+    UNIT_CHECK( result.acquisitions == static_cast<unsigned long long>( counter ) );
+    UNIT_CHECK( result.contended_acquisitions <= result.acquisitions );
+}
+
+
+static void spinning_test( )
+{
+    UnitTestManager::UnitTest test( "spinning" );
+
+    spinning_exercise( 0 );
+    spinning_exercise( 1000 );
+
+    // A consumer spinning on an empty counting_sem must still block and be woken properly.
+    counting_sem items( 0, 1000 );
+    std::thread producer( [&items]( ) {
+        for( int i = 0; i < 1000; ++i ) items.up( );
+    } );
+    for( int i = 0; i < 1000; ++i ) items.down( );
+    producer.join( );
+    UNIT_CHECK( !items.try_down( ) );
+    UNIT_CHECK( items.statistics( ).acquisitions == 1000 );
+}
+
+
+static void br_sem_test( )
+{
+    UnitTestManager::UnitTest test( "br_sem" );
+
+    br_sem lock( 4 );
+
+    // Several read locks can be held at once, also by one thread.
+    lock.r_lock( );
+    lock.r_lock( );
+    lock.r_unlock( );
+    lock.r_unlock( );
+    lock.w_lock( );
+    lock.w_unlock( );
+
+    // Threads that share a slot can read at the same time. Each reader waits (for a while)
+    // until the other is also inside.
+    br_sem one_slot( 1 );
+    std::atomic<int> inside( 0 );
+    std::atomic<int> together( 0 );
+    std::vector<std::thread> readers;
+    for( int t = 0; t < 2; ++t ) {
+        readers.emplace_back( [&]( ) {
+            br_sem::read_grabber critical( one_slot );
+            inside++;
+            for( int i = 0; i < 2000 && inside.load( ) < 2; ++i ) {
+                std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+            }
+            if( inside.load( ) == 2 ) together++;
+        } );
+    }
+    for( std::thread &t : readers ) t.join( );
+    UNIT_CHECK( together == 2 );
+
+    reader_writer_exercise( lock );
+    reader_writer_exercise( one_slot );
+}
+
+
+bool synchronize_tests( )
+{
+    statistics_test( );
+    spinning_test( );
+    rw_sem_test( );
+    br_sem_test( );
+    return true;
+}
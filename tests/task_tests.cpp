@@ -0,0 +1,168 @@
+/*! \file    task_tests.cpp
+ *  \brief   Exercise spica::task and the related awaitables.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <chrono>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "../task.hpp"
+#include "../WorkQueue.hpp"
+#include "../u_tests.hpp"
+#include "../UnitTestManager.hpp"
+
+using namespace spica;
+
+// A minimal executor with a single thread. ThreadPool is not used here so that these tests
+// don't depend on boost.
+class test_executor {
+public:
+    test_executor( ) : jobs( 1024 ), worker( [this]( ) { run( ); } ) { }
+
+   ~test_executor( )
+    {
+        jobs.push( std::function< void( ) >( ) );
+        worker.join( );
+    }
+
+    void post( std::function< void( ) > work ) { jobs.push( std::move( work ) ); }
+
+    std::thread::id id( ) const { return worker.get_id( ); }
+
+private:
+    WorkQueue< std::function< void( ) > > jobs;
+    std::thread worker;
+
+    // An empty function tells the worker to stop.
+    void run( )
+    {
+        std::function< void( ) > work;
+        for( jobs.pop( work ); work; jobs.pop( work ) ) work( );
+    }
+};
+
+
+static task< int > forty_two( )
+{
+    co_return 42;
+}
+
+static task< int > add_one( task< int > inner )
+{
+    int value = co_await inner;
+    co_return value + 1;
+}
+
+static task< > fail( )
+{
+    throw std::runtime_error( "failed" );
+    co_return;
+}
+
+
+static void basic_test( )
+{
+    UnitTestManager::UnitTest test( "basic" );
+
+    UNIT_CHECK( sync_wait( forty_two( ) ) == 42 );
+    UNIT_CHECK( sync_wait( add_one( add_one( forty_two( ) ) ) ) == 44 );
+
+    // Tasks are lazy.
+    bool started = false;
+    auto lazy = [&started]( ) -> task< > { started = true; co_return; };
+    task< > pending = lazy( );
+    UNIT_CHECK( !started );
+    UNIT_CHECK( !pending.done( ) );
+    sync_wait( std::move( pending ) );
+    UNIT_CHECK( started );
+
+    bool caught = false;
+    try {
+        sync_wait( fail( ) );
+    }
+    catch( const std::runtime_error & ) {
+        caught = true;
+    }
+    UNIT_CHECK( caught );
+}
+
+
+static task< bool > switch_threads( test_executor &executor )
+{
+    co_await schedule_on( executor );
+    co_return std::this_thread::get_id( ) == executor.id( );
+}
+
+
+static void schedule_test( )
+{
+    UnitTestManager::UnitTest test( "schedule_on" );
+
+    test_executor executor;
+    UNIT_CHECK( sync_wait( switch_threads( executor ) ) );
+}
+
+
+static task< long > timed_sleep( test_executor &executor, long milliseconds )
+{
+    auto start = std::chrono::steady_clock::now( );
+    co_await sleep_for( executor, milliseconds );
+    co_return std::chrono::duration_cast< std::chrono::milliseconds >(
+        std::chrono::steady_clock::now( ) - start ).count( );
+}
+
+
+static void sleep_test( )
+{
+    UnitTestManager::UnitTest test( "sleep_for" );
+
+    test_executor executor;
+    UNIT_CHECK( sync_wait( timed_sleep( executor, 20 ) ) >= 20 );
+}
+
+
+static task< int > sum_items( WorkQueue< int > &queue, test_executor &executor, int count )
+{
+    int sum = 0;
+    for( int i = 0; i < count; ++i ) {
+        sum += co_await queue.pop_async( executor );
+    }
+    co_return sum;
+}
+
+
+static void pop_async_test( )
+{
+    UnitTestManager::UnitTest test( "pop_async" );
+
+    test_executor executor;
+    WorkQueue< int > queue( 16 );
+
+    // Items already in the queue are taken without suspending.
+    queue.push( 1 );
+    queue.push( 2 );
+    UNIT_CHECK( sync_wait( sum_items( queue, executor, 2 ) ) == 3 );
+    UNIT_CHECK( queue.empty( ) );
+
+    // Items pushed later are handed to the waiting coroutine.
+    const int count = 10000;
+    std::thread producer( [&queue]( ) {
+        for( int i = 1; i <= count; ++i ) queue.push( i );
+    } );
+    UNIT_CHECK( sync_wait( sum_items( queue, executor, count ) ) == count * ( count + 1 ) / 2 );
+    producer.join( );
+    UNIT_CHECK( queue.empty( ) );
+}
+
+
+bool task_tests( )
+{
+    basic_test( );
+    schedule_test( );
+    sleep_test( );
+    pop_async_test( );
+    return true;
+}
@@ -28,9 +28,24 @@ int main( int argc, char **argv )
 
     UnitTestManager::register_suite( BinomialHeap_tests, "BinomialHeap Tests" );
     UnitTestManager::register_suite( BoundedList_tests, "BoundedList Tests" );
+    UnitTestManager::register_suite( BTree_tests, "BTree Tests" );
+    UnitTestManager::register_suite( ConcurrentBoundedList_tests, "ConcurrentBoundedList Tests" );
+    UnitTestManager::register_suite( ConcurrentHashMap_tests, "ConcurrentHashMap Tests" );
+    UnitTestManager::register_suite( FileHashIndex_tests, "FileHashIndex Tests" );
+    UnitTestManager::register_suite( FileVector_tests, "FileVector Tests" );
     UnitTestManager::register_suite( Graph_tests, "Graph Tests" );
+    UnitTestManager::register_suite( HashMapFlat_tests, "HashMapFlat Tests" );
+    UnitTestManager::register_suite( HashtableOpen_tests, "HashtableOpen Tests" );
+    UnitTestManager::register_suite( Heap_tests, "Heap Tests" );
+    UnitTestManager::register_suite( lock_profile_tests, "Lock Profile Tests" );
+    UnitTestManager::register_suite( PoolAllocator_tests, "PoolAllocator Tests" );
     UnitTestManager::register_suite( sort_tests, "Sorting Algorithms" );
+    UnitTestManager::register_suite( synchronize_tests, "Synchronization Tests" );
+    UnitTestManager::register_suite( task_tests, "Task Tests" );
+    UnitTestManager::register_suite( Tree_tests, "BinaryTree Tests" );
+    UnitTestManager::register_suite( UnrolledList_tests, "UnrolledList Tests" );
     UnitTestManager::register_suite( VeryLong_tests, "VeryLong Tests" );
+    UnitTestManager::register_suite( WorkQueue_tests, "WorkQueue Tests" );
 
     // TODO: The following tests are interactive, which is not ideal. They're better than nothing.
     UnitTestManager::register_suite( RexxString_tests, "RexxString Tests" );
@@ -8,11 +8,26 @@
 
 extern bool BinomialHeap_tests( );
 extern bool BoundedList_tests( );
+extern bool BTree_tests( );
+extern bool ConcurrentBoundedList_tests( );
+extern bool ConcurrentHashMap_tests( );
+extern bool FileHashIndex_tests( );
+extern bool FileVector_tests( );
 extern bool Graph_tests( );
+extern bool HashMapFlat_tests( );
+extern bool HashtableOpen_tests( );
+extern bool Heap_tests( );
+extern bool lock_profile_tests( );
+extern bool PoolAllocator_tests( );
 extern bool RexxString_tests( );
 extern bool sort_tests( );
+extern bool synchronize_tests( );
+extern bool task_tests( );
 extern bool Timer_tests( );
+extern bool Tree_tests( );
+extern bool UnrolledList_tests( );
 extern bool VeryLong_tests( );
+extern bool WorkQueue_tests( );
 
 #endif
 